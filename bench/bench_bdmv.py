@@ -0,0 +1,133 @@
+"""
+Time opening, walking, serializing and reading the synthetic discs of fixtures.py.
+
+Usage: python3 bench/bench_bdmv.py [--fixtures DIR] [--json FILE] [--rounds N] [preset ...]
+
+Every preset is opened as a BDMV directory, as a UDF image through libbluray's own reader and
+as an image through the mmap backend.  The best and median of N rounds are printed and, with
+--json, written out with the module version and kernels so runs can be compared later.
+"""
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import sys
+import tempfile
+import time
+
+import _bluread
+import bluread
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import fixtures
+
+# How each fixture is opened: (name, use the image, Open() arguments)
+FORMS = [
+	('tree', False, {}),
+	('udf', True, {}),
+	('mmap', True, {'backend': 'mmap'}),
+]
+
+def Time(func, rounds):
+	"""Runs @func @rounds times, returns (best, median) seconds"""
+	times = []
+	for i in range(rounds):
+		t = time.perf_counter()
+		func()
+		times.append(time.perf_counter() - t)
+	return min(times), statistics.median(times)
+
+def Open(path, kw):
+	b = bluread.Bluray(path)
+	b.Open(**kw)
+	return b
+
+def Walk(b):
+	"""Touches every title, chapter, clip and stream the way BRToXML() does, returns how many objects it made"""
+	n = 0
+	for tnum in range(b.NumberOfTitles):
+		t = b.GetTitle(tnum)
+		t.Length, t.NumberOfAngles
+		for cnum in range(1, t.NumberOfChapters + 1):
+			c = t.GetChapter(cnum)
+			c.Start, c.End, c.ClipNum
+		for cnum in range(t.NumberOfClips):
+			c = t.GetClip(cnum)
+			for s in range(c.NumberOfVideosPrimary):
+				v = c.GetVideo(s)
+				v.CodingType, v.Format, v.Rate, v.Aspect
+			for s in range(c.NumberOfAudiosPrimary):
+				a = c.GetAudio(s)
+				a.Language, a.CodingType, a.Format, a.Rate
+			for s in range(c.NumberOfSubtitles):
+				c.GetSubtitle(s).Language
+			n += 1 + c.NumberOfVideosPrimary + c.NumberOfAudiosPrimary + c.NumberOfSubtitles
+		n += 1 + t.NumberOfChapters
+	return n
+
+def Bench(preset, tree, image, rounds):
+	results = {}
+
+	def record(key, best, median, **extra):
+		results[key] = dict(best=best, median=median, rounds=rounds, **extra)
+		line = "%-34s best %9.3f ms  median %9.3f ms" % (key, best * 1e3, median * 1e3)
+		if 'bytes' in extra:
+			line += "  %8.1f MB/s" % (extra['bytes'] / best / 1e6)
+		if 'objects' in extra:
+			line += "  %8.0f objects/s" % (extra['objects'] / best)
+		print(line)
+
+	for form, useimage, kw in FORMS:
+		path = image if useimage else tree
+		key = '%s/%s' % (preset, form)
+
+		record(key + '/open', *Time(lambda: Open(path, kw).Close(), rounds))
+
+		b = Open(path, kw)
+		record(key + '/walk', *Time(lambda: Walk(b), rounds), objects=Walk(b))
+
+		# The longest title, read through libbluray as a player would
+		if b.NumberOfTitles:
+			main = b.GetTitle(b.MainTitleNumber)
+			size = [0]
+			def read():
+				size[0] = _bluread.Title.Copy(main, os.devnull)['Size']
+			best, median = Time(read, rounds)
+			record(key + '/read', best, median, bytes=size[0])
+		b.Close()
+
+		if not kw:
+			record(key + '/xml', *Time(lambda: bluread.BRToXML(path, None), rounds))
+
+	return results
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+	parser.add_argument('presets', nargs='*', default=sorted(fixtures.PRESETS), help='fixture presets to run (default all)')
+	parser.add_argument('--fixtures', default=os.path.join(tempfile.gettempdir(), 'bluread-fixtures'), help='where fixtures are made and kept')
+	parser.add_argument('--json', help='write the results to this file')
+	parser.add_argument('--rounds', type=int, default=5)
+	args = parser.parse_args()
+
+	report = {
+		'version': _bluread.Version,
+		'python': platform.python_version(),
+		'machine': platform.machine(),
+		'packetkernel': _bluread.PacketKernel,
+		'zerokernel': _bluread.ZeroKernel,
+		'rounds': args.rounds,
+		'results': {},
+	}
+
+	for preset in args.presets:
+		tree, image = fixtures.Fixture(args.fixtures, preset)
+		report['results'].update(Bench(preset, tree, image, args.rounds))
+
+	if args.json:
+		with open(args.json, 'w') as f:
+			json.dump(report, f, indent=1, sort_keys=True)
+
+if __name__ == '__main__':
+	main()
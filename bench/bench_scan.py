@@ -0,0 +1,53 @@
+"""
+Benchmark the BDAV packet scan kernels against the scalar loop.
+
+Usage: python3 bench/bench_scan.py [megabytes]
+"""
+
+import sys
+import time
+
+import _bluread
+
+
+def MakePackets(size):
+	"""
+	Build roughly @size bytes of BDAV packets cycling through a typical video/audio/PG PID mix.
+	"""
+	pids = [0x1011]*12 + [0x1100, 0x1101, 0x1200]
+	pkts = bytearray()
+	for pid in pids:
+		pkts += b'\0\0\0\0' + bytes([0x47, 0x40 | (pid >> 8), pid & 0xFF, 0x10]) + b'\xff'*184
+
+	return bytes(pkts) * max(1, size // len(pkts))
+
+def Time(data, kernel, rounds=5):
+	best = None
+	for i in range(rounds):
+		t = time.perf_counter()
+		_bluread.ScanPackets(data, Kernel=kernel)
+		t = time.perf_counter() - t
+
+		if best is None or t < best:
+			best = t
+
+	return best
+
+def main():
+	mb = int(sys.argv[1]) if len(sys.argv) > 1 else 256
+	data = MakePackets(mb*1024*1024)
+
+	print("Default kernel: %s" % _bluread.PacketKernel)
+
+	scalar = Time(data, 'scalar')
+	for kernel in ['scalar', 'sse4', 'avx2']:
+		try:
+			t = Time(data, kernel)
+		except ValueError:
+			print("%-8s unsupported" % kernel)
+			continue
+
+		print("%-8s %8.1f MB/s  %5.2fx" % (kernel, len(data)/t/1e6, scalar/t))
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,617 @@
+"""
+Synthetic Blu-ray fixtures for the benchmarks.
+
+Writes BDMV trees that libbluray parses like a pressed disc (index.bdmv, MovieObject.bdmv,
+MPLS playlists with chapters, angles and stream tables, CLPI clip info with program info and
+EP maps, and M2TS streams of real BDAV packets), and UDF 2.50 images of them with a metadata
+partition as on BD-ROM, so opening, title parsing and reads can be timed without a disc.
+
+Usage: python3 bench/fixtures.py outdir [preset ...]
+
+Each preset becomes outdir/<preset>/ (the BDMV tree) and outdir/<preset>.iso.
+"""
+
+import os
+import random
+import struct
+import sys
+import zlib
+
+SECTOR = 2048
+PACKET = 192
+UNIT = 32 * PACKET      # aligned unit, M2TS files are read in these
+TICKS = 45000           # playlist and clip times are in 45 kHz ticks
+
+PID_PAT = 0x0000
+PID_PMT = 0x0100
+PID_VIDEO = 0x1011
+PID_AUDIO = 0x1100
+PID_PG = 0x1200
+
+LANGUAGES = ['eng', 'fra', 'deu', 'spa', 'ita', 'jpn', 'por', 'nld', 'swe', 'dan', 'fin', 'nor', 'pol', 'ces', 'hun', 'rus', 'kor', 'zho', 'tha', 'tur']
+
+# playlists, clips per angle, play items per playlist, chapters per playlist, angles,
+# audio and subtitle streams, seconds and bytes of each clip
+PRESETS = {
+	'small': dict(playlists=4, clips=4, items=1, chapters=8, angles=1, audio=2, subtitles=2, seconds=120, clipsize=1 << 20),
+	'feature': dict(playlists=40, clips=30, items=2, chapters=24, angles=1, audio=6, subtitles=16, seconds=600, clipsize=1 << 20),
+	'angles': dict(playlists=6, clips=8, items=4, chapters=16, angles=3, audio=3, subtitles=6, seconds=300, clipsize=1 << 20),
+	# Obfuscated releases bury the feature among hundreds of playlists of the same clips shuffled
+	'obfuscated': dict(playlists=800, clips=120, items=40, chapters=30, angles=1, audio=4, subtitles=10, seconds=150, clipsize=256 << 10, shuffle=True),
+	'stream': dict(playlists=1, clips=2, items=2, chapters=12, angles=1, audio=2, subtitles=2, seconds=1800, clipsize=96 << 20),
+}
+
+# --------------------------------------------------------------------------------
+# Bits and checksums
+
+class Bits:
+	"""Big endian bit writer for the BDMV structures, which are specified field by field in bits"""
+	def __init__(self):
+		self.acc = 0
+		self.n = 0
+		self.out = bytearray()
+
+	def put(self, bits, value):
+		self.acc = (self.acc << bits) | (value & ((1 << bits) - 1))
+		self.n += bits
+		while self.n >= 8:
+			self.n -= 8
+			self.out.append((self.acc >> self.n) & 0xFF)
+		self.acc &= (1 << self.n) - 1
+		return self
+
+	def raw(self, data):
+		assert self.n == 0
+		self.out += data
+		return self
+
+	def bytes(self):
+		assert self.n == 0
+		return bytes(self.out)
+
+def _crc32mpeg(data):
+	crc = 0xFFFFFFFF
+	for b in data:
+		crc ^= b << 24
+		for i in range(8):
+			crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+			crc &= 0xFFFFFFFF
+	return crc
+
+_CRC16 = []
+for i in range(256):
+	c = i << 8
+	for j in range(8):
+		c = ((c << 1) ^ 0x1021) if c & 0x8000 else (c << 1)
+	_CRC16.append(c & 0xFFFF)
+
+def _crc16(data):
+	crc = 0
+	for b in data:
+		crc = ((crc << 8) & 0xFFFF) ^ _CRC16[(crc >> 8) ^ b]
+	return crc
+
+# --------------------------------------------------------------------------------
+# BDMV files
+
+def _streams(spec):
+	"""(pid, coding type, language) of every elementary stream in a clip"""
+	streams = [(PID_VIDEO, 0x1B, None)]
+	streams += [(PID_AUDIO + i, 0x81, LANGUAGES[i % len(LANGUAGES)]) for i in range(spec['audio'])]
+	streams += [(PID_PG + i, 0x90, LANGUAGES[i % len(LANGUAGES)]) for i in range(spec['subtitles'])]
+	return streams
+
+def _attributes(coding, lang):
+	"""Stream coding attributes, laid out the same in STN tables and clip program info"""
+	b = Bits().put(8, coding)
+	if coding == 0x1B:
+		b.put(4, 6).put(4, 1)                       # 1080p, 23.976
+	elif coding == 0x81:
+		b.put(4, 6).put(4, 1).raw(lang.encode())    # multichannel, 48 kHz
+	else:
+		b.raw(lang.encode())
+	return b.bytes()
+
+def _clipstart(clip):
+	# Presentation times start some way into the clock as on discs, each clip on its own
+	return (600 + clip) * TICKS
+
+def MakeIndex(titles):
+	"""index.bdmv: first play and top menu run movie objects, title N plays playlist N"""
+	indexes = Bits()
+	indexes.put(2, 1).put(30, 0).put(2, 0).put(14, 0).put(16, titles).put(32, 0)      # first play
+	indexes.put(2, 1).put(30, 0).put(2, 0).put(14, 0).put(16, titles).put(32, 0)      # top menu
+	indexes.put(16, titles)
+	for t in range(titles):
+		indexes.put(2, 1).put(2, 0).put(28, 0).put(2, 0).put(14, 0).put(16, t).put(32, 0)
+	indexes = indexes.bytes()
+
+	appinfo = struct.pack('>I', 34) + b'\0' * 34
+	start = 40 + len(appinfo)
+	return b'INDX0200' + struct.pack('>II', start, 0) + b'\0' * 24 + appinfo + struct.pack('>I', len(indexes)) + indexes
+
+def MakeMovieObject(titles):
+	"""MovieObject.bdmv: object N plays playlist N, the last one is an empty menu"""
+	objs = Bits().put(32, 0).put(16, titles + 1)
+	for t in range(titles + 1):
+		cmds = 1 if t < titles else 0
+		objs.put(1, 1).put(1, 0).put(1, 0).put(13, 0).put(16, cmds)
+		if cmds:
+			# PLAY_PL with an immediate playlist number
+			objs.raw(bytes([0x22, 0x80, 0, 0]) + struct.pack('>II', t, 0))
+	objs = objs.bytes()
+	return b'MOBJ0200' + struct.pack('>I', 0) + b'\0' * 28 + struct.pack('>I', len(objs)) + objs
+
+def MakePlaylist(spec, items):
+	"""
+	An MPLS playlist playing @items, a list of (clip numbers per angle, in ticks, out ticks).
+	"""
+	streams = _streams(spec)
+	video = [s for s in streams if s[1] == 0x1B]
+	audio = [s for s in streams if s[1] == 0x81]
+	pg = [s for s in streams if s[1] == 0x90]
+
+	stn = Bits().put(16, 0)
+	stn.put(8, len(video)).put(8, len(audio)).put(8, len(pg)).put(8, 0).put(8, 0).put(8, 0).put(8, 0).put(8, 0).put(32, 0)
+	for pid, coding, lang in video + audio + pg:
+		stn.put(8, 9).put(8, 1).put(16, pid).raw(b'\0' * 6)
+		attr = _attributes(coding, lang)
+		attr += b'\0' * (5 - len(attr))
+		stn.put(8, len(attr)).raw(attr)
+	stn = stn.bytes()
+	stn = struct.pack('>H', len(stn)) + stn
+
+	pl = Bits().put(16, 0).put(16, len(items)).put(16, 0)
+	for clips, tin, tout in items:
+		pi = Bits().raw(b'%05dM2TS' % clips[0])
+		pi.put(11, 0).put(1, len(clips) > 1).put(4, 1).put(8, 0)
+		pi.put(32, tin).put(32, tout).raw(b'\0' * 8)
+		pi.put(1, 0).put(7, 0).put(8, 0).put(16, 0)
+		if len(clips) > 1:
+			pi.put(8, len(clips)).put(6, 0).put(1, 0).put(1, 1)
+			for c in clips[1:]:
+				pi.raw(b'%05dM2TS' % c).put(8, 0)
+		pi = pi.bytes() + stn
+		pl.raw(struct.pack('>H', len(pi)) + pi)
+	pl = pl.bytes()
+
+	# Chapters spread evenly over the whole playlist
+	total = sum(tout - tin for clips, tin, tout in items)
+	marks = Bits().put(16, spec['chapters'])
+	for m in range(spec['chapters']):
+		at = total * m // spec['chapters']
+		for i, (clips, tin, tout) in enumerate(items):
+			if at < tout - tin or i == len(items) - 1:
+				break
+			at -= tout - tin
+		marks.put(8, 0).put(8, 1).put(16, i).put(32, tin + at).put(16, 0xFFFF).put(32, 0)
+	marks = marks.bytes()
+
+	appinfo = Bits().put(8, 0).put(8, 1).put(16, 0).raw(b'\0' * 8).put(16, 0).bytes()
+	appinfo = struct.pack('>I', len(appinfo)) + appinfo
+
+	plstart = 40 + len(appinfo)
+	mkstart = plstart + 4 + len(pl)
+	return b'MPLS0200' + struct.pack('>III', plstart, mkstart, 0) + b'\0' * 20 + appinfo + struct.pack('>I', len(pl)) + pl + struct.pack('>I', len(marks)) + marks
+
+def MakeClipInfo(spec, clip, packets):
+	"""CLPI for clip number @clip of @packets source packets, with an EP map entry a second"""
+	start = _clipstart(clip)
+	end = start + spec['seconds'] * TICKS
+	rate = packets * PACKET * 8 // max(1, spec['seconds'])
+
+	info = Bits().put(16, 0).put(8, 1).put(8, 1).put(31, 0).put(1, 0)
+	info.put(32, rate // 8).put(32, packets).raw(b'\0' * 128)
+	info.put(16, 0)                                             # no TS type info block
+	info = info.bytes()
+
+	seq = Bits().put(8, 0).put(8, 1).put(32, 0).put(8, 1).put(8, 0)
+	seq.put(16, PID_VIDEO).put(32, 0).put(32, start).put(32, end)
+	seq = seq.bytes()
+
+	streams = _streams(spec)
+	prog = Bits().put(8, 0).put(8, 1).put(32, 0).put(16, PID_PMT).put(8, len(streams)).put(8, 0)
+	for pid, coding, lang in streams:
+		attr = _attributes(coding, lang)
+		if coding == 0x1B:
+			attr += bytes([0x30])                               # 16:9
+		attr += b'\0' * (21 - len(attr))
+		prog.put(16, pid).put(8, len(attr)).raw(attr)
+	prog = prog.bytes()
+
+	# EP map for the video PID, a coarse entry per fine one keeps the lookups exact
+	n = max(1, spec['seconds'])
+	eps = [(2 * (start + i * TICKS), packets * i // n) for i in range(n)]
+	coarse = Bits()
+	fine = Bits()
+	for i, (pts, spn) in enumerate(eps):
+		coarse.put(18, i).put(14, pts >> 19).put(32, spn)
+		fine.put(1, 0).put(3, 1).put(11, pts >> 9).put(17, spn)
+	coarse = coarse.bytes()
+	fine = fine.bytes()
+	epmap = Bits().put(8, 0).put(8, 1).put(16, PID_VIDEO).put(10, 0).put(4, 1).put(16, n).put(18, n).put(32, 14).bytes()
+	epmap += struct.pack('>I', 4 + len(coarse)) + coarse + fine
+	cpi = Bits().put(12, 0).put(4, 1).bytes() + epmap
+
+	body = b''
+	offsets = []
+	for section in (seq, prog, cpi, b''):
+		offsets.append(40 + 4 + len(info) + len(body))
+		body += struct.pack('>I', len(section)) + section
+	return b'HDMV0200' + struct.pack('>IIIII', offsets[0], offsets[1], offsets[2], offsets[3], 0) + b'\0' * 12 + struct.pack('>I', len(info)) + info + body
+
+def _section(pid, cc, table):
+	"""A TS packet carrying one PSI section, with its CRC"""
+	table += struct.pack('>I', _crc32mpeg(table))
+	ts = bytes([0x47, 0x40 | (pid >> 8), pid & 0xFF, 0x10 | cc]) + b'\0' + table
+	return ts + b'\xff' * (188 - len(ts))
+
+def MakeStreamBlock(spec, rng):
+	"""
+	512 source packets: PAT and PMT, then video with the audio and subtitle PIDs mixed in, each
+	PID a multiple of 16 times so the continuity counters still run on when the block repeats.
+	"""
+	streams = _streams(spec)
+	pat = struct.pack('>BHHBBBHH', 0x00, 0xB000 | 13, 1, 0xC1, 0, 0, 1, 0xE000 | PID_PMT)
+	es = b''
+	for pid, coding, lang in streams:
+		es += struct.pack('>BHH', coding, 0xE000 | pid, 0xF000)
+	pmt = struct.pack('>BHHBBBHH', 0x02, 0xB000 | (13 + len(es)), 1, 0xC1, 0, 0, 0xE000 | PID_VIDEO, 0xF000) + es
+
+	group = [PID_PAT, PID_PMT] + [s[0] for s in streams[1:]]
+	group = (group + [PID_VIDEO] * 32)[:32]
+	payload = bytes(rng.getrandbits(8) for i in range(4096))
+
+	cc = {}
+	block = bytearray()
+	for n in range(512):
+		pid = group[n % 32]
+		c = cc.get(pid, 0)
+		cc[pid] = (c + 1) & 15
+		if pid == PID_PAT:
+			ts = _section(pid, c, pat)
+		elif pid == PID_PMT:
+			ts = _section(pid, c, pmt)
+		else:
+			off = (n * 184) % (len(payload) - 184)
+			ts = bytes([0x47, pid >> 8, pid & 0xFF, 0x10 | c]) + payload[off:off + 184]
+		block += struct.pack('>I', (n * 1024) & 0x3FFFFFFF) + ts
+	return bytes(block)
+
+def _layout(spec, rng):
+	"""(clip numbers per angle, in, out) play items of every playlist"""
+	playlists = []
+	for p in range(spec['playlists']):
+		if spec.get('shuffle'):
+			order = rng.sample(range(spec['clips']), spec['items'])
+		else:
+			order = [(p * spec['items'] + i) % spec['clips'] for i in range(spec['items'])]
+
+		items = []
+		for c in order:
+			clips = [c + a * spec['clips'] for a in range(spec['angles'])]
+			start = _clipstart(c)
+			items.append((clips, start, start + spec['seconds'] * TICKS))
+		playlists.append(items)
+	return playlists
+
+def WriteTree(root, spec, seed=1):
+	"""Writes the BDMV tree of @spec under @root, returns the number of bytes written"""
+	rng = random.Random(seed)
+	for d in ('BDMV/PLAYLIST', 'BDMV/CLIPINF', 'BDMV/STREAM', 'BDMV/AUXDATA', 'BDMV/BDJO', 'BDMV/JAR', 'BDMV/META',
+			'BDMV/BACKUP/PLAYLIST', 'BDMV/BACKUP/CLIPINF', 'BDMV/BACKUP/BDJO', 'CERTIFICATE/BACKUP'):
+		os.makedirs(os.path.join(root, d), exist_ok=True)
+
+	files = {}
+	titles = min(spec['playlists'], 100)
+	files['BDMV/index.bdmv'] = MakeIndex(titles)
+	files['BDMV/MovieObject.bdmv'] = MakeMovieObject(titles)
+
+	for p, items in enumerate(_layout(spec, rng)):
+		files['BDMV/PLAYLIST/%05d.mpls' % p] = MakePlaylist(spec, items)
+
+	packets = max(UNIT, spec['clipsize'] // UNIT * UNIT) // PACKET
+	for c in range(spec['clips'] * spec['angles']):
+		files['BDMV/CLIPINF/%05d.clpi' % c] = MakeClipInfo(spec, c % spec['clips'], packets)
+
+	# Discs carry a copy of everything but the streams under BDMV/BACKUP
+	total = 0
+	for name, data in files.items():
+		for path in (name, name.replace('BDMV/', 'BDMV/BACKUP/', 1)):
+			with open(os.path.join(root, path), 'wb') as f:
+				f.write(data)
+			total += len(data)
+
+	block = MakeStreamBlock(spec, rng)
+	for c in range(spec['clips'] * spec['angles']):
+		with open(os.path.join(root, 'BDMV/STREAM/%05d.m2ts' % c), 'wb') as f:
+			left = packets * PACKET
+			while left > 0:
+				n = min(left, len(block))
+				f.write(block[:n])
+				left -= n
+		total += packets * PACKET
+
+	return total
+
+# --------------------------------------------------------------------------------
+# UDF 2.50 image
+
+def _tag(ident, loc, body):
+	"""Fills in the 16 byte descriptor tag at the start of @body"""
+	b = bytearray(body)
+	struct.pack_into('<HHBBHHHI', b, 0, ident, 3, 0, 0, 1, _crc16(b[16:]), len(b) - 16, loc)
+	b[4] = sum(b[0:4] + b[5:16]) & 0xFF
+	return bytes(b)
+
+def _dstring(s, size):
+	d = bytearray(size)
+	e = b'\x08' + s.encode('latin-1')[:size - 2]
+	d[:len(e)] = e
+	d[size - 1] = len(e)
+	return bytes(d)
+
+def _regid(ident, suffix=b''):
+	return b'\0' + ident.encode().ljust(23, b'\0') + suffix.ljust(8, b'\0')
+
+def _charspec():
+	return b'\0' + b'OSTA Compressed Unicode'.ljust(63, b'\0')
+
+def _timestamp():
+	return struct.pack('<HHBBBBBBBB', 0x1000, 2020, 1, 1, 0, 0, 0, 0, 0, 0)
+
+_UDF250 = struct.pack('<HB', 0x0250, 0)
+
+def _fe(loc, filetype, size, ads, adtype, uid):
+	"""A file entry of @size bytes with allocation descriptors @ads"""
+	b = bytearray(176)
+	# ICB tag: strategy 4, one entry, file type, AD type in the flags
+	struct.pack_into('<IHHHBB', b, 16, 0, 4, 0, 1, 0, filetype)
+	struct.pack_into('<H', b, 34, adtype)
+	struct.pack_into('<IIIH', b, 36, 0xFFFFFFFF, 0xFFFFFFFF, 0x14A5 if filetype == 4 else 0x1084, 1)
+	struct.pack_into('<QQ', b, 56, size, (size + SECTOR - 1) // SECTOR if adtype != 3 else 0)
+	b[72:84] = b[84:96] = b[96:108] = _timestamp()
+	struct.pack_into('<I', b, 108, 1)
+	b[128:160] = _regid('*bluread')
+	struct.pack_into('<QII', b, 160, uid, 0, len(ads))
+	return _tag(261, loc, bytes(b) + ads)
+
+def _fid(name, icb, part, isdir, parent=False):
+	fi = b'' if parent else b'\x08' + name.encode('latin-1')
+	b = bytearray(38)
+	struct.pack_into('<HBB', b, 16, 1, (0x08 if parent else 0) | (0x02 if isdir else 0), len(fi))
+	struct.pack_into('<IIH', b, 20, SECTOR, icb, part)
+	b = bytes(b) + fi
+	return b + b'\0' * ((-len(b)) % 4)
+
+def WriteUDF(root, path, label='BLUREAD_FIXTURE'):
+	"""
+	Writes the files under @root into a UDF 2.50 image at @path: volume descriptors, a metadata
+	partition holding the file set, directories and file entries, and the file data after it,
+	each file in one extent as on pressed discs.
+	"""
+	# Walk the tree, directories get their entries in name order
+	dirs = []
+	files = []
+	def walk(rel, parent):
+		me = len(dirs)
+		dirs.append({'rel': rel, 'parent': parent, 'children': []})
+		for name in sorted(os.listdir(os.path.join(root, rel))):
+			p = os.path.join(rel, name)
+			if os.path.isdir(os.path.join(root, p)):
+				dirs[me]['children'].append((name, 'dir', walk(p, me)))
+			else:
+				files.append({'rel': p, 'size': os.path.getsize(os.path.join(root, p))})
+				dirs[me]['children'].append((name, 'file', len(files) - 1))
+		return me
+	walk('', 0)
+
+	# Metadata partition blocks: FSD, its terminator, a file entry per directory and file, then directory data
+	meta = {}
+	nextmeta = 2
+	for d in dirs:
+		d['icb'] = nextmeta
+		nextmeta += 1
+	for f in files:
+		f['icb'] = nextmeta
+		nextmeta += 1
+
+	# Directory data sizes only depend on names, so their blocks can be placed before filling them
+	for d in dirs:
+		size = len(_fid('', 0, 1, True, parent=True))
+		for name, kind, idx in d['children']:
+			size += len(_fid(name, 0, 1, kind == 'dir'))
+		d['size'] = size
+		d['data'] = nextmeta
+		nextmeta += (size + SECTOR - 1) // SECTOR
+
+	metablocks = (nextmeta + 31) // 32 * 32
+
+	# Physical partition: metadata file and mirror entries, their contents, then the file data
+	P = 288
+	phys_meta = 2
+	phys_mirror = phys_meta + metablocks
+	nextdata = phys_mirror + metablocks
+	for f in files:
+		f['lb'] = nextdata
+		nextdata += (f['size'] + SECTOR - 1) // SECTOR
+	plen = nextdata
+
+	uid = 16
+	for i, d in enumerate(dirs):
+		data = _fid('', dirs[d['parent']]['icb'], 1, True, parent=True)
+		for name, kind, idx in d['children']:
+			icb = dirs[idx]['icb'] if kind == 'dir' else files[idx]['icb']
+			data += _fid(name, icb, 1, kind == 'dir')
+		# Each identifier is tagged with the block it starts in
+		out = bytearray()
+		pos = 0
+		while pos < len(data):
+			n = 38 + data[pos + 19] + struct.unpack_from('<H', data, pos + 36)[0]
+			n += (-n) % 4
+			out += _tag(257, d['data'] + len(out) // SECTOR, data[pos:pos + n])
+			pos += n
+		for b in range(0, len(out), SECTOR):
+			meta[d['data'] + b // SECTOR] = bytes(out[b:b + SECTOR])
+
+		ads = struct.pack('<II', d['size'], d['data'])
+		meta[d['icb']] = _fe(d['icb'], 4, d['size'], ads, 0, 0 if i == 0 else uid)
+		uid += 1
+
+	for f in files:
+		ads = b''
+		left = f['size']
+		lb = f['lb']
+		while left > 0 or not ads:
+			# Extent lengths must stay under 1 GiB and whole blocks but for the last
+			n = min(left, 0x3FFFF800)
+			ads += struct.pack('<II', n, lb)
+			lb += n // SECTOR
+			left -= n
+			if left == 0:
+				break
+		meta[f['icb']] = _fe(f['icb'], 5, f['size'], ads, 0, uid)
+		uid += 1
+
+	fsd = bytearray(512)
+	fsd[16:28] = _timestamp()
+	struct.pack_into('<HHII', fsd, 28, 3, 3, 1, 1)
+	fsd[48:112] = _charspec()
+	fsd[112:240] = _dstring(label, 128)
+	fsd[240:304] = _charspec()
+	fsd[304:336] = _dstring(label, 32)
+	struct.pack_into('<IIH', fsd, 400, SECTOR, dirs[0]['icb'], 1)
+	fsd[416:448] = _regid('*OSTA UDF Compliant', _UDF250)
+	meta[0] = _tag(256, 0, bytes(fsd))
+	meta[1] = _tag(8, 1, bytes(512))
+
+	metadata = bytearray(metablocks * SECTOR)
+	for lb, data in meta.items():
+		metadata[lb * SECTOR:lb * SECTOR + len(data)] = data
+
+	# Volume descriptors
+	vds = {}
+	pvd = bytearray(512)
+	struct.pack_into('<II', pvd, 16, 1, 0)
+	pvd[24:56] = _dstring(label, 32)
+	struct.pack_into('<HHHHII', pvd, 56, 1, 1, 2, 3, 1, 1)
+	pvd[72:200] = _dstring('%016X' % zlib.crc32(label.encode()) + label, 128)
+	pvd[200:264] = _charspec()
+	pvd[264:328] = _charspec()
+	pvd[344:376] = _regid('*bluread')
+	pvd[376:388] = _timestamp()
+	pvd[388:420] = _regid('*bluread')
+	vds[0] = (1, pvd)
+
+	iuvd = bytearray(512)
+	struct.pack_into('<I', iuvd, 16, 2)
+	iuvd[20:52] = _regid('*UDF LV Info', _UDF250)
+	iuvd[52:116] = _charspec()
+	iuvd[116:244] = _dstring(label, 128)
+	iuvd[352:384] = _regid('*bluread')
+	vds[1] = (4, iuvd)
+
+	pd = bytearray(512)
+	struct.pack_into('<IHH', pd, 16, 3, 1, 0)
+	pd[24:56] = _regid('+NSR03')
+	struct.pack_into('<III', pd, 184, 1, P, plen)
+	pd[196:228] = _regid('*bluread')
+	vds[2] = (5, pd)
+
+	maps = struct.pack('<BBHH', 1, 6, 1, 0)
+	m2 = bytearray(64)
+	m2[0:2] = bytes([2, 64])
+	m2[4:36] = _regid('*UDF Metadata Partition', _UDF250)
+	struct.pack_into('<HHIIIIHB', m2, 36, 1, 0, 0, 1, 0xFFFFFFFF, 32, 32, 0)
+	maps += bytes(m2)
+	lvd = bytearray(440)
+	struct.pack_into('<I', lvd, 16, 4)
+	lvd[20:84] = _charspec()
+	lvd[84:212] = _dstring(label, 128)
+	struct.pack_into('<I', lvd, 212, SECTOR)
+	lvd[216:248] = _regid('*OSTA UDF Compliant', _UDF250)
+	struct.pack_into('<IIH', lvd, 248, SECTOR, 0, 1)
+	struct.pack_into('<II', lvd, 264, len(maps), 2)
+	lvd[272:304] = _regid('*bluread')
+	struct.pack_into('<II', lvd, 432, 2 * SECTOR, 64)
+	vds[3] = (6, bytes(lvd) + maps)
+
+	usd = bytearray(24)
+	struct.pack_into('<II', usd, 16, 5, 0)
+	vds[4] = (7, usd)
+	vds[5] = (8, bytearray(512))
+
+	lvid = bytearray(80)
+	lvid[16:28] = _timestamp()
+	struct.pack_into('<I', lvid, 28, 1)
+	struct.pack_into('<Q', lvid, 40, uid)
+	struct.pack_into('<II', lvid, 72, 2, 46)
+	lvid += struct.pack('<IIII', 0, 0, plen, plen)
+	lvid += _regid('*bluread') + struct.pack('<IIHHH', len(files), len(dirs), 0x0250, 0x0250, 0x0250)
+
+	total = P + plen + 1
+	with open(path, 'wb') as out:
+		def put(lba, data):
+			out.seek(lba * SECTOR)
+			out.write(data)
+
+		out.truncate(total * SECTOR)
+		for i, vsd in enumerate((b'BEA01', b'NSR03', b'TEA01')):
+			put(16 + i, b'\0' + vsd + b'\x01' + b'\0' * (SECTOR - 7))
+		for base in (32, 48):
+			for i, (ident, body) in vds.items():
+				put(base + i, _tag(ident, base + i, bytes(body)))
+		put(64, _tag(9, 64, bytes(lvid)))
+		put(65, _tag(8, 65, bytes(512)))
+
+		avdp = bytearray(512)
+		struct.pack_into('<IIII', avdp, 16, 16 * SECTOR, 32, 16 * SECTOR, 48)
+		put(256, _tag(2, 256, bytes(avdp)))
+		put(total - 1, _tag(2, total - 1, bytes(avdp)))
+
+		# Metadata file and its mirror, each one extent in the physical partition
+		put(P + 0, _fe(0, 250, len(metadata), struct.pack('<II', len(metadata), phys_meta), 0, 0))
+		put(P + 1, _fe(1, 251, len(metadata), struct.pack('<II', len(metadata), phys_mirror), 0, 0))
+		put(P + phys_meta, metadata)
+		put(P + phys_mirror, metadata)
+
+		for f in files:
+			out.seek((P + f['lb']) * SECTOR)
+			with open(os.path.join(root, f['rel']), 'rb') as src:
+				while True:
+					chunk = src.read(1 << 22)
+					if not chunk:
+						break
+					out.write(chunk)
+
+	return total * SECTOR
+
+# --------------------------------------------------------------------------------
+
+def Fixture(outdir, preset, iso=True):
+	"""
+	Makes (once) the tree and image of @preset under @outdir, returns (tree path, image path).
+	"""
+	spec = PRESETS[preset]
+	tree = os.path.join(outdir, preset)
+	image = os.path.join(outdir, preset + '.iso')
+
+	if not os.path.exists(os.path.join(tree, 'BDMV', 'index.bdmv')):
+		WriteTree(tree, spec)
+	if iso and not os.path.exists(image):
+		WriteUDF(tree, image, label=preset.upper())
+
+	return tree, (image if iso else None)
+
+def main():
+	if len(sys.argv) < 2:
+		print(__doc__.strip())
+		sys.exit(1)
+
+	outdir = sys.argv[1]
+	for preset in sys.argv[2:] or sorted(PRESETS):
+		tree, image = Fixture(outdir, preset)
+		print("%-12s %s  %s (%d MB)" % (preset, tree, image, os.path.getsize(image) >> 20))
+
+if __name__ == '__main__':
+	main()
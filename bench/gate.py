@@ -0,0 +1,165 @@
+"""
+Compare benchmark runs against a stored baseline and fail on regressions.
+
+Usage: python3 bench/gate.py [--baseline FILE] [--threshold PCT] [--runs N] [--rounds N] [--update] [preset ...]
+
+bench_bdmv.py is run @runs times, each in a fresh process, and every benchmark reduced to the
+figure that matters for it: seconds for open and xml, objects a second for walk and bytes a
+second for read.  The median over runs is compared with the baseline, along with the median
+absolute deviation as the noise of each side.  A benchmark regresses when it is worse than the
+baseline by more than the threshold plus that noise; the exit status is 1 if any did.
+
+--update writes the medians of this run as the new baseline instead of comparing.  Without
+--update a missing baseline is an error, a gate that compares with nothing would always pass.
+"""
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Suffix of a benchmark key: (metric, unit, higher is better, figure from a bench_bdmv.py result)
+METRICS = {
+	'open': ('latency', 's', False, lambda r: r['best']),
+	'xml': ('latency', 's', False, lambda r: r['best']),
+	'walk': ('objects/s', 'obj/s', True, lambda r: r['objects'] / r['best']),
+	'read': ('throughput', 'B/s', True, lambda r: r['bytes'] / r['best']),
+}
+
+def Run(args):
+	"""Runs bench_bdmv.py @args.runs times, returns (report of the last run, {key: [figure per run]})"""
+	figures = {}
+	report = None
+
+	fd, path = tempfile.mkstemp(suffix='.json')
+	os.close(fd)
+	try:
+		for i in range(args.runs):
+			print("Run %d of %d" % (i + 1, args.runs), flush=True)
+			cmd = [sys.executable, os.path.join(HERE, 'bench_bdmv.py'), '--json', path, '--rounds', str(args.rounds)]
+			if args.fixtures:
+				cmd += ['--fixtures', args.fixtures]
+			subprocess.run(cmd + args.presets, check=True, stdout=subprocess.DEVNULL)
+
+			with open(path) as f:
+				report = json.load(f)
+
+			for key, r in report['results'].items():
+				metric = METRICS.get(key.rsplit('/', 1)[1])
+				if metric is None:
+					continue
+				try:
+					figures.setdefault(key, []).append(metric[3](r))
+				except (KeyError, ZeroDivisionError):
+					# No titles to walk or nothing read, nothing to compare
+					pass
+	finally:
+		os.unlink(path)
+
+	return report, figures
+
+def Summarize(figures):
+	"""Median and median absolute deviation (as a fraction of the median) of each benchmark"""
+	summary = {}
+	for key, values in sorted(figures.items()):
+		metric, unit, higher, f = METRICS[key.rsplit('/', 1)[1]]
+		median = statistics.median(values)
+		mad = statistics.median(abs(v - median) for v in values)
+		summary[key] = {
+			'metric': metric,
+			'unit': unit,
+			'higher': higher,
+			'median': median,
+			'dispersion': mad / median if median else 0.0,
+			'runs': len(values),
+		}
+	return summary
+
+def Fancy(value, unit):
+	if unit == 's':
+		return '%.3f ms' % (value * 1e3)
+	if unit == 'B/s':
+		return '%.1f MB/s' % (value / 1e6)
+	return '%.0f %s' % (value, unit)
+
+def Compare(baseline, current, threshold):
+	"""Prints a per benchmark diff, returns the keys that regressed"""
+	regressed = []
+
+	print("%-28s %-10s %14s %14s %8s %7s  %s" % ('benchmark', 'metric', 'baseline', 'current', 'change', 'noise', ''))
+	for key in sorted(set(baseline) | set(current)):
+		if key not in current:
+			print("%-28s %-10s %14s %14s %8s %7s  %s" % (key, baseline[key]['metric'], Fancy(baseline[key]['median'], baseline[key]['unit']), '-', '', '', 'missing'))
+			continue
+		c = current[key]
+		if key not in baseline:
+			print("%-28s %-10s %14s %14s %8s %7s  %s" % (key, c['metric'], '-', Fancy(c['median'], c['unit']), '', '', 'new'))
+			continue
+		b = baseline[key]
+
+		if not b['median']:
+			continue
+		change = (c['median'] - b['median']) / b['median']
+		worse = -change if c['higher'] else change
+		noise = b['dispersion'] + c['dispersion']
+
+		if worse > threshold + noise:
+			status = 'REGRESSED'
+			regressed.append(key)
+		elif -worse > threshold + noise:
+			status = 'improved'
+		else:
+			status = 'ok'
+
+		print("%-28s %-10s %14s %14s %+7.1f%% %6.1f%%  %s" % (key, c['metric'], Fancy(b['median'], b['unit']), Fancy(c['median'], c['unit']), change * 100, noise * 100, status))
+
+	return regressed
+
+def main():
+	parser = argparse.ArgumentParser(description=__doc__.strip().split('\n')[0])
+	parser.add_argument('presets', nargs='*', help='fixture presets to run (default all)')
+	parser.add_argument('--baseline', default=os.path.join(HERE, 'baseline.json'), help='baseline to compare with or --update')
+	parser.add_argument('--threshold', type=float, default=10.0, help='percent worse than the baseline, beyond the noise, that fails')
+	parser.add_argument('--runs', type=int, default=5, help='times to run the suite, each in a new process')
+	parser.add_argument('--rounds', type=int, default=5, help='rounds of each benchmark within a run')
+	parser.add_argument('--fixtures', help='where fixtures are made and kept')
+	parser.add_argument('--update', action='store_true', help='write this run as the baseline')
+	args = parser.parse_args()
+
+	if not args.update and not os.path.exists(args.baseline):
+		sys.exit("No baseline at %s, record one on the reference machine with --update (python3 setup.py bench --update)" % args.baseline)
+
+	report, figures = Run(args)
+	current = Summarize(figures)
+
+	env = {k: report[k] for k in ('version', 'python', 'machine', 'packetkernel', 'zerokernel')}
+
+	if args.update:
+		with open(args.baseline, 'w') as f:
+			json.dump(dict(env, runs=args.runs, rounds=args.rounds, results=current), f, indent=1, sort_keys=True)
+			f.write('\n')
+		print("Baseline of %d benchmarks written to %s" % (len(current), args.baseline))
+		return
+
+	with open(args.baseline) as f:
+		baseline = json.load(f)
+
+	# Numbers from another machine or kernel are still compared, but say so
+	for k, v in env.items():
+		if k != 'version' and baseline.get(k) != v:
+			print("Note: baseline %s is %s, this run %s" % (k, baseline.get(k), v))
+
+	regressed = Compare(baseline['results'], current, args.threshold / 100)
+	if regressed:
+		print("\n%d of %d benchmarks regressed more than %g%% beyond noise: %s" % (len(regressed), len(current), args.threshold, ', '.join(regressed)))
+		sys.exit(1)
+
+	print("\nNo regressions beyond %g%%" % args.threshold)
+
+if __name__ == '__main__':
+	main()
@@ -7,11 +7,16 @@ Not everything in libbluray is wrapped by this library.
 
 import _bluread
 
-__all__ = ["Bluray", "Title", "Chapter", "Clip", "Video", "Audio", "Subtitle", "Version", "BRToXML", "Disc"]
+__all__ = ["Bluray", "Title", "Chapter", "Clip", "Video", "Audio", "Subtitle", "TitleSnapshot", "ChapterSnapshot", "ClipSnapshot", "VideoSnapshot", "AudioSnapshot", "SubtitleSnapshot", "DiscSnapshot", "Catalog", "PackCatalog", "Version", "BRToXML", "Disc", "ScanPackets", "MetricsText", "ServeMetrics", "CaptureDebugLog"]
 
 Version = _bluread.Version
+ScanPackets = _bluread.ScanPackets
 
 from .objects import Bluray, Title, Chapter, Clip, Video, Audio, Subtitle, Disc
+from .objects import TitleSnapshot, ChapterSnapshot, ClipSnapshot, VideoSnapshot, AudioSnapshot, SubtitleSnapshot, DiscSnapshot
+from .catalog import Catalog, PackCatalog
+from .metrics import MetricsText, ServeMetrics
+from .debuglog import CaptureDebugLog
 
 from crudexml import node,tnode
 
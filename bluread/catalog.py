@@ -0,0 +1,140 @@
+"""
+Metadata of many discs in one flat buffer shared by worker processes.
+
+PackCatalog() lays the disc records of Bluray.SnapshotDisc() one after another behind a table
+of their offsets (the layout is described in src/snapshot.c).  Put in a file or in
+multiprocessing.shared_memory, every process maps the same pages and reads discs, titles, clips
+and streams in place through a Catalog: nothing is parsed up front and nothing is copied, the
+objects handed out only hold the offset of their record.
+"""
+
+import mmap
+import os
+import struct
+from multiprocessing import resource_tracker, shared_memory
+
+import _bluread
+
+from .objects import Bluray, DiscSnapshot
+
+MAGIC = b'BRC1'
+
+def _Snapshots(discs):
+	for d in discs:
+		if isinstance(d, _bluread.DiscSnapshot):
+			yield d
+		elif isinstance(d, _bluread.Bluray):
+			yield d.SnapshotDisc()
+		else:
+			with Bluray(d) as b:
+				b.Open()
+				yield b.SnapshotDisc()
+
+def PackCatalog(discs):
+	"""
+	Returns the catalog of @discs as bytes.
+	Each of @discs is a DiscSnapshot, an open Bluray or a path to open.
+	"""
+	records = [d.Record() for d in _Snapshots(discs)]
+
+	offsets = []
+	off = 16 + 8 * len(records)
+	for r in records:
+		offsets.append(off)
+		off += len(r)
+
+	header = struct.pack('<4sIQ%dQ' % len(records), MAGIC, len(records), off, *offsets)
+	return b''.join([header] + records)
+
+class Catalog(_bluread.Catalog):
+	"""
+	Disc snapshots of many discs in one buffer (bytes, an mmap, shared memory or any other buffer), read in place.
+	Create() puts a new catalog in shared memory and Attach() maps it by name in another process;
+	Save() writes one to a file and Load() maps it read-only.  A catalog made either way pickles as its
+	name or path, so handing it to a process pool sends a few bytes rather than the catalog.
+	The buffer stays mapped while the catalog or anything read from it is alive, @Owner is released after it.
+	"""
+
+	__slots__ = ('_shm', '_path')
+
+	def __init__(self, Buffer, Owner=None):
+		_bluread.Catalog.__init__(self, Buffer, DiscSnapshot, Owner)
+		self._shm = Owner if isinstance(Owner, shared_memory.SharedMemory) else None
+		self._path = None
+
+	@classmethod
+	def Create(cls, discs, name=None):
+		"""
+		Packs @discs (as for PackCatalog()) into new shared memory called @name (picked when None).
+		The creator should Unlink() it once no process needs it.
+		"""
+		data = PackCatalog(discs)
+
+		shm = shared_memory.SharedMemory(name=name, create=True, size=len(data))
+		shm.buf[:len(data)] = data
+
+		return cls(shm.buf, shm)
+
+	@classmethod
+	def Attach(cls, name):
+		"""Maps the catalog in shared memory called @name"""
+		try:
+			# Only the creator should unlink it, keep the resource tracker of this process out of it
+			shm = shared_memory.SharedMemory(name=name, track=False)
+		except TypeError:
+			# Before 3.13 attaching registers it all the same, and the tracker would unlink it when this process exits
+			shm = shared_memory.SharedMemory(name=name)
+			resource_tracker.unregister(shm._name, 'shared_memory')
+
+		return cls(shm.buf, shm)
+
+	@staticmethod
+	def Save(discs, path):
+		"""Packs @discs (as for PackCatalog()) into the file @path, replacing it whole"""
+		data = PackCatalog(discs)
+
+		tmp = path + '.tmp'
+		with open(tmp, 'wb') as f:
+			f.write(data)
+			f.flush()
+			os.fsync(f.fileno())
+		os.replace(tmp, path)
+
+	@classmethod
+	def Load(cls, path):
+		"""Maps the catalog in the file @path read-only"""
+		with open(path, 'rb') as f:
+			m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+		c = cls(m)
+		c._path = path
+		return c
+
+	@property
+	def Name(self):
+		"""Name of the shared memory holding the catalog, or None"""
+		return self._shm.name if self._shm is not None else None
+
+	def Unlink(self):
+		"""Removes the shared memory of a catalog made by Create(), processes that have it mapped keep it"""
+		if self._shm is not None:
+			# Before 3.13 an Attach() sharing this process's resource tracker took the segment off it,
+			# put it back so unlink() unregisters something and the tracker does not complain
+			if not hasattr(self._shm, '_track'):
+				resource_tracker.register(self._shm._name, 'shared_memory')
+			self._shm.unlink()
+
+	def __len__(self):
+		return self.NumberOfDiscs
+
+	def __getitem__(self, num):
+		if num < 0 or num >= self.NumberOfDiscs:
+			raise IndexError(num)
+		return self.GetDisc(num)
+
+	def __reduce__(self):
+		if self._shm is not None:
+			return (Catalog.Attach, (self._shm.name,))
+		if self._path is not None:
+			return (Catalog.Load, (self._path,))
+		raise TypeError("Only catalogs in shared memory or a file can be pickled")
@@ -0,0 +1,113 @@
+"""
+Forwards libbluray's debug output to Python logging.
+
+Left alone libbluray writes every debug line to stderr as it happens, from inside the call
+that produced it.  CaptureDebugLog() points it at a ring in _bluread instead, which costs the
+library a copy per line, and a background thread drains the ring every @interval seconds and
+logs what it finds.  Runs of the same line come out once with a count, and a disc spewing
+more than @rate lines a second has the rest counted rather than logged.
+"""
+
+import logging
+import threading
+
+import _bluread
+
+# Debug masks from libbluray's log_control.h
+DBG_CONFIGFILE = 0x00002
+DBG_FILE = 0x00004
+DBG_AACS = 0x00008
+DBG_MKB = 0x00010
+DBG_MMC = 0x00020
+DBG_BLURAY = 0x00040
+DBG_DIR = 0x00080
+DBG_NAV = 0x00100
+DBG_BDPLUS = 0x00200
+DBG_DLX = 0x00400
+DBG_CRIT = 0x00800
+DBG_HDMV = 0x01000
+DBG_BDJ = 0x02000
+DBG_STREAM = 0x04000
+DBG_GC = 0x08000
+DBG_DECODE = 0x10000
+DBG_JNI = 0x20000
+
+class DebugLog:
+	"""
+	Drains libbluray's debug lines into @logger at @level while started.
+	@mask selects what libbluray reports (None leaves its current mask, by default DBG_CRIT or
+	whatever BD_DEBUG_MASK says).  Usable as a context manager.
+	"""
+
+	def __init__(self, logger='bluread.libbluray', level=logging.DEBUG, mask=None, rate=100, interval=0.5):
+		self.logger = logging.getLogger(logger) if isinstance(logger, str) else logger
+		self.level = level
+		self.mask = mask
+		self.rate = rate
+		self.interval = interval
+
+		self._stop = threading.Event()
+		self._thread = None
+
+	def start(self):
+		if self._thread is not None:
+			return self
+
+		_bluread.SetDebugHandler(Enable=True, Mask=self.mask, Rate=self.rate)
+
+		self._stop.clear()
+		self._thread = threading.Thread(target=self._run, name='bluread-debuglog', daemon=True)
+		self._thread.start()
+		return self
+
+	def stop(self):
+		"""Puts stderr back and logs whatever was still queued"""
+		if self._thread is None:
+			return
+
+		self._stop.set()
+		self._thread.join()
+		self._thread = None
+
+		_bluread.SetDebugHandler(Enable=False)
+		self.flush()
+
+	def flush(self):
+		"""Logs every queued line now rather than at the next interval"""
+		while True:
+			d = _bluread.DrainDebugLog()
+			self._emit(d)
+			if not d['Lines']:
+				break
+
+	def _emit(self, d):
+		log = self.logger.log
+		level = self.level
+
+		for line, repeated in d['Lines']:
+			if repeated:
+				log(level, 'last message repeated %d more times', repeated)
+			log(level, '%s', line)
+
+		if d['Repeats']:
+			log(level, 'last message repeated %d more times', d['Repeats'])
+		if d['Suppressed']:
+			log(logging.WARNING, '%d libbluray debug lines suppressed, over %d a second', d['Suppressed'], self.rate)
+		if d['Dropped']:
+			log(logging.WARNING, '%d libbluray debug lines dropped, the log ring was full', d['Dropped'])
+
+	def _run(self):
+		while not self._stop.wait(self.interval):
+			self.flush()
+
+	def __enter__(self):
+		return self.start()
+
+	def __exit__(self, *args):
+		self.stop()
+
+def CaptureDebugLog(logger='bluread.libbluray', level=logging.DEBUG, mask=None, rate=100, interval=0.5):
+	"""
+	Starts forwarding libbluray's debug output to Python logging, returning the DebugLog whose stop() ends it.
+	"""
+	return DebugLog(logger, level, mask, rate, interval).start()
@@ -0,0 +1,105 @@
+"""
+Process wide metrics in the Prometheus text exposition format.
+
+_bluread keeps counters of opens, titles parsed, bytes read and imaged, read errors, range
+retries and block cache lookups for the life of the process, plus a histogram of open
+latency.  MetricsText() renders them, along with the per call latency histograms of
+_bluread.Stats() when those are enabled, and ServeMetrics() serves the same text over HTTP
+for a scraper to collect.
+"""
+
+import http.server
+import threading
+
+import _bluread
+
+# (name, key in _bluread.Metrics(), help)
+_COUNTERS = [
+	('bluread_opens_total', 'Opens', 'Discs and images opened'),
+	('bluread_open_failures_total', 'OpenFailures', 'Opens that failed'),
+	('bluread_titles_parsed_total', 'Titles', 'Title objects made, each parsing its playlist'),
+	('bluread_read_bytes_total', 'BytesRead', 'Bytes read from discs and images by copies, scans and verification'),
+	('bluread_imaged_bytes_total', 'BytesImaged', 'Bytes copied into images by Image()'),
+	('bluread_read_errors_total', 'ReadErrors', 'Failed reads of a disc or image'),
+	('bluread_retries_total', 'Retries', 'Sector ranges copied again by Image(Ranges=...)'),
+	('bluread_cache_hits_total', 'CacheHits', 'Block cache lookups served from memory'),
+	('bluread_cache_misses_total', 'CacheMisses', 'Block cache lookups that read the disc'),
+	('bluread_cache_evictions_total', 'CacheEvictions', 'Blocks dropped from a block cache to make room'),
+]
+
+# _bluread counts into log2 microsecond buckets, so any power of two bound is exact; every other one will do
+_BOUNDS = [1 << b for b in range(0, 31, 2)]
+
+def _histogram(lines, name, labels, counter):
+	"""Appends a counter from _bluread (Count, Seconds, Histogram) as a Prometheus histogram"""
+	sep = ',' if labels else ''
+	hist = counter['Histogram']
+	for upper in _BOUNDS:
+		n = sum(c for u, c in hist if u <= upper)
+		lines.append('%s_bucket{%s%sle="%r"} %d' % (name, labels, sep, upper / 1e6, n))
+	lines.append('%s_bucket{%s%sle="+Inf"} %d' % (name, labels, sep, counter['Count']))
+
+	labels = '{%s}' % labels if labels else ''
+	lines.append('%s_sum%s %.9f' % (name, labels, counter['Seconds']))
+	lines.append('%s_count%s %d' % (name, labels, counter['Count']))
+
+def MetricsText():
+	"""
+	Renders the process metrics in the Prometheus text exposition format (version 0.0.4).
+	"""
+	m = _bluread.Metrics()
+	lines = []
+
+	lines.append('# HELP bluread_info Version and kernels of the loaded module')
+	lines.append('# TYPE bluread_info gauge')
+	lines.append('bluread_info{version="%s",packet_kernel="%s",zero_kernel="%s"} 1' % (_bluread.Version, _bluread.PacketKernel, _bluread.ZeroKernel))
+
+	for name, key, help in _COUNTERS:
+		lines.append('# HELP %s %s' % (name, help))
+		lines.append('# TYPE %s counter' % name)
+		lines.append('%s %d' % (name, m[key]))
+
+	lines.append('# HELP bluread_open_duration_seconds Time to open a disc and list its titles')
+	lines.append('# TYPE bluread_open_duration_seconds histogram')
+	_histogram(lines, 'bluread_open_duration_seconds', '', m['OpenLatency'])
+
+	# Only there while EnableStats() is on
+	stats = _bluread.Stats()
+	if stats:
+		lines.append('# HELP bluread_call_duration_seconds Latency of libbluray calls and object construction')
+		lines.append('# TYPE bluread_call_duration_seconds histogram')
+		for call in sorted(stats):
+			_histogram(lines, 'bluread_call_duration_seconds', 'call="%s"' % call, stats[call])
+
+	return '\n'.join(lines) + '\n'
+
+class _MetricsHandler(http.server.BaseHTTPRequestHandler):
+	def do_GET(self):
+		if self.path.split('?')[0] not in ('/', '/metrics'):
+			self.send_error(404)
+			return
+
+		body = MetricsText().encode('utf-8')
+		self.send_response(200)
+		self.send_header('Content-Type', 'text/plain; version=0.0.4; charset=utf-8')
+		self.send_header('Content-Length', str(len(body)))
+		self.end_headers()
+		self.wfile.write(body)
+
+	def log_message(self, format, *args):
+		# Scrapes every few seconds would drown the daemon's own output
+		pass
+
+def ServeMetrics(port=9466, host='127.0.0.1'):
+	"""
+	Serves MetricsText() at http://host:port/metrics from a daemon thread.
+	Binds to localhost unless told otherwise, the counters are not meant for the network at large.
+	Returns the server, whose shutdown() stops it.
+	"""
+	server = http.server.ThreadingHTTPServer((host, port), _MetricsHandler)
+	server.daemon_threads = True
+
+	t = threading.Thread(target=server.serve_forever, name='bluread-metrics', daemon=True)
+	t.start()
+
+	return server
@@ -5,6 +5,7 @@ Python objects that wrap C API objects.
 import _bluread
 
 import glob
+import json
 import os
 import subprocess
 
@@ -190,6 +191,18 @@ class Disc:
 
 		return "%s - %s" % (label, uuid)
 
+	@staticmethod
+	def br_fingerprint(path, samples=8, streams=3):
+		"""
+		Gets a content fingerprint of the BR disc at @path (device, image, or BDMV directory tree).
+		This is a SHA-256 over the navigation files (index, movie objects, playlists, clip info) and
+		@samples sectors from each of the @streams largest M2TS files.
+		Unlike br_discid, it tells apart discs that share a label and UUID, and it needs only a few
+		megabytes of reads.
+		"""
+
+		return _bluread.Fingerprint(path, Samples=samples, Streams=streams)
+
 	@staticmethod
 	def br_getSize(path):
 		label,uuid = __class__.br_discid(path).split(' - ')
@@ -205,78 +218,147 @@ class Disc:
 		return (label,blocksize,blocks)
 
 	@staticmethod
-	def dd(inf, outf, blocksize, blocks, label):
+	def dd(inf, outf, blocksize, blocks, label, hashes=('sha256', 'xxh3', 'crc32'), manifest=None, engine=None, queue_depth=4, sparse=False, compress=None, compress_threads=4, ranges=None):
 		"""
-		Perform a 'resumable' dd copy from @inf to @ouf using the given blocksize and number of blocks.
+		Perform a 'resumable' copy from @inf to @outf using the given blocksize and number of blocks.
 		The @label is used in exceptions to be descriptive.
 
 		The resumable aspect:
 		1) If @outf exists, then the sizes are compared
-		2) If the @outf size is the same as what is expected then nothing is done
-		3) If the @outf size is not a multiple of @blocksize, the remainder of the block is copied with blocksize=1
-		4) If the @outf size is a multiple of @blocksize, the remainder of the blocks are copied by seek and skip appropriately.
-		5) If @outf does not exist, then the entire @inf is copied.
+		2) If the @outf size is the same as what is expected (and no @outf + '.progress' is left) then nothing is done
+		3) If the @outf size is short, copying resumes from the last whole chunk (4 MiB) already in @outf
+		4) If @outf does not exist, then the entire @inf is copied.
+		While a copy is unfinished, @outf + '.progress' records how much of @outf is synced to disc, and it
+		resumes from there instead, as writes in flight when it was stopped may have left @outf longer than that.
+
+		The copy is done natively by _bluread.Image() and the @hashes (any of sha256, xxh3 and crc32)
+		are computed inline on the same buffers by a separate thread, so no second read of the image is needed.
+		On a resumed copy the part already in @outf is read back from @outf (not the drive) for hashing.
+		Digests of the whole image and of every chunk are saved to @manifest, which defaults to @outf + '.manifest.json'.
+		Pass hashes=None to skip hashing, or manifest=False to only return the digests.
+
+		By default one chunk is read and then written at a time.  With @engine ('auto', 'io_uring' or 'threads')
+		@queue_depth chunks are kept in flight against both @inf and @outf; 'auto' uses io_uring and falls back
+		to a small thread pool where the kernel lacks it.  Tune @queue_depth per drive, each chunk is a buffer.
 
-		Commands used:
-			Partial block copy:   ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=1', 'count=%d' % (blocksize - (cursize % blocksize)), 'skip=%d'%cursize, 'seek=%d'%cursize]
-			Remaining block copy: ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=1', 'count=%d' % (blocksize - (cursize % blocksize)), 'skip=%d'%cursize, 'seek=%d'%cursize]
-			Remaining block copy: ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=%d' % blocksize, 'count=%d' % (blocksize - (cursize % blocksize)), 'skip=%d'%cursize, 'seek=%d'%cursize]
-			Full block copy:      ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=%d'%blocksize, 'count=%d'%blocks]
+		With @sparse, all-zero blocks of the image are not written and @outf becomes a sparse file.  The
+		'Sparse' entry of the result has the block counts, the zero block ratio and the bytes @outf occupies.
 
-		Where cursize is given by os.path.getsize().
+		With @compress (a zstd level) @outf is written as a seekable zstd image while the disc is read,
+		frames are compressed by @compress_threads threads.  Bluray(@outf).Open() reads it directly.  A
+		compressed copy cannot be resumed, an existing @outf is overwritten.
+
+		With @ranges, a list of (sector, count) or the path of a map saved by Disc.verify(), only those
+		sectors are read again and written over @outf, which is how sectors that failed verification are retried.
+
+		Returned is the dictionary from _bluread.Image(), or None if the disc was already copied.
 		"""
 
 		# Get expected total size
 		expectedsize = blocksize * blocks
 
-		if os.path.exists(outf):
+		if ranges is not None:
+			if isinstance(ranges, str):
+				with open(ranges, 'r') as f:
+					m = json.load(f)
+				ranges = m['mismatches'] + m['unreadable']
+
+			try:
+				return _bluread.Image(inf, outf, expectedsize, Ranges=ranges)
+			except OSError as e:
+				raise Exception("Failed to re-copy sectors of disc '%s': %s" % (label, e))
+
+		if os.path.exists(outf) and compress is None:
 			cursize = os.path.getsize(outf)
 
-			# If sizes are the same, then no need to copy
-			if expectedsize == cursize:
+			# If sizes are the same, then no need to copy, unless the copy never finished
+			if expectedsize <= cursize and not os.path.exists(outf + '.progress'):
 				print("Disc already copied")
-				return
+				return None
 
-			elif expectedsize < cursize:
-				print("Disc already copied")
-				# Um, ok, I guess it's done copying
-				return
+			print("Partial copy: blocksize=%d, blocks=%d, copied=%d" % (blocksize, blocks, cursize))
 
-			else:
-				# Partial copy
-				print("Partial copy: blocksize=%d, blocks=%d, mod=%d" % (blocksize, blocks, blocksize - (cursize % blocksize)))
-
-				# First, need to copy remaining block
-				if cursize % blocksize != 0:
-					print("Partial block copy")
-					# Finish remainder of block
-					args = ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=1', 'count=%d' % (blocksize - (cursize % blocksize)), 'skip=%d'%cursize, 'seek=%d'%cursize]
-					print(" ".join(args))
-					ret = subprocess.call(args)
-					if ret != 0:
-						raise Exception("Failed to partial copy remaining block %d of disc '%s' to drive" % (int(cursize/blocksize)+1, label))
-
-				# Get [possibly] updated size
-				cursize = os.path.getsize(outf)
-
-				print("Partial copy")
-				# Finish remainder of disc
-				#   * Blocks written: int(cursize / blocksize)
-				#   * Remaining blocks: blocks - int(cursize / blocksize)
-				#   * Starting block: int(cursize / blocksize)
-				args = ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=%d' % blocksize, 'count=%d' % (blocks - int(cursize / blocksize)), 'skip=%d'%int(cursize/blocksize), 'seek=%d'%int(cursize/blocksize)]
-				print(" ".join(args))
-				ret = subprocess.call(args)
-				if ret != 0:
-					raise Exception("Failed to copy remaining %d blocks (total %d) of disc '%s' to drive" % (blocks - int(cursize/blocksize)+1, blocks, label))
-
-		else:
-			# Dup entire disc to drive
-			args = ['dd', 'if=%s'%inf, 'of=%s'%outf, 'bs=%d'%blocksize, 'count=%d'%blocks]
-			print(" ".join(args))
-			ret = subprocess.call(args)
-			if ret != 0:
-				raise Exception("Failed to copy disc '%s' to drive" % label)
+		try:
+			ret = _bluread.Image(inf, outf, expectedsize, Hashes=hashes, Engine=engine, QueueDepth=queue_depth, Sparse=sparse, Compress=compress, CompressThreads=compress_threads)
+		except OSError as e:
+			raise Exception("Failed to copy disc '%s' to drive: %s" % (label, e))
+
+		if hashes and manifest is not False:
+			Disc.WriteManifest(manifest or (outf + '.manifest.json'), ret)
+
+		return ret
+
+	@staticmethod
+	def verify(inf, outf, threads=4, samples=0, mapfile=None):
+		"""
+		Re-read the device @inf and compare it with its image @outf, which Disc.dd() only checks by size.
+		The image is compared through a memory map by @threads threads while the drive streams.
+		Pass @samples to compare only that many 4 MiB chunks spread over the disc instead of all of it.
+
+		Returned is the dictionary from _bluread.Verify(), whose 'Mismatches' and 'Unreadable' are lists of
+		(sector, count).  They are also saved as JSON to @mapfile if given, which Disc.dd(ranges=@mapfile) retries.
+		"""
+
+		ret = _bluread.Verify(inf, outf, Threads=threads, Samples=samples)
+
+		if mapfile:
+			with open(mapfile, 'w') as f:
+				json.dump({
+					'size': ret['Size'],
+					'sampled': ret['Sampled'],
+					'mismatches': ret['Mismatches'],
+					'unreadable': ret['Unreadable'],
+				}, f, indent=1)
+
+		return ret
+
+	@staticmethod
+	def backup(inf, outdir, titles=None, threads=4):
+		"""
+		Copy the files of the disc at @inf (device or image) into the directory @outdir.
+		All extents are read in one pass in the order they sit on disc, while @threads threads write the files.
+		If @titles (Title objects) are given, only the streams of their clips are copied along with everything outside BDMV/STREAM.
+		"""
+
+		filt = None
+		if titles is not None:
+			clips = set()
+			for t in titles:
+				for cnum in range(t.NumberOfClips):
+					clips.add(t.GetClip(cnum).ClipId)
+
+			def filt(path):
+				parts = path.upper().split('/')
+				if parts[:2] != ['BDMV', 'STREAM']:
+					return True
+				return parts[-1].split('.')[0] in clips
+
+		return _bluread.Backup(inf, outdir, Filter=filt, Threads=threads)
+
+	@staticmethod
+	def WriteManifest(path, result):
+		"""
+		Save the digests returned by _bluread.Image() or Title.Copy() as JSON to @path.
+		Per-chunk digests allow verifying part of an image later without reading all of it.
+		"""
+
+		manifest = {
+			'size': result['Size'],
+			'digests': result['Digests'],
+			'chunks': [{'offset': o, 'length': l, 'digests': d} for o,l,d in result['Chunks']],
+		}
+
+		with open(path, 'w') as f:
+			json.dump(manifest, f, indent=1)
+
+	@staticmethod
+	def ReadManifest(path):
+		"""
+		Load a manifest saved by WriteManifest().
+		"""
+
+		with open(path, 'r') as f:
+			return json.load(f)
 
 	@staticmethod
 	def dvd_GetSize(path):
@@ -325,6 +407,12 @@ class Bluray(_bluread.Bluray):
 	"""
 
 	def __init__(self, Path, KEYDB=None):
+		"""
+		Path can also be an image already in memory (bytes, bytearray, mmap, or any buffer, used without copying)
+		or a seekable binary file-like object, which is read through a block cache.
+		Threads may share a Bluray, calls that use the disc take turns on its lock (a Copy() holds it until done);
+		separate Bluray objects do not wait for each other, and on free-threaded Python run fully in parallel.
+		"""
 		if type(KEYDB) ==  str and not os.path.exists(KEYDB):
 			raise ValueError("KEYDB.cfg path '%s' does not exist" % KEYDB)
 
@@ -343,6 +431,42 @@ class Bluray(_bluread.Bluray):
 		# Don't suppress any exceptions
 		return False
 
+	def Snapshot(self):
+		"""
+		Snapshots every title, returning a list of TitleSnapshot indexed by title number.
+		The snapshots are immutable, outlive Close() and pickle compactly, so scan results can be handed
+		to a process pool without reopening the disc.
+		"""
+		if self.IsDetached:
+			return [self.GetTitle(i) for i in range(self.NumberOfTitles)]
+		return [self.GetTitle(i).Snapshot() for i in range(self.NumberOfTitles)]
+
+	def SnapshotDisc(self):
+		"""
+		Snapshots the disc and every title into one DiscSnapshot, the record a Catalog is made of;
+		a Catalog shares the snapshots of many discs between processes.
+		"""
+		return _bluread.Bluray.SnapshotDisc(self, DiscSnapshot)
+
+	def Detach(self):
+		"""
+		Copies the disc into a DiscSnapshot record it keeps, then closes the device and frees libbluray's title info.
+		Returns {'Titles', 'Before', 'After', 'TotalBefore', 'TotalAfter'}, with the bytes each title took in
+		libbluray before and in the record after.
+		The metadata properties and GetTitle() (returning TitleSnapshot) keep working from the record.
+		"""
+		return _bluread.Bluray.Detach(self, DiscSnapshot)
+
+	def FindTitles(self, **conditions):
+		"""
+		Returns the numbers of the titles matching MinLength=, MaxLength=, MinChapters=, MaxChapters=, Video=, Audio=
+		and Subtitle=, checked in C without making objects for the others.  Lengths are in the units of Title.Length.
+		A stream condition is True (has one), False (has none), or a dict of the CodingType, Format and Language
+		(codes, or lists of them) one stream must have, e.g. Audio={'CodingType': 0x83, 'Language': 'eng'};
+		a list of conditions must all hold.
+		"""
+		return _bluread.Bluray.FindTitles(self, **conditions)
+
 class Title(_bluread.Title):
 	def __init__(self, BR, Num):
 		_bluread.Title.__init__(self, BR, Num, Chapter,Clip)
@@ -358,6 +482,27 @@ class Title(_bluread.Title):
 		"""
 		return "%05d.mpls" % self.PlaylistNumber
 
+	def Copy(self, path, hashes=('sha256', 'xxh3', 'crc32'), manifest=None, scan=True):
+		"""
+		Read this title through libbluray into the file @path.
+		The @hashes are computed inline and saved to @manifest (defaults to @path + '.manifest.json') as with Disc.dd().
+		With @scan the packets are checked and counted per PID on the way, as _bluread.ScanPackets() reports them, under 'Packets'.
+		"""
+
+		ret = _bluread.Title.Copy(self, path, Hashes=hashes, Scan=scan)
+
+		if hashes and manifest is not False:
+			Disc.WriteManifest(manifest or (path + '.manifest.json'), ret)
+
+		return ret
+
+	def Snapshot(self):
+		"""
+		Copies this title's metadata into a TitleSnapshot, which outlives the disc and can be pickled.
+		Bitrates are included if SampleBitrates() was called first.
+		"""
+		return _bluread.Title.Snapshot(self, TitleSnapshot)
+
 class Chapter(_bluread.Chapter):
 	"""
 	Represents a chaper which belongs to a title.
@@ -493,3 +638,86 @@ class Subtitle(_bluread.Subtitle):
 	def __init__(self, Clip, Num):
 		_bluread.Subtitle.__init__(self, Clip, Num)
 
+
+class TitleSnapshot(_bluread.TitleSnapshot):
+	"""
+	Detached, immutable copy of a title's metadata from Title.Snapshot() or Bluray.Snapshot().
+	It has the properties and Get methods of a Title but holds no disc, so it stays usable after Close()
+	and pickles as one compact binary record for handing scan results to other processes.
+	Buffer is the record (bytes, or any buffer with the record at Offset, used without copying).
+	"""
+
+	__slots__ = ()
+
+	def __init__(self, Buffer, Offset=0):
+		_bluread.TitleSnapshot.__init__(self, Buffer, Offset, ChapterSnapshot, ClipSnapshot)
+
+	LengthFancy = Title.LengthFancy
+	Playlist = Title.Playlist
+
+class ChapterSnapshot(_bluread.ChapterSnapshot):
+	"""
+	Chapter of a TitleSnapshot.
+	"""
+
+	__slots__ = ()
+
+	def __init__(self, Title, Num):
+		_bluread.ChapterSnapshot.__init__(self, Title, Num)
+
+	StartFancy = Chapter.StartFancy
+	LengthFancy = Chapter.LengthFancy
+	End = Chapter.End
+	EndFancy = Chapter.EndFancy
+
+class ClipSnapshot(_bluread.ClipSnapshot):
+	"""
+	Clip of a TitleSnapshot, with its primary video, primary audio and subtitle streams.
+	"""
+
+	__slots__ = ()
+
+	def __init__(self, Title, Num):
+		_bluread.ClipSnapshot.__init__(self, Title, Num, VideoSnapshot, AudioSnapshot, SubtitleSnapshot)
+
+class VideoSnapshot(_bluread.VideoSnapshot):
+	"""
+	Video stream of a ClipSnapshot.
+	"""
+
+	__slots__ = ()
+
+	CodingType = Video.CodingType
+	Format = Video.Format
+	Rate = Video.Rate
+	Aspect = Video.Aspect
+
+class AudioSnapshot(_bluread.AudioSnapshot):
+	"""
+	Audio stream of a ClipSnapshot.
+	"""
+
+	__slots__ = ()
+
+	CodingType = Audio.CodingType
+	Format = Audio.Format
+	Rate = Audio.Rate
+
+class SubtitleSnapshot(_bluread.SubtitleSnapshot):
+	"""
+	Subtitle stream of a ClipSnapshot.
+	"""
+
+	__slots__ = ()
+
+class DiscSnapshot(_bluread.DiscSnapshot):
+	"""
+	Detached, immutable copy of a disc's metadata from Bluray.SnapshotDisc() or Catalog.GetDisc().
+	It has the properties of an open Bluray and GetTitle() returns TitleSnapshots read in place from the same buffer.
+	Pickles as one compact binary record.
+	"""
+
+	__slots__ = ()
+
+	def __init__(self, Buffer, Offset=0):
+		_bluread.DiscSnapshot.__init__(self, Buffer, Offset, TitleSnapshot)
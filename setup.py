@@ -1,11 +1,14 @@
+import os
+import subprocess
 import sys
-from setuptools import setup, Extension
+from setuptools import setup, Extension, Command
 
 majv = 1
 minv = 5
 
-if sys.version_info < (3,):
-    print("This library is only tested with Python 3.7")
+# Heap types made per module (PyType_FromModuleAndSpec) need 3.9
+if sys.version_info < (3, 9):
+    print("This library needs Python 3.9 or later")
     sys.exit(1)
 
 bluray = Extension(
@@ -15,10 +18,58 @@ bluray = Extension(
         ('MINOR_VERSION', str(minv))
     ],
 	include_dirs = ['/usr/include/libbluray'],
-    libraries=['bluray'],
-    sources=['src/bluread.c']
+    libraries=['bluray', 'crypto', 'z', 'xxhash', 'zstd'],
+    sources=['src/bluread.c', 'src/tsscan.c', 'src/image.c', 'src/source.c', 'src/cache.c', 'src/discfs.c', 'src/fingerprint.c', 'src/bdfs.c', 'src/backup.c', 'src/extents.c', 'src/ioengine.c', 'src/zeroscan.c', 'src/zimage.c', 'src/verify.c', 'src/stats.c', 'src/debuglog.c', 'src/snapshot.c']
 )
 
+class bench(Command):
+    """
+    Builds the extension in place and runs bench/gate.py, failing if the benchmarks regressed
+    against bench/baseline.json, which must exist unless --update records it.
+    """
+
+    description = 'run the benchmarks and compare them with the stored baseline'
+    user_options = [
+        ('baseline=', None, 'baseline JSON [default: bench/baseline.json]'),
+        ('threshold=', None, 'percent worse than the baseline, beyond noise, that fails [default: 10]'),
+        ('runs=', None, 'times to run the suite [default: 5]'),
+        ('presets=', None, 'comma separated fixture presets [default: all]'),
+        ('update', None, 'write the results as the new baseline'),
+    ]
+    boolean_options = ['update']
+
+    def initialize_options(self):
+        self.baseline = None
+        self.threshold = None
+        self.runs = None
+        self.presets = None
+        self.update = 0
+
+    def finalize_options(self):
+        pass
+
+    def run(self):
+        build = self.reinitialize_command('build_ext')
+        build.inplace = 1
+        self.run_command('build_ext')
+
+        root = os.path.dirname(os.path.abspath(__file__))
+        cmd = [sys.executable, os.path.join(root, 'bench', 'gate.py')]
+        for opt in ('baseline', 'threshold', 'runs'):
+            if getattr(self, opt) is not None:
+                cmd += ['--' + opt, str(getattr(self, opt))]
+        if self.update:
+            cmd.append('--update')
+        if self.presets:
+            cmd += self.presets.split(',')
+
+        env = dict(os.environ)
+        env['PYTHONPATH'] = os.pathsep.join(filter(None, [root, env.get('PYTHONPATH')]))
+
+        ret = subprocess.call(cmd, env=env)
+        if ret:
+            sys.exit(ret)
+
 setup(
     name='bluread',
     version='%d.%d' % (majv, minv),
@@ -29,8 +80,16 @@ setup(
     download_url="https://pypi.python.org/pypi/bluread",
     packages=['bluread'],
     ext_modules=[bluray],
+    cmdclass={'bench': bench},
     requires=['crudexml'],
+    python_requires='>=3.9',
     classifiers=[
-        'Programming Language :: Python :: 3.7'
+        'Programming Language :: Python :: 3',
+        'Programming Language :: Python :: 3 :: Only',
+        'Programming Language :: Python :: 3.9',
+        'Programming Language :: Python :: 3.10',
+        'Programming Language :: Python :: 3.11',
+        'Programming Language :: Python :: 3.12',
+        'Programming Language :: Python :: 3.13',
     ]
 )
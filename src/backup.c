@@ -0,0 +1,610 @@
+#include "bluread.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// File level backup in physical order
+//
+// Instead of copying files one after another, every extent to copy is sorted by LBA and
+// the disc is read in a single forward pass.  Each chunk read is handed to a pool of
+// writer threads that pwrite() it into the output file it belongs to, so slow writes
+// never hold up the drive.
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+	int fd;
+	uint64_t offset;
+	BackupRange *range;
+} BackupBuf;
+
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	BackupBuf *bufs;
+	int numbufs;
+
+	int *free;   // stack of idle buffers
+	int numfree;
+
+	int *queue;  // ring of buffers waiting to be written
+	int qhead;
+	int qcount;
+
+	int done;
+	int err;
+
+	int journalfd;
+} BackupPool;
+
+static int
+_backup_cmp(const void *a, const void *b)
+{
+	const BackupRange *x = a, *y = b;
+	if (x->lba != y->lba) return x->lba < y->lba ? -1 : 1;
+	if (x->fd != y->fd) return x->fd - y->fd;
+	return x->offset < y->offset ? -1 : (x->offset > y->offset);
+}
+
+static int
+_backup_push(BackupJob *job, const DiscFile *f, int fd, uint64_t offset, uint64_t len, uint64_t lba)
+{
+	if (job->numranges == job->maxranges)
+	{
+		size_t n = job->maxranges ? job->maxranges * 2 : 256;
+		BackupRange *tmp = realloc(job->ranges, n * sizeof(BackupRange));
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		job->ranges = tmp;
+		job->maxranges = n;
+	}
+
+	BackupRange *r = &job->ranges[job->numranges++];
+	r->file = f;
+	r->fd = fd;
+	r->offset = offset;
+	r->len = len;
+	r->lba = lba;
+	r->written = 0;
+
+	return 0;
+}
+
+int
+backup_addrange(BackupJob *job, const DiscFile *f, int fd, uint64_t offset, uint64_t len)
+{
+	if (offset >= f->size || len == 0)
+	{
+		return 0;
+	}
+	if (len > f->size - offset)
+	{
+		len = f->size - offset;
+	}
+
+	// Embedded data, directory trees and sparse extents have no position on disc, they sort last
+	if (f->data || f->numextents == 0)
+	{
+		return _backup_push(job, f, fd, offset, len, UINT64_MAX);
+	}
+
+	// Split at extent boundaries so every piece sorts by where it really is
+	int i;
+	for (i = 0; i < f->numextents; i++)
+	{
+		const DiscExtent *e = &f->extents[i];
+		if (e->offset + e->len <= offset || e->offset >= offset + len)
+		{
+			continue;
+		}
+
+		uint64_t from = offset > e->offset ? offset : e->offset;
+		uint64_t to = offset + len < e->offset + e->len ? offset + len : e->offset + e->len;
+		uint64_t lba = e->sparse ? UINT64_MAX : e->lba + (from - e->offset) / DISC_SECTOR_SIZE;
+
+		if (_backup_push(job, f, fd, from, to - from, lba) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void*
+_backup_writer(void *arg)
+{
+	BackupPool *pool = arg;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;)
+	{
+		while (pool->qcount == 0 && ! pool->done)
+		{
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		}
+		if (pool->qcount == 0)
+		{
+			break;
+		}
+
+		int idx = pool->queue[pool->qhead];
+		pool->qhead = (pool->qhead + 1) % pool->numbufs;
+		pool->qcount--;
+		pthread_mutex_unlock(&pool->lock);
+
+		BackupBuf *b = &pool->bufs[idx];
+		size_t put = 0;
+		int err = 0;
+		while (put < b->len)
+		{
+			ssize_t n = pwrite(b->fd, b->data + put, b->len - put, b->offset + put);
+			if (n < 0 && errno == EINTR) continue;
+			if (n < 0)
+			{
+				err = errno;
+				break;
+			}
+			put += n;
+		}
+
+		BackupRange *r = b->range;
+		int complete = 0;
+
+		pthread_mutex_lock(&pool->lock);
+		if (err && ! pool->err)
+		{
+			pool->err = err;
+		}
+		if (! err)
+		{
+			r->written += b->len;
+			complete = r->written == r->len && pool->journalfd >= 0;
+		}
+		pool->free[pool->numfree++] = idx;
+		pthread_cond_broadcast(&pool->cond);
+
+		if (complete)
+		{
+			// Record whole ranges once written so an interrupted copy can skip them, but only after
+			// the data is on disk: a record that got there first would skip what a crash lost
+			pthread_mutex_unlock(&pool->lock);
+			err = fdatasync(r->fd) < 0 ? errno : 0;
+			pthread_mutex_lock(&pool->lock);
+
+			if (err)
+			{
+				if (! pool->err)
+				{
+					pool->err = err;
+				}
+			}
+			else
+			{
+				dprintf(pool->journalfd, "%s %llu %llu\n", r->file->path, (unsigned long long)r->offset, (unsigned long long)r->len);
+			}
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+int
+backup_run(BackupJob *job)
+{
+	BackupPool pool;
+	pthread_t *writers = NULL;
+	int numwriters = 0;
+	int i;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.journalfd = job->journalfd;
+	job->err = 0;
+	job->bytes = 0;
+
+	double start = copy_now();
+
+	qsort(job->ranges, job->numranges, sizeof(BackupRange), _backup_cmp);
+
+	pool.numbufs = job->threads * 2 + 1;
+	pool.bufs = calloc(pool.numbufs, sizeof(BackupBuf));
+	pool.free = calloc(pool.numbufs, sizeof(int));
+	pool.queue = calloc(pool.numbufs, sizeof(int));
+	writers = calloc(job->threads, sizeof(pthread_t));
+	if (pool.bufs == NULL || pool.free == NULL || pool.queue == NULL || writers == NULL)
+	{
+		job->err = ENOMEM;
+		goto cleanup;
+	}
+	for (i = 0; i < pool.numbufs; i++)
+	{
+		pool.bufs[i].data = malloc(job->chunk);
+		if (pool.bufs[i].data == NULL)
+		{
+			job->err = ENOMEM;
+			goto cleanup;
+		}
+		pool.free[pool.numfree++] = i;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+	for (i = 0; i < job->threads; i++)
+	{
+		if (pthread_create(&writers[i], NULL, _backup_writer, &pool) != 0)
+		{
+			break;
+		}
+		numwriters++;
+	}
+	if (numwriters == 0)
+	{
+		job->err = EAGAIN;
+		goto stop;
+	}
+
+	size_t r;
+	for (r = 0; r < job->numranges && ! job->err; r++)
+	{
+		BackupRange *rg = &job->ranges[r];
+		uint64_t done = 0;
+
+		while (done < rg->len)
+		{
+			pthread_mutex_lock(&pool.lock);
+			while (pool.numfree == 0 && ! pool.err)
+			{
+				pthread_cond_wait(&pool.cond, &pool.lock);
+			}
+			if (pool.err)
+			{
+				job->err = pool.err;
+				pthread_mutex_unlock(&pool.lock);
+				break;
+			}
+			int idx = pool.free[--pool.numfree];
+			pthread_mutex_unlock(&pool.lock);
+
+			BackupBuf *b = &pool.bufs[idx];
+			size_t want = rg->len - done < job->chunk ? rg->len - done : job->chunk;
+
+			int64_t n = discfs_read(job->fs, rg->file, rg->offset + done, b->data, want);
+			if (n <= 0)
+			{
+				job->err = (n < 0 && errno) ? errno : EIO;
+				metrics_add(METRIC_READ_ERRORS, 1);
+				pthread_mutex_lock(&pool.lock);
+				pool.free[pool.numfree++] = idx;
+				pthread_mutex_unlock(&pool.lock);
+				break;
+			}
+
+			b->len = n;
+			b->fd = rg->fd;
+			b->offset = rg->offset + done;
+			b->range = rg;
+			done += n;
+			job->bytes += n;
+
+			pthread_mutex_lock(&pool.lock);
+			pool.queue[(pool.qhead + pool.qcount) % pool.numbufs] = idx;
+			pool.qcount++;
+			pthread_cond_broadcast(&pool.cond);
+			pthread_mutex_unlock(&pool.lock);
+		}
+	}
+
+stop:
+	pthread_mutex_lock(&pool.lock);
+	pool.done = 1;
+	pthread_cond_broadcast(&pool.cond);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (i = 0; i < numwriters; i++)
+	{
+		pthread_join(writers[i], NULL);
+	}
+	if (! job->err && pool.err)
+	{
+		job->err = pool.err;
+	}
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+
+cleanup:
+	job->seconds = copy_now() - start;
+	metrics_add(METRIC_BYTES_READ, job->bytes);
+
+	if (pool.bufs)
+	{
+		for (i = 0; i < pool.numbufs; i++)
+		{
+			free(pool.bufs[i].data);
+		}
+	}
+	free(pool.bufs);
+	free(pool.free);
+	free(pool.queue);
+	free(writers);
+
+	return job->err ? -1 : 0;
+}
+
+// Drop the ranges an earlier run recorded in the journal at @path, then append to it.
+// Sets *@skipped to the bytes already copied.
+int
+backup_journal(BackupJob *job, const char *path, uint64_t *skipped)
+{
+	*skipped = 0;
+
+	FILE *fp = fopen(path, "r");
+	if (fp != NULL)
+	{
+		char line[1024];
+		while (fgets(line, sizeof(line), fp) != NULL)
+		{
+			// "<path> <offset> <len>", split from the end
+			char *sp2 = strrchr(line, ' ');
+			if (sp2 == NULL) continue;
+			*sp2 = '\0';
+			char *sp1 = strrchr(line, ' ');
+			if (sp1 == NULL) continue;
+			*sp1 = '\0';
+
+			uint64_t offset = strtoull(sp1 + 1, NULL, 10);
+			uint64_t len = strtoull(sp2 + 1, NULL, 10);
+
+			size_t i;
+			for (i = 0; i < job->numranges; i++)
+			{
+				BackupRange *r = &job->ranges[i];
+				if (r->offset == offset && r->len == len && strcmp(r->file->path, line) == 0)
+				{
+					*skipped += r->len;
+					job->ranges[i] = job->ranges[--job->numranges];
+					break;
+				}
+			}
+		}
+		fclose(fp);
+	}
+
+	job->journalfd = open(path, O_WRONLY|O_CREAT|O_APPEND, 0644);
+	return job->journalfd < 0 ? -1 : 0;
+}
+
+void
+backup_free(BackupJob *job)
+{
+	free(job->ranges);
+	job->ranges = NULL;
+	job->numranges = job->maxranges = 0;
+
+	if (job->journalfd >= 0)
+	{
+		close(job->journalfd);
+	}
+	job->journalfd = -1;
+}
+
+// Whether every component of @path names an entry inside its directory, so joining it under a root stays there
+static int
+_backup_safepath(const char *path)
+{
+	const char *p = path;
+
+	for (;;)
+	{
+		const char *end = strchr(p, '/');
+		size_t len = end ? (size_t)(end - p) : strlen(p);
+
+		if (len == 0 || (len == 1 && p[0] == '.') || (len == 2 && p[0] == '.' && p[1] == '.'))
+		{
+			return 0;
+		}
+		if (end == NULL)
+		{
+			return 1;
+		}
+		p = end + 1;
+	}
+}
+
+// Create @path under @root along with its parent directories, sized to @size
+int
+backup_openout(const char *root, const char *path, uint64_t size)
+{
+	// Paths come from the disc, one with an empty, "." or ".." component could point anywhere
+	if (! _backup_safepath(path))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	size_t rl = strlen(root), pl = strlen(path);
+	char *full = malloc(rl + pl + 2);
+	if (full == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+	memcpy(full, root, rl);
+	full[rl] = '/';
+	memcpy(full + rl + 1, path, pl + 1);
+
+	// Every directory on the way, @root included
+	char *p;
+	for (p = full + 1; (p = strchr(p, '/')) != NULL; p++)
+	{
+		*p = '\0';
+		if (mkdir(full, 0755) < 0 && errno != EEXIST)
+		{
+			free(full);
+			return -1;
+		}
+		*p = '/';
+	}
+
+	// Not truncated, whatever is already there may be reused by a resumed copy; never through a symlink
+	int fd = open(full, O_WRONLY|O_CREAT|O_NOFOLLOW, 0644);
+	free(full);
+	if (fd < 0)
+	{
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || ((uint64_t)st.st_size != size && ftruncate(fd, (off_t)size) < 0))
+	{
+		int err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	return fd;
+}
+
+PyObject*
+BluRead_Backup(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	const char *src=NULL, *dst=NULL;
+	PyObject *filter=NULL;
+	int threads=4;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	static char *kwlist[] = {"Source", "Destination", "Filter", "Threads", "ChunkSize", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "ss|Oin", kwlist, &src, &dst, &filter, &threads, &chunk))
+	{
+		return NULL;
+	}
+
+	if (filter == Py_None)
+	{
+		filter = NULL;
+	}
+	if (filter && ! PyCallable_Check(filter))
+	{
+		PyErr_SetString(PyExc_TypeError, "Filter must be callable or None");
+		return NULL;
+	}
+	if (threads < 1 || threads > 64)
+	{
+		PyErr_Format(PyExc_ValueError, "Threads (%d) must be between 1 and 64", threads);
+		return NULL;
+	}
+	if (chunk < DISC_SECTOR_SIZE || chunk % DISC_SECTOR_SIZE != 0)
+	{
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must be a multiple of the 2048 byte sector", chunk);
+		return NULL;
+	}
+
+	DiscFS *fs;
+	Py_BEGIN_ALLOW_THREADS
+	fs = discfs_open(src);
+	Py_END_ALLOW_THREADS
+	if (fs == NULL)
+	{
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, src);
+	}
+
+	BackupJob job;
+	memset(&job, 0, sizeof(job));
+	job.fs = fs;
+	job.journalfd = -1;
+	job.threads = threads;
+	job.chunk = chunk;
+
+	int *fds = calloc(fs->numfiles + 1, sizeof(int));
+	size_t numfds = 0, i;
+	uint64_t size = 0;
+	PyObject *result = NULL;
+
+	if (fds == NULL)
+	{
+		PyErr_NoMemory();
+		goto cleanup;
+	}
+
+	for (i = 0; i < fs->numfiles; i++)
+	{
+		const DiscFile *f = &fs->files[i];
+		if (f->isdir)
+		{
+			continue;
+		}
+
+		if (filter)
+		{
+			PyObject *r = PyObject_CallFunction(filter, "s", f->path);
+			int keep = r ? PyObject_IsTrue(r) : -1;
+			Py_XDECREF(r);
+			if (keep < 0)
+			{
+				goto cleanup;
+			}
+			if (! keep)
+			{
+				continue;
+			}
+		}
+
+		int fd = backup_openout(dst, f->path, f->size);
+		if (fd < 0)
+		{
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, f->path);
+			goto cleanup;
+		}
+		fds[numfds++] = fd;
+
+		if (backup_addrange(&job, f, fd, 0, f->size) < 0)
+		{
+			PyErr_NoMemory();
+			goto cleanup;
+		}
+		size += f->size;
+	}
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = backup_run(&job);
+	Py_END_ALLOW_THREADS
+
+	if (ret < 0)
+	{
+		errno = job.err;
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, src);
+		goto cleanup;
+	}
+
+	result = Py_BuildValue("{s:n,s:K,s:K,s:d}",
+		"Files", (Py_ssize_t)numfds,
+		"Bytes", (unsigned long long)job.bytes,
+		"Size", (unsigned long long)size,
+		"Seconds", job.seconds);
+
+cleanup:
+	for (i = 0; i < numfds; i++)
+	{
+		if (close(fds[i]) < 0 && result)
+		{
+			Py_CLEAR(result);
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst);
+		}
+	}
+	free(fds);
+	backup_free(&job);
+	discfs_close(fs);
+
+	return result;
+}
@@ -0,0 +1,251 @@
+#include "bluread.h"
+
+#include <stdio.h>
+
+#include <filesystem.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// libbluray file system handlers
+//
+// bd_open_files() lets libbluray read the disc through our callbacks instead of its own
+// UDF reader, so any BlockSource (mmap'd image, ...) can back a Bluray.  Files and
+// directories come straight out of the DiscFS tree parsed when the disc was opened.
+
+// Read-ahead window requested ahead of sequential stream reads
+#define BDFS_READAHEAD (8*1024*1024)
+
+typedef struct {
+	DiscFS *fs;
+	const DiscFile *f;
+	int64_t pos;
+
+	int stream;        // M2TS/SSIF, read sequentially by bd_read()
+	uint64_t advised;  // file offset read-ahead has been requested up to
+} BDFSFile;
+
+typedef struct {
+	DiscFS *fs;
+	char *dir;
+	size_t pos;
+} BDFSDir;
+
+// Ask the source to bring in [@offset, @offset+@len) of @f
+static void
+_bdfs_willneed(DiscFS *fs, const DiscFile *f, uint64_t offset, uint64_t len)
+{
+	int i;
+	for (i = 0; i < f->numextents; i++)
+	{
+		const DiscExtent *e = &f->extents[i];
+		if (e->sparse || e->offset + e->len <= offset || e->offset >= offset + len)
+		{
+			continue;
+		}
+
+		uint64_t from = offset > e->offset ? offset - e->offset : 0;
+		uint64_t to = offset + len - e->offset;
+		if (to > e->len) to = e->len;
+
+		uint64_t first = from / DISC_SECTOR_SIZE;
+		uint64_t last = (to + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE;
+		source_willneed(fs->src, e->lba + first, last - first);
+	}
+}
+
+static void
+_bdfs_file_close(BD_FILE_H *file)
+{
+	free(file->internal);
+	free(file);
+}
+
+static int64_t
+_bdfs_file_seek(BD_FILE_H *file, int64_t offset, int32_t origin)
+{
+	BDFSFile *h = file->internal;
+	int64_t pos;
+
+	switch (origin)
+	{
+		case SEEK_SET: pos = offset; break;
+		case SEEK_CUR: pos = h->pos + offset; break;
+		case SEEK_END: pos = (int64_t)h->f->size + offset; break;
+		default: return -1;
+	}
+
+	if (pos < 0)
+	{
+		return -1;
+	}
+
+	// A jump elsewhere restarts read-ahead from there
+	if ((uint64_t)pos < h->advised && (uint64_t)pos + BDFS_READAHEAD < h->advised)
+	{
+		h->advised = pos;
+	}
+	else if ((uint64_t)pos > h->advised)
+	{
+		h->advised = pos;
+	}
+
+	h->pos = pos;
+	return pos;
+}
+
+static int64_t
+_bdfs_file_tell(BD_FILE_H *file)
+{
+	return ((BDFSFile*)file->internal)->pos;
+}
+
+static int
+_bdfs_file_eof(BD_FILE_H *file)
+{
+	BDFSFile *h = file->internal;
+	return (uint64_t)h->pos >= h->f->size;
+}
+
+static int64_t
+_bdfs_file_read(BD_FILE_H *file, uint8_t *buf, int64_t size)
+{
+	BDFSFile *h = file->internal;
+
+	if (size <= 0)
+	{
+		return 0;
+	}
+
+	if (h->stream && h->fs->src && (uint64_t)h->pos + BDFS_READAHEAD/2 >= h->advised)
+	{
+		uint64_t from = h->advised > (uint64_t)h->pos ? h->advised : (uint64_t)h->pos;
+		uint64_t to = (uint64_t)h->pos + BDFS_READAHEAD;
+		_bdfs_willneed(h->fs, h->f, from, to - from);
+		h->advised = to;
+	}
+
+	int64_t n = discfs_read(h->fs, h->f, h->pos, buf, (size_t)size);
+	if (n > 0)
+	{
+		h->pos += n;
+	}
+
+	return n;
+}
+
+static int64_t
+_bdfs_file_write(BD_FILE_H *file, const uint8_t *buf, int64_t size)
+{
+	// Read only
+	return -1;
+}
+
+static BD_FILE_H*
+_bdfs_file_open(void *handle, const char *filename)
+{
+	DiscFS *fs = handle;
+
+	const DiscFile *f = discfs_find(fs, filename);
+	if (f == NULL || f->isdir)
+	{
+		return NULL;
+	}
+
+	BD_FILE_H *file = calloc(1, sizeof(BD_FILE_H));
+	BDFSFile *h = calloc(1, sizeof(BDFSFile));
+	if (file == NULL || h == NULL)
+	{
+		free(file);
+		free(h);
+		return NULL;
+	}
+
+	size_t len = strlen(f->path);
+	h->fs = fs;
+	h->f = f;
+	h->stream = len > 5 && (strcasecmp(f->path + len - 5, ".m2ts") == 0 || strcasecmp(f->path + len - 5, ".ssif") == 0);
+
+	file->internal = h;
+	file->close = _bdfs_file_close;
+	file->seek = _bdfs_file_seek;
+	file->tell = _bdfs_file_tell;
+	file->eof = _bdfs_file_eof;
+	file->read = _bdfs_file_read;
+	file->write = _bdfs_file_write;
+
+	return file;
+}
+
+static void
+_bdfs_dir_close(BD_DIR_H *dir)
+{
+	BDFSDir *h = dir->internal;
+	free(h->dir);
+	free(h);
+	free(dir);
+}
+
+// Returns 0 with the next entry, 1 at the end
+static int
+_bdfs_dir_read(BD_DIR_H *dir, BD_DIRENT *entry)
+{
+	BDFSDir *h = dir->internal;
+
+	const DiscFile *f = discfs_next_child(h->fs, h->dir, &h->pos);
+	if (f == NULL)
+	{
+		return 1;
+	}
+
+	const char *name = strrchr(f->path, '/');
+	name = name ? name + 1 : f->path;
+
+	strncpy(entry->d_name, name, sizeof(entry->d_name) - 1);
+	entry->d_name[sizeof(entry->d_name) - 1] = '\0';
+
+	return 0;
+}
+
+static BD_DIR_H*
+_bdfs_dir_open(void *handle, const char *dirname)
+{
+	DiscFS *fs = handle;
+
+	// The root has no entry of its own
+	const char *p = dirname;
+	while (*p == '/') p++;
+	if (*p)
+	{
+		const DiscFile *f = discfs_find(fs, p);
+		if (f == NULL || ! f->isdir)
+		{
+			return NULL;
+		}
+	}
+
+	BD_DIR_H *dir = calloc(1, sizeof(BD_DIR_H));
+	BDFSDir *h = calloc(1, sizeof(BDFSDir));
+	char *copy = strdup(p);
+	if (dir == NULL || h == NULL || copy == NULL)
+	{
+		free(dir);
+		free(h);
+		free(copy);
+		return NULL;
+	}
+
+	h->fs = fs;
+	h->dir = copy;
+
+	dir->internal = h;
+	dir->close = _bdfs_dir_close;
+	dir->read = _bdfs_dir_read;
+
+	return dir;
+}
+
+int
+bdfs_open(BLURAY *bd, DiscFS *fs)
+{
+	return bd_open_files(bd, fs, _bdfs_dir_open, _bdfs_file_open);
+}
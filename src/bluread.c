@@ -12,9 +12,21 @@ typedef struct {
 	BLURAY *BR;
 	const BLURAY_DISC_INFO *info;
 
+	// Files libbluray reads through, when not opened by libbluray itself
+	DiscFS *fs;
+
 	PyObject* TitleClass;
 
 	int numtitles;
+
+	// Latency of the libbluray calls and objects made for this disc
+	StatSet *stats;
+
+	// Record of the disc once Detach()ed, the metadata getters and GetTitle() read it instead
+	PyObject *detached;
+
+	// Held across every use of BR, info, fs and detached, threads sharing a Bluray take turns with libbluray
+	pthread_mutex_t lock;
 } Bluray;
 
 typedef struct {
@@ -28,6 +40,8 @@ typedef struct {
 	PyObject* ChapterClass;
 	PyObject* ClipClass;
 
+	// PID -> measured bitrate, filled by SampleBitrates()
+	PyObject* bitrates;
 } Title;
 
 typedef struct {
@@ -79,14 +93,130 @@ typedef struct {
 	BLURAY_STREAM_INFO *info;
 } Subtitle;
 
-// Predefine them so they can be used below since their full definition references the functions below
-static PyTypeObject BlurayType;
-static PyTypeObject TitleType;
-static PyTypeObject ChapterType;
-static PyTypeObject ClipType;
-static PyTypeObject VideoType;
-static PyTypeObject AudioType;
-static PyTypeObject SubtitleType;
+// Detached copies of the above, read from a record made by snapshot_pack() (snapshot.c)
+typedef struct {
+	PyObject_HEAD
+	// Held while the snapshot lives, the record lies within it
+	Py_buffer view;
+
+	SnapshotTitle info;
+
+	PyObject* ChapterClass;
+	PyObject* ClipClass;
+} TitleSnapshot;
+
+typedef struct {
+	PyObject_HEAD
+	int chapternum;
+
+	TitleSnapshot *title;
+
+	SnapshotChapter info;
+} ChapterSnapshot;
+
+typedef struct {
+	PyObject_HEAD
+	int clipnum;
+
+	TitleSnapshot *title;
+
+	SnapshotClip info;
+
+	PyObject* VideoClass;
+	PyObject* AudioClass;
+	PyObject* SubtitleClass;
+} ClipSnapshot;
+
+// VideoSnapshot, AudioSnapshot and SubtitleSnapshot
+typedef struct {
+	PyObject_HEAD
+	int streamnum;
+
+	ClipSnapshot *clip;
+
+	SnapshotStream info;
+} StreamSnapshot;
+
+typedef struct {
+	PyObject_HEAD
+	// Held while the snapshot lives, the record lies @offset bytes into it
+	Py_buffer view;
+	Py_ssize_t offset;
+
+	SnapshotDisc info;
+
+	PyObject* TitleClass;
+} DiscSnapshot;
+
+typedef struct {
+	PyObject_HEAD
+	Py_buffer view;
+
+	SnapshotCatalog info;
+
+	PyObject* DiscClass;
+
+	// Released after the buffer, for whatever must outlive the mapping (the SharedMemory that made it)
+	PyObject* owner;
+} Catalog;
+
+// Per module state, the types are made for each (sub)interpreter that imports the module
+typedef struct {
+	PyObject *BlurayType;
+	PyObject *TitleType;
+	PyObject *ChapterType;
+	PyObject *ClipType;
+	PyObject *VideoType;
+	PyObject *AudioType;
+	PyObject *SubtitleType;
+
+	PyObject *TitleSnapshotType;
+	PyObject *ChapterSnapshotType;
+	PyObject *ClipSnapshotType;
+	PyObject *VideoSnapshotType;
+	PyObject *AudioSnapshotType;
+	PyObject *SubtitleSnapshotType;
+	PyObject *DiscSnapshotType;
+	PyObject *CatalogType;
+} BluReadState;
+
+// Predefine it so the state can be found from the types below
+static struct PyModuleDef BluReadModule;
+
+#if PY_VERSION_HEX < 0x030B0000
+// Python 3.9 and 3.10 lack it, find the first type in the MRO made by @def
+static PyObject*
+PyType_GetModuleByDef(PyTypeObject *type, PyModuleDef *def)
+{
+	PyObject *mro = type->tp_mro;
+	Py_ssize_t i;
+
+	for (i = 0; mro != NULL && i < PyTuple_GET_SIZE(mro); i++)
+	{
+		PyTypeObject *t = (PyTypeObject*)PyTuple_GET_ITEM(mro, i);
+		if (! (t->tp_flags & Py_TPFLAGS_HEAPTYPE))
+		{
+			continue;
+		}
+
+		PyObject *m = ((PyHeapTypeObject*)t)->ht_module;
+		if (m != NULL && PyModule_GetDef(m) == def)
+		{
+			return m;
+		}
+	}
+
+	PyErr_Format(PyExc_TypeError, "PyType_GetModuleByDef: No superclass of '%s' has the given module", type->tp_name);
+	return NULL;
+}
+#endif
+
+static BluReadState*
+_BluRead_getState(PyTypeObject *type)
+{
+	PyObject *m = PyType_GetModuleByDef(type, &BluReadModule);
+	return m ? PyModule_GetState(m) : NULL;
+}
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
@@ -110,9 +240,20 @@ Bluray_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 
 		self->BR = NULL;
 		self->info = NULL;
+		self->fs = NULL;
 		self->TitleClass = NULL;
+		self->detached = NULL;
 
 		self->numtitles = 0;
+
+		pthread_mutex_init(&self->lock, NULL);
+
+		self->stats = calloc(1, sizeof(StatSet));
+		if (self->stats == NULL)
+		{
+			Py_DECREF(self);
+			return PyErr_NoMemory();
+		}
 	}
 
 	return (PyObject*)self;
@@ -129,27 +270,39 @@ Bluray_init(Bluray *self, PyObject *args, PyObject *kwds)
 		return -1;
 	}
 
+	uint64_t start = STATS_START();
+	PyObject *oldpath, *oldkeydb;
+
+	Py_INCREF(path);
+	Py_INCREF(keydb);
+	Py_INCREF(titleclass);
+
+	bluread_lock(&self->lock);
+
 	// Allocated in Bluray_Open
 	self->BR = NULL;
 	self->info = NULL;
 
 	// Path
-	tmp = self->path;
+	oldpath = self->path;
 	self->path = path;
-	Py_INCREF(path);
-	Py_CLEAR(tmp);
 
 	// Path
-	tmp = self->keydb;
+	oldkeydb = self->keydb;
 	self->keydb = keydb;
-	Py_INCREF(keydb);
-	Py_CLEAR(tmp);
 
 	// TitleClass
 	tmp = self->TitleClass;
 	self->TitleClass = titleclass;
-	Py_INCREF(titleclass);
-	Py_CLEAR(tmp);
+
+	pthread_mutex_unlock(&self->lock);
+
+	// Outside the lock, these can run arbitrary code
+	Py_XDECREF(oldpath);
+	Py_XDECREF(oldkeydb);
+	Py_XDECREF(tmp);
+
+	STATS_END(self->stats, STAT_NEW_BLURAY, start);
 
 	return 0;
 }
@@ -167,69 +320,177 @@ Bluray_dealloc(Bluray *self)
 	self->BR = NULL;
 	self->info = NULL; // an inner structure of BLURAY, nothing to free
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	free(self->stats);
+	self->stats = NULL;
+
+	pthread_mutex_destroy(&self->lock);
+
+	Py_CLEAR(self->TitleClass);
+	Py_CLEAR(self->detached);
+
+	// Instances of heap types hold a reference to their type
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
 // Interface stuff for Bluray
 
+// Read without the lock, it is only set once everything else is in place and cleared before it is torn down
 static int
 _Bluray_getIsOpen(Bluray *self)
 {
-	return !!self->BR;
+	return __atomic_load_n(&self->BR, __ATOMIC_ACQUIRE) != NULL;
+}
+
+// Locks @self if it is open, otherwise sets the error and returns -1
+static int
+_Bluray_lockOpen(Bluray *self)
+{
+	bluread_lock(&self->lock);
+	if (self->BR == NULL)
+	{
+		pthread_mutex_unlock(&self->lock);
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return -1;
+	}
+
+	return 0;
+}
+
+// Once Detach()ed, sets @ret to attribute @name of the record (NULL with an exception if that fails)
+// and returns 1, returns 0 while @self is not detached
+static int
+_Bluray_detached(Bluray *self, const char *name, PyObject **ret)
+{
+	bluread_lock(&self->lock);
+	PyObject *d = self->detached;
+	Py_XINCREF(d);
+	pthread_mutex_unlock(&self->lock);
+
+	if (d == NULL)
+	{
+		return 0;
+	}
+
+	*ret = PyObject_GetAttrString(d, name);
+	Py_DECREF(d);
+	return 1;
+}
+
+// Tears down the open disc, with the lock held
+static void
+_Bluray_close(Bluray *self)
+{
+	BLURAY *bd = self->BR;
+
+	// Closed before anything is torn down, so titles see it closed rather than half gone
+	__atomic_store_n(&self->BR, NULL, __ATOMIC_RELEASE);
+	self->info = NULL;
+
+	// bd_close() calls free() on the BLURAY object itself, so nothing to match bd_init()
+	uint64_t start = STATS_START();
+	bd_close(bd);
+	STATS_END(self->stats, STAT_BD_CLOSE, start);
+
+	discfs_close(self->fs);
+	self->fs = NULL;
+
+	self->numtitles = 0;
 }
 
 static PyObject*
 Bluray_getPath(Bluray *self)
 {
-	if (self->path == NULL)
+	bluread_lock(&self->lock);
+	PyObject *ret = self->path;
+	Py_XINCREF(ret);
+	pthread_mutex_unlock(&self->lock);
+
+	if (ret == NULL)
 	{
 		PyErr_SetString(PyExc_AttributeError, "_path");
-		return NULL;
 	}
-
-	Py_INCREF(self->path);
-	return self->path;
+	return ret;
 }
 
 static PyObject*
 Bluray_getKeyDB(Bluray *self)
 {
-	if (self->keydb == NULL)
+	bluread_lock(&self->lock);
+	PyObject *ret = self->keydb;
+	Py_XINCREF(ret);
+	pthread_mutex_unlock(&self->lock);
+
+	if (ret == NULL)
 	{
 		PyErr_SetString(PyExc_AttributeError, "_keydb");
-		return NULL;
 	}
+	return ret;
+}
+
+// Copies at most @size - 1 bytes of the id @src, which need not be terminated within them (or be there at all)
+static void
+_Bluray_copyid(char *dst, size_t size, const char *src)
+{
+	size_t len = 0;
+	if (src != NULL)
+	{
+		len = strnlen(src, size - 1);
+		memcpy(dst, src, len);
+	}
+	dst[len] = '\0';
+}
 
-	Py_INCREF(self->keydb);
-	return self->keydb;
+// Copies what VolumeId, DiscId and OrgId return, with the lock held on an open disc
+static void
+_Bluray_ids(Bluray *self, char volid[33], char discid[37], char orgid[13])
+{
+	_Bluray_copyid(volid, 33, self->info->udf_volume_id);
+	_Bluray_copyid(discid, 34, self->info->bdj_disc_id);
+	_Bluray_copyid(orgid, 10, self->info->bdj_org_id);
 }
 
 static PyObject*
 Bluray_getVolumeId(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	PyObject *ret;
+	if (_Bluray_detached(self, "VolumeId", &ret))
+	{
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyUnicode_FromString(self->info->udf_volume_id);
+	char volid[33], discid[37], orgid[13];
+	_Bluray_ids(self, volid, discid, orgid);
+	pthread_mutex_unlock(&self->lock);
+
+	return PyUnicode_FromString(volid);
 }
 
 static PyObject*
 Bluray_getDiscId(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	PyObject *ret;
+	if (_Bluray_detached(self, "DiscId", &ret))
+	{
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	char discid[34];
-	strncpy(discid, self->info->bdj_disc_id, 33);
-	discid[33] = '\0';
+	char volid[33], discid[37], orgid[13];
+	_Bluray_ids(self, volid, discid, orgid);
+	pthread_mutex_unlock(&self->lock);
 
 	return PyUnicode_FromString(discid);
 }
@@ -237,15 +498,20 @@ Bluray_getDiscId(Bluray *self)
 static PyObject*
 Bluray_getOrgId(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	PyObject *ret;
+	if (_Bluray_detached(self, "OrgId", &ret))
+	{
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	char orgid[10];
-	strncpy(orgid, self->info->bdj_disc_id, 9);
-	orgid[9] = '\0';
+	char volid[33], discid[37], orgid[13];
+	_Bluray_ids(self, volid, discid, orgid);
+	pthread_mutex_unlock(&self->lock);
 
 	return PyUnicode_FromString(orgid);
 }
@@ -253,25 +519,41 @@ Bluray_getOrgId(Bluray *self)
 static PyObject*
 Bluray_getNumberOfTitles(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	PyObject *ret;
+	if (_Bluray_detached(self, "NumberOfTitles", &ret))
+	{
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->numtitles);
+	int num = self->numtitles;
+	pthread_mutex_unlock(&self->lock);
+
+	return PyLong_FromLong((long)num);
 }
 
 static PyObject*
 Bluray_getMainTitleNumber(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	PyObject *ret;
+	if (_Bluray_detached(self, "MainTitleNumber", &ret))
+	{
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
+	uint64_t start = STATS_START();
 	int num = bd_get_main_title(self->BR);
+	STATS_END(self->stats, STAT_BD_GET_MAIN_TITLE, start);
+	pthread_mutex_unlock(&self->lock);
 	if (num < 0)
 	{
 		PyErr_SetString(PyExc_Exception, "Unable to get main title number");
@@ -299,64 +581,220 @@ Bluray_getIsOpen(Bluray *self)
 static PyObject*
 Bluray_Open(Bluray *self, PyObject *args, PyObject *kwargs)
 {
-	if (_Bluray_getIsOpen(self))
+	// defaults to No flags (0) and no minimum title time (0)
+	// backend picks who reads the disc: libbluray itself (None), an mmap of the image ("mmap") or a
+	// seekable zstd image ("zstd", also picked for None when the path is one)
+	// prefetch reads all playlists and clip info in one LBA ordered sweep before libbluray parses them
+	// cache is the size in bytes of a block cache between libbluray and the disc, 0 for none
+	int flags = 0;
+	int minTime = 0;
+	const char *backend = NULL;
+	int prefetch = 0;
+	Py_ssize_t cache = -1;
+	static char *kwlist[] = {"flags", "min_duration", "backend", "prefetch", "cache", NULL};
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|iizpn", kwlist, &flags, &minTime, &backend, &prefetch, &cache)) {
+		return NULL;
+	}
+
+	if (backend != NULL && strcmp(backend, "mmap") != 0 && strcmp(backend, "zstd") != 0)
+	{
+		PyErr_Format(PyExc_ValueError, "Unknown backend '%s', expected None, 'mmap' or 'zstd'", backend);
+		return NULL;
+	}
+
+	// Held until the disc is open or given up on, another thread opening or closing it waits
+	bluread_lock(&self->lock);
+
+	if (self->BR != NULL)
 	{
+		pthread_mutex_unlock(&self->lock);
 		PyErr_SetString(PyExc_Exception, "Device is already open, first Close() it to re-open");
 		return NULL;
 	}
 
-	char *charpath = PyUnicode_AsUTF8(self->path);
-	if (charpath == NULL)
+	// Path may also be an image in memory (buffer) or a seekable file-like object
+	BlockSource *src = NULL;
+	const char *charpath = NULL;
+	if (PyUnicode_Check(self->path))
+	{
+		charpath = PyUnicode_AsUTF8(self->path);
+		if (charpath == NULL)
+		{
+			pthread_mutex_unlock(&self->lock);
+			return NULL;
+		}
+	}
+	else if (PyObject_CheckBuffer(self->path))
+	{
+		src = source_open_buffer(self->path);
+	}
+	else if (PyObject_HasAttrString(self->path, "read") && PyObject_HasAttrString(self->path, "seek"))
+	{
+		src = source_open_pyfile(self->path, cache > 0 ? (size_t)cache : PYFILE_CACHE_SIZE);
+	}
+	else
+	{
+		pthread_mutex_unlock(&self->lock);
+		PyErr_SetString(PyExc_TypeError, "Path must be a str, a buffer or a seekable file-like object");
+		return NULL;
+	}
+	if (charpath == NULL && src == NULL)
 	{
+		pthread_mutex_unlock(&self->lock);
 		return NULL;
 	}
 
+	// libbluray cannot read compressed images itself
+	if (charpath != NULL && backend == NULL && zimage_probe(charpath))
+	{
+		backend = "zstd";
+	}
+
 	char *keyfile_charpath = NULL;
+	StatSet *stats = self->stats;
+	int opened = 0, numtitles = 0;
+	const BLURAY_DISC_INFO *info = NULL;
 
 	// Allocate space for BLURAY structure
-	self->BR = bd_init();
+	uint64_t openstart = stats_now();
+	uint64_t start = STATS_START();
+	BLURAY *bd = bd_init();
+	STATS_END(stats, STAT_BD_INIT, start);
 
-	if (! bd_open_disc(self->BR, charpath, keyfile_charpath))
+	if (charpath != NULL && (backend != NULL || prefetch || cache > 0))
 	{
-		PyErr_SetString(PyExc_Exception, "Failed to open device");
-		goto error;
+		// Prefetching and caching need our own file layer, plain reads of the device will do under it
+		if (backend == NULL)
+		{
+			src = source_open_fd(charpath);
+		}
+		else if (strcmp(backend, "zstd") == 0)
+		{
+			src = source_open_zstd(charpath);
+		}
+		else
+		{
+			src = source_open_mmap(charpath);
+		}
+		if (src != NULL && cache > 0)
+		{
+			src = source_cache(src, (size_t)cache);
+		}
+		if (src == NULL)
+		{
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, charpath);
+			goto error;
+		}
 	}
 
-	// Get basic disc information
-	self->info = bd_get_disc_info(self->BR);
-	if (self->info == NULL)
+	if (src != NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Failed to get disc info");
-		goto error;
+		self->fs = discfs_open_source(src);
+		if (self->fs == NULL)
+		{
+			if (! PyErr_Occurred())
+			{
+				PyErr_SetFromErrno(PyExc_OSError);
+			}
+			goto error;
+		}
+
+		if (prefetch)
+		{
+			static const char *dirs[] = {"BDMV", "BDMV/PLAYLIST", "BDMV/CLIPINF", NULL};
+			uint64_t bytes;
+			int ret;
+
+			Py_BEGIN_ALLOW_THREADS
+			ret = discfs_preload(self->fs, dirs, &bytes);
+			Py_END_ALLOW_THREADS
+
+			if (ret < 0)
+			{
+				PyErr_SetFromErrno(PyExc_OSError);
+				goto error;
+			}
+		}
 	}
 
-	// defaults to No flags (0) and no minimum title time (0)
-    int flags = 0;
-    int minTime = 0;
-    static char *kwlist[] = {"flags", "min_duration", NULL};
-	if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ii", kwlist, &flags, &minTime)) {
-        return NULL;
+	// libbluray parses the disc without needing Python, file-like objects take the GIL themselves
+	DiscFS *fs = self->fs;
+	Py_BEGIN_ALLOW_THREADS
+	if (fs != NULL)
+	{
+		start = STATS_START();
+		opened = bdfs_open(bd, fs);
+		STATS_END(stats, STAT_BD_OPEN_FILES, start);
+	}
+	else
+	{
+		start = STATS_START();
+		opened = bd_open_disc(bd, charpath, keyfile_charpath);
+		STATS_END(stats, STAT_BD_OPEN_DISC, start);
+	}
+
+	if (opened)
+	{
+		// Get basic disc information
+		start = STATS_START();
+		info = bd_get_disc_info(bd);
+		STATS_END(stats, STAT_BD_GET_DISC_INFO, start);
+	}
+
+	if (info != NULL)
+	{
+		start = STATS_START();
+		numtitles = bd_get_titles(bd, flags, minTime);
+		STATS_END(stats, STAT_BD_GET_TITLES, start);
 	}
+	Py_END_ALLOW_THREADS
 
-	self->numtitles = bd_get_titles(self->BR, flags, minTime);
-	if (self->numtitles <= 0)
+	if (! opened)
+	{
+		PyErr_SetString(PyExc_Exception, "Failed to open device");
+		goto error;
+	}
+	if (info == NULL)
+	{
+		PyErr_SetString(PyExc_Exception, "Failed to get disc info");
+		goto error;
+	}
+	if (numtitles <= 0)
 	{
 		PyErr_SetString(PyExc_Exception, "Failed to get titles");
 		goto error;
 	}
 
+	self->info = info;
+	self->numtitles = numtitles;
+	__atomic_store_n(&self->BR, bd, __ATOMIC_RELEASE);
+
+	// Reading the disc again replaces what was detached from it
+	PyObject *detached = self->detached;
+	self->detached = NULL;
+	pthread_mutex_unlock(&self->lock);
+	Py_XDECREF(detached);
+
+	metrics_open(openstart, 1);
+
 	Py_INCREF(Py_None);
 	return Py_None;
 
 error:
-	if (self->BR)
+	metrics_open(openstart, 0);
+
+	if (bd)
 	{
-		bd_close(self->BR);
+		start = STATS_START();
+		bd_close(bd);
+		STATS_END(stats, STAT_BD_CLOSE, start);
 	}
-	self->BR = NULL;
-	self->info = NULL;
 
-	self->numtitles = 0;
+	// After bd_close(), libbluray reads through it until then
+	discfs_close(self->fs);
+	self->fs = NULL;
+
+	pthread_mutex_unlock(&self->lock);
 
 	return NULL;
 }
@@ -364,28 +802,89 @@ error:
 static PyObject*
 Bluray_Close(Bluray *self)
 {
-	if (! _Bluray_getIsOpen(self))
+	bluread_lock(&self->lock);
+
+	// A detached disc was already closed, closing it drops the record
+	PyObject *detached = self->detached;
+	self->detached = NULL;
+
+	if (self->BR == NULL && detached == NULL)
 	{
+		pthread_mutex_unlock(&self->lock);
 		PyErr_SetString(PyExc_Exception, "Device not open, cannot close it");
 		return NULL;
 	}
 
-	if (self->BR)
+	if (self->BR != NULL)
 	{
-		// bd_close() calls free() on the BLURAY object itself, so nothing to match bd_init()
-		bd_close(self->BR);
+		_Bluray_close(self);
 	}
-	self->BR = NULL;
-	self->info = NULL;
 
-	self->numtitles = 0;
+	pthread_mutex_unlock(&self->lock);
+	Py_XDECREF(detached);
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
 static PyObject*
-Bluray_GetTitle(Bluray *self, PyObject *args, PyObject *kwds)
+Bluray_CacheStats(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	int reset=0;
+	static char *kwlist[] = {"Reset", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|p", kwlist, &reset))
+	{
+		return NULL;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
+	{
+		return NULL;
+	}
+
+	CacheStats st;
+	int ret = self->fs == NULL ? -1 : source_cachestats(self->fs->src, &st, reset);
+	pthread_mutex_unlock(&self->lock);
+
+	if (ret < 0)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return Py_BuildValue("{s:K,s:K,s:K,s:K,s:n,s:n}",
+		"Hits", (unsigned long long)st.hits,
+		"Misses", (unsigned long long)st.misses,
+		"Evictions", (unsigned long long)st.evictions,
+		"Bypassed", (unsigned long long)st.bypassed,
+		"Blocks", (Py_ssize_t)st.blocks,
+		"BlockSize", (Py_ssize_t)st.blocksize);
+}
+
+// Counters outlive Close() so an open and scan can be looked at afterwards
+static PyObject*
+Bluray_Stats(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	int reset=0;
+	static char *kwlist[] = {"Reset", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|p", kwlist, &reset))
+	{
+		return NULL;
+	}
+
+	PyObject *ret = stats_topython(self->stats);
+	if (ret != NULL && reset)
+	{
+		stats_reset(self->stats);
+	}
+
+	return ret;
+}
+
+static PyObject*
+Bluray_CopyTitles(Bluray *self, PyObject *args, PyObject *kwds)
 {
 	if (! _Bluray_getIsOpen(self))
 	{
@@ -393,269 +892,2902 @@ Bluray_GetTitle(Bluray *self, PyObject *args, PyObject *kwds)
 		return NULL;
 	}
 
-	int num=0;
-	static char *kwlist[] = {"Num", NULL};
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return NULL;
+	}
+	PyTypeObject *titletype = (PyTypeObject*)state->TitleType;
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	PyObject *titles=NULL;
+	const char *dst=NULL;
+	int metadata=1, threads=4;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	static char *kwlist[] = {"Titles", "Destination", "Metadata", "Threads", "ChunkSize", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Os|pin", kwlist, &titles, &dst, &metadata, &threads, &chunk))
 	{
 		return NULL;
 	}
 
-	if (num < 0)
+	if (threads < 1 || threads > 64)
 	{
-		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative", num);
+		PyErr_Format(PyExc_ValueError, "Threads (%d) must be between 1 and 64", threads);
 		return NULL;
 	}
-	if (num > self->numtitles)
+	if (chunk < DISC_SECTOR_SIZE || chunk % DISC_SECTOR_SIZE != 0)
 	{
-		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative but it exceeds the number (%d) of available titles", num,self->numtitles);
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must be a multiple of the 2048 byte sector", chunk);
 		return NULL;
 	}
 
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
+	// Title numbers or Title objects, one or many
+	PyObject *seq = PyObject_TypeCheck(titles, titletype) || PyLong_Check(titles) ? PyTuple_Pack(1, titles) : PySequence_Fast(titles, "Titles must be a title or a sequence of titles");
+	if (seq == NULL)
 	{
 		return NULL;
 	}
 
-	return PyObject_CallObject(self->TitleClass, a);
-}
-
+	Py_ssize_t n = PySequence_Fast_GET_SIZE(seq), i;
+	uint32_t *nums = PyMem_Malloc((n ? n : 1) * sizeof(uint32_t));
+	if (nums == NULL)
+	{
+		Py_DECREF(seq);
+		return PyErr_NoMemory();
+	}
+	for (i = 0; i < n; i++)
+	{
+		PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+		long num = PyObject_TypeCheck(item, titletype) ? ((Title*)item)->titlenum : PyLong_AsLong(item);
+		if (num == -1 && PyErr_Occurred())
+		{
+			PyMem_Free(nums);
+			Py_DECREF(seq);
+			return NULL;
+		}
+		if (num < 0 || num > INT_MAX)
+		{
+			PyErr_Format(PyExc_Exception, "Title number (%ld) must be non-negative", num);
+			PyMem_Free(nums);
+			Py_DECREF(seq);
+			return NULL;
+		}
+		nums[i] = (uint32_t)num;
+	}
+	Py_DECREF(seq);
 
-static PyMemberDef Bluray_members[] = {
-	{"_path", T_OBJECT_EX, offsetof(Bluray, path), 0, "Path of Bluray device"},
+	// Other threads wait for the BLURAY and file tree until the copy is done
+	if (_Bluray_lockOpen(self) < 0)
+	{
+		PyMem_Free(nums);
+		return NULL;
+	}
+	for (i = 0; i < n; i++)
+	{
+		if (nums[i] >= (uint32_t)self->numtitles)
+		{
+			PyErr_Format(PyExc_Exception, "Title number (%ld) is not between 0 and %d", (long)nums[i], self->numtitles - 1);
+			pthread_mutex_unlock(&self->lock);
+			PyMem_Free(nums);
+			return NULL;
+		}
+	}
+
+	// Reuse the file tree libbluray reads through, otherwise parse the device or image
+	DiscFS *fs = self->fs;
+	if (fs == NULL)
+	{
+		const char *path = PyUnicode_Check(self->path) ? PyUnicode_AsUTF8(self->path) : NULL;
+		if (path == NULL)
+		{
+			pthread_mutex_unlock(&self->lock);
+			PyMem_Free(nums);
+			if (! PyErr_Occurred()) PyErr_SetString(PyExc_TypeError, "Path must be a str");
+			return NULL;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		fs = discfs_open(path);
+		Py_END_ALLOW_THREADS
+		if (fs == NULL)
+		{
+			pthread_mutex_unlock(&self->lock);
+			PyMem_Free(nums);
+			return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+		}
+	}
+
+	PyObject *result = extents_copy(self->BR, fs, nums, n, dst, metadata, threads, chunk);
+
+	if (fs != self->fs)
+	{
+		discfs_close(fs);
+	}
+	pthread_mutex_unlock(&self->lock);
+	PyMem_Free(nums);
+
+	return result;
+}
+
+static PyObject*
+Bluray_GetTitle(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	PyObject *get;
+	if (_Bluray_detached(self, "GetTitle", &get))
+	{
+		if (get == NULL)
+		{
+			return NULL;
+		}
+		PyObject *ret = PyObject_CallFunction(get, "i", num);
+		Py_DECREF(get);
+		return ret;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
+	{
+		return NULL;
+	}
+
+	int numtitles = self->numtitles;
+	PyObject *titleclass = self->TitleClass;
+	Py_INCREF(titleclass);
+	pthread_mutex_unlock(&self->lock);
+
+	if (num < 0)
+	{
+		Py_DECREF(titleclass);
+		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if (num > numtitles)
+	{
+		Py_DECREF(titleclass);
+		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative but it exceeds the number (%d) of available titles", num,numtitles);
+		return NULL;
+	}
+
+	// Title_init() takes the lock again for the title info, if the disc was closed meanwhile it says so
+	PyObject *ret = PyObject_CallFunction(titleclass, "Oi", self, num);
+	Py_DECREF(titleclass);
+
+	return ret;
+}
+
+// Sets the bit in @set of every code in @value, an int or an iterable of them, or every bit for None
+static int
+_Query_codes(uint8_t set[32], PyObject *value, const char *name)
+{
+	if (value == NULL || value == Py_None)
+	{
+		memset(set, 0xFF, 32);
+		return 0;
+	}
+
+	memset(set, 0, 32);
+
+	PyObject *seq = PyLong_Check(value) ? PyTuple_Pack(1, value) : PySequence_Fast(value, name);
+	if (seq == NULL)
+	{
+		return -1;
+	}
+
+	Py_ssize_t i;
+	for (i = 0; i < PySequence_Fast_GET_SIZE(seq); i++)
+	{
+		long code = PyLong_AsLong(PySequence_Fast_GET_ITEM(seq, i));
+		if (code == -1 && PyErr_Occurred())
+		{
+			Py_DECREF(seq);
+			return -1;
+		}
+		if (code < 0 || code > 0xFF)
+		{
+			Py_DECREF(seq);
+			PyErr_Format(PyExc_ValueError, "%s (%ld) must be between 0 and 255", name, code);
+			return -1;
+		}
+		set[code >> 3] |= 1 << (code & 7);
+	}
+
+	Py_DECREF(seq);
+	return 0;
+}
+
+// Fills @sq from a stream condition: True (a stream of the kind), False (none), or a dict of the
+// CodingType, Format and Language a stream must have, each a value or an iterable of those allowed
+static int
+_Query_stream(SnapshotStreamQuery *sq, int kind, PyObject *value)
+{
+	memset(sq, 0, sizeof(*sq));
+	sq->kind = kind;
+
+	if (PyBool_Check(value))
+	{
+		sq->present = value == Py_True;
+		_Query_codes(sq->codings, NULL, NULL);
+		_Query_codes(sq->formats, NULL, NULL);
+		return 0;
+	}
+	if (! PyDict_Check(value))
+	{
+		PyErr_SetString(PyExc_TypeError, "Stream conditions must be True, False, a dict or a list of dicts");
+		return -1;
+	}
+
+	PyObject *key, *item;
+	Py_ssize_t pos = 0;
+	while (PyDict_Next(value, &pos, &key, &item))
+	{
+		if (! PyUnicode_Check(key) || (PyUnicode_CompareWithASCIIString(key, "CodingType") != 0 && PyUnicode_CompareWithASCIIString(key, "Format") != 0 && PyUnicode_CompareWithASCIIString(key, "Language") != 0))
+		{
+			PyErr_Format(PyExc_KeyError, "Unknown stream condition %R, expected CodingType, Format or Language", key);
+			return -1;
+		}
+	}
+
+	sq->present = 1;
+	if (_Query_codes(sq->codings, PyDict_GetItemString(value, "CodingType"), "CodingType") < 0
+		|| _Query_codes(sq->formats, PyDict_GetItemString(value, "Format"), "Format") < 0)
+	{
+		return -1;
+	}
+
+	PyObject *langs = PyDict_GetItemString(value, "Language");
+	if (langs == NULL || langs == Py_None)
+	{
+		return 0;
+	}
+
+	PyObject *seq = PyUnicode_Check(langs) ? PyTuple_Pack(1, langs) : PySequence_Fast(langs, "Language must be a str or an iterable of them");
+	if (seq == NULL)
+	{
+		return -1;
+	}
+
+	Py_ssize_t i, n = PySequence_Fast_GET_SIZE(seq);
+	sq->langs = PyMem_Calloc(n ? n : 1, sizeof(*sq->langs));
+	if (sq->langs == NULL)
+	{
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return -1;
+	}
+	for (i = 0; i < n; i++)
+	{
+		Py_ssize_t len;
+		const char *lang = PyUnicode_Check(PySequence_Fast_GET_ITEM(seq, i)) ? PyUnicode_AsUTF8AndSize(PySequence_Fast_GET_ITEM(seq, i), &len) : NULL;
+		if (lang == NULL || len != 3)
+		{
+			Py_DECREF(seq);
+			if (! PyErr_Occurred())
+			{
+				PyErr_SetString(PyExc_ValueError, "Language must be a 3 letter code such as 'eng'");
+			}
+			return -1;
+		}
+		memcpy(sq->langs[i], lang, 3);
+	}
+	sq->numlangs = n;
+
+	Py_DECREF(seq);
+	return 0;
+}
+
+static void
+_Query_free(SnapshotQuery *q)
+{
+	uint32_t i;
+
+	for (i = 0; i < q->numstreams; i++)
+	{
+		PyMem_Free(q->streams[i].langs);
+	}
+	PyMem_Free(q->streams);
+	q->streams = NULL;
+	q->numstreams = 0;
+}
+
+// Fills @q from the arguments of FindTitles(), _Query_free() it afterwards either way
+static int
+_Query_parse(SnapshotQuery *q, PyObject *args, PyObject *kwds)
+{
+	PyObject *conds[3] = {NULL, NULL, NULL};
+	static char *kwlist[] = {"MinLength", "MaxLength", "MinChapters", "MaxChapters", "Video", "Audio", "Subtitle", NULL};
+
+	memset(q, 0, sizeof(*q));
+	q->maxlength = UINT64_MAX;
+	q->maxchapters = UINT32_MAX;
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|$KKIIOOO", kwlist, &q->minlength, &q->maxlength, &q->minchapters, &q->maxchapters, &conds[SNAPSHOT_VIDEO], &conds[SNAPSHOT_AUDIO], &conds[SNAPSHOT_SUBTITLE]))
+	{
+		return -1;
+	}
+
+	// Each kind takes one condition or a list of them that must all hold
+	Py_ssize_t n = 0;
+	int kind;
+	for (kind = 0; kind < 3; kind++)
+	{
+		if (conds[kind] != NULL && conds[kind] != Py_None)
+		{
+			n += PyList_Check(conds[kind]) || PyTuple_Check(conds[kind]) ? PySequence_Size(conds[kind]) : 1;
+		}
+	}
+
+	q->streams = PyMem_Calloc(n ? n : 1, sizeof(*q->streams));
+	if (q->streams == NULL)
+	{
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	for (kind = 0; kind < 3; kind++)
+	{
+		PyObject *c = conds[kind];
+		if (c == NULL || c == Py_None)
+		{
+			continue;
+		}
+		if (! PyList_Check(c) && ! PyTuple_Check(c))
+		{
+			if (_Query_stream(&q->streams[q->numstreams++], kind, c) < 0)
+			{
+				return -1;
+			}
+			continue;
+		}
+
+		Py_ssize_t i;
+		for (i = 0; i < PySequence_Fast_GET_SIZE(c); i++)
+		{
+			if (_Query_stream(&q->streams[q->numstreams++], kind, PySequence_Fast_GET_ITEM(c, i)) < 0)
+			{
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// Packs the disc record of @self into a bytes object, with the disc it was read from in @bd and,
+// if @infosizes is not NULL, what libbluray held for each title info in a PyMem_Malloc()ed array
+static PyObject*
+_Bluray_packDisc(Bluray *self, BLURAY **bd, size_t **infosizes)
+{
+	SnapshotDisc d;
+	memset(&d, 0, sizeof(d));
+
+	// Paths are kept as given, images in memory and file-like objects have none
+	bluread_lock(&self->lock);
+	PyObject *path = self->path;
+	Py_XINCREF(path);
+	pthread_mutex_unlock(&self->lock);
+
+	d.path = "";
+	if (path != NULL && PyUnicode_Check(path))
+	{
+		Py_ssize_t len;
+		d.path = PyUnicode_AsUTF8AndSize(path, &len);
+		if (d.path == NULL)
+		{
+			Py_DECREF(path);
+			return NULL;
+		}
+		d.pathlen = len;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
+	{
+		Py_XDECREF(path);
+		return NULL;
+	}
+
+	d.numtitles = self->numtitles;
+	_Bluray_ids(self, d.volumeid, d.discid, d.orgid);
+
+	BLURAY_TITLE_INFO **infos = PyMem_Calloc(d.numtitles ? d.numtitles : 1, sizeof(*infos));
+	if (infos == NULL)
+	{
+		pthread_mutex_unlock(&self->lock);
+		Py_XDECREF(path);
+		return PyErr_NoMemory();
+	}
+
+	// Parse every title without the GIL, as Title_init() does
+	*bd = self->BR;
+	StatSet *stats = self->stats;
+	uint32_t i, got = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	uint64_t start = STATS_START();
+	d.main = bd_get_main_title(*bd);
+	STATS_END(stats, STAT_BD_GET_MAIN_TITLE, start);
+
+	for (got = 0; got < d.numtitles; got++)
+	{
+		start = STATS_START();
+		infos[got] = bd_get_title_info(*bd, got, 0);
+		STATS_END(stats, STAT_BD_GET_TITLE_INFO, start);
+		if (infos[got] == NULL)
+		{
+			break;
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_unlock(&self->lock);
+	metrics_add(METRIC_TITLES, got);
+
+	PyObject *rec = NULL;
+	size_t *sizes = NULL;
+	if (got < d.numtitles)
+	{
+		PyErr_Format(PyExc_Exception, "Failed to get title information for title %u from disc", got);
+	}
+	else
+	{
+		rec = PyBytes_FromStringAndSize(NULL, snapshot_disc_size(&d, infos));
+		if (rec != NULL && snapshot_pack_disc((uint8_t*)PyBytes_AS_STRING(rec), &d, infos) < 0)
+		{
+			Py_CLEAR(rec);
+		}
+	}
+
+	if (rec != NULL && infosizes != NULL)
+	{
+		sizes = PyMem_Malloc((d.numtitles ? d.numtitles : 1) * sizeof(*sizes));
+		if (sizes == NULL)
+		{
+			Py_CLEAR(rec);
+			PyErr_NoMemory();
+		}
+		for (i = 0; sizes != NULL && i < d.numtitles; i++)
+		{
+			sizes[i] = snapshot_info_size(infos[i]);
+		}
+		*infosizes = sizes;
+	}
+
+	for (i = 0; i < got; i++)
+	{
+		uint64_t start = STATS_START();
+		bd_free_title_info(infos[i]);
+		STATS_END(stats, STAT_BD_FREE_TITLE_INFO, start);
+	}
+	PyMem_Free(infos);
+	Py_XDECREF(path);
+
+	return rec;
+}
+
+// Class for SnapshotDisc() and Detach(), DiscSnapshot unless given
+static PyObject*
+_Bluray_discClass(Bluray *self, PyObject *cls)
+{
+	if (cls != NULL && cls != Py_None)
+	{
+		return cls;
+	}
+
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return NULL;
+	}
+	return state->DiscSnapshotType;
+}
+
+static PyObject*
+Bluray_SnapshotDisc(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *cls=NULL;
+	static char *kwlist[] = {"Class", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|O", kwlist, &cls))
+	{
+		return NULL;
+	}
+
+	cls = _Bluray_discClass(self, cls);
+	if (cls == NULL)
+	{
+		return NULL;
+	}
+
+	// Once detached the record is all there is, copy it
+	PyObject *rec;
+	if (_Bluray_detached(self, "Record", &rec))
+	{
+		if (rec == NULL)
+		{
+			return NULL;
+		}
+		Py_SETREF(rec, PyObject_CallNoArgs(rec));
+	}
+	else
+	{
+		BLURAY *bd;
+		rec = _Bluray_packDisc(self, &bd, NULL);
+	}
+	if (rec == NULL)
+	{
+		return NULL;
+	}
+
+	PyObject *ret = PyObject_CallFunctionObjArgs(cls, rec, NULL);
+	Py_DECREF(rec);
+	return ret;
+}
+
+static PyObject*
+Bluray_Detach(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *cls=NULL;
+	static char *kwlist[] = {"Class", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|O", kwlist, &cls))
+	{
+		return NULL;
+	}
+
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return NULL;
+	}
+	cls = _Bluray_discClass(self, cls);
+	if (cls == NULL)
+	{
+		return NULL;
+	}
+
+	BLURAY *bd;
+	size_t *sizes = NULL;
+	PyObject *rec = _Bluray_packDisc(self, &bd, &sizes);
+	if (rec == NULL)
+	{
+		return NULL;
+	}
+
+	PyObject *disc = PyObject_CallFunctionObjArgs(cls, rec, NULL);
+	Py_DECREF(rec);
+	if (disc == NULL)
+	{
+		PyMem_Free(sizes);
+		return NULL;
+	}
+	if (! PyObject_TypeCheck(disc, (PyTypeObject*)state->DiscSnapshotType))
+	{
+		PyMem_Free(sizes);
+		Py_DECREF(disc);
+		PyErr_SetString(PyExc_TypeError, "Class must make a DiscSnapshot");
+		return NULL;
+	}
+
+	// Footprint of each title before, the libbluray title info, and after, its record
+	SnapshotDisc *d = &((DiscSnapshot*)disc)->info;
+	PyObject *before = PyList_New(d->numtitles);
+	PyObject *after = PyList_New(d->numtitles);
+	unsigned long long totalbefore = 0, totalafter = 0;
+	uint32_t i;
+
+	for (i = 0; before != NULL && after != NULL && i < d->numtitles; i++)
+	{
+		SnapshotTitle t;
+		uint32_t off;
+		if (snapshot_disc_title(d, i, &off) < 0 || snapshot_parse(&t, d->rec + off, d->size - off) < 0)
+		{
+			Py_CLEAR(before);
+			break;
+		}
+
+		PyObject *b = PyLong_FromSize_t(sizes[i]);
+		PyObject *a = PyLong_FromUnsignedLong(t.size);
+		if (b == NULL || a == NULL)
+		{
+			Py_XDECREF(b);
+			Py_XDECREF(a);
+			Py_CLEAR(before);
+			break;
+		}
+		PyList_SET_ITEM(before, i, b);
+		PyList_SET_ITEM(after, i, a);
+
+		totalbefore += sizes[i];
+		totalafter += t.size;
+	}
+	PyMem_Free(sizes);
+
+	PyObject *ret = NULL;
+	if (before != NULL && after != NULL)
+	{
+		ret = Py_BuildValue("{s:I,s:O,s:O,s:K,s:K}",
+			"Titles", (unsigned int)d->numtitles,
+			"Before", before,
+			"After", after,
+			"TotalBefore", totalbefore,
+			"TotalAfter", totalafter);
+	}
+	Py_XDECREF(before);
+	Py_XDECREF(after);
+	if (ret == NULL)
+	{
+		Py_DECREF(disc);
+		return NULL;
+	}
+
+	// Close the disc the record was made from, unless it was closed or reopened meanwhile
+	bluread_lock(&self->lock);
+	if (self->BR != bd)
+	{
+		pthread_mutex_unlock(&self->lock);
+		Py_DECREF(disc);
+		Py_DECREF(ret);
+		PyErr_SetString(PyExc_Exception, "Device was closed while detaching from it");
+		return NULL;
+	}
+	_Bluray_close(self);
+	PyObject *old = self->detached;
+	self->detached = disc;
+	pthread_mutex_unlock(&self->lock);
+	Py_XDECREF(old);
+
+	return ret;
+}
+
+// Evaluates the query on each title info as it is parsed, only the numbers of those that match become objects
+static PyObject*
+Bluray_FindTitles(Bluray *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *find;
+	if (_Bluray_detached(self, "FindTitles", &find))
+	{
+		if (find == NULL)
+		{
+			return NULL;
+		}
+		PyObject *ret = PyObject_Call(find, args, kwds);
+		Py_DECREF(find);
+		return ret;
+	}
+
+	SnapshotQuery q;
+	if (_Query_parse(&q, args, kwds) < 0)
+	{
+		_Query_free(&q);
+		return NULL;
+	}
+
+	if (_Bluray_lockOpen(self) < 0)
+	{
+		_Query_free(&q);
+		return NULL;
+	}
+
+	BLURAY *bd = self->BR;
+	StatSet *stats = self->stats;
+	uint32_t i, numtitles = self->numtitles, nummatches = 0;
+	uint32_t *matches = PyMem_Malloc((numtitles ? numtitles : 1) * sizeof(*matches));
+
+	// Each title is packed into one scratch record, read by the same matcher as detached titles
+	uint8_t *rec = NULL;
+	size_t reclen = 0;
+	int failed = matches == NULL;
+	if (failed)
+	{
+		PyErr_NoMemory();
+	}
+
+	for (i = 0; ! failed && i < numtitles; i++)
+	{
+		BLURAY_TITLE_INFO *info;
+
+		Py_BEGIN_ALLOW_THREADS
+		uint64_t start = STATS_START();
+		info = bd_get_title_info(bd, i, 0);
+		STATS_END(stats, STAT_BD_GET_TITLE_INFO, start);
+		Py_END_ALLOW_THREADS
+
+		if (info == NULL)
+		{
+			PyErr_Format(PyExc_Exception, "Failed to get title information for title %u from disc", i);
+			failed = 1;
+			break;
+		}
+
+		size_t size = snapshot_size(info);
+		if (size > reclen)
+		{
+			uint8_t *grown = PyMem_Realloc(rec, size);
+			if (grown == NULL)
+			{
+				PyErr_NoMemory();
+				failed = 1;
+			}
+			else
+			{
+				rec = grown;
+				reclen = size;
+			}
+		}
+
+		SnapshotTitle t;
+		if (! failed && (snapshot_pack(rec, i, info, NULL) < 0 || snapshot_parse(&t, rec, reclen) < 0))
+		{
+			failed = 1;
+		}
+		if (! failed && snapshot_match(&t, &q))
+		{
+			matches[nummatches++] = i;
+		}
+
+		uint64_t start = STATS_START();
+		bd_free_title_info(info);
+		STATS_END(stats, STAT_BD_FREE_TITLE_INFO, start);
+	}
+
+	pthread_mutex_unlock(&self->lock);
+	metrics_add(METRIC_TITLES, i);
+	PyMem_Free(rec);
+	_Query_free(&q);
+
+	PyObject *ret = failed ? NULL : PyList_New(nummatches);
+	for (i = 0; ret != NULL && i < nummatches; i++)
+	{
+		PyObject *num = PyLong_FromUnsignedLong(matches[i]);
+		if (num == NULL)
+		{
+			Py_CLEAR(ret);
+			break;
+		}
+		PyList_SET_ITEM(ret, i, num);
+	}
+	PyMem_Free(matches);
+
+	return ret;
+}
+
+static PyObject*
+Bluray_getIsDetached(Bluray *self)
+{
+	bluread_lock(&self->lock);
+	int detached = self->detached != NULL;
+	pthread_mutex_unlock(&self->lock);
+
+	return PyBool_FromLong(detached);
+}
+
+static PyMemberDef Bluray_members[] = {
+	{"_path", T_OBJECT_EX, offsetof(Bluray, path), 0, "Path of Bluray device"},
 	{"_keydb", T_OBJECT_EX, offsetof(Bluray, keydb), 0, "KEYDB.cfg location"},
 	{NULL}
 };
 
-static PyMethodDef Bluray_methods[] = {
-	{"Open", (PyCFunction)Bluray_Open, METH_VARARGS|METH_KEYWORDS, "Opens the device for reading"},
-	{"Close", (PyCFunction)Bluray_Close, METH_NOARGS, "Closes the device"},
-	{"GetTitle", (PyCFunction)Bluray_GetTitle, METH_VARARGS|METH_KEYWORDS, "Gets title information"},
+static PyMethodDef Bluray_methods[] = {
+	{"Open", (PyCFunction)Bluray_Open, METH_VARARGS|METH_KEYWORDS, "Opens the device, image, buffer or file-like object for reading; backend='mmap' reads an ISO image through a memory map instead of libbluray's UDF reader, a seekable zstd image from Disc.dd(compress=...) is read in place by frame, prefetch=True reads every playlist and clip info file in one sweep in disc order, and cache=bytes puts an LRU block cache of that size in front of the disc"},
+	{"Close", (PyCFunction)Bluray_Close, METH_NOARGS, "Closes the device"},
+	{"GetTitle", (PyCFunction)Bluray_GetTitle, METH_VARARGS|METH_KEYWORDS, "Gets title information"},
+	{"CopyTitles", (PyCFunction)Bluray_CopyTitles, METH_VARARGS|METH_KEYWORDS, "Copies only the stream byte ranges the given titles play (and the small BDMV files) into outdir, in physical order, resuming an interrupted copy"},
+	{"CacheStats", (PyCFunction)Bluray_CacheStats, METH_VARARGS|METH_KEYWORDS, "Gets the hit, miss and eviction counters of the block cache Open(cache=bytes) made, None without one"},
+	{"Stats", (PyCFunction)Bluray_Stats, METH_VARARGS|METH_KEYWORDS, "Gets call counts, latencies and histograms of the libbluray calls and objects made for this disc, empty unless EnableStats() is on (or BLUREAD_STATS set); _bluread.Stats() sums all discs"},
+	{"SnapshotDisc", (PyCFunction)Bluray_SnapshotDisc, METH_VARARGS|METH_KEYWORDS, "Copies the metadata of the disc and every title into a detached, picklable Class (DiscSnapshot by default), the record catalogs are made of"},
+	{"FindTitles", (PyCFunction)Bluray_FindTitles, METH_VARARGS|METH_KEYWORDS, "Gets the numbers of the titles matching MinLength/MaxLength, MinChapters/MaxChapters and Video/Audio/Subtitle stream conditions, evaluated without making objects for the others"},
+	{"Detach", (PyCFunction)Bluray_Detach, METH_VARARGS|METH_KEYWORDS, "Keeps only the record SnapshotDisc() makes and closes the device, freeing libbluray's structures; returns the bytes each title took before and after"},
+	{NULL}
+};
+
+static PyGetSetDef Bluray_getseters[] = {
+	{"IsOpen", (getter)Bluray_getIsOpen, NULL, "Gets flag indicating if device is open or not", NULL},
+	{"IsDetached", (getter)Bluray_getIsDetached, NULL, "Gets flag indicating if the metadata is served from a detached record", NULL},
+	{"Path", (getter)Bluray_getPath, NULL, "Get the path to the Bluray device", NULL},
+	{"KeyDB", (getter)Bluray_getKeyDB, NULL, "Get the path to the KEYDB.cfg file", NULL},
+	{"VolumeId", (getter)Bluray_getVolumeId, NULL, "Gets the volume ID for the UDF partition", NULL},
+	{"DiscId", (getter)Bluray_getDiscId, NULL, "Gets the disc ID", NULL},
+	{"OrgId", (getter)Bluray_getOrgId, NULL, "Gets the organization ID", NULL},
+	{"MainTitleNumber", (getter)Bluray_getMainTitleNumber, NULL, "Gets the main title number of the disc", NULL},
+	{"NumberOfTitles", (getter)Bluray_getNumberOfTitles, NULL, "Gets the number of titles on this disc", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for Title
+
+static PyObject*
+Title_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	Title *self;
+
+	self = (Title*)type->tp_alloc(type, 0);
+	if (self)
+	{
+		self->br = NULL;
+		self->info = NULL;
+		self->titlenum = 0;
+
+		self->ChapterClass = NULL;
+		self->ClipClass = NULL;
+
+		self->bitrates = NULL;
+	}
+
+	return (PyObject*)self;
+}
+
+static int
+Title_init(Title *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *br=NULL, *chapterclass=NULL, *clipclass=NULL, *tmp=NULL;
+	int num=0;
+	static char *kwlist[] = {"BR", "Num", "ChapterClass", "ClipClass", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "OiOO", kwlist, &br, &num, &chapterclass, &clipclass))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	// br
+	tmp = (PyObject*)self->br;
+	self->br = (Bluray*)br;
+	Py_INCREF(br);
+	Py_CLEAR(tmp);
+
+	// chapterclass
+	tmp = self->ChapterClass;
+	self->ChapterClass = chapterclass;
+	Py_INCREF(chapterclass);
+	Py_CLEAR(tmp);
+
+	// clipclass
+	tmp = self->ClipClass;
+	self->ClipClass = clipclass;
+	Py_INCREF(clipclass);
+	Py_CLEAR(tmp);
+
+	// titlenum
+	self->titlenum = num;
+
+	// Get title information for angle 0, parsing the playlist needs no GIL
+	if (_Bluray_lockOpen(self->br) < 0)
+	{
+		return -1;
+	}
+
+	BLURAY *bd = self->br->BR;
+	StatSet *stats = self->br->stats;
+	BLURAY_TITLE_INFO *info;
+
+	Py_BEGIN_ALLOW_THREADS
+	uint64_t infostart = STATS_START();
+	info = bd_get_title_info(bd, num, 0);
+	STATS_END(stats, STAT_BD_GET_TITLE_INFO, infostart);
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_unlock(&self->br->lock);
+
+	// Title info is a copy of its own, used without the lock from here on
+	self->info = info;
+	if (self->info == NULL)
+	{
+		PyErr_SetString(PyExc_Exception, "Failed to get title information from disc");
+		return -1;
+	}
+
+	STATS_END(self->br->stats, STAT_NEW_TITLE, start);
+	metrics_add(METRIC_TITLES, 1);
+
+	return 0;
+}
+
+static void
+Title_dealloc(Title *self)
+{
+	if (self->info)
+	{
+		uint64_t start = STATS_START();
+		bd_free_title_info(self->info);
+		STATS_END(self->br ? self->br->stats : NULL, STAT_BD_FREE_TITLE_INFO, start);
+	}
+	self->info = NULL;
+
+	self->titlenum = 0;
+	Py_CLEAR(self->br);
+
+	Py_CLEAR(self->ChapterClass);
+	Py_CLEAR(self->ClipClass);
+	Py_CLEAR(self->bitrates);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for Title
+
+static PyObject*
+Title_getNum(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->titlenum);
+}
+
+static PyObject*
+Title_getLength(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->duration);
+}
+
+static PyObject*
+Title_getNumberOfAngles(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->angle_count);
+}
+
+static PyObject*
+Title_getNumberOfChapters(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->chapter_count);
+}
+
+static PyObject*
+Title_getNumberOfClips(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->clip_count);
+}
+
+static PyObject*
+Title_getPlaylistNumber(Title *self)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->playlist);
+}
+
+
+static PyObject*
+Title_GetChapter(Title *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	if (num < 1)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive", num);
+		return NULL;
+	}
+	if (num > self->info->chapter_count)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%d) of available titles", num,self->info->chapter_count);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->ChapterClass, "Oi", self, num);
+}
+
+static PyObject*
+Title_GetClip(Title *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if (num >= self->info->clip_count)
+	{
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->clip_count);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->ClipClass, "Oi", self, num);
+}
+
+// Size of each sampled segment, a multiple of the 6144 byte aligned unit
+#define SAMPLE_SEGMENT_SIZE (6144*256)
+
+static PyObject*
+Title_SampleBitrates(Title *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int segments=16;
+	int segsize=SAMPLE_SEGMENT_SIZE;
+	static char *kwlist[] = {"Segments", "SegmentSize", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|ii", kwlist, &segments, &segsize))
+	{
+		return NULL;
+	}
+
+	if (segments < 1)
+	{
+		PyErr_Format(PyExc_ValueError, "Number of segments (%d) must be positive", segments);
+		return NULL;
+	}
+	if (segsize < BDAV_PACKET_SIZE)
+	{
+		PyErr_Format(PyExc_ValueError, "Segment size (%d) must hold at least one packet", segsize);
+		return NULL;
+	}
+
+	TSScanResult *r = PyMem_Malloc(sizeof(TSScanResult));
+	unsigned char *buf = PyMem_Malloc(segsize);
+	if (r == NULL || buf == NULL)
+	{
+		PyMem_Free(r);
+		PyMem_Free(buf);
+		return PyErr_NoMemory();
+	}
+	tsscan_reset(r);
+
+	// Selecting, seeking and reading move libbluray's one read position, so the disc is held throughout
+	if (_Bluray_lockOpen(self->br) < 0)
+	{
+		PyMem_Free(r);
+		PyMem_Free(buf);
+		return NULL;
+	}
+
+	StatSet *stats = self->br->stats;
+	uint64_t start = STATS_START();
+	int selected = bd_select_title(self->br->BR, self->titlenum);
+	STATS_END(stats, STAT_BD_SELECT_TITLE, start);
+	if (! selected)
+	{
+		pthread_mutex_unlock(&self->br->lock);
+		PyMem_Free(r);
+		PyMem_Free(buf);
+		PyErr_Format(PyExc_Exception, "Failed to select title %d for sampling", self->titlenum);
+		return NULL;
+	}
+
+	start = STATS_START();
+	uint64_t size = bd_get_title_size(self->br->BR);
+	STATS_END(stats, STAT_BD_GET_TITLE_SIZE, start);
+	uint64_t duration = self->info->duration;
+	if (size == 0 || duration == 0)
+	{
+		pthread_mutex_unlock(&self->br->lock);
+		PyMem_Free(r);
+		PyMem_Free(buf);
+		PyErr_Format(PyExc_Exception, "Title %d has no stream data to sample", self->titlenum);
+		return NULL;
+	}
+
+	int failed = 0;
+	Py_BEGIN_ALLOW_THREADS
+	int i;
+	for (i = 0; i < segments && !failed; i++)
+	{
+		// Sample the middle of N evenly sized slices of the title, seeking by time keeps this to N short reads
+		uint64_t t = STATS_START();
+		int64_t pos = bd_seek_time(self->br->BR, duration * (2*i + 1) / (2*segments));
+		STATS_END(stats, STAT_BD_SEEK_TIME, t);
+		if (pos < 0)
+		{
+			failed = 1;
+			break;
+		}
+
+		int len = 0;
+		while (len < segsize)
+		{
+			t = STATS_START();
+			int got = bd_read(self->br->BR, buf + len, segsize - len);
+			STATS_END(stats, STAT_BD_READ, t);
+			if (got < 0)
+			{
+				failed = 1;
+				metrics_add(METRIC_READ_ERRORS, 1);
+			}
+			if (got <= 0) break;
+			len += got;
+			metrics_add(METRIC_BYTES_READ, got);
+		}
+
+		tsscan_run(r, buf, len, NULL);
+	}
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_unlock(&self->br->lock);
+	PyMem_Free(buf);
+
+	if (failed || r->packets == 0)
+	{
+		PyMem_Free(r);
+		PyErr_Format(PyExc_Exception, "Failed to read title %d while sampling", self->titlenum);
+		return NULL;
+	}
+
+	// The share of sampled packets for each PID applied to the title's overall mux rate
+	// Rates count the 188 byte transport packets, without the 4 byte BDAV header
+	double seconds = duration / 90000.0;
+	double pktrate = (size / BDAV_PACKET_SIZE) / seconds;
+
+	PyObject *rates = PyDict_New();
+	if (rates == NULL)
+	{
+		PyMem_Free(r);
+		return NULL;
+	}
+
+	int pid;
+	for (pid = 0; pid < TS_PID_COUNT; pid++)
+	{
+		if (r->pids[pid] == 0) continue;
+
+		double bps = pktrate * ((double)r->pids[pid] / r->packets) * 188 * 8;
+
+		PyObject *k = PyLong_FromLong(pid);
+		PyObject *v = PyLong_FromLongLong((long long)bps);
+		if (k == NULL || v == NULL || PyDict_SetItem(rates, k, v) < 0)
+		{
+			Py_XDECREF(k);
+			Py_XDECREF(v);
+			Py_DECREF(rates);
+			PyMem_Free(r);
+			return NULL;
+		}
+		Py_DECREF(k);
+		Py_DECREF(v);
+	}
+	PyMem_Free(r);
+
+	// Keep the results for the Bitrate property of streams in this title
+	Py_INCREF(rates);
+	bluread_lock(&self->br->lock);
+	PyObject *tmp = self->bitrates;
+	self->bitrates = rates;
+	pthread_mutex_unlock(&self->br->lock);
+	Py_XDECREF(tmp);
+
+	return rates;
+}
+
+// Select the title for reading from its start, with the disc locked
+static int
+_Title_select(Title *self)
+{
+	StatSet *stats = self->br->stats;
+
+	uint64_t start = STATS_START();
+	int selected = bd_select_title(self->br->BR, self->titlenum);
+	STATS_END(stats, STAT_BD_SELECT_TITLE, start);
+	if (! selected)
+	{
+		return -1;
+	}
+
+	start = STATS_START();
+	int64_t pos = bd_seek(self->br->BR, 0);
+	STATS_END(stats, STAT_BD_SEEK, start);
+
+	return pos < 0 ? -1 : 0;
+}
+
+// copy_read_func over bd_read() of the selected title, @handle is its Bluray and @offset is implied by the read position
+static int64_t
+_Title_read(void *handle, uint8_t *buf, size_t len, uint64_t offset)
+{
+	Bluray *br = (Bluray*)handle;
+	size_t got = 0;
+	while (got < len)
+	{
+		uint64_t start = STATS_START();
+		int n = bd_read(br->BR, buf + got, len - got > INT_MAX ? INT_MAX : (int)(len - got));
+		STATS_END(br->stats, STAT_BD_READ, start);
+		if (n < 0)
+		{
+			errno = EIO;
+			return -1;
+		}
+		if (n == 0) break;
+		got += n;
+	}
+
+	return got;
+}
+
+// The packet scan a title copy runs over what it reads, so a damaged stream shows up without another pass
+static TSScanStream*
+_Title_newscan(void)
+{
+	TSScanStream *ts = PyMem_Malloc(sizeof(TSScanStream));
+	if (ts == NULL)
+	{
+		PyErr_NoMemory();
+		return NULL;
+	}
+	tsscan_reset(&ts->result);
+	ts->carried = 0;
+
+	return ts;
+}
+
+// Adds the scan counts to the @result of a copy as 'Packets', as ScanPackets() reports them
+static int
+_Title_addscan(PyObject *result, const TSScanStream *ts)
+{
+	if (ts == NULL)
+	{
+		return 0;
+	}
+
+	PyObject *packets = tsscan_topython(&ts->result, ts->carried);
+	if (packets == NULL)
+	{
+		return -1;
+	}
+
+	int ret = PyDict_SetItemString(result, "Packets", packets);
+	Py_DECREF(packets);
+
+	return ret;
+}
+
+static PyObject*
+Title_Copy(Title *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	const char *path=NULL;
+	PyObject *hashnames=NULL;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	int hashes=0;
+	int scan=1;
+	static char *kwlist[] = {"Path", "Hashes", "ChunkSize", "Scan", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "s|Onp", kwlist, &path, &hashnames, &chunk, &scan))
+	{
+		return NULL;
+	}
+
+	if (chunk < BDAV_PACKET_SIZE)
+	{
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must hold at least one packet", chunk);
+		return NULL;
+	}
+
+	if (copy_parsehashes(hashnames, &hashes) < 0)
+	{
+		return NULL;
+	}
+
+	TSScanStream *ts = NULL;
+	if (scan && (ts = _Title_newscan()) == NULL)
+	{
+		return NULL;
+	}
+
+	// Held until the copy is done, another read of this disc would move the read position
+	if (_Bluray_lockOpen(self->br) < 0)
+	{
+		PyMem_Free(ts);
+		return NULL;
+	}
+
+	if (_Title_select(self) < 0)
+	{
+		pthread_mutex_unlock(&self->br->lock);
+		PyMem_Free(ts);
+		PyErr_Format(PyExc_Exception, "Failed to select title %d for reading", self->titlenum);
+		return NULL;
+	}
+
+	int outfd = open(path, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+	if (outfd < 0)
+	{
+		pthread_mutex_unlock(&self->br->lock);
+		PyMem_Free(ts);
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+	}
+
+	CopyJob job;
+	memset(&job, 0, sizeof(job));
+	job.read = _Title_read;
+	job.handle = self->br;
+	job.outfd = outfd;
+	job.prefixfd = -1;
+	job.end = UINT64_MAX;
+	job.chunk = chunk;
+	job.hashes = hashes;
+	job.scan = ts;
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = copy_run(&job);
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_unlock(&self->br->lock);
+
+	if (close(outfd) < 0 && ret == 0)
+	{
+		job.err = errno;
+		ret = -1;
+	}
+
+	if (ret < 0)
+	{
+		copy_free(&job);
+		PyMem_Free(ts);
+		errno = job.err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+	}
+
+	PyObject *result = copy_topython(&job);
+	copy_free(&job);
+
+	if (result != NULL && _Title_addscan(result, ts) < 0)
+	{
+		Py_CLEAR(result);
+	}
+	PyMem_Free(ts);
+
+	return result;
+}
+
+static PyObject*
+Title_Stream(Title *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	PyObject *fdobj=NULL;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	int scan=1;
+	static char *kwlist[] = {"FD", "ChunkSize", "Scan", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "O|np", kwlist, &fdobj, &chunk, &scan))
+	{
+		return NULL;
+	}
+
+	// Accepts a descriptor number or anything with fileno(), like Popen.stdin
+	int outfd = PyObject_AsFileDescriptor(fdobj);
+	if (outfd < 0)
+	{
+		return NULL;
+	}
+
+	if (chunk < BDAV_PACKET_SIZE)
+	{
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must hold at least one packet", chunk);
+		return NULL;
+	}
+
+	TSScanStream *ts = NULL;
+	if (scan && (ts = _Title_newscan()) == NULL)
+	{
+		return NULL;
+	}
+
+	if (_Bluray_lockOpen(self->br) < 0)
+	{
+		PyMem_Free(ts);
+		return NULL;
+	}
+
+	if (_Title_select(self) < 0)
+	{
+		pthread_mutex_unlock(&self->br->lock);
+		PyMem_Free(ts);
+		PyErr_Format(PyExc_Exception, "Failed to select title %d for reading", self->titlenum);
+		return NULL;
+	}
+
+	CopyJob job;
+	memset(&job, 0, sizeof(job));
+	job.read = _Title_read;
+	job.handle = self->br;
+	job.outfd = outfd;
+	job.prefixfd = -1;
+	job.end = UINT64_MAX;
+	job.chunk = chunk;
+	job.scan = ts;
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = copy_stream(&job);
+	Py_END_ALLOW_THREADS
+
+	pthread_mutex_unlock(&self->br->lock);
+
+	if (ret < 0)
+	{
+		PyMem_Free(ts);
+		errno = job.err;
+		return PyErr_SetFromErrno(PyExc_OSError);
+	}
+
+	PyObject *result = Py_BuildValue("{s:K,s:d,s:d,s:O}",
+		"Bytes", (unsigned long long)job.bytes,
+		"Seconds", job.seconds,
+		"Throughput", job.seconds > 0 ? job.bytes / job.seconds : 0.0,
+		"Spliced", job.spliced ? Py_True : Py_False);
+
+	if (result != NULL && _Title_addscan(result, ts) < 0)
+	{
+		Py_CLEAR(result);
+	}
+	PyMem_Free(ts);
+
+	return result;
+}
+
+// Look up the sampled bitrate of a stream in @t, None if the title has not been sampled
+static PyObject*
+_Title_getStreamBitrate(Title *t, BLURAY_STREAM_INFO *info)
+{
+	// SampleBitrates() may replace it from another thread
+	bluread_lock(&t->br->lock);
+	PyObject *bitrates = t->bitrates;
+	Py_XINCREF(bitrates);
+	pthread_mutex_unlock(&t->br->lock);
+
+	if (bitrates == NULL)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	PyObject *k = PyLong_FromLong(info->pid);
+	if (k == NULL)
+	{
+		Py_DECREF(bitrates);
+		return NULL;
+	}
+
+	PyObject *v = PyDict_GetItemWithError(bitrates, k);
+	Py_DECREF(k);
+	if (v == NULL)
+	{
+		Py_DECREF(bitrates);
+		if (PyErr_Occurred())
+		{
+			return NULL;
+		}
+
+		// Sampled, but no packets of this PID were seen
+		return PyLong_FromLong(0);
+	}
+
+	Py_INCREF(v);
+	Py_DECREF(bitrates);
+	return v;
+}
+
+static PyObject*
+Title_Snapshot(Title *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *cls=NULL;
+	static char *kwlist[] = {"Class", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|O", kwlist, &cls))
+	{
+		return NULL;
+	}
+
+	if (cls == NULL || cls == Py_None)
+	{
+		BluReadState *state = _BluRead_getState(Py_TYPE(self));
+		if (state == NULL)
+		{
+			return NULL;
+		}
+		cls = state->TitleSnapshotType;
+	}
+
+	// Title info is the title's own, only the bitrates can change under us
+	bluread_lock(&self->br->lock);
+	PyObject *bitrates = self->bitrates;
+	Py_XINCREF(bitrates);
+	pthread_mutex_unlock(&self->br->lock);
+
+	PyObject *rec = PyBytes_FromStringAndSize(NULL, snapshot_size(self->info));
+	if (rec == NULL || snapshot_pack((uint8_t*)PyBytes_AS_STRING(rec), self->titlenum, self->info, bitrates) < 0)
+	{
+		Py_XDECREF(rec);
+		Py_XDECREF(bitrates);
+		return NULL;
+	}
+	Py_XDECREF(bitrates);
+
+	PyObject *ret = PyObject_CallFunctionObjArgs(cls, rec, NULL);
+	Py_DECREF(rec);
+	return ret;
+}
+
+
+static PyMemberDef Title_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Title, titlenum), 0, "Title number"},
+	{NULL}
+};
+
+static PyMethodDef Title_methods[] = {
+	{"GetChapter", (PyCFunction)Title_GetChapter, METH_VARARGS|METH_KEYWORDS, "Gets the specified chapter for this title"},
+	{"GetClip", (PyCFunction)Title_GetClip, METH_VARARGS|METH_KEYWORDS, "Gets the specified clip for this title"},
+	{"Copy", (PyCFunction)Title_Copy, METH_VARARGS|METH_KEYWORDS, "Reads this title through libbluray into a file, optionally hashing it inline and counting its packets per PID (Scan=True)"},
+	{"Stream", (PyCFunction)Title_Stream, METH_VARARGS|METH_KEYWORDS, "Reads this title through libbluray straight into a file descriptor, such as a pipe to another process, counting its packets per PID (Scan=True)"},
+	{"SampleBitrates", (PyCFunction)Title_SampleBitrates, METH_VARARGS|METH_KEYWORDS, "Reads evenly spaced segments of this title and measures the bitrate of each PID"},
+	{"Snapshot", (PyCFunction)Title_Snapshot, METH_VARARGS|METH_KEYWORDS, "Copies this title's metadata into a detached, picklable Class (TitleSnapshot by default) that outlives the disc"},
+	{NULL}
+};
+
+static PyGetSetDef Title_getseters[] = {
+	{"Num", (getter)Title_getNum, NULL, "Get the title number of this title", NULL},
+	{"Length", (getter)Title_getLength, NULL, "Get the duration of this title", NULL},
+	{"NumberOfAngles", (getter)Title_getNumberOfAngles, NULL, "Gets the number of angles in this title", NULL},
+	{"NumberOfChapters", (getter)Title_getNumberOfChapters, NULL, "Gets the number of chapters in this title", NULL},
+	{"NumberOfClips", (getter)Title_getNumberOfClips, NULL, "Gets the number of clips in this title", NULL},
+	{"PlaylistNumber", (getter)Title_getPlaylistNumber, NULL, "Gets the playlist as a number", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for Chapter
+
+static PyObject*
+Chapter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	Chapter *self;
+
+	self = (Chapter*)type->tp_alloc(type, 0);
+	if (self)
+	{
+		self->title = NULL;
+		self->info = NULL;
+		self->chapternum = 0;
+	}
+
+	return (PyObject*)self;
+}
+
+static int
+Chapter_init(Chapter *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *title=NULL, *tmp=NULL;
+	int num=0;
+	static char *kwlist[] = {"Title", "Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &title, &num))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	Title *t = (Title*)title;
+
+	// Get title information for angle 0
+	BLURAY_TITLE_INFO *tinfo = t->info;
+
+
+	if (num < 1)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive", num);
+		return -1;
+	}
+	if (num > tinfo->chapter_count)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%d) of available chapters", num,tinfo->chapter_count);
+		return -1;
+	}
+
+	// title
+	tmp = (PyObject*)self->title;
+	self->title = t;
+	Py_INCREF(title);
+	Py_CLEAR(tmp);
+
+	self->chapternum = num;
+
+	// Get chapter information, chapters are numbered from 1
+	self->info = &tinfo->chapters[num - 1];
+
+	STATS_END(self->title->br->stats, STAT_NEW_CHAPTER, start);
+
+	return 0;
+}
+
+static void
+Chapter_dealloc(Chapter *self)
+{
+	if (self->info)
+	{
+		// Nothing to do, it's a part of title info
+	}
+	self->info = NULL;
+
+	self->chapternum = 0;
+	Py_CLEAR(self->title);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for Chapter
+
+static PyObject*
+Chapter_getNum(Chapter *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->chapternum);
+}
+
+static PyObject*
+Chapter_getStart(Chapter *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->start);
+}
+
+static PyObject*
+Chapter_getLength(Chapter *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->duration);
+}
+
+static PyObject*
+Chapter_getClipNum(Chapter *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->clip_ref);
+}
+
+
+static PyMemberDef Chapter_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Chapter, chapternum), 0, "Chapter number"},
+	{NULL}
+};
+
+static PyMethodDef Chapter_methods[] = {
+	//{"Open", (PyCFunction)Chapter_Open, METH_NOARGS, "Opens the device for reading"},
+	{NULL}
+};
+
+static PyGetSetDef Chapter_getseters[] = {
+	{"Num", (getter)Chapter_getNum, NULL, "Get the chapter number of this chapte", NULL},
+	{"Start", (getter)Chapter_getStart, NULL, "Get the start time of this chapter", NULL},
+	{"Length", (getter)Chapter_getLength, NULL, "Get the length of this chapter", NULL},
+	{"ClipNum", (getter)Chapter_getClipNum, NULL, "Get the clip number used for this chapter", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for Clip
+
+static PyObject*
+Clip_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	Clip *self;
+
+	self = (Clip*)type->tp_alloc(type, 0);
+	if (self)
+	{
+		self->title = NULL;
+		self->info = NULL;
+		self->clipnum = 0;
+
+		self->VideoClass = NULL;
+		self->AudioClass = NULL;
+		self->SubtitleClass = NULL;
+	}
+
+	return (PyObject*)self;
+}
+
+static int
+Clip_init(Clip *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *title=NULL, *videoclass=NULL, *audioclass=NULL, *subtitleclass=NULL, *tmp=NULL;
+	int num=0;
+	static char *kwlist[] = {"Title", "Num", "VideoClass", "audioClass", "SubtitleClass", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "OiOOO", kwlist, &title, &num, &videoclass, &audioclass, &subtitleclass))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	Title *t = (Title*)title;
+
+	// Get title information for angle 0
+	BLURAY_TITLE_INFO *tinfo = t->info;
+
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative", num);
+		return -1;
+	}
+	if (num >= tinfo->clip_count)
+	{
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,tinfo->clip_count);
+		return -1;
+	}
+
+	// title
+	tmp = (PyObject*)self->title;
+	self->title = t;
+	Py_INCREF(title);
+	Py_CLEAR(tmp);
+
+	// videoclass
+	tmp = (PyObject*)self->VideoClass;
+	self->VideoClass = videoclass;
+	Py_INCREF(videoclass);
+	Py_CLEAR(tmp);
+
+	// audioclass
+	tmp = (PyObject*)self->AudioClass;
+	self->AudioClass = audioclass;
+	Py_INCREF(audioclass);
+	Py_CLEAR(tmp);
+
+	// subtitleclass
+	tmp = (PyObject*)self->SubtitleClass;
+	self->SubtitleClass = subtitleclass;
+	Py_INCREF(subtitleclass);
+	Py_CLEAR(tmp);
+
+	self->clipnum = num;
+
+	// Get clip information
+	self->info = &tinfo->clips[num];
+
+	STATS_END(self->title->br->stats, STAT_NEW_CLIP, start);
+
+	return 0;
+}
+
+static void
+Clip_dealloc(Clip *self)
+{
+	if (self->info)
+	{
+		// Nothing to do, it's a part of title info
+	}
+	self->info = NULL;
+
+	self->clipnum = 0;
+	Py_CLEAR(self->title);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for Clip
+
+static PyObject*
+Clip_getNum(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->clipnum);
+}
+
+static PyObject*
+Clip_getClipId(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	char clipid[6];
+	strncpy(clipid, self->info->clip_id, 5);
+	clipid[5] = '\0';
+
+	return PyUnicode_FromString(clipid);
+}
+
+static PyObject*
+Clip_getNumberOfVideosPrimary(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->video_stream_count);
+}
+
+static PyObject*
+Clip_getNumberOfVideosSecondary(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->sec_video_stream_count);
+}
+
+static PyObject*
+Clip_getNumberOfAudiosPrimary(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->audio_stream_count);
+}
+
+static PyObject*
+Clip_getNumberOfAudiosSecondary(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->sec_audio_stream_count);
+}
+
+static PyObject*
+Clip_getNumberOfSubtitles(Clip *self)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->info->pg_stream_count);
+}
+
+static PyObject*
+Clip_GetVideo(Clip *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Video stream number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if (num >= self->info->video_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Video stream number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->video_stream_count);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->VideoClass, "Oi", self, num);
+}
+
+static PyObject*
+Clip_GetAudio(Clip *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Audio stream number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if (num >= self->info->audio_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Audio stream number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->audio_stream_count);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->AudioClass, "Oi", self, num);
+}
+
+static PyObject*
+Clip_GetSubtitle(Clip *self, PyObject *args, PyObject *kwds)
+{
+	if (! _Bluray_getIsOpen(self->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+	{
+		return NULL;
+	}
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if (num >= self->info->pg_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->pg_stream_count);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->SubtitleClass, "Oi", self, num);
+}
+
+
+
+static PyMemberDef Clip_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Clip, clipnum), 0, "Clip number"},
+	{NULL}
+};
+
+static PyMethodDef Clip_methods[] = {
+	{"GetVideo", (PyCFunction)Clip_GetVideo, METH_VARARGS|METH_KEYWORDS, "Gets video stream for this clip"},
+	{"GetAudio", (PyCFunction)Clip_GetAudio, METH_VARARGS|METH_KEYWORDS, "Gets audio stream for this clip"},
+	{"GetSubtitle", (PyCFunction)Clip_GetSubtitle, METH_VARARGS|METH_KEYWORDS, "Gets subtitle (pg: presentation graphics) for this clip"},
+	{NULL}
+};
+
+static PyGetSetDef Clip_getseters[] = {
+	{"Num", (getter)Clip_getNum, NULL, "Get the clip number of this clip", NULL},
+	{"ClipId", (getter)Clip_getClipId, NULL, "Get the clip ID, the name of its M2TS and CLPI files without extension", NULL},
+	{"NumberOfVideosPrimary", (getter)Clip_getNumberOfVideosPrimary, NULL, "Get the number of primary video streams in this clip", NULL},
+	{"NumberOfVideosSecondary", (getter)Clip_getNumberOfVideosSecondary, NULL, "Get the number of secondary video streams in this clip", NULL},
+	{"NumberOfAudiosPrimary", (getter)Clip_getNumberOfAudiosPrimary, NULL, "Get the number of primary audio streams in this clip", NULL},
+	{"NumberOfAudiosSecondary", (getter)Clip_getNumberOfAudiosSecondary, NULL, "Get the number of secondary audio streams in this clip", NULL},
+	{"NumberOfSubtitles", (getter)Clip_getNumberOfSubtitles, NULL, "Get the number of subtitles (pg: presentation graphics) in this clip", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for Video
+
+static PyObject*
+Video_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	Video *self;
+
+	self = (Video*)type->tp_alloc(type, 0);
+	if (self)
+	{
+		self->clip = NULL;
+		self->info = NULL;
+		self->vidnum = 0;
+	}
+
+	return (PyObject*)self;
+}
+
+static int
+Video_init(Video *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *clip=NULL, *tmp=NULL;
+	int num=0;
+	static char *kwlist[] = {"Clip", "Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &clip, &num))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	Clip *c = (Clip*)clip;
+
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Video number (%d) must be non-negative", num);
+		return -1;
+	}
+	if (num >= c->info->video_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Video number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->video_stream_count);
+		return -1;
+	}
+
+	// clip
+	tmp = (PyObject*)self->clip;
+	self->clip = c;
+	Py_INCREF(clip);
+	Py_CLEAR(tmp);
+
+	self->vidnum = num;
+
+	// Get video information
+	self->info = &c->info->video_streams[num];
+
+	STATS_END(self->clip->title->br->stats, STAT_NEW_VIDEO, start);
+
+	return 0;
+}
+
+static void
+Video_dealloc(Video *self)
+{
+	if (self->info)
+	{
+		// Nothing to do, it's a part of title info
+	}
+	self->info = NULL;
+
+	self->vidnum = 0;
+	Py_CLEAR(self->clip);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for Video
+
+static PyObject*
+Video_getNum(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->vidnum);
+}
+
+static PyObject*
+Video_getLanguage(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	char lang[5];
+	strncpy(lang, (char*)self->info->lang, 4);
+	lang[4] = '\0';
+
+	return PyUnicode_FromString(lang);
+}
+
+static PyObject*
+Video_getCodingType(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->coding_type);
+}
+
+static PyObject*
+Video_getFormat(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->format);
+}
+
+static PyObject*
+Video_getRate(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->rate);
+}
+
+static PyObject*
+Video_getAspect(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->aspect);
+}
+
+
+static PyObject*
+Video_getPid(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->pid);
+}
+
+static PyObject*
+Video_getBitrate(Video *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return _Title_getStreamBitrate(self->clip->title, self->info);
+}
+
+
+static PyMemberDef Video_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Video, vidnum), 0, "Video number"},
+	{NULL}
+};
+
+static PyMethodDef Video_methods[] = {
+	//{"Open", (PyCFunction)Video_Open, METH_NOARGS, "Opens the device for reading"},
 	{NULL}
 };
 
-static PyGetSetDef Bluray_getseters[] = {
-	{"IsOpen", (getter)Bluray_getIsOpen, NULL, "Gets flag indicating if device is open or not", NULL},
-	{"Path", (getter)Bluray_getPath, NULL, "Get the path to the Bluray device", NULL},
-	{"KeyDB", (getter)Bluray_getKeyDB, NULL, "Get the path to the KEYDB.cfg file", NULL},
-	{"VolumeId", (getter)Bluray_getVolumeId, NULL, "Gets the volume ID for the UDF partition", NULL},
-	{"DiscId", (getter)Bluray_getDiscId, NULL, "Gets the disc ID", NULL},
-	{"OrgId", (getter)Bluray_getOrgId, NULL, "Gets the organization ID", NULL},
-	{"MainTitleNumber", (getter)Bluray_getMainTitleNumber, NULL, "Gets the main title number of the disc", NULL},
-	{"NumberOfTitles", (getter)Bluray_getNumberOfTitles, NULL, "Gets the number of titles on this disc", NULL},
+static PyGetSetDef Video_getseters[] = {
+	{"Num", (getter)Video_getNum, NULL, "Get the video number of this stream", NULL},
+	{"_CodingType", (getter)Video_getCodingType, NULL, "Get the coding type of this stream", NULL},
+	{"_Format", (getter)Video_getFormat, NULL, "Get the format of this stream", NULL},
+	{"_Rate", (getter)Video_getRate, NULL, "Get the rate of this stream", NULL},
+	{"_Aspect", (getter)Video_getAspect, NULL, "Get the aspect of this stream", NULL},
+	{"Language", (getter)Video_getLanguage, NULL, "Gets the language code of the video stream", NULL},
+	{"Pid", (getter)Video_getPid, NULL, "Gets the transport stream PID of the video stream", NULL},
+	{"Bitrate", (getter)Video_getBitrate, NULL, "Gets the measured bitrate (bits/s) after Title.SampleBitrates(), otherwise None", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Title
+// Administrative functions for Audio
 
 static PyObject*
-Title_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+Audio_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Title *self;
+	Audio *self;
 
-	self = (Title*)type->tp_alloc(type, 0);
+	self = (Audio*)type->tp_alloc(type, 0);
 	if (self)
 	{
-		self->br = NULL;
+		self->clip = NULL;
 		self->info = NULL;
-		self->titlenum = 0;
+		self->audnum = 0;
+	}
 
-		self->ChapterClass = NULL;
-		self->ClipClass = NULL;
+	return (PyObject*)self;
+}
+
+static int
+Audio_init(Audio *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *clip=NULL, *tmp=NULL;
+	int num=0;
+	static char *kwlist[] = {"Clip", "Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &clip, &num))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	Clip *c = (Clip*)clip;
+
+
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Audio number (%d) must be non-negative", num);
+		return -1;
+	}
+	if (num >= c->info->audio_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Audio number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->audio_stream_count);
+		return -1;
+	}
+
+	// clip
+	tmp = (PyObject*)self->clip;
+	self->clip = c;
+	Py_INCREF(clip);
+	Py_CLEAR(tmp);
+
+	self->audnum = num;
+
+	// Get subtitle information
+	self->info = &c->info->audio_streams[num];
+
+	STATS_END(self->clip->title->br->stats, STAT_NEW_AUDIO, start);
+
+	return 0;
+}
+
+static void
+Audio_dealloc(Audio *self)
+{
+	if (self->info)
+	{
+		// Nothing to do, it's a part of title info
+	}
+	self->info = NULL;
+
+	self->audnum = 0;
+	Py_CLEAR(self->clip);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for Audio
+
+static PyObject*
+Audio_getNum(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong((long)self->audnum);
+}
+
+static PyObject*
+Audio_getCodingType(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->coding_type);
+}
+
+static PyObject*
+Audio_getFormat(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->format);
+}
+
+static PyObject*
+Audio_getRate(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->rate);
+}
+
+static PyObject*
+Audio_getAspect(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->aspect);
+}
+
+static PyObject*
+Audio_getLanguage(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	char lang[5];
+	strncpy(lang, (char*)self->info->lang, 4);
+	lang[4] = '\0';
+
+	return PyUnicode_FromString(lang);
+}
+
+
+static PyObject*
+Audio_getPid(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return PyLong_FromLong(self->info->pid);
+}
+
+static PyObject*
+Audio_getBitrate(Audio *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
+	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		return NULL;
+	}
+
+	return _Title_getStreamBitrate(self->clip->title, self->info);
+}
+
+
+static PyMemberDef Audio_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Audio, audnum), 0, "Audio number"},
+	{NULL}
+};
+
+static PyMethodDef Audio_methods[] = {
+	//{"Open", (PyCFunction)Audio_Open, METH_NOARGS, "Opens the device for reading"},
+	{NULL}
+};
+
+static PyGetSetDef Audio_getseters[] = {
+	{"Num", (getter)Audio_getNum, NULL, "Get the audio number of this stream", NULL},
+	{"_CodingType", (getter)Audio_getCodingType, NULL, "Get the coding type of this stream", NULL},
+	{"_Format", (getter)Audio_getFormat, NULL, "Get the format of this stream", NULL},
+	{"_Rate", (getter)Audio_getRate, NULL, "Get the rate of this stream", NULL},
+	{"_Aspect", (getter)Audio_getAspect, NULL, "Get the aspect of this stream", NULL},
+	{"Language", (getter)Audio_getLanguage, NULL, "Gets the language code of the audio stream", NULL},
+	{"Pid", (getter)Audio_getPid, NULL, "Gets the transport stream PID of the audio stream", NULL},
+	{"Bitrate", (getter)Audio_getBitrate, NULL, "Gets the measured bitrate (bits/s) after Title.SampleBitrates(), otherwise None", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for Subtitle
+
+static PyObject*
+Subtitle_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	Subtitle *self;
+
+	self = (Subtitle*)type->tp_alloc(type, 0);
+	if (self)
+	{
+		self->clip = NULL;
+		self->info = NULL;
+		self->pgnum = 0;
 	}
 
 	return (PyObject*)self;
 }
 
 static int
-Title_init(Title *self, PyObject *args, PyObject *kwds)
+Subtitle_init(Subtitle *self, PyObject *args, PyObject *kwds)
 {
-	PyObject *br=NULL, *chapterclass=NULL, *clipclass=NULL, *tmp=NULL;
+	PyObject *clip=NULL, *tmp=NULL;
 	int num=0;
-	static char *kwlist[] = {"BR", "Num", "ChapterClass", "ClipClass", NULL};
+	static char *kwlist[] = {"Clip", "Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &clip, &num))
+	{
+		return -1;
+	}
+
+	uint64_t start = STATS_START();
+
+	Clip *c = (Clip*)clip;
+
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "OiOO", kwlist, &br, &num, &chapterclass, &clipclass))
+	if (num < 0)
 	{
+		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative", num);
+		return -1;
+	}
+	if (num >= c->info->pg_stream_count)
+	{
+		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->pg_stream_count);
 		return -1;
 	}
 
-	// br
-	tmp = (PyObject*)self->br;
-	self->br = (Bluray*)br;
-	Py_INCREF(br);
-	Py_CLEAR(tmp);
-
-	// chapterclass
-	tmp = self->ChapterClass;
-	self->ChapterClass = chapterclass;
-	Py_INCREF(chapterclass);
+	// clip
+	tmp = (PyObject*)self->clip;
+	self->clip = c;
+	Py_INCREF(clip);
 	Py_CLEAR(tmp);
 
-	// clipclass
-	tmp = self->ClipClass;
-	self->ClipClass = clipclass;
-	Py_INCREF(clipclass);
-	Py_CLEAR(tmp);
+	self->pgnum = num;
 
-	// titlenum
-	self->titlenum = num;
+	// Get subtitle information
+	self->info = &c->info->pg_streams[num];
 
-	// Get title information for angle 0
-	self->info = bd_get_title_info(self->br->BR, self->titlenum, 0);
-	if (self->info == NULL)
-	{
-		Py_XDECREF(br);
-		PyErr_SetString(PyExc_Exception, "Failed to get title information from disc");
-		return -1;
-	}
+	STATS_END(self->clip->title->br->stats, STAT_NEW_SUBTITLE, start);
 
 	return 0;
 }
 
 static void
-Title_dealloc(Title *self)
+Subtitle_dealloc(Subtitle *self)
 {
 	if (self->info)
 	{
-		bd_free_title_info(self->info);
+		// Nothing to do, it's a part of title info
 	}
 	self->info = NULL;
 
-	self->titlenum = 0;
-	Py_CLEAR(self->br);
-
-	Py_CLEAR(self->ChapterClass);
-	Py_CLEAR(self->ClipClass);
+	self->pgnum = 0;
+	Py_CLEAR(self->clip);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Title
+// Interface stuff for Subtitle
 
 static PyObject*
-Title_getNum(Title *self)
+Subtitle_getNum(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->titlenum);
+	return PyLong_FromLong((long)self->pgnum);
 }
 
 static PyObject*
-Title_getLength(Title *self)
+Subtitle_getCodingType(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->duration);
+	return PyLong_FromLong(self->info->coding_type);
 }
 
 static PyObject*
-Title_getNumberOfAngles(Title *self)
+Subtitle_getFormat(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->info->angle_count);
+	return PyLong_FromLong(self->info->format);
 }
 
 static PyObject*
-Title_getNumberOfChapters(Title *self)
+Subtitle_getRate(Audio *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->info->chapter_count);
+	return PyLong_FromLong(self->info->rate);
 }
 
 static PyObject*
-Title_getNumberOfClips(Title *self)
+Subtitle_getAspect(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->info->clip_count);
+	return PyLong_FromLong(self->info->aspect);
 }
 
 static PyObject*
-Title_getPlaylistNumber(Title *self)
+Subtitle_getLanguage(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->info->playlist);
+	char lang[5];
+	strncpy(lang, (char*)self->info->lang, 4);
+	lang[4] = '\0';
+
+	return PyUnicode_FromString(lang);
 }
 
 
 static PyObject*
-Title_GetChapter(Title *self, PyObject *args, PyObject *kwds)
+Subtitle_getPid(Subtitle *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
 		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	int num=0;
-	static char *kwlist[] = {"Num", NULL};
+	return PyLong_FromLong(self->info->pid);
+}
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
+static PyObject*
+Subtitle_getBitrate(Subtitle *self)
+{
+	if (! _Bluray_getIsOpen(self->clip->title->br))
 	{
+		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	if (num < 1)
+	return _Title_getStreamBitrate(self->clip->title, self->info);
+}
+
+
+static PyMemberDef Subtitle_members[] = {
+	{"_num", T_OBJECT_EX, offsetof(Subtitle, pgnum), 0, "Subtitle number"},
+	{NULL}
+};
+
+static PyMethodDef Subtitle_methods[] = {
+	//{"Open", (PyCFunction)Subtitle_Open, METH_NOARGS, "Opens the device for reading"},
+	{NULL}
+};
+
+static PyGetSetDef Subtitle_getseters[] = {
+	{"Num", (getter)Subtitle_getNum, NULL, "Get the subtitle number of this pg (presentation graphics) stream", NULL},
+	{"_CodingType", (getter)Subtitle_getCodingType, NULL, "Get the coding type of this stream", NULL},
+	{"_Format", (getter)Subtitle_getFormat, NULL, "Get the format of this stream", NULL},
+	{"_Rate", (getter)Subtitle_getRate, NULL, "Get the rate of this stream", NULL},
+	{"_Aspect", (getter)Subtitle_getAspect, NULL, "Get the aspect of this stream", NULL},
+	{"Language", (getter)Subtitle_getLanguage, NULL, "Gets the language code of the subtitle", NULL},
+	{"Pid", (getter)Subtitle_getPid, NULL, "Gets the transport stream PID of the subtitle", NULL},
+	{"Bitrate", (getter)Subtitle_getBitrate, NULL, "Gets the measured bitrate (bits/s) after Title.SampleBitrates(), otherwise None", NULL},
+	{NULL}
+};
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Administrative functions for TitleSnapshot
+//
+// Snapshots read the fields of a title record (snapshot.c) wherever it lies: bytes from
+// Title.Snapshot() or unpickling, or any other buffer.  They never touch libbluray, need no
+// lock and are immutable, so they work after the disc is closed and in other processes.
+
+static PyObject*
+TitleSnapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	TitleSnapshot *self;
+
+	self = (TitleSnapshot*)type->tp_alloc(type, 0);
+	if (self)
 	{
-		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive", num);
-		return NULL;
+		memset(&self->view, 0, sizeof(self->view));
+		memset(&self->info, 0, sizeof(self->info));
+
+		self->ChapterClass = NULL;
+		self->ClipClass = NULL;
 	}
-	if (num > self->info->chapter_count)
+
+	return (PyObject*)self;
+}
+
+static int
+TitleSnapshot_init(TitleSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	PyObject *buffer=NULL, *chapterclass=Py_None, *clipclass=Py_None, *tmp=NULL;
+	Py_ssize_t offset=0;
+	static char *kwlist[] = {"Buffer", "Offset", "ChapterClass", "ClipClass", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "O|nOO", kwlist, &buffer, &offset, &chapterclass, &clipclass))
 	{
-		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%d) of available titles", num,self->info->chapter_count);
-		return NULL;
+		return -1;
 	}
 
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
 	{
-		return NULL;
+		return -1;
+	}
+
+	Py_buffer view;
+	if (PyObject_GetBuffer(buffer, &view, PyBUF_SIMPLE) < 0)
+	{
+		return -1;
+	}
+
+	if (offset < 0 || offset > view.len)
+	{
+		PyErr_Format(PyExc_Exception, "Offset (%zd) is outside the buffer of %zd bytes", offset, view.len);
+		PyBuffer_Release(&view);
+		return -1;
+	}
+
+	SnapshotTitle info;
+	if (snapshot_parse(&info, (const uint8_t*)view.buf + offset, view.len - offset) < 0)
+	{
+		PyBuffer_Release(&view);
+		return -1;
+	}
+
+	// view
+	if (self->view.obj)
+	{
+		PyBuffer_Release(&self->view);
+	}
+	self->view = view;
+	self->info = info;
+
+	// chapterclass
+	if (chapterclass == Py_None)
+	{
+		chapterclass = state->ChapterSnapshotType;
+	}
+	tmp = self->ChapterClass;
+	self->ChapterClass = chapterclass;
+	Py_INCREF(chapterclass);
+	Py_CLEAR(tmp);
+
+	// clipclass
+	if (clipclass == Py_None)
+	{
+		clipclass = state->ClipSnapshotType;
+	}
+	tmp = self->ClipClass;
+	self->ClipClass = clipclass;
+	Py_INCREF(clipclass);
+	Py_CLEAR(tmp);
+
+	return 0;
+}
+
+static void
+TitleSnapshot_dealloc(TitleSnapshot *self)
+{
+	if (self->view.obj)
+	{
+		PyBuffer_Release(&self->view);
 	}
 
-	return PyObject_CallObject(self->ChapterClass, a);
+	Py_CLEAR(self->ChapterClass);
+	Py_CLEAR(self->ClipClass);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Interface stuff for TitleSnapshot
+
 static PyObject*
-Title_GetClip(Title *self, PyObject *args, PyObject *kwds)
+TitleSnapshot_getNum(TitleSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->br))
+	return PyLong_FromUnsignedLong(self->info.num);
+}
+
+static PyObject*
+TitleSnapshot_getLength(TitleSnapshot *self)
+{
+	return PyLong_FromUnsignedLongLong(self->info.duration);
+}
+
+static PyObject*
+TitleSnapshot_getNumberOfAngles(TitleSnapshot *self)
+{
+	return PyLong_FromLong((long)self->info.angles);
+}
+
+static PyObject*
+TitleSnapshot_getNumberOfChapters(TitleSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.numchapters);
+}
+
+static PyObject*
+TitleSnapshot_getNumberOfClips(TitleSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.numclips);
+}
+
+static PyObject*
+TitleSnapshot_getPlaylistNumber(TitleSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.playlist);
+}
+
+static PyObject*
+TitleSnapshot_getSize(TitleSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.size);
+}
+
+static PyObject*
+TitleSnapshot_GetChapter(TitleSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
+	if (num < 1)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive", num);
+		return NULL;
+	}
+	if ((uint32_t)num > self->info.numchapters)
+	{
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%u) of available chapters", num,self->info.numchapters);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->ChapterClass, "Oi", self, num);
+}
+
+static PyObject*
+TitleSnapshot_GetClip(TitleSnapshot *self, PyObject *args, PyObject *kwds)
+{
 	int num=0;
 	static char *kwlist[] = {"Num", NULL};
 
@@ -666,68 +3798,85 @@ Title_GetClip(Title *self, PyObject *args, PyObject *kwds)
 
 	if (num < 0)
 	{
-		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative", num);
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if ((uint32_t)num >= self->info.numclips)
+	{
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%u) of available clips", num,self->info.numclips);
+		return NULL;
+	}
+
+	return PyObject_CallFunction(self->ClipClass, "Oi", self, num);
+}
+
+static PyObject*
+TitleSnapshot_reduce(TitleSnapshot *self, PyObject *unused)
+{
+	if (self->view.obj == NULL)
+	{
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
 		return NULL;
 	}
-	if (num >= self->info->clip_count)
+
+	// Pickled as the record alone, cut out of a larger buffer when it lies in one
+	PyObject *rec = self->view.obj;
+	if (PyBytes_CheckExact(rec) && self->info.rec == self->view.buf && self->info.size == self->view.len)
 	{
-		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->clip_count);
-		return NULL;
+		Py_INCREF(rec);
 	}
-
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
+	else
 	{
-		return NULL;
+		rec = PyBytes_FromStringAndSize((const char*)self->info.rec, self->info.size);
+		if (rec == NULL)
+		{
+			return NULL;
+		}
 	}
 
-	return PyObject_CallObject(self->ClipClass, a);
+	return Py_BuildValue("O(N)", (PyObject*)Py_TYPE(self), rec);
 }
 
-
-static PyMemberDef Title_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Title, titlenum), 0, "Title number"},
-	{NULL}
-};
-
-static PyMethodDef Title_methods[] = {
-	{"GetChapter", (PyCFunction)Title_GetChapter, METH_VARARGS|METH_KEYWORDS, "Gets the specified chapter for this title"},
-	{"GetClip", (PyCFunction)Title_GetClip, METH_VARARGS|METH_KEYWORDS, "Gets the specified clip for this title"},
+static PyMethodDef TitleSnapshot_methods[] = {
+	{"GetChapter", (PyCFunction)TitleSnapshot_GetChapter, METH_VARARGS|METH_KEYWORDS, "Gets the specified chapter for this title"},
+	{"GetClip", (PyCFunction)TitleSnapshot_GetClip, METH_VARARGS|METH_KEYWORDS, "Gets the specified clip for this title"},
+	{"__reduce__", (PyCFunction)TitleSnapshot_reduce, METH_NOARGS, "Pickles the title as its packed record"},
 	{NULL}
 };
 
-static PyGetSetDef Title_getseters[] = {
-	{"Num", (getter)Title_getNum, NULL, "Get the title number of this title", NULL},
-	{"Length", (getter)Title_getLength, NULL, "Get the duration of this title", NULL},
-	{"NumberOfAngles", (getter)Title_getNumberOfAngles, NULL, "Gets the number of angles in this title", NULL},
-	{"NumberOfChapters", (getter)Title_getNumberOfChapters, NULL, "Gets the number of chapters in this title", NULL},
-	{"NumberOfClips", (getter)Title_getNumberOfClips, NULL, "Gets the number of clips in this title", NULL},
-	{"PlaylistNumber", (getter)Title_getPlaylistNumber, NULL, "Gets the playlist as a number", NULL},
+static PyGetSetDef TitleSnapshot_getseters[] = {
+	{"Num", (getter)TitleSnapshot_getNum, NULL, "Get the title number of this title", NULL},
+	{"Length", (getter)TitleSnapshot_getLength, NULL, "Get the duration of this title", NULL},
+	{"NumberOfAngles", (getter)TitleSnapshot_getNumberOfAngles, NULL, "Gets the number of angles in this title", NULL},
+	{"NumberOfChapters", (getter)TitleSnapshot_getNumberOfChapters, NULL, "Gets the number of chapters in this title", NULL},
+	{"NumberOfClips", (getter)TitleSnapshot_getNumberOfClips, NULL, "Gets the number of clips in this title", NULL},
+	{"PlaylistNumber", (getter)TitleSnapshot_getPlaylistNumber, NULL, "Gets the playlist as a number", NULL},
+	{"Size", (getter)TitleSnapshot_getSize, NULL, "Gets the bytes the packed record of this title takes", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Chapter
+// Administrative functions for ChapterSnapshot
 
 static PyObject*
-Chapter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+ChapterSnapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Chapter *self;
+	ChapterSnapshot *self;
 
-	self = (Chapter*)type->tp_alloc(type, 0);
+	self = (ChapterSnapshot*)type->tp_alloc(type, 0);
 	if (self)
 	{
 		self->title = NULL;
-		self->info = NULL;
 		self->chapternum = 0;
+		memset(&self->info, 0, sizeof(self->info));
 	}
 
 	return (PyObject*)self;
 }
 
 static int
-Chapter_init(Chapter *self, PyObject *args, PyObject *kwds)
+ChapterSnapshot_init(ChapterSnapshot *self, PyObject *args, PyObject *kwds)
 {
 	PyObject *title=NULL, *tmp=NULL;
 	int num=0;
@@ -738,20 +3887,27 @@ Chapter_init(Chapter *self, PyObject *args, PyObject *kwds)
 		return -1;
 	}
 
-	Title *t = (Title*)title;
-
-	// Get title information for angle 0
-	BLURAY_TITLE_INFO *tinfo = t->info;
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return -1;
+	}
+	if (! PyObject_TypeCheck(title, (PyTypeObject*)state->TitleSnapshotType))
+	{
+		PyErr_SetString(PyExc_TypeError, "Title must be a TitleSnapshot");
+		return -1;
+	}
 
+	TitleSnapshot *t = (TitleSnapshot*)title;
 
-	if (num < 0)
+	if (num < 1)
 	{
 		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive", num);
 		return -1;
 	}
-	if (num > tinfo->chapter_count)
+	if ((uint32_t)num > t->info.numchapters)
 	{
-		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%d) of available chapters", num,tinfo->chapter_count);
+		PyErr_Format(PyExc_Exception, "Chapter number (%d) must be positive but it exceeds the number (%u) of available chapters", num,t->info.numchapters);
 		return -1;
 	}
 
@@ -762,114 +3918,89 @@ Chapter_init(Chapter *self, PyObject *args, PyObject *kwds)
 	Py_CLEAR(tmp);
 
 	self->chapternum = num;
-
-	// Get chapter information
-	self->info = &tinfo->chapters[num];
+	snapshot_chapter(&t->info, num - 1, &self->info);
 
 	return 0;
 }
 
 static void
-Chapter_dealloc(Chapter *self)
+ChapterSnapshot_dealloc(ChapterSnapshot *self)
 {
-	if (self->info)
-	{
-		// Nothing to do, it's a part of title info
-	}
-	self->info = NULL;
-
-	self->chapternum = 0;
 	Py_CLEAR(self->title);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Chapter
+// Interface stuff for ChapterSnapshot
 
 static PyObject*
-Chapter_getNum(Chapter *self)
+ChapterSnapshot_getNum(ChapterSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
 	return PyLong_FromLong((long)self->chapternum);
 }
 
 static PyObject*
-Chapter_getStart(Chapter *self)
+ChapterSnapshot_getStart(ChapterSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->start);
+	return PyLong_FromUnsignedLongLong(self->info.start);
 }
 
 static PyObject*
-Chapter_getLength(Chapter *self)
+ChapterSnapshot_getLength(ChapterSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
+	return PyLong_FromUnsignedLongLong(self->info.length);
+}
 
-	return PyLong_FromLong((long)self->info->duration);
+static PyObject*
+ChapterSnapshot_getClipNum(ChapterSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.clip);
 }
 
 static PyObject*
-Chapter_getClipNum(Chapter *self)
+ChapterSnapshot_reduce(ChapterSnapshot *self, PyObject *unused)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
+	if (self->title == NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
 		return NULL;
 	}
 
-	return PyLong_FromLong((long)self->info->clip_ref);
+	return Py_BuildValue("O(Oi)", (PyObject*)Py_TYPE(self), (PyObject*)self->title, self->chapternum);
 }
 
-
-static PyMemberDef Chapter_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Chapter, chapternum), 0, "Chapter number"},
-	{NULL}
-};
-
-static PyMethodDef Chapter_methods[] = {
-	//{"Open", (PyCFunction)Chapter_Open, METH_NOARGS, "Opens the device for reading"},
+static PyMethodDef ChapterSnapshot_methods[] = {
+	{"__reduce__", (PyCFunction)ChapterSnapshot_reduce, METH_NOARGS, "Pickles the chapter as its title and number"},
 	{NULL}
 };
 
-static PyGetSetDef Chapter_getseters[] = {
-	{"Num", (getter)Chapter_getNum, NULL, "Get the chapter number of this chapte", NULL},
-	{"Start", (getter)Chapter_getStart, NULL, "Get the start time of this chapter", NULL},
-	{"Length", (getter)Chapter_getLength, NULL, "Get the length of this chapter", NULL},
-	{"ClipNum", (getter)Chapter_getClipNum, NULL, "Get the clip number used for this chapter", NULL},
+static PyGetSetDef ChapterSnapshot_getseters[] = {
+	{"Num", (getter)ChapterSnapshot_getNum, NULL, "Get the chapter number of this chapter", NULL},
+	{"Start", (getter)ChapterSnapshot_getStart, NULL, "Get the start time of this chapter", NULL},
+	{"Length", (getter)ChapterSnapshot_getLength, NULL, "Get the duration of this chapter", NULL},
+	{"ClipNum", (getter)ChapterSnapshot_getClipNum, NULL, "Get the clip number this chapter references", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Clip
+// Administrative functions for ClipSnapshot
 
 static PyObject*
-Clip_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+ClipSnapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Clip *self;
+	ClipSnapshot *self;
 
-	self = (Clip*)type->tp_alloc(type, 0);
+	self = (ClipSnapshot*)type->tp_alloc(type, 0);
 	if (self)
 	{
 		self->title = NULL;
-		self->info = NULL;
 		self->clipnum = 0;
+		memset(&self->info, 0, sizeof(self->info));
 
 		self->VideoClass = NULL;
 		self->AudioClass = NULL;
@@ -880,31 +4011,38 @@ Clip_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 }
 
 static int
-Clip_init(Clip *self, PyObject *args, PyObject *kwds)
+ClipSnapshot_init(ClipSnapshot *self, PyObject *args, PyObject *kwds)
 {
-	PyObject *title=NULL, *videoclass=NULL, *audioclass=NULL, *subtitleclass=NULL, *tmp=NULL;
+	PyObject *title=NULL, *videoclass=Py_None, *audioclass=Py_None, *subtitleclass=Py_None, *tmp=NULL;
 	int num=0;
-	static char *kwlist[] = {"Title", "Num", "VideoClass", "audioClass", "SubtitleClass", NULL};
+	static char *kwlist[] = {"Title", "Num", "VideoClass", "AudioClass", "SubtitleClass", NULL};
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "OiOOO", kwlist, &title, &num, &videoclass, &audioclass, &subtitleclass))
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi|OOO", kwlist, &title, &num, &videoclass, &audioclass, &subtitleclass))
 	{
 		return -1;
 	}
 
-	Title *t = (Title*)title;
-
-	// Get title information for angle 0
-	BLURAY_TITLE_INFO *tinfo = t->info;
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return -1;
+	}
+	if (! PyObject_TypeCheck(title, (PyTypeObject*)state->TitleSnapshotType))
+	{
+		PyErr_SetString(PyExc_TypeError, "Title must be a TitleSnapshot");
+		return -1;
+	}
 
+	TitleSnapshot *t = (TitleSnapshot*)title;
 
 	if (num < 0)
 	{
 		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative", num);
 		return -1;
 	}
-	if (num >= tinfo->clip_count)
+	if ((uint32_t)num >= t->info.numclips)
 	{
-		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,tinfo->clip_count);
+		PyErr_Format(PyExc_Exception, "Clip number (%d) must be non-negative but it exceeds the number (%u) of available clips", num,t->info.numclips);
 		return -1;
 	}
 
@@ -915,168 +4053,105 @@ Clip_init(Clip *self, PyObject *args, PyObject *kwds)
 	Py_CLEAR(tmp);
 
 	// videoclass
-	tmp = (PyObject*)self->VideoClass;
+	if (videoclass == Py_None)
+	{
+		videoclass = state->VideoSnapshotType;
+	}
+	tmp = self->VideoClass;
 	self->VideoClass = videoclass;
 	Py_INCREF(videoclass);
 	Py_CLEAR(tmp);
 
 	// audioclass
-	tmp = (PyObject*)self->AudioClass;
+	if (audioclass == Py_None)
+	{
+		audioclass = state->AudioSnapshotType;
+	}
+	tmp = self->AudioClass;
 	self->AudioClass = audioclass;
 	Py_INCREF(audioclass);
 	Py_CLEAR(tmp);
 
 	// subtitleclass
-	tmp = (PyObject*)self->SubtitleClass;
+	if (subtitleclass == Py_None)
+	{
+		subtitleclass = state->SubtitleSnapshotType;
+	}
+	tmp = self->SubtitleClass;
 	self->SubtitleClass = subtitleclass;
 	Py_INCREF(subtitleclass);
 	Py_CLEAR(tmp);
 
 	self->clipnum = num;
-
-	// Get clip information
-	self->info = &tinfo->clips[num];
+	snapshot_clip(&t->info, num, &self->info);
 
 	return 0;
 }
 
 static void
-Clip_dealloc(Clip *self)
+ClipSnapshot_dealloc(ClipSnapshot *self)
 {
-	if (self->info)
-	{
-		// Nothing to do, it's a part of title info
-	}
-	self->info = NULL;
-
-	self->clipnum = 0;
 	Py_CLEAR(self->title);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	Py_CLEAR(self->VideoClass);
+	Py_CLEAR(self->AudioClass);
+	Py_CLEAR(self->SubtitleClass);
+
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Clip
+// Interface stuff for ClipSnapshot
 
 static PyObject*
-Clip_getNum(Clip *self)
+ClipSnapshot_getNum(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
 	return PyLong_FromLong((long)self->clipnum);
 }
 
 static PyObject*
-Clip_getNumberOfVideosPrimary(Clip *self)
+ClipSnapshot_getClipId(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->video_stream_count);
+	return PyUnicode_FromString(self->info.clipid);
 }
 
 static PyObject*
-Clip_getNumberOfVideosSecondary(Clip *self)
+ClipSnapshot_getNumberOfVideosPrimary(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->sec_video_stream_count);
+	return PyLong_FromLong((long)self->info.videos);
 }
 
 static PyObject*
-Clip_getNumberOfAudiosPrimary(Clip *self)
+ClipSnapshot_getNumberOfVideosSecondary(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->audio_stream_count);
+	return PyLong_FromLong((long)self->info.secvideos);
 }
 
 static PyObject*
-Clip_getNumberOfAudiosSecondary(Clip *self)
+ClipSnapshot_getNumberOfAudiosPrimary(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->sec_audio_stream_count);
+	return PyLong_FromLong((long)self->info.audios);
 }
 
 static PyObject*
-Clip_getNumberOfSubtitles(Clip *self)
+ClipSnapshot_getNumberOfAudiosSecondary(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->info->pg_stream_count);
+	return PyLong_FromLong((long)self->info.secaudios);
 }
 
 static PyObject*
-Clip_GetVideo(Clip *self, PyObject *args, PyObject *kwds)
+ClipSnapshot_getNumberOfSubtitles(ClipSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	int num=0;
-	static char *kwlist[] = {"Num", NULL};
-
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
-	{
-		return NULL;
-	}
-
-	if (num < 0)
-	{
-		PyErr_Format(PyExc_Exception, "Video stream number (%d) must be non-negative", num);
-		return NULL;
-	}
-	if (num >= self->info->video_stream_count)
-	{
-		PyErr_Format(PyExc_Exception, "Video stream number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->video_stream_count);
-		return NULL;
-	}
-
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
-	{
-		return NULL;
-	}
-
-	return PyObject_CallObject(self->VideoClass, a);
+	return PyLong_FromLong((long)self->info.subtitles);
 }
 
+// Makes stream @num of @kind with @cls, @count of them in the clip
 static PyObject*
-Clip_GetAudio(Clip *self, PyObject *args, PyObject *kwds)
+_ClipSnapshot_getStream(ClipSnapshot *self, PyObject *args, PyObject *kwds, PyObject *cls, int count, const char *name)
 {
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
 	int num=0;
 	static char *kwlist[] = {"Num", NULL};
 
@@ -1087,107 +4162,89 @@ Clip_GetAudio(Clip *self, PyObject *args, PyObject *kwds)
 
 	if (num < 0)
 	{
-		PyErr_Format(PyExc_Exception, "Audio stream number (%d) must be non-negative", num);
-		return NULL;
-	}
-	if (num >= self->info->audio_stream_count)
-	{
-		PyErr_Format(PyExc_Exception, "Audio stream number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->audio_stream_count);
+		PyErr_Format(PyExc_Exception, "%s stream number (%d) must be non-negative", name, num);
 		return NULL;
 	}
-
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
+	if (num >= count)
 	{
+		PyErr_Format(PyExc_Exception, "%s stream number (%d) must be non-negative but it exceeds the number (%d) of available streams", name, num, count);
 		return NULL;
 	}
 
-	return PyObject_CallObject(self->AudioClass, a);
+	return PyObject_CallFunction(cls, "Oi", self, num);
 }
 
 static PyObject*
-Clip_GetSubtitle(Clip *self, PyObject *args, PyObject *kwds)
-{
-	if (! _Bluray_getIsOpen(self->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	int num=0;
-	static char *kwlist[] = {"Num", NULL};
-
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
-	{
-		return NULL;
-	}
-
-	if (num < 0)
-	{
-		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative", num);
-		return NULL;
-	}
-	if (num >= self->info->pg_stream_count)
-	{
-		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,self->info->pg_stream_count);
-		return NULL;
-	}
+ClipSnapshot_GetVideo(ClipSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	return _ClipSnapshot_getStream(self, args, kwds, self->VideoClass, self->info.videos, "Video");
+}
+
+static PyObject*
+ClipSnapshot_GetAudio(ClipSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	return _ClipSnapshot_getStream(self, args, kwds, self->AudioClass, self->info.audios, "Audio");
+}
+
+static PyObject*
+ClipSnapshot_GetSubtitle(ClipSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	return _ClipSnapshot_getStream(self, args, kwds, self->SubtitleClass, self->info.subtitles, "Subtitle");
+}
 
-	PyObject *a = Py_BuildValue("Oi", self, num);
-	if (a == NULL)
+static PyObject*
+ClipSnapshot_reduce(ClipSnapshot *self, PyObject *unused)
+{
+	if (self->title == NULL)
 	{
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
 		return NULL;
 	}
 
-	return PyObject_CallObject(self->SubtitleClass, a);
+	return Py_BuildValue("O(Oi)", (PyObject*)Py_TYPE(self), (PyObject*)self->title, self->clipnum);
 }
 
-
-
-static PyMemberDef Clip_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Clip, clipnum), 0, "Clip number"},
-	{NULL}
-};
-
-static PyMethodDef Clip_methods[] = {
-	{"GetVideo", (PyCFunction)Clip_GetVideo, METH_VARARGS|METH_KEYWORDS, "Gets video stream for this clip"},
-	{"GetAudio", (PyCFunction)Clip_GetAudio, METH_VARARGS|METH_KEYWORDS, "Gets audio stream for this clip"},
-	{"GetSubtitle", (PyCFunction)Clip_GetSubtitle, METH_VARARGS|METH_KEYWORDS, "Gets subtitle (pg: presentation graphics) for this clip"},
+static PyMethodDef ClipSnapshot_methods[] = {
+	{"GetVideo", (PyCFunction)ClipSnapshot_GetVideo, METH_VARARGS|METH_KEYWORDS, "Gets the specified primary video stream"},
+	{"GetAudio", (PyCFunction)ClipSnapshot_GetAudio, METH_VARARGS|METH_KEYWORDS, "Gets the specified primary audio stream"},
+	{"GetSubtitle", (PyCFunction)ClipSnapshot_GetSubtitle, METH_VARARGS|METH_KEYWORDS, "Gets the specified subtitle stream"},
+	{"__reduce__", (PyCFunction)ClipSnapshot_reduce, METH_NOARGS, "Pickles the clip as its title and number"},
 	{NULL}
 };
 
-static PyGetSetDef Clip_getseters[] = {
-	{"Num", (getter)Clip_getNum, NULL, "Get the clip number of this clip", NULL},
-	{"NumberOfVideosPrimary", (getter)Clip_getNumberOfVideosPrimary, NULL, "Get the number of primary video streams in this clip", NULL},
-	{"NumberOfVideosSecondary", (getter)Clip_getNumberOfVideosSecondary, NULL, "Get the number of secondary video streams in this clip", NULL},
-	{"NumberOfAudiosPrimary", (getter)Clip_getNumberOfAudiosPrimary, NULL, "Get the number of primary audio streams in this clip", NULL},
-	{"NumberOfAudiosSecondary", (getter)Clip_getNumberOfAudiosSecondary, NULL, "Get the number of secondary audio streams in this clip", NULL},
-	{"NumberOfSubtitles", (getter)Clip_getNumberOfSubtitles, NULL, "Get the number of subtitles (pg: presentation graphics) in this clip", NULL},
+static PyGetSetDef ClipSnapshot_getseters[] = {
+	{"Num", (getter)ClipSnapshot_getNum, NULL, "Get the clip number of this clip", NULL},
+	{"ClipId", (getter)ClipSnapshot_getClipId, NULL, "Gets the clip ID (the M2TS file name without extension)", NULL},
+	{"NumberOfVideosPrimary", (getter)ClipSnapshot_getNumberOfVideosPrimary, NULL, "Gets the number of primary video streams", NULL},
+	{"NumberOfVideosSecondary", (getter)ClipSnapshot_getNumberOfVideosSecondary, NULL, "Gets the number of secondary video streams", NULL},
+	{"NumberOfAudiosPrimary", (getter)ClipSnapshot_getNumberOfAudiosPrimary, NULL, "Gets the number of primary audio streams", NULL},
+	{"NumberOfAudiosSecondary", (getter)ClipSnapshot_getNumberOfAudiosSecondary, NULL, "Gets the number of secondary audio streams", NULL},
+	{"NumberOfSubtitles", (getter)ClipSnapshot_getNumberOfSubtitles, NULL, "Gets the number of subtitle (presentation graphics) streams", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Video
+// Administrative functions for VideoSnapshot, AudioSnapshot and SubtitleSnapshot
 
 static PyObject*
-Video_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+StreamSnapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Video *self;
+	StreamSnapshot *self;
 
-	self = (Video*)type->tp_alloc(type, 0);
+	self = (StreamSnapshot*)type->tp_alloc(type, 0);
 	if (self)
 	{
 		self->clip = NULL;
-		self->info = NULL;
-		self->vidnum = 0;
+		self->streamnum = 0;
+		memset(&self->info, 0, sizeof(self->info));
 	}
 
 	return (PyObject*)self;
 }
 
 static int
-Video_init(Video *self, PyObject *args, PyObject *kwds)
+_StreamSnapshot_init(StreamSnapshot *self, PyObject *args, PyObject *kwds, int kind)
 {
 	PyObject *clip=NULL, *tmp=NULL;
 	int num=0;
@@ -1198,17 +4255,36 @@ Video_init(Video *self, PyObject *args, PyObject *kwds)
 		return -1;
 	}
 
-	Clip *c = (Clip*)clip;
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return -1;
+	}
+	if (! PyObject_TypeCheck(clip, (PyTypeObject*)state->ClipSnapshotType))
+	{
+		PyErr_SetString(PyExc_TypeError, "Clip must be a ClipSnapshot");
+		return -1;
+	}
 
+	ClipSnapshot *c = (ClipSnapshot*)clip;
 
-	if (num < 0)
+	// Streams of a clip are its videos, then audios, then subtitles
+	uint32_t first = c->info.first;
+	int count = c->info.videos;
+	if (kind != SNAPSHOT_VIDEO)
 	{
-		PyErr_Format(PyExc_Exception, "Video number (%d) must be non-negative", num);
-		return -1;
+		first += count;
+		count = c->info.audios;
 	}
-	if (num >= c->info->video_stream_count)
+	if (kind == SNAPSHOT_SUBTITLE)
 	{
-		PyErr_Format(PyExc_Exception, "Video number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->video_stream_count);
+		first += count;
+		count = c->info.subtitles;
+	}
+
+	if (num < 0 || num >= count)
+	{
+		PyErr_Format(PyExc_Exception, "Stream number (%d) must be non-negative and less than the number (%d) of available streams", num, count);
 		return -1;
 	}
 
@@ -1218,771 +4294,867 @@ Video_init(Video *self, PyObject *args, PyObject *kwds)
 	Py_INCREF(clip);
 	Py_CLEAR(tmp);
 
-	self->vidnum = num;
-
-	// Get video information
-	self->info = &c->info->video_streams[num];
+	self->streamnum = num;
+	snapshot_stream(&c->title->info, first + num, &self->info);
 
 	return 0;
 }
 
-static void
-Video_dealloc(Video *self)
+static int
+VideoSnapshot_init(StreamSnapshot *self, PyObject *args, PyObject *kwds)
 {
-	if (self->info)
-	{
-		// Nothing to do, it's a part of title info
-	}
-	self->info = NULL;
+	return _StreamSnapshot_init(self, args, kwds, SNAPSHOT_VIDEO);
+}
 
-	self->vidnum = 0;
+static int
+AudioSnapshot_init(StreamSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	return _StreamSnapshot_init(self, args, kwds, SNAPSHOT_AUDIO);
+}
+
+static int
+SubtitleSnapshot_init(StreamSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	return _StreamSnapshot_init(self, args, kwds, SNAPSHOT_SUBTITLE);
+}
+
+static void
+StreamSnapshot_dealloc(StreamSnapshot *self)
+{
 	Py_CLEAR(self->clip);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Video
+// Interface stuff for VideoSnapshot, AudioSnapshot and SubtitleSnapshot
 
 static PyObject*
-Video_getNum(Video *self)
+StreamSnapshot_getNum(StreamSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->vidnum);
+	return PyLong_FromLong((long)self->streamnum);
 }
 
 static PyObject*
-Video_getLanguage(Video *self)
+StreamSnapshot_getLanguage(StreamSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	char lang[5];
-	strncpy(lang, (char*)self->info->lang, 4);
-	lang[4] = '\0';
+	return PyUnicode_FromString(self->info.lang);
+}
 
-	return PyUnicode_FromString(lang);
+static PyObject*
+StreamSnapshot_getCodingType(StreamSnapshot *self)
+{
+	return PyLong_FromLong(self->info.coding_type);
 }
 
 static PyObject*
-Video_getCodingType(Video *self)
+StreamSnapshot_getFormat(StreamSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
+	return PyLong_FromLong(self->info.format);
+}
 
-	return PyLong_FromLong(self->info->coding_type);
+static PyObject*
+StreamSnapshot_getRate(StreamSnapshot *self)
+{
+	return PyLong_FromLong(self->info.rate);
 }
 
 static PyObject*
-Video_getFormat(Video *self)
+StreamSnapshot_getAspect(StreamSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
+	return PyLong_FromLong(self->info.aspect);
+}
 
-	return PyLong_FromLong(self->info->format);
+static PyObject*
+StreamSnapshot_getPid(StreamSnapshot *self)
+{
+	return PyLong_FromLong(self->info.pid);
 }
 
 static PyObject*
-Video_getRate(Audio *self)
+StreamSnapshot_getBitrate(StreamSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->clip == NULL || ! (self->clip->title->info.flags & SNAPSHOT_SAMPLED))
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
+		Py_INCREF(Py_None);
+		return Py_None;
 	}
 
-	return PyLong_FromLong(self->info->rate);
+	return PyLong_FromUnsignedLong(self->info.bitrate);
 }
 
 static PyObject*
-Video_getAspect(Video *self)
+StreamSnapshot_reduce(StreamSnapshot *self, PyObject *unused)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->clip == NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->aspect);
+	return Py_BuildValue("O(Oi)", (PyObject*)Py_TYPE(self), (PyObject*)self->clip, self->streamnum);
 }
 
-
-static PyMemberDef Video_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Video, vidnum), 0, "Video number"},
-	{NULL}
-};
-
-static PyMethodDef Video_methods[] = {
-	//{"Open", (PyCFunction)Video_Open, METH_NOARGS, "Opens the device for reading"},
+static PyMethodDef StreamSnapshot_methods[] = {
+	{"__reduce__", (PyCFunction)StreamSnapshot_reduce, METH_NOARGS, "Pickles the stream as its clip and number"},
 	{NULL}
 };
 
-static PyGetSetDef Video_getseters[] = {
-	{"Num", (getter)Video_getNum, NULL, "Get the video number of this stream", NULL},
-	{"_CodingType", (getter)Video_getCodingType, NULL, "Get the coding type of this stream", NULL},
-	{"_Format", (getter)Video_getFormat, NULL, "Get the format of this stream", NULL},
-	{"_Rate", (getter)Video_getRate, NULL, "Get the rate of this stream", NULL},
-	{"_Aspect", (getter)Video_getAspect, NULL, "Get the aspect of this stream", NULL},
-	{"Language", (getter)Video_getLanguage, NULL, "Gets the language code of the video stream", NULL},
+static PyGetSetDef StreamSnapshot_getseters[] = {
+	{"Num", (getter)StreamSnapshot_getNum, NULL, "Get the number of this stream within its kind", NULL},
+	{"_CodingType", (getter)StreamSnapshot_getCodingType, NULL, "Get the coding type of this stream", NULL},
+	{"_Format", (getter)StreamSnapshot_getFormat, NULL, "Get the format of this stream", NULL},
+	{"_Rate", (getter)StreamSnapshot_getRate, NULL, "Get the rate of this stream", NULL},
+	{"_Aspect", (getter)StreamSnapshot_getAspect, NULL, "Get the aspect of this stream", NULL},
+	{"Language", (getter)StreamSnapshot_getLanguage, NULL, "Gets the language code of the stream", NULL},
+	{"Pid", (getter)StreamSnapshot_getPid, NULL, "Gets the transport stream PID of the stream", NULL},
+	{"Bitrate", (getter)StreamSnapshot_getBitrate, NULL, "Gets the measured bitrate (bits/s) if the title was sampled before the snapshot, otherwise None", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Audio
+// Administrative functions for DiscSnapshot
+//
+// A disc record (snapshot.c) read in place, from Bluray.SnapshotDisc() or within a Catalog.
+// Its titles are TitleSnapshots over the same buffer.
 
 static PyObject*
-Audio_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+DiscSnapshot_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Audio *self;
+	DiscSnapshot *self;
 
-	self = (Audio*)type->tp_alloc(type, 0);
+	self = (DiscSnapshot*)type->tp_alloc(type, 0);
 	if (self)
 	{
-		self->clip = NULL;
-		self->info = NULL;
-		self->audnum = 0;
+		memset(&self->view, 0, sizeof(self->view));
+		memset(&self->info, 0, sizeof(self->info));
+		self->offset = 0;
+
+		self->TitleClass = NULL;
 	}
 
 	return (PyObject*)self;
 }
 
 static int
-Audio_init(Audio *self, PyObject *args, PyObject *kwds)
+DiscSnapshot_init(DiscSnapshot *self, PyObject *args, PyObject *kwds)
 {
-	PyObject *clip=NULL, *tmp=NULL;
-	int num=0;
-	static char *kwlist[] = {"Clip", "Num", NULL};
+	PyObject *buffer=NULL, *titleclass=Py_None, *tmp=NULL;
+	Py_ssize_t offset=0;
+	static char *kwlist[] = {"Buffer", "Offset", "TitleClass", NULL};
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &clip, &num))
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "O|nO", kwlist, &buffer, &offset, &titleclass))
 	{
 		return -1;
 	}
 
-	Clip *c = (Clip*)clip;
-
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return -1;
+	}
 
-	if (num < 0)
+	Py_buffer view;
+	if (PyObject_GetBuffer(buffer, &view, PyBUF_SIMPLE) < 0)
 	{
-		PyErr_Format(PyExc_Exception, "Audio number (%d) must be non-negative", num);
 		return -1;
 	}
-	if (num >= c->info->audio_stream_count)
+
+	if (offset < 0 || offset > view.len)
 	{
-		PyErr_Format(PyExc_Exception, "Audio number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->audio_stream_count);
+		PyErr_Format(PyExc_Exception, "Offset (%zd) is outside the buffer of %zd bytes", offset, view.len);
+		PyBuffer_Release(&view);
 		return -1;
 	}
 
-	// clip
-	tmp = (PyObject*)self->clip;
-	self->clip = c;
-	Py_INCREF(clip);
-	Py_CLEAR(tmp);
+	SnapshotDisc info;
+	if (snapshot_parse_disc(&info, (const uint8_t*)view.buf + offset, view.len - offset) < 0)
+	{
+		PyBuffer_Release(&view);
+		return -1;
+	}
 
-	self->audnum = num;
+	// view
+	if (self->view.obj)
+	{
+		PyBuffer_Release(&self->view);
+	}
+	self->view = view;
+	self->offset = offset;
+	self->info = info;
 
-	// Get subtitle information
-	self->info = &c->info->audio_streams[num];
+	// titleclass
+	if (titleclass == Py_None)
+	{
+		titleclass = state->TitleSnapshotType;
+	}
+	tmp = self->TitleClass;
+	self->TitleClass = titleclass;
+	Py_INCREF(titleclass);
+	Py_CLEAR(tmp);
 
 	return 0;
 }
 
 static void
-Audio_dealloc(Audio *self)
+DiscSnapshot_dealloc(DiscSnapshot *self)
 {
-	if (self->info)
+	if (self->view.obj)
 	{
-		// Nothing to do, it's a part of title info
+		PyBuffer_Release(&self->view);
 	}
-	self->info = NULL;
 
-	self->audnum = 0;
-	Py_CLEAR(self->clip);
+	Py_CLEAR(self->TitleClass);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Audio
+// Interface stuff for DiscSnapshot
 
 static PyObject*
-Audio_getNum(Audio *self)
+DiscSnapshot_getPath(DiscSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->info.pathlen == 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
+		Py_INCREF(Py_None);
+		return Py_None;
 	}
 
-	return PyLong_FromLong((long)self->audnum);
+	return PyUnicode_DecodeUTF8(self->info.path, self->info.pathlen, "surrogateescape");
 }
 
 static PyObject*
-Audio_getCodingType(Audio *self)
+DiscSnapshot_getVolumeId(DiscSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	return PyUnicode_FromString(self->info.volumeid);
+}
+
+static PyObject*
+DiscSnapshot_getDiscId(DiscSnapshot *self)
+{
+	return PyUnicode_FromString(self->info.discid);
+}
+
+static PyObject*
+DiscSnapshot_getOrgId(DiscSnapshot *self)
+{
+	return PyUnicode_FromString(self->info.orgid);
+}
+
+static PyObject*
+DiscSnapshot_getNumberOfTitles(DiscSnapshot *self)
+{
+	return PyLong_FromUnsignedLong(self->info.numtitles);
+}
+
+static PyObject*
+DiscSnapshot_getMainTitleNumber(DiscSnapshot *self)
+{
+	if (self->info.main < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		PyErr_SetString(PyExc_Exception, "Unable to get main title number");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->coding_type);
+	return PyLong_FromLong((long)self->info.main);
 }
 
 static PyObject*
-Audio_getFormat(Audio *self)
+DiscSnapshot_getSize(DiscSnapshot *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	return PyLong_FromUnsignedLong(self->info.size);
+}
+
+static PyObject*
+DiscSnapshot_GetTitle(DiscSnapshot *self, PyObject *args, PyObject *kwds)
+{
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->format);
+	if (num < 0)
+	{
+		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if ((uint32_t)num >= self->info.numtitles)
+	{
+		PyErr_Format(PyExc_Exception, "Title number (%d) must be non-negative but it exceeds the number (%u) of available titles", num,self->info.numtitles);
+		return NULL;
+	}
+
+	uint32_t off;
+	if (snapshot_disc_title(&self->info, num, &off) < 0)
+	{
+		return NULL;
+	}
+
+	// Over the same buffer, nothing is copied
+	return PyObject_CallFunction(self->TitleClass, "On", self->view.obj, self->offset + (Py_ssize_t)off);
 }
 
 static PyObject*
-Audio_getRate(Audio *self)
+DiscSnapshot_FindTitles(DiscSnapshot *self, PyObject *args, PyObject *kwds)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->view.obj == NULL)
+	{
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
+		return NULL;
+	}
+
+	SnapshotQuery q;
+	if (_Query_parse(&q, args, kwds) < 0)
+	{
+		_Query_free(&q);
+		return NULL;
+	}
+
+	PyObject *ret = PyList_New(0);
+	uint32_t i;
+
+	for (i = 0; ret != NULL && i < self->info.numtitles; i++)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
+		SnapshotTitle t;
+		uint32_t off;
+		if (snapshot_disc_title(&self->info, i, &off) < 0 || snapshot_parse(&t, self->info.rec + off, self->info.size - off) < 0)
+		{
+			Py_CLEAR(ret);
+			break;
+		}
+		if (! snapshot_match(&t, &q))
+		{
+			continue;
+		}
+
+		PyObject *num = PyLong_FromUnsignedLong(i);
+		if (num == NULL || PyList_Append(ret, num) < 0)
+		{
+			Py_CLEAR(ret);
+		}
+		Py_XDECREF(num);
 	}
+	_Query_free(&q);
 
-	return PyLong_FromLong(self->info->rate);
+	return ret;
 }
 
 static PyObject*
-Audio_getAspect(Audio *self)
+DiscSnapshot_Record(DiscSnapshot *self, PyObject *unused)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->view.obj == NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		PyErr_SetString(PyExc_Exception, "Snapshot was never initialized");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->aspect);
+	PyObject *rec = self->view.obj;
+	if (PyBytes_CheckExact(rec) && self->offset == 0 && self->info.size == self->view.len)
+	{
+		Py_INCREF(rec);
+		return rec;
+	}
+
+	return PyBytes_FromStringAndSize((const char*)self->info.rec, self->info.size);
 }
 
 static PyObject*
-Audio_getLanguage(Audio *self)
+DiscSnapshot_reduce(DiscSnapshot *self, PyObject *unused)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	PyObject *rec = DiscSnapshot_Record(self, NULL);
+	if (rec == NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	char lang[5];
-	strncpy(lang, (char*)self->info->lang, 4);
-	lang[4] = '\0';
-
-	return PyUnicode_FromString(lang);
+	return Py_BuildValue("O(N)", (PyObject*)Py_TYPE(self), rec);
 }
 
-
-static PyMemberDef Audio_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Audio, audnum), 0, "Audio number"},
-	{NULL}
-};
-
-static PyMethodDef Audio_methods[] = {
-	//{"Open", (PyCFunction)Audio_Open, METH_NOARGS, "Opens the device for reading"},
+static PyMethodDef DiscSnapshot_methods[] = {
+	{"GetTitle", (PyCFunction)DiscSnapshot_GetTitle, METH_VARARGS|METH_KEYWORDS, "Gets the specified title, read in place"},
+	{"FindTitles", (PyCFunction)DiscSnapshot_FindTitles, METH_VARARGS|METH_KEYWORDS, "Gets the numbers of the titles matching the conditions Bluray.FindTitles() takes, read in place"},
+	{"Record", (PyCFunction)DiscSnapshot_Record, METH_NOARGS, "Gets the packed disc record as bytes"},
+	{"__reduce__", (PyCFunction)DiscSnapshot_reduce, METH_NOARGS, "Pickles the disc as its packed record"},
 	{NULL}
 };
 
-static PyGetSetDef Audio_getseters[] = {
-	{"Num", (getter)Audio_getNum, NULL, "Get the audio number of this stream", NULL},
-	{"_CodingType", (getter)Audio_getCodingType, NULL, "Get the coding type of this stream", NULL},
-	{"_Format", (getter)Audio_getFormat, NULL, "Get the format of this stream", NULL},
-	{"_Rate", (getter)Audio_getRate, NULL, "Get the rate of this stream", NULL},
-	{"_Aspect", (getter)Audio_getAspect, NULL, "Get the aspect of this stream", NULL},
-	{"Language", (getter)Audio_getLanguage, NULL, "Gets the language code of the audio stream", NULL},
+static PyGetSetDef DiscSnapshot_getseters[] = {
+	{"Path", (getter)DiscSnapshot_getPath, NULL, "Get the path the disc was opened from, None for images in memory and file-like objects", NULL},
+	{"VolumeId", (getter)DiscSnapshot_getVolumeId, NULL, "Gets the UDF volume identifier", NULL},
+	{"DiscId", (getter)DiscSnapshot_getDiscId, NULL, "Gets the disc identifier", NULL},
+	{"OrgId", (getter)DiscSnapshot_getOrgId, NULL, "Gets the organization identifier", NULL},
+	{"NumberOfTitles", (getter)DiscSnapshot_getNumberOfTitles, NULL, "Gets the number of titles", NULL},
+	{"MainTitleNumber", (getter)DiscSnapshot_getMainTitleNumber, NULL, "Gets the main title number", NULL},
+	{"Size", (getter)DiscSnapshot_getSize, NULL, "Gets the bytes the packed record of this disc takes", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Administrative functions for Subtitle
+// Administrative functions for Catalog
+//
+// Disc records of many discs in one buffer, typically shared memory or a mapped file that
+// every worker process reads in place.
 
 static PyObject*
-Subtitle_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+Catalog_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-	Subtitle *self;
+	Catalog *self;
 
-	self = (Subtitle*)type->tp_alloc(type, 0);
+	self = (Catalog*)type->tp_alloc(type, 0);
 	if (self)
 	{
-		self->clip = NULL;
-		self->info = NULL;
-		self->pgnum = 0;
+		memset(&self->view, 0, sizeof(self->view));
+		memset(&self->info, 0, sizeof(self->info));
+
+		self->DiscClass = NULL;
+		self->owner = NULL;
 	}
 
 	return (PyObject*)self;
 }
 
 static int
-Subtitle_init(Subtitle *self, PyObject *args, PyObject *kwds)
+Catalog_init(Catalog *self, PyObject *args, PyObject *kwds)
 {
-	PyObject *clip=NULL, *tmp=NULL;
-	int num=0;
-	static char *kwlist[] = {"Clip", "Num", NULL};
+	PyObject *buffer=NULL, *discclass=Py_None, *owner=Py_None, *tmp=NULL;
+	static char *kwlist[] = {"Buffer", "DiscClass", "Owner", NULL};
 
-	if (! PyArg_ParseTupleAndKeywords(args,kwds, "Oi", kwlist, &clip, &num))
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "O|OO", kwlist, &buffer, &discclass, &owner))
 	{
 		return -1;
 	}
 
-	Clip *c = (Clip*)clip;
-
+	BluReadState *state = _BluRead_getState(Py_TYPE(self));
+	if (state == NULL)
+	{
+		return -1;
+	}
 
-	if (num < 0)
+	Py_buffer view;
+	if (PyObject_GetBuffer(buffer, &view, PyBUF_SIMPLE) < 0)
 	{
-		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative", num);
 		return -1;
 	}
-	if (num >= c->info->pg_stream_count)
+
+	SnapshotCatalog info;
+	if (snapshot_parse_catalog(&info, view.buf, view.len) < 0)
 	{
-		PyErr_Format(PyExc_Exception, "Subtitle number (%d) must be non-negative but it exceeds the number (%d) of available clips", num,c->info->pg_stream_count);
+		PyBuffer_Release(&view);
 		return -1;
 	}
 
-	// clip
-	tmp = (PyObject*)self->clip;
-	self->clip = c;
-	Py_INCREF(clip);
-	Py_CLEAR(tmp);
+	// view
+	if (self->view.obj)
+	{
+		PyBuffer_Release(&self->view);
+	}
+	self->view = view;
+	self->info = info;
 
-	self->pgnum = num;
+	// discclass
+	if (discclass == Py_None)
+	{
+		discclass = state->DiscSnapshotType;
+	}
+	tmp = self->DiscClass;
+	self->DiscClass = discclass;
+	Py_INCREF(discclass);
+	Py_CLEAR(tmp);
 
-	// Get subtitle information
-	self->info = &c->info->pg_streams[num];
+	// owner
+	tmp = self->owner;
+	self->owner = owner;
+	Py_INCREF(owner);
+	Py_CLEAR(tmp);
 
 	return 0;
 }
 
 static void
-Subtitle_dealloc(Subtitle *self)
+Catalog_dealloc(Catalog *self)
 {
-	if (self->info)
+	if (self->view.obj)
 	{
-		// Nothing to do, it's a part of title info
+		PyBuffer_Release(&self->view);
 	}
-	self->info = NULL;
 
-	self->pgnum = 0;
-	Py_CLEAR(self->clip);
+	Py_CLEAR(self->DiscClass);
+	Py_CLEAR(self->owner);
 
-	Py_TYPE(self)->tp_free((PyObject*)self);
+	PyTypeObject *type = Py_TYPE(self);
+	type->tp_free((PyObject*)self);
+	Py_DECREF(type);
 }
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Interface stuff for Subtitle
+// Interface stuff for Catalog
 
 static PyObject*
-Subtitle_getNum(Subtitle *self)
+Catalog_getNumberOfDiscs(Catalog *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong((long)self->pgnum);
+	return PyLong_FromUnsignedLong(self->info.numdiscs);
 }
 
 static PyObject*
-Subtitle_getCodingType(Subtitle *self)
+Catalog_getSize(Catalog *self)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
-	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
-	}
-
-	return PyLong_FromLong(self->info->coding_type);
+	return PyLong_FromUnsignedLongLong(self->info.size);
 }
 
 static PyObject*
-Subtitle_getFormat(Subtitle *self)
+Catalog_GetDisc(Catalog *self, PyObject *args, PyObject *kwds)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	int num=0;
+	static char *kwlist[] = {"Num", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "i", kwlist, &num))
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->format);
-}
-
-static PyObject*
-Subtitle_getRate(Audio *self)
-{
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (num < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
+		PyErr_Format(PyExc_Exception, "Disc number (%d) must be non-negative", num);
+		return NULL;
+	}
+	if ((uint32_t)num >= self->info.numdiscs)
+	{
+		PyErr_Format(PyExc_Exception, "Disc number (%d) must be non-negative but it exceeds the number (%u) of discs in the catalog", num,self->info.numdiscs);
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->rate);
-}
-
-static PyObject*
-Subtitle_getAspect(Subtitle *self)
-{
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	uint64_t off;
+	if (snapshot_catalog_disc(&self->info, num, &off) < 0)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
 		return NULL;
 	}
 
-	return PyLong_FromLong(self->info->aspect);
+	// Over the catalog itself, which stays alive while any disc or title read from it does
+	return PyObject_CallFunction(self->DiscClass, "On", self, (Py_ssize_t)off);
 }
 
-static PyObject*
-Subtitle_getLanguage(Subtitle *self)
+// Lends the catalog's buffer, read-only
+static int
+Catalog_getbuffer(Catalog *self, Py_buffer *view, int flags)
 {
-	if (! _Bluray_getIsOpen(self->clip->title->br))
+	if (self->view.obj == NULL)
 	{
-		PyErr_SetString(PyExc_Exception, "Device not open, must Open() it first before accessing it");
-		return NULL;
+		PyErr_SetString(PyExc_BufferError, "Catalog was never initialized");
+		view->obj = NULL;
+		return -1;
 	}
 
-	char lang[5];
-	strncpy(lang, (char*)self->info->lang, 4);
-	lang[4] = '\0';
-
-	return PyUnicode_FromString(lang);
+	return PyBuffer_FillInfo(view, (PyObject*)self, self->view.buf, self->view.len, 1, flags);
 }
 
-
-static PyMemberDef Subtitle_members[] = {
-	{"_num", T_OBJECT_EX, offsetof(Subtitle, pgnum), 0, "Subtitle number"},
-	{NULL}
-};
-
-static PyMethodDef Subtitle_methods[] = {
-	//{"Open", (PyCFunction)Subtitle_Open, METH_NOARGS, "Opens the device for reading"},
+static PyMethodDef Catalog_methods[] = {
+	{"GetDisc", (PyCFunction)Catalog_GetDisc, METH_VARARGS|METH_KEYWORDS, "Gets the specified disc, read in place"},
 	{NULL}
 };
 
-static PyGetSetDef Subtitle_getseters[] = {
-	{"Num", (getter)Subtitle_getNum, NULL, "Get the subtitle number of this pg (presentation graphics) stream", NULL},
-	{"_CodingType", (getter)Subtitle_getCodingType, NULL, "Get the coding type of this stream", NULL},
-	{"_Format", (getter)Subtitle_getFormat, NULL, "Get the format of this stream", NULL},
-	{"_Rate", (getter)Subtitle_getRate, NULL, "Get the rate of this stream", NULL},
-	{"_Aspect", (getter)Subtitle_getAspect, NULL, "Get the aspect of this stream", NULL},
-	{"Language", (getter)Subtitle_getLanguage, NULL, "Gets the language code of the subtitle", NULL},
+static PyGetSetDef Catalog_getseters[] = {
+	{"NumberOfDiscs", (getter)Catalog_getNumberOfDiscs, NULL, "Gets the number of discs in the catalog", NULL},
+	{"Size", (getter)Catalog_getSize, NULL, "Gets the bytes the catalog takes", NULL},
 	{NULL}
 };
 
 // --------------------------------------------------------------------------------
 // --------------------------------------------------------------------------------
-// Fully define PyObject types now
-
-static PyTypeObject BlurayType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Bluray",         /* tp_name */
-	sizeof(Bluray),            /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Bluray_dealloc,/* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Bluray_methods,            /* tp_methods */
-	Bluray_members,            /* tp_members */
-	Bluray_getseters,          /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Bluray_init,     /* tp_init */
-	0,                         /* tp_alloc */
-	Bluray_new,                /* tp_new */
-};
-
-static PyTypeObject TitleType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Title",          /* tp_name */
-	sizeof(Title),             /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Title_dealloc, /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Title_methods,             /* tp_methods */
-	Title_members,             /* tp_members */
-	Title_getseters,           /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Title_init,      /* tp_init */
-	0,                         /* tp_alloc */
-	Title_new,                 /* tp_new */
-};
-
-static PyTypeObject ChapterType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Chapter",        /* tp_name */
-	sizeof(Chapter),           /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Chapter_dealloc, /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Chapter_methods,           /* tp_methods */
-	Chapter_members,           /* tp_members */
-	Chapter_getseters,         /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Chapter_init,    /* tp_init */
-	0,                         /* tp_alloc */
-	Chapter_new,               /* tp_new */
-};
-
-static PyTypeObject ClipType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Clip",           /* tp_name */
-	sizeof(Clip),              /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Clip_dealloc,  /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Clip_methods,              /* tp_methods */
-	Clip_members,              /* tp_members */
-	Clip_getseters,            /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Clip_init,       /* tp_init */
-	0,                         /* tp_alloc */
-	Clip_new,                  /* tp_new */
-};
-
-static PyTypeObject VideoType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Video",          /* tp_name */
-	sizeof(Video),             /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Video_dealloc, /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Video_methods,             /* tp_methods */
-	Video_members,             /* tp_members */
-	Video_getseters,           /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Video_init,      /* tp_init */
-	0,                         /* tp_alloc */
-	Video_new,                 /* tp_new */
-};
-
-static PyTypeObject AudioType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Audio",          /* tp_name */
-	sizeof(Audio),             /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Audio_dealloc, /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Audio_methods,             /* tp_methods */
-	Audio_members,             /* tp_members */
-	Audio_getseters,           /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Audio_init,      /* tp_init */
-	0,                         /* tp_alloc */
-	Audio_new,                 /* tp_new */
-};
-
-static PyTypeObject SubtitleType = {
-	PyVarObject_HEAD_INIT(NULL, 0)
-	"_bluread.Subtitle",       /* tp_name */
-	sizeof(Subtitle),          /* tp_basicsize */
-	0,                         /* tp_itemsize */
-	(destructor)Subtitle_dealloc,  /* tp_dealloc */
-	0,                         /* tp_print */
-	0,                         /* tp_getattr */
-	0,                         /* tp_setattr */
-	0,                         /* tp_reserved */
-	0,                         /* tp_repr */
-	0,                         /* tp_as_number */
-	0,                         /* tp_as_sequence */
-	0,                         /* tp_as_mapping */
-	0,                         /* tp_hash  */
-	0,                         /* tp_call */
-	0,                         /* tp_str */
-	0,                         /* tp_getattro */
-	0,                         /* tp_setattro */
-	0,                         /* tp_as_buffer */
-	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE,        /* tp_flags */
-	"Represents a BLURAY from libbluray",          /* tp_doc */
-	0,                         /* tp_traverse */
-	0,                         /* tp_clear */
-	0,                         /* tp_richcompare */
-	0,                         /* tp_weaklistoffset */
-	0,                         /* tp_iter */
-	0,                         /* tp_iternext */
-	Subtitle_methods,          /* tp_methods */
-	Subtitle_members,          /* tp_members */
-	Subtitle_getseters,        /* tp_getset */
-	0,                         /* tp_base */
-	0,                         /* tp_dict */
-	0,                         /* tp_descr_get */
-	0,                         /* tp_descr_set */
-	0,                         /* tp_dictoffset */
-	(initproc)Subtitle_init,   /* tp_init */
-	0,                         /* tp_alloc */
-	Subtitle_new,              /* tp_new */
+// Fully define PyObject types now, as heap types made per module by PyType_FromModuleAndSpec()
+
+#ifndef Py_TPFLAGS_IMMUTABLETYPE
+#define Py_TPFLAGS_IMMUTABLETYPE 0 // Python 3.9
+#endif
+
+static PyType_Slot Bluray_slots[] = {
+	{Py_tp_dealloc, Bluray_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Bluray_methods},
+	{Py_tp_members, Bluray_members},
+	{Py_tp_getset, Bluray_getseters},
+	{Py_tp_init, Bluray_init},
+	{Py_tp_new, Bluray_new},
+	{0, NULL}
+};
+
+static PyType_Spec Bluray_spec = {
+	"_bluread.Bluray",
+	sizeof(Bluray),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Bluray_slots
+};
+
+static PyType_Slot Title_slots[] = {
+	{Py_tp_dealloc, Title_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Title_methods},
+	{Py_tp_members, Title_members},
+	{Py_tp_getset, Title_getseters},
+	{Py_tp_init, Title_init},
+	{Py_tp_new, Title_new},
+	{0, NULL}
+};
+
+static PyType_Spec Title_spec = {
+	"_bluread.Title",
+	sizeof(Title),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Title_slots
+};
+
+static PyType_Slot Chapter_slots[] = {
+	{Py_tp_dealloc, Chapter_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Chapter_methods},
+	{Py_tp_members, Chapter_members},
+	{Py_tp_getset, Chapter_getseters},
+	{Py_tp_init, Chapter_init},
+	{Py_tp_new, Chapter_new},
+	{0, NULL}
+};
+
+static PyType_Spec Chapter_spec = {
+	"_bluread.Chapter",
+	sizeof(Chapter),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Chapter_slots
+};
+
+static PyType_Slot Clip_slots[] = {
+	{Py_tp_dealloc, Clip_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Clip_methods},
+	{Py_tp_members, Clip_members},
+	{Py_tp_getset, Clip_getseters},
+	{Py_tp_init, Clip_init},
+	{Py_tp_new, Clip_new},
+	{0, NULL}
+};
+
+static PyType_Spec Clip_spec = {
+	"_bluread.Clip",
+	sizeof(Clip),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Clip_slots
+};
+
+static PyType_Slot Video_slots[] = {
+	{Py_tp_dealloc, Video_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Video_methods},
+	{Py_tp_members, Video_members},
+	{Py_tp_getset, Video_getseters},
+	{Py_tp_init, Video_init},
+	{Py_tp_new, Video_new},
+	{0, NULL}
+};
+
+static PyType_Spec Video_spec = {
+	"_bluread.Video",
+	sizeof(Video),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Video_slots
+};
+
+static PyType_Slot Audio_slots[] = {
+	{Py_tp_dealloc, Audio_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Audio_methods},
+	{Py_tp_members, Audio_members},
+	{Py_tp_getset, Audio_getseters},
+	{Py_tp_init, Audio_init},
+	{Py_tp_new, Audio_new},
+	{0, NULL}
+};
+
+static PyType_Spec Audio_spec = {
+	"_bluread.Audio",
+	sizeof(Audio),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Audio_slots
+};
+
+static PyType_Slot Subtitle_slots[] = {
+	{Py_tp_dealloc, Subtitle_dealloc},
+	{Py_tp_doc, "Represents a BLURAY from libbluray"},
+	{Py_tp_methods, Subtitle_methods},
+	{Py_tp_members, Subtitle_members},
+	{Py_tp_getset, Subtitle_getseters},
+	{Py_tp_init, Subtitle_init},
+	{Py_tp_new, Subtitle_new},
+	{0, NULL}
+};
+
+static PyType_Spec Subtitle_spec = {
+	"_bluread.Subtitle",
+	sizeof(Subtitle),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Subtitle_slots
+};
+
+static PyType_Slot TitleSnapshot_slots[] = {
+	{Py_tp_dealloc, TitleSnapshot_dealloc},
+	{Py_tp_doc, "Detached, immutable copy of a title's metadata"},
+	{Py_tp_methods, TitleSnapshot_methods},
+	{Py_tp_getset, TitleSnapshot_getseters},
+	{Py_tp_init, TitleSnapshot_init},
+	{Py_tp_new, TitleSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec TitleSnapshot_spec = {
+	"_bluread.TitleSnapshot",
+	sizeof(TitleSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	TitleSnapshot_slots
+};
+
+static PyType_Slot ChapterSnapshot_slots[] = {
+	{Py_tp_dealloc, ChapterSnapshot_dealloc},
+	{Py_tp_doc, "Chapter of a TitleSnapshot"},
+	{Py_tp_methods, ChapterSnapshot_methods},
+	{Py_tp_getset, ChapterSnapshot_getseters},
+	{Py_tp_init, ChapterSnapshot_init},
+	{Py_tp_new, ChapterSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec ChapterSnapshot_spec = {
+	"_bluread.ChapterSnapshot",
+	sizeof(ChapterSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	ChapterSnapshot_slots
+};
+
+static PyType_Slot ClipSnapshot_slots[] = {
+	{Py_tp_dealloc, ClipSnapshot_dealloc},
+	{Py_tp_doc, "Clip of a TitleSnapshot"},
+	{Py_tp_methods, ClipSnapshot_methods},
+	{Py_tp_getset, ClipSnapshot_getseters},
+	{Py_tp_init, ClipSnapshot_init},
+	{Py_tp_new, ClipSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec ClipSnapshot_spec = {
+	"_bluread.ClipSnapshot",
+	sizeof(ClipSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	ClipSnapshot_slots
+};
+
+static PyType_Slot VideoSnapshot_slots[] = {
+	{Py_tp_dealloc, StreamSnapshot_dealloc},
+	{Py_tp_doc, "Video stream of a ClipSnapshot"},
+	{Py_tp_methods, StreamSnapshot_methods},
+	{Py_tp_getset, StreamSnapshot_getseters},
+	{Py_tp_init, VideoSnapshot_init},
+	{Py_tp_new, StreamSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec VideoSnapshot_spec = {
+	"_bluread.VideoSnapshot",
+	sizeof(StreamSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	VideoSnapshot_slots
+};
+
+static PyType_Slot AudioSnapshot_slots[] = {
+	{Py_tp_dealloc, StreamSnapshot_dealloc},
+	{Py_tp_doc, "Audio stream of a ClipSnapshot"},
+	{Py_tp_methods, StreamSnapshot_methods},
+	{Py_tp_getset, StreamSnapshot_getseters},
+	{Py_tp_init, AudioSnapshot_init},
+	{Py_tp_new, StreamSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec AudioSnapshot_spec = {
+	"_bluread.AudioSnapshot",
+	sizeof(StreamSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	AudioSnapshot_slots
+};
+
+static PyType_Slot SubtitleSnapshot_slots[] = {
+	{Py_tp_dealloc, StreamSnapshot_dealloc},
+	{Py_tp_doc, "Subtitle stream of a ClipSnapshot"},
+	{Py_tp_methods, StreamSnapshot_methods},
+	{Py_tp_getset, StreamSnapshot_getseters},
+	{Py_tp_init, SubtitleSnapshot_init},
+	{Py_tp_new, StreamSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec SubtitleSnapshot_spec = {
+	"_bluread.SubtitleSnapshot",
+	sizeof(StreamSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	SubtitleSnapshot_slots
+};
+
+static PyType_Slot DiscSnapshot_slots[] = {
+	{Py_tp_dealloc, DiscSnapshot_dealloc},
+	{Py_tp_doc, "Detached, immutable copy of a disc's metadata and its titles"},
+	{Py_tp_methods, DiscSnapshot_methods},
+	{Py_tp_getset, DiscSnapshot_getseters},
+	{Py_tp_init, DiscSnapshot_init},
+	{Py_tp_new, DiscSnapshot_new},
+	{0, NULL}
+};
+
+static PyType_Spec DiscSnapshot_spec = {
+	"_bluread.DiscSnapshot",
+	sizeof(DiscSnapshot),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	DiscSnapshot_slots
+};
+
+static PyType_Slot Catalog_slots[] = {
+	{Py_tp_dealloc, Catalog_dealloc},
+	{Py_tp_doc, "Disc snapshots of many discs in one buffer, read in place"},
+	{Py_tp_methods, Catalog_methods},
+	{Py_tp_getset, Catalog_getseters},
+	{Py_tp_init, Catalog_init},
+	{Py_tp_new, Catalog_new},
+	{Py_bf_getbuffer, Catalog_getbuffer},
+	{0, NULL}
+};
+
+static PyType_Spec Catalog_spec = {
+	"_bluread.Catalog",
+	sizeof(Catalog),
+	0,
+	Py_TPFLAGS_DEFAULT|Py_TPFLAGS_BASETYPE|Py_TPFLAGS_IMMUTABLETYPE,
+	Catalog_slots
 };
 
 // --------------------------------------------------------------------------------
@@ -1990,51 +5162,162 @@ static PyTypeObject SubtitleType = {
 // Define the module
 
 static PyMethodDef BluReadModuleMethods[] = {
+	{"ScanPackets", (PyCFunction)BluRead_ScanPackets, METH_VARARGS|METH_KEYWORDS, "Validates sync bytes and counts packets per PID in a buffer of BDAV (M2TS) packets"},
+	{"Backup", (PyCFunction)BluRead_Backup, METH_VARARGS|METH_KEYWORDS, "Copies the files of a disc into a directory, reading the disc in one pass in physical order"},
+	{"Fingerprint", (PyCFunction)BluRead_Fingerprint, METH_VARARGS|METH_KEYWORDS, "Quickly fingerprints a disc from its BDMV metadata and sampled stream sectors"},
+	{"Image", (PyCFunction)BluRead_Image, METH_VARARGS|METH_KEYWORDS, "Resumably copies a device or image to a file, optionally hashing it inline, keeping several chunks in flight with an I/O engine, leaving zero blocks as holes or compressing to a seekable zstd image"},
+	{"Verify", (PyCFunction)BluRead_Verify, METH_VARARGS|METH_KEYWORDS, "Re-reads a device and compares it with its image, fully or sampled, returning the sector ranges that differ"},
+	{"Stats", (PyCFunction)BluRead_Stats, METH_VARARGS|METH_KEYWORDS, "Gets call counts, latencies and histograms of libbluray calls and object construction summed over all discs"},
+	{"EnableStats", (PyCFunction)BluRead_EnableStats, METH_VARARGS|METH_KEYWORDS, "Turns latency counters on or off, returning the previous setting; BLUREAD_STATS in the environment turns them on at import"},
+	{"Metrics", (PyCFunction)BluRead_Metrics, METH_NOARGS, "Gets the process wide counters of opens, titles parsed, bytes read and imaged, read errors, retries and cache lookups, with the open latency histogram"},
+	{"SetDebugHandler", (PyCFunction)BluRead_SetDebugHandler, METH_VARARGS|METH_KEYWORDS, "Sends libbluray debug output matching Mask to a ring read by DrainDebugLog() instead of stderr, repeats collapsed and at most Rate lines a second; Enable=False restores stderr"},
+	{"DrainDebugLog", (PyCFunction)BluRead_DrainDebugLog, METH_VARARGS|METH_KEYWORDS, "Takes up to Max queued libbluray debug lines, each with the repeat count of the line before it, and the counts of repeated, dropped and suppressed lines since the last drain"},
 	{NULL, NULL, 0, NULL}
 };
 
-static struct PyModuleDef BluReadModule = {
-	PyModuleDef_HEAD_INIT,
-	"_bluread",
-	"Python wrapper for libbluray", // Doc
-	-1, // state in global vars
-	BluReadModuleMethods
-};
+static int
+_BluRead_traverse(PyObject *m, visitproc visit, void *arg)
+{
+	BluReadState *state = PyModule_GetState(m);
+	Py_VISIT(state->BlurayType);
+	Py_VISIT(state->TitleType);
+	Py_VISIT(state->ChapterType);
+	Py_VISIT(state->ClipType);
+	Py_VISIT(state->VideoType);
+	Py_VISIT(state->AudioType);
+	Py_VISIT(state->SubtitleType);
+	Py_VISIT(state->TitleSnapshotType);
+	Py_VISIT(state->ChapterSnapshotType);
+	Py_VISIT(state->ClipSnapshotType);
+	Py_VISIT(state->VideoSnapshotType);
+	Py_VISIT(state->AudioSnapshotType);
+	Py_VISIT(state->SubtitleSnapshotType);
+	Py_VISIT(state->DiscSnapshotType);
+	Py_VISIT(state->CatalogType);
+	return 0;
+}
 
-PyMODINIT_FUNC
-PyInit__bluread(void)
+static int
+_BluRead_clear(PyObject *m)
+{
+	BluReadState *state = PyModule_GetState(m);
+	Py_CLEAR(state->BlurayType);
+	Py_CLEAR(state->TitleType);
+	Py_CLEAR(state->ChapterType);
+	Py_CLEAR(state->ClipType);
+	Py_CLEAR(state->VideoType);
+	Py_CLEAR(state->AudioType);
+	Py_CLEAR(state->SubtitleType);
+	Py_CLEAR(state->TitleSnapshotType);
+	Py_CLEAR(state->ChapterSnapshotType);
+	Py_CLEAR(state->ClipSnapshotType);
+	Py_CLEAR(state->VideoSnapshotType);
+	Py_CLEAR(state->AudioSnapshotType);
+	Py_CLEAR(state->SubtitleSnapshotType);
+	Py_CLEAR(state->DiscSnapshotType);
+	Py_CLEAR(state->CatalogType);
+	return 0;
+}
+
+static void
+_BluRead_free(void *m)
 {
-	// Ready the types
-	if(PyType_Ready(&BlurayType) < 0) { return NULL; }
-	if(PyType_Ready(&TitleType) < 0) { return NULL; }
-	if(PyType_Ready(&ChapterType) < 0) { return NULL; }
-	if(PyType_Ready(&ClipType) < 0) { return NULL; }
-	if(PyType_Ready(&VideoType) < 0) { return NULL; }
-	if(PyType_Ready(&AudioType) < 0) { return NULL; }
-	if(PyType_Ready(&SubtitleType) < 0) { return NULL; }
+	_BluRead_clear((PyObject*)m);
+}
+
+// Process wide, whichever interpreter imports the module first
+static pthread_once_t bluread_once = PTHREAD_ONCE_INIT;
+
+static void
+_BluRead_init(void)
+{
+	// Pick the fastest packet scan and zero block kernels for this CPU
+	tsscan_init();
+	zeroscan_init();
 
-	// Create the module defined in the struct above
-	PyObject *m = PyModule_Create(&BluReadModule);
-	if (m == NULL)
+	// Latency counters are off unless asked for
+	if (getenv("BLUREAD_STATS") != NULL)
 	{
-		return NULL;
+		__atomic_store_n(&stats_enabled, 1, __ATOMIC_RELAXED);
+	}
+}
+
+static int
+_BluRead_addType(PyObject *m, PyType_Spec *spec, PyObject **slot)
+{
+	*slot = PyType_FromModuleAndSpec(m, spec, NULL);
+	if (*slot == NULL)
+	{
+		return -1;
 	}
 
+	return PyModule_AddType(m, (PyTypeObject*)*slot);
+}
+
+static int
+_BluRead_exec(PyObject *m)
+{
+	BluReadState *state = PyModule_GetState(m);
+
+	// Make the types for this module
+	if (_BluRead_addType(m, &Bluray_spec, &state->BlurayType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Title_spec, &state->TitleType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Chapter_spec, &state->ChapterType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Clip_spec, &state->ClipType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Video_spec, &state->VideoType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Audio_spec, &state->AudioType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Subtitle_spec, &state->SubtitleType) < 0) { return -1; }
+	if (_BluRead_addType(m, &TitleSnapshot_spec, &state->TitleSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &ChapterSnapshot_spec, &state->ChapterSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &ClipSnapshot_spec, &state->ClipSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &VideoSnapshot_spec, &state->VideoSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &AudioSnapshot_spec, &state->AudioSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &SubtitleSnapshot_spec, &state->SubtitleSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &DiscSnapshot_spec, &state->DiscSnapshotType) < 0) { return -1; }
+	if (_BluRead_addType(m, &Catalog_spec, &state->CatalogType) < 0) { return -1; }
+
 	// Not sure of a better way to do this, but form a string containing the version
 	char v[32];
 	sprintf(v, "%d.%d", MAJOR_VERSION, MINOR_VERSION);
 
-	// Add the types to the module
-	Py_INCREF(&BlurayType);
-	PyModule_AddObject(m, "Bluray", (PyObject*)&BlurayType);
-	PyModule_AddObject(m, "Title", (PyObject*)&TitleType);
-	PyModule_AddObject(m, "Chapter", (PyObject*)&ChapterType);
-	PyModule_AddObject(m, "Clip", (PyObject*)&ClipType);
-	PyModule_AddObject(m, "Video", (PyObject*)&VideoType);
-	PyModule_AddObject(m, "Audio", (PyObject*)&AudioType);
-	PyModule_AddObject(m, "Subtitle", (PyObject*)&SubtitleType);
-	PyModule_AddStringConstant(m, "Version", v);
+	if (PyModule_AddStringConstant(m, "Version", v) < 0) { return -1; }
+	if (PyModule_AddStringConstant(m, "PacketKernel", tsscan_kernel_name()) < 0) { return -1; }
+	if (PyModule_AddStringConstant(m, "ZeroKernel", zeroscan_kernel_name()) < 0) { return -1; }
 
-	return m;
+	return 0;
 }
 
+static PyModuleDef_Slot BluReadModuleSlots[] = {
+	{Py_mod_exec, _BluRead_exec},
+#if PY_VERSION_HEX >= 0x030C0000
+	// Process wide state (counters, the debug log ring) is atomic or locked, never a Python object,
+	// and sources over Python objects enter the interpreter they were opened in, not the main one
+	{Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
+#endif
+#if PY_VERSION_HEX >= 0x030D0000
+	// Each Bluray has its own lock, free-threaded builds can scan discs in parallel
+	{Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+	{0, NULL}
+};
+
+static struct PyModuleDef BluReadModule = {
+	PyModuleDef_HEAD_INIT,
+	"_bluread",
+	"Python wrapper for libbluray", // Doc
+	sizeof(BluReadState), // per module state, see BluReadState
+	BluReadModuleMethods,
+	BluReadModuleSlots,
+	_BluRead_traverse,
+	_BluRead_clear,
+	_BluRead_free
+};
+
+PyMODINIT_FUNC
+PyInit__bluread(void)
+{
+	pthread_once(&bluread_once, _BluRead_init);
+
+	// Multi-phase initialization, _BluRead_exec() fills in each module made from the definition
+	return PyModuleDef_Init(&BluReadModule);
+}
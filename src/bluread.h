@@ -6,8 +6,588 @@
 
 
 #include <bluray.h>
+#include <log_control.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <string.h>
+#include <unistd.h>
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Locking
+//
+// Locks @m from a thread holding the GIL (attached, on the free-threaded build).  When the
+// lock is taken the thread detaches while it waits, so the holder can get the GIL back and
+// a stop-the-world pause is not held up.
+
+static inline void
+bluread_lock(pthread_mutex_t *m)
+{
+	if (pthread_mutex_trylock(m) != 0)
+	{
+		Py_BEGIN_ALLOW_THREADS
+		pthread_mutex_lock(m);
+		Py_END_ALLOW_THREADS
+	}
+}
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Latency counters (stats.c)
+
+enum {
+	STAT_BD_INIT,
+	STAT_BD_OPEN_DISC,
+	STAT_BD_OPEN_FILES,
+	STAT_BD_GET_DISC_INFO,
+	STAT_BD_GET_TITLES,
+	STAT_BD_GET_MAIN_TITLE,
+	STAT_BD_GET_TITLE_INFO,
+	STAT_BD_FREE_TITLE_INFO,
+	STAT_BD_SELECT_TITLE,
+	STAT_BD_GET_TITLE_SIZE,
+	STAT_BD_SEEK,
+	STAT_BD_SEEK_TIME,
+	STAT_BD_READ,
+	STAT_BD_CLOSE,
+	STAT_NEW_BLURAY,
+	STAT_NEW_TITLE,
+	STAT_NEW_CHAPTER,
+	STAT_NEW_CLIP,
+	STAT_NEW_VIDEO,
+	STAT_NEW_AUDIO,
+	STAT_NEW_SUBTITLE,
+	STAT_COUNT
+};
+
+#define STATS_BUCKETS 32
+
+typedef struct {
+	uint64_t count;
+	uint64_t total; // ns
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[STATS_BUCKETS];
+} StatCounter;
+
+typedef struct {
+	StatCounter c[STAT_COUNT];
+} StatSet;
+
+extern int stats_enabled;
+
+// Time a call with: uint64_t t = STATS_START(); call(); STATS_END(set, STAT_..., t);
+#define STATS_START() (__atomic_load_n(&stats_enabled, __ATOMIC_RELAXED) ? stats_now() : 0)
+#define STATS_END(set, id, start) do { if (start) stats_record((set), (id), (start)); } while (0)
+
+uint64_t stats_now(void);
+void stats_record(StatSet *set, int id, uint64_t start); // also counts into the module wide set
+void stats_reset(StatSet *set);                          // NULL for the module wide set
+PyObject* stats_topython(const StatSet *set);            // NULL for the module wide set
+
+PyObject* BluRead_Stats(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject* BluRead_EnableStats(PyObject *self, PyObject *args, PyObject *kwds);
+
+// Process metrics, always counted, for long running scanners to export
+enum {
+	METRIC_OPENS,
+	METRIC_OPEN_FAILURES,
+	METRIC_TITLES,
+	METRIC_BYTES_READ,
+	METRIC_BYTES_IMAGED,
+	METRIC_READ_ERRORS,
+	METRIC_RETRIES,
+	METRIC_CACHE_HITS,
+	METRIC_CACHE_MISSES,
+	METRIC_CACHE_EVICTIONS,
+	METRIC_COUNT
+};
+
+void metrics_add(int id, uint64_t n);
+void metrics_open(uint64_t start, int ok); // start from stats_now()
+
+PyObject* BluRead_Metrics(PyObject *self, PyObject *unused);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// libbluray debug log ring (debuglog.c)
+
+#define DEBUGLOG_SLOTS 1024 // power of two
+#define DEBUGLOG_LINE 256   // longer lines are cut
+#define DEBUGLOG_RATE 100   // lines a second let through by default
+
+typedef struct {
+	uint64_t seq;
+	uint64_t repeats; // of the line before this one
+	char line[DEBUGLOG_LINE];
+} DebugLogSlot;
+
+PyObject* BluRead_SetDebugHandler(PyObject *self, PyObject *args, PyObject *kwds);
+PyObject* BluRead_DrainDebugLog(PyObject *self, PyObject *args, PyObject *kwds);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// BDAV packet scanning (tsscan.c)
+
+#define BDAV_PACKET_SIZE 192
+#define TS_SYNC_BYTE 0x47
+#define TS_PID_COUNT 8192
+
+typedef struct {
+	uint64_t packets;
+	uint64_t bytes;
+	uint64_t bad_sync;
+	int64_t first_bad; // byte offset of the first packet with a bad sync byte, -1 if none
+
+	uint64_t pids[TS_PID_COUNT]; // packets seen per PID
+} TSScanResult;
+
+// Scans a stream that arrives in pieces of any size, packets split between pieces are joined up
+typedef struct {
+	TSScanResult result;
+	uint8_t carry[BDAV_PACKET_SIZE];
+	size_t carried; // bytes of an incomplete packet held in @carry
+} TSScanStream;
+
+void tsscan_init(void);
+const char* tsscan_kernel_name(void);
+void tsscan_reset(TSScanResult *r);
+int tsscan_run(TSScanResult *r, const uint8_t *buf, size_t len, const char *kernel);
+void tsscan_feed(TSScanStream *s, const uint8_t *buf, size_t len);
+PyObject* tsscan_topython(const TSScanResult *r, Py_ssize_t remainder);
+
+PyObject* BluRead_ScanPackets(PyObject *self, PyObject *args, PyObject *kwds);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Zero block detection (zeroscan.c)
+
+void zeroscan_init(void);
+const char* zeroscan_kernel_name(void);
+int zeroscan_iszero(const uint8_t *buf, size_t len);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Copy pipeline with inline hashing (image.c)
+
+#define HASH_SHA256 0x01
+#define HASH_XXH3   0x02
+#define HASH_CRC32  0x04
+
+#define COPY_CHUNK_SIZE (4*1024*1024)
+#define COPY_SYNC_BYTES (256*1024*1024) // a resumable copy syncs and records its progress this often
+
+// Reads up to @len bytes at @offset of the source, returns bytes read, 0 at the end or -1 with errno set
+typedef int64_t (*copy_read_func)(void *handle, uint8_t *buf, size_t len, uint64_t offset);
+
+typedef struct {
+	uint64_t offset;
+	uint32_t len;
+	uint32_t crc32;
+	uint64_t xxh3;
+} CopyChunk;
+
+typedef struct {
+	// Set by the caller
+	copy_read_func read;
+	void *handle;
+	int outfd;
+	int prefixfd; // when hashing, [0,start) is read back from this fd instead of the source, -1 for none
+	uint64_t start;
+	uint64_t end; // UINT64_MAX to copy until the source ends
+	size_t chunk;
+	int hashes;
+	int engine;     // IOENGINE_*, IOENGINE_NONE reads through @read one chunk at a time
+	unsigned depth; // chunks in flight with an engine
+	int infd;       // source the engine reads directly
+	size_t sparse;  // zero blocks of this size are left as holes (seekable destinations only), 0 writes everything
+	struct ZImageWriter *zw; // compress into this instead of writing @outfd, the caller opens and finishes it
+	int resumable;  // the copy can be resumed, a failed copy must not leave the destination past what it got through
+	int progressfd; // with resumable, where the offset everything below is synced to is recorded
+	uint64_t synced; // offset last recorded there, the caller sets it to where it resumes from
+	TSScanStream *scan; // packets read through @read are counted into this as they pass, NULL for none
+
+	// Results
+	int seekable;
+	int spliced; // copy_stream() vmsplice()'d into a pipe
+	int err;
+	uint64_t bytes; // bytes copied from the source
+	uint64_t size;  // offset the copy ended at
+	double seconds;
+	const char *enginename;
+	uint64_t holefrom;   // destination size before the copy, zero blocks below it are punched out
+	uint64_t blocks;     // blocks checked for zeros
+	uint64_t zeroblocks; // blocks left as holes
+	uint64_t allocated;  // bytes the destination occupies afterwards
+
+	unsigned char sha256[32];
+	uint64_t xxh3;
+	uint32_t crc32;
+
+	CopyChunk *chunks;
+	size_t numchunks;
+	size_t maxchunks;
+} CopyJob;
+
+double copy_now(void);
+int64_t copy_read_fd(void *handle, uint8_t *buf, size_t len, uint64_t offset);
+int copy_run(CopyJob *job);
+int copy_stream(CopyJob *job);
+void copy_free(CopyJob *job);
+int copy_parsehashes(PyObject *names, int *mask);
+PyObject* copy_topython(const CopyJob *job);
+
+PyObject* BluRead_Image(PyObject *self, PyObject *args, PyObject *kwds);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Image verification (verify.c)
+
+typedef struct {
+	uint64_t lba;
+	uint64_t count;
+} SectorRange;
+
+typedef struct {
+	// Set by the caller
+	copy_read_func read;
+	void *handle;
+	const char *image;
+	uint64_t size; // bytes to compare, 0 for the image size
+	size_t chunk;
+	int threads;
+	int samples;   // compare this many chunks spread over the disc, 0 for all of it
+
+	// Results
+	int err;
+	int sampled;
+	uint64_t bytes;
+	double seconds;
+	SectorRange *mismatch;   // sectors that differ from the image, sorted and merged
+	size_t nummismatch;
+	SectorRange *unreadable; // sectors the source failed to read
+	size_t numunreadable;
+} VerifyJob;
+
+int verify_run(VerifyJob *job);
+void verify_free(VerifyJob *job);
+
+PyObject* BluRead_Verify(PyObject *self, PyObject *args, PyObject *kwds);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Seekable zstd images (zimage.c)
+
+#define ZIMAGE_FRAME_SIZE (1024*1024)
+#define ZIMAGE_MAXTHREADS 32
+
+typedef struct ZImageWriter ZImageWriter;
+
+// Frames are compressed by @threads threads and written to @fd in order, @fd need not be seekable
+ZImageWriter* zimage_open(int fd, int level, int threads, size_t framesize);
+int zimage_write(ZImageWriter *w, const uint8_t *buf, size_t len);
+// Compresses what is left and writes the seek table
+int zimage_finish(ZImageWriter *w);
+void zimage_stats(const ZImageWriter *w, uint64_t *frames, uint64_t *insize, uint64_t *outsize);
+void zimage_free(ZImageWriter *w);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Asynchronous I/O engines (ioengine.c)
+
+#define IOENGINE_NONE    0
+#define IOENGINE_AUTO    1 // io_uring, or threads where it is unavailable
+#define IOENGINE_URING   2
+#define IOENGINE_THREADS 3
+
+#define IOENGINE_DEPTH     4
+#define IOENGINE_MAXDEPTH  256
+
+typedef struct IOEngine IOEngine;
+
+typedef struct {
+	uint64_t tag;
+	int64_t res; // bytes transferred or -errno
+} IOCompletion;
+
+// @bufs are the @depth buffers of @buflen bytes every operation uses, registered with io_uring when possible
+IOEngine* ioengine_open(int kind, unsigned depth, uint8_t **bufs, size_t buflen);
+const char* ioengine_name(const IOEngine *e);
+// @buf is the index of the buffer @data lies in, at most @depth operations can be in flight
+int ioengine_read(IOEngine *e, int fd, int buf, uint8_t *data, size_t len, uint64_t offset, uint64_t tag);
+int ioengine_write(IOEngine *e, int fd, int buf, const uint8_t *data, size_t len, uint64_t offset, uint64_t tag);
+// Waits for at least one completion when anything is in flight, returns how many were stored in @out
+int ioengine_wait(IOEngine *e, IOCompletion *out, int max);
+void ioengine_close(IOEngine *e);
+int ioengine_parse(PyObject *name, int *kind);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Block sources (source.c, cache.c), disc file trees (discfs.c) and libbluray handlers over them (bdfs.c)
+
+#define DISC_SECTOR_SIZE 2048
+
+// Block cache in front of Python file-like objects
+#define PYFILE_CACHE_SIZE (16*1024*1024)
+
+typedef struct BlockSource BlockSource;
+struct BlockSource {
+	// Reads @num sectors from @lba, returns the number of sectors read or -1 with errno set
+	int (*read)(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num);
+	void (*close)(BlockSource *src);
+
+	uint64_t blocks; // size of the source in sectors
+	int fd;
+	void *handle;
+
+	const uint8_t *map; // whole source mapped in memory, or NULL
+	size_t maplen;
+
+	PyInterpreterState *interp; // interpreter a source over a Python object was opened in
+};
+
+BlockSource* source_open_fd(const char *path);
+BlockSource* source_open_mmap(const char *path);
+BlockSource* source_open_buffer(PyObject *obj);
+BlockSource* source_open_pyfile(PyObject *obj, size_t cachebytes);
+BlockSource* source_cache(BlockSource *inner, size_t bytes); // takes ownership of @inner
+BlockSource* source_open_zstd(const char *path);
+int zimage_probe(const char *path); // 1 if @path is a seekable zstd image
+
+typedef struct {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t bypassed; // large reads passed straight to the source
+	size_t blocks;
+	size_t blocksize;
+} CacheStats;
+
+int source_cachestats(BlockSource *src, CacheStats *stats, int reset);
+int source_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num);
+void source_willneed(BlockSource *src, uint64_t lba, uint64_t num);
+void source_close(BlockSource *src);
+
+typedef struct {
+	uint64_t offset; // offset of the extent within the file
+	uint64_t lba;    // absolute sector the extent starts at
+	uint64_t len;    // bytes
+	int sparse;      // not recorded on disc, reads as zeros
+} DiscExtent;
+
+typedef struct {
+	char *path; // relative to the disc root without a leading slash, e.g. BDMV/index.bdmv
+	int isdir;
+	uint64_t size;
+
+	DiscExtent *extents;
+	int numextents;
+	uint8_t *data; // file data embedded in its UDF file entry
+} DiscFile;
+
+typedef struct {
+	BlockSource *src; // NULL when the tree is a directory
+	char *root;       // directory the tree was walked from
+
+	DiscFile *files;  // sorted by path, case insensitive
+	size_t numfiles;
+} DiscFS;
+
+DiscFS* discfs_open(const char *path);
+DiscFS* discfs_open_source(BlockSource *src);
+void discfs_close(DiscFS *fs);
+const DiscFile* discfs_find(DiscFS *fs, const char *path);
+const DiscFile* discfs_next_child(DiscFS *fs, const char *dir, size_t *pos);
+int64_t discfs_read(DiscFS *fs, const DiscFile *f, uint64_t offset, uint8_t *buf, size_t len);
+uint64_t discfs_lba(const DiscFile *f, uint64_t offset);
+int discfs_preload(DiscFS *fs, const char **dirs, uint64_t *bytes); // @dirs is NULL terminated
+
+// Opens @bd over the files of @fs, which must stay open until bd_close()
+int bdfs_open(BLURAY *bd, DiscFS *fs);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// File level backup in physical order (backup.c)
+
+typedef struct {
+	const DiscFile *file;
+	int fd;          // output file
+	uint64_t offset; // same offset in the disc file and the output file
+	uint64_t len;
+	uint64_t lba;    // where the range starts on disc, UINT64_MAX when it has no position
+	uint64_t written;
+} BackupRange;
+
+typedef struct {
+	// Set by the caller
+	DiscFS *fs;
+	int threads; // writer threads
+	size_t chunk;
+	int journalfd; // completed ranges are appended here, -1 for none
+
+	BackupRange *ranges;
+	size_t numranges;
+	size_t maxranges;
+
+	// Results
+	int err;
+	uint64_t bytes;
+	double seconds;
+} BackupJob;
+
+int backup_addrange(BackupJob *job, const DiscFile *f, int fd, uint64_t offset, uint64_t len);
+int backup_run(BackupJob *job);
+int backup_journal(BackupJob *job, const char *path, uint64_t *skipped);
+void backup_free(BackupJob *job);
+int backup_openout(const char *root, const char *path, uint64_t size);
+
+PyObject* BluRead_Backup(PyObject *self, PyObject *args, PyObject *kwds);
+
+// Copy only the M2TS byte ranges @titles play (extents.c)
+PyObject* extents_copy(BLURAY *bd, DiscFS *fs, const uint32_t *titles, size_t numtitles, const char *dst, int metadata, int threads, size_t chunk);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Detached metadata records (snapshot.c)
+
+#define SNAPSHOT_MAGIC "BRT1"
+#define SNAPSHOT_HEADER_SIZE 40
+#define SNAPSHOT_SAMPLED 0x01 // flags, the title was SampleBitrates()'d
+
+enum {
+	SNAPSHOT_VIDEO,
+	SNAPSHOT_AUDIO,
+	SNAPSHOT_SUBTITLE
+};
+
+// A record parsed in place, the columns point into it
+typedef struct {
+	const uint8_t *rec;
+	uint32_t size; // bytes, a multiple of 8
+
+	uint32_t num;
+	uint32_t playlist;
+	uint64_t duration;
+	uint32_t numchapters;
+	uint32_t numclips;
+	uint32_t numstreams;
+	uint8_t angles;
+	uint8_t flags;
+
+	const uint8_t *chapterstart, *chapterlength, *chapterclip;
+	const uint8_t *clipfirst, *clipcounts, *clipid;
+	const uint8_t *streambitrate, *streampid, *streamcoding, *streamformat, *streamrate, *streamaspect, *streamlang;
+} SnapshotTitle;
+
+typedef struct {
+	uint64_t start;
+	uint64_t length;
+	uint32_t clip;
+} SnapshotChapter;
+
+typedef struct {
+	char clipid[6];
+	uint8_t videos, secvideos, audios, secaudios, subtitles;
+	uint32_t first; // index of its first video stream, then the audio and subtitle streams follow
+} SnapshotClip;
+
+typedef struct {
+	uint8_t coding_type;
+	uint8_t format;
+	uint8_t rate;
+	uint8_t aspect;
+	char lang[5];
+	uint16_t pid;
+	uint32_t bitrate; // bits/s, only when the title was sampled
+} SnapshotStream;
+
+// Bytes the record of @info takes
+size_t snapshot_size(const BLURAY_TITLE_INFO *info);
+// Bytes libbluray holds for @info, the title info with all its chapters, marks, clips and streams
+size_t snapshot_info_size(const BLURAY_TITLE_INFO *info);
+// Packs @info into @out (snapshot_size() bytes), with the bitrates of a sampled title in @bitrates (PID -> bits/s) or NULL
+int snapshot_pack(uint8_t *out, uint32_t num, const BLURAY_TITLE_INFO *info, PyObject *bitrates);
+// Checks the record at the start of @buf and points @t into it, 0 or -1 with an exception set
+int snapshot_parse(SnapshotTitle *t, const uint8_t *buf, size_t len);
+void snapshot_chapter(const SnapshotTitle *t, uint32_t i, SnapshotChapter *c);
+void snapshot_clip(const SnapshotTitle *t, uint32_t i, SnapshotClip *c);
+void snapshot_stream(const SnapshotTitle *t, uint32_t i, SnapshotStream *s);
+
+// A condition on the streams of one kind in a title for FindTitles()
+typedef struct {
+	uint8_t kind;        // SNAPSHOT_VIDEO, SNAPSHOT_AUDIO or SNAPSHOT_SUBTITLE
+	uint8_t present;     // 1 when a stream of the kind must match, 0 when none may
+	uint8_t codings[32]; // bit per coding type allowed
+	uint8_t formats[32]; // bit per format allowed
+	char (*langs)[3];    // languages allowed, any when there are none
+	uint32_t numlangs;
+} SnapshotStreamQuery;
+
+typedef struct {
+	uint64_t minlength, maxlength;
+	uint32_t minchapters, maxchapters;
+	SnapshotStreamQuery *streams; // all of them must hold
+	uint32_t numstreams;
+} SnapshotQuery;
+
+// Whether @t satisfies @q
+int snapshot_match(const SnapshotTitle *t, const SnapshotQuery *q);
+
+// Disc records hold the title records of a disc, catalogs the disc records of many discs
+#define SNAPSHOT_DISC_MAGIC "BRD1"
+#define SNAPSHOT_CATALOG_MAGIC "BRC1"
+
+typedef struct {
+	const uint8_t *rec;
+	uint32_t size;
+
+	uint32_t numtitles;
+	int32_t main; // -1 for none
+	char volumeid[33];
+	char discid[37];
+	char orgid[13];
+	const char *path; // not NUL terminated
+	uint32_t pathlen;
+} SnapshotDisc;
+
+typedef struct {
+	const uint8_t *rec;
+	uint64_t size;
+	uint32_t numdiscs;
+} SnapshotCatalog;
+
+// Bytes the record of @d with the titles @infos (@d->numtitles of them) takes
+size_t snapshot_disc_size(const SnapshotDisc *d, BLURAY_TITLE_INFO **infos);
+int snapshot_pack_disc(uint8_t *out, const SnapshotDisc *d, BLURAY_TITLE_INFO **infos);
+int snapshot_parse_disc(SnapshotDisc *d, const uint8_t *buf, size_t len);
+// Offset of title @i from the start of the disc record
+int snapshot_disc_title(const SnapshotDisc *d, uint32_t i, uint32_t *off);
+int snapshot_parse_catalog(SnapshotCatalog *c, const uint8_t *buf, size_t len);
+// Offset of disc @i from the start of the catalog
+int snapshot_catalog_disc(const SnapshotCatalog *c, uint32_t i, uint64_t *off);
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Disc fingerprint (fingerprint.c)
+
+PyObject* BluRead_Fingerprint(PyObject *self, PyObject *args, PyObject *kwds);
 
 
 #endif // Py_BLUREADMODULE_H
@@ -0,0 +1,282 @@
+#include "bluread.h"
+
+#include <pthread.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Block cache
+//
+// A BlockSource that keeps recently read blocks of another source in memory, least
+// recently used blocks are dropped first.  Blocks are CACHE_BLOCK_SECTORS sectors so
+// that the small scattered reads of UDF and BDMV parsing turn into fewer, larger reads
+// of the slow source underneath.  Large reads (stream data) go around the cache so they
+// do not flush it.
+
+#define CACHE_BLOCK_SECTORS 32
+#define CACHE_BYPASS_SECTORS (4*CACHE_BLOCK_SECTORS)
+
+typedef struct CacheEntry CacheEntry;
+struct CacheEntry {
+	uint64_t block;
+	uint32_t valid; // sectors of the block the source had
+	int used;
+
+	CacheEntry *prev, *next; // LRU list, most recent first
+	CacheEntry *hnext;       // hash chain
+	uint8_t *data;
+};
+
+typedef struct {
+	BlockSource *inner;
+
+	pthread_mutex_t lock;
+
+	CacheEntry *entries;
+	size_t count;
+	uint8_t *mem;
+
+	CacheEntry **hash;
+	size_t hashsize;
+
+	CacheEntry lru; // sentinel
+
+	CacheStats stats;
+} BlockCache;
+
+static inline size_t
+_cache_bucket(BlockCache *c, uint64_t block)
+{
+	return (size_t)((block * 0x9E3779B97F4A7C15ULL) >> 32) % c->hashsize;
+}
+
+static void
+_cache_unlink(CacheEntry *e)
+{
+	e->prev->next = e->next;
+	e->next->prev = e->prev;
+}
+
+static void
+_cache_pushfront(BlockCache *c, CacheEntry *e)
+{
+	e->next = c->lru.next;
+	e->prev = &c->lru;
+	c->lru.next->prev = e;
+	c->lru.next = e;
+}
+
+static void
+_cache_unhash(BlockCache *c, CacheEntry *e)
+{
+	CacheEntry **p = &c->hash[_cache_bucket(c, e->block)];
+	while (*p && *p != e)
+	{
+		p = &(*p)->hnext;
+	}
+	if (*p)
+	{
+		*p = e->hnext;
+	}
+	e->hnext = NULL;
+}
+
+// Find @block, reading it from the source on a miss.  Called with the lock held.
+static CacheEntry*
+_cache_get(BlockCache *c, uint64_t block)
+{
+	CacheEntry *e;
+
+	for (e = c->hash[_cache_bucket(c, block)]; e; e = e->hnext)
+	{
+		if (e->block == block)
+		{
+			c->stats.hits++;
+			metrics_add(METRIC_CACHE_HITS, 1);
+			_cache_unlink(e);
+			_cache_pushfront(c, e);
+			return e;
+		}
+	}
+
+	// Reuse the least recently used entry
+	c->stats.misses++;
+	metrics_add(METRIC_CACHE_MISSES, 1);
+	e = c->lru.prev;
+	if (e->used)
+	{
+		c->stats.evictions++;
+		metrics_add(METRIC_CACHE_EVICTIONS, 1);
+		_cache_unhash(c, e);
+	}
+	e->used = 0;
+
+	int n = source_read(c->inner, e->data, block * CACHE_BLOCK_SECTORS, CACHE_BLOCK_SECTORS);
+	if (n <= 0)
+	{
+		if (n == 0) errno = EIO;
+		return NULL;
+	}
+
+	e->block = block;
+	e->valid = n;
+	e->used = 1;
+
+	size_t b = _cache_bucket(c, block);
+	e->hnext = c->hash[b];
+	c->hash[b] = e;
+
+	_cache_unlink(e);
+	_cache_pushfront(c, e);
+
+	return e;
+}
+
+static int
+_cache_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	BlockCache *c = src->handle;
+	uint32_t done = 0;
+
+	if (num >= CACHE_BYPASS_SECTORS)
+	{
+		pthread_mutex_lock(&c->lock);
+		c->stats.bypassed++;
+		pthread_mutex_unlock(&c->lock);
+
+		return source_read(c->inner, buf, lba, num);
+	}
+
+	pthread_mutex_lock(&c->lock);
+	while (done < num)
+	{
+		uint64_t at = lba + done;
+		CacheEntry *e = _cache_get(c, at / CACHE_BLOCK_SECTORS);
+		if (e == NULL)
+		{
+			pthread_mutex_unlock(&c->lock);
+			return done ? (int)done : -1;
+		}
+
+		uint32_t in = (uint32_t)(at % CACHE_BLOCK_SECTORS);
+		if (in >= e->valid)
+		{
+			// Past the end of the source
+			break;
+		}
+
+		uint32_t n = e->valid - in;
+		if (n > num - done)
+		{
+			n = num - done;
+		}
+
+		memcpy(buf + (size_t)done * DISC_SECTOR_SIZE, e->data + (size_t)in * DISC_SECTOR_SIZE, (size_t)n * DISC_SECTOR_SIZE);
+		done += n;
+
+		if (e->valid < CACHE_BLOCK_SECTORS)
+		{
+			break;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return (int)done;
+}
+
+static void
+_cache_close(BlockSource *src)
+{
+	BlockCache *c = src->handle;
+
+	source_close(c->inner);
+	pthread_mutex_destroy(&c->lock);
+	free(c->hash);
+	free(c->entries);
+	free(c->mem);
+	free(c);
+	free(src);
+}
+
+BlockSource*
+source_cache(BlockSource *inner, size_t bytes)
+{
+	size_t blocksize = (size_t)CACHE_BLOCK_SECTORS * DISC_SECTOR_SIZE;
+	size_t count = bytes / blocksize;
+	size_t i;
+
+	if (count < 1)
+	{
+		count = 1;
+	}
+
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	BlockCache *c = calloc(1, sizeof(BlockCache));
+	if (src == NULL || c == NULL)
+	{
+		goto error;
+	}
+
+	c->count = count;
+	c->stats.blocks = count;
+	c->stats.blocksize = blocksize;
+	c->hashsize = count * 2 + 1;
+	c->entries = calloc(count, sizeof(CacheEntry));
+	c->hash = calloc(c->hashsize, sizeof(CacheEntry*));
+	c->mem = malloc(count * blocksize);
+	if (c->entries == NULL || c->hash == NULL || c->mem == NULL)
+	{
+		goto error;
+	}
+
+	c->lru.next = c->lru.prev = &c->lru;
+	for (i = 0; i < count; i++)
+	{
+		c->entries[i].data = c->mem + i * blocksize;
+		_cache_pushfront(c, &c->entries[i]);
+	}
+
+	pthread_mutex_init(&c->lock, NULL);
+	c->inner = inner;
+
+	src->handle = c;
+	src->fd = -1;
+	src->blocks = inner->blocks;
+	src->read = _cache_read;
+	src->close = _cache_close;
+
+	return src;
+
+error:
+	if (c)
+	{
+		free(c->hash);
+		free(c->entries);
+		free(c->mem);
+	}
+	free(c);
+	free(src);
+	source_close(inner);
+	errno = ENOMEM;
+	return NULL;
+}
+
+// Copy the counters of the cache at the top of @src, -1 if @src is not a cache
+int
+source_cachestats(BlockSource *src, CacheStats *stats, int reset)
+{
+	if (src == NULL || src->read != _cache_read)
+	{
+		return -1;
+	}
+
+	BlockCache *c = src->handle;
+	pthread_mutex_lock(&c->lock);
+	*stats = c->stats;
+	if (reset)
+	{
+		c->stats.hits = c->stats.misses = c->stats.evictions = c->stats.bypassed = 0;
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return 0;
+}
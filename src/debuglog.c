@@ -0,0 +1,232 @@
+#include "bluread.h"
+
+#include <time.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// libbluray debug log ring
+//
+// libbluray calls its debug handler synchronously, from whichever thread is in the library
+// and without the GIL, and an obfuscated disc can produce thousands of lines per scan.  The
+// handler here only copies the line into a bounded lock-free ring (Vyukov's MPMC queue with
+// a single consumer) and returns; DrainDebugLog() empties it from Python in batches, one
+// drain at a time since subinterpreters and free-threaded builds can call it concurrently.
+//
+// Before a line is queued it is checked against the last one, and repeats of it are only
+// counted, the next different line (or the drain, once the ring is empty) carrying how many
+// there were.  Past Rate lines a second the rest are counted as suppressed, and with the
+// ring full as dropped.
+
+static DebugLogSlot debuglog_ring[DEBUGLOG_SLOTS];
+static uint64_t debuglog_head;   // next slot a producer claims
+static uint64_t debuglog_tail;   // next slot the drain reads, only touched under debuglog_drainlock
+static pthread_mutex_t debuglog_drainlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t debuglog_once = PTHREAD_ONCE_INIT;
+
+static uint64_t debuglog_last;       // hash of the last line let through
+static uint64_t debuglog_repeats;    // repeats of it since
+static uint64_t debuglog_window;     // second the rate is being counted for
+static uint64_t debuglog_inwindow;   // lines let through in it
+static uint32_t debuglog_rate = DEBUGLOG_RATE;
+
+static uint64_t debuglog_dropped;
+static uint64_t debuglog_suppressed;
+
+static uint64_t
+_debuglog_hash(const char *s, size_t len)
+{
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	size_t i;
+	for (i = 0; i < len; i++)
+	{
+		h ^= (uint8_t)s[i];
+		h *= 1099511628211ULL;
+	}
+	return h | 1; // never 0, which debuglog_last starts as
+}
+
+static int
+_debuglog_ratelimit(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+	uint64_t sec = ts.tv_sec;
+	uint64_t window = __atomic_load_n(&debuglog_window, __ATOMIC_RELAXED);
+	if (sec != window && __atomic_compare_exchange_n(&debuglog_window, &window, sec, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+		__atomic_store_n(&debuglog_inwindow, 0, __ATOMIC_RELAXED);
+	}
+
+	return __atomic_fetch_add(&debuglog_inwindow, 1, __ATOMIC_RELAXED) >= __atomic_load_n(&debuglog_rate, __ATOMIC_RELAXED);
+}
+
+static void
+_debuglog_handler(const char *msg)
+{
+	size_t len = strlen(msg);
+	while (len > 0 && (msg[len-1] == '\n' || msg[len-1] == '\r'))
+	{
+		len--;
+	}
+	if (len >= DEBUGLOG_LINE)
+	{
+		len = DEBUGLOG_LINE - 1;
+	}
+
+	uint64_t h = _debuglog_hash(msg, len);
+	if (__atomic_load_n(&debuglog_last, __ATOMIC_RELAXED) == h)
+	{
+		__atomic_fetch_add(&debuglog_repeats, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (_debuglog_ratelimit())
+	{
+		__atomic_fetch_add(&debuglog_suppressed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	uint64_t pos = __atomic_load_n(&debuglog_head, __ATOMIC_RELAXED);
+	DebugLogSlot *slot;
+	for (;;)
+	{
+		slot = &debuglog_ring[pos & (DEBUGLOG_SLOTS - 1)];
+		int64_t dif = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+		if (dif == 0)
+		{
+			if (__atomic_compare_exchange_n(&debuglog_head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				break;
+			}
+		}
+		else if (dif < 0)
+		{
+			// Full, the drain has fallen behind
+			__atomic_fetch_add(&debuglog_dropped, 1, __ATOMIC_RELAXED);
+			return;
+		}
+		else
+		{
+			pos = __atomic_load_n(&debuglog_head, __ATOMIC_RELAXED);
+		}
+	}
+
+	// Only a line that made it into the ring is the one later repeats are counted against,
+	// one suppressed or dropped would have them counted for a line nobody sees
+	__atomic_store_n(&debuglog_last, h, __ATOMIC_RELAXED);
+	slot->repeats = __atomic_exchange_n(&debuglog_repeats, 0, __ATOMIC_RELAXED);
+	memcpy(slot->line, msg, len);
+	slot->line[len] = '\0';
+	__atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void
+_debuglog_init(void)
+{
+	uint64_t i;
+
+	for (i = 0; i < DEBUGLOG_SLOTS; i++)
+	{
+		__atomic_store_n(&debuglog_ring[i].seq, i, __ATOMIC_RELAXED);
+	}
+}
+
+PyObject*
+BluRead_SetDebugHandler(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	int enable = 1;
+	PyObject *maskobj = Py_None;
+	unsigned int rate = DEBUGLOG_RATE;
+	static char *kwlist[] = {"Enable", "Mask", "Rate", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|pOI", kwlist, &enable, &maskobj, &rate))
+	{
+		return NULL;
+	}
+
+	if (maskobj != Py_None)
+	{
+		unsigned long mask = PyLong_AsUnsignedLong(maskobj);
+		if (mask == (unsigned long)-1 && PyErr_Occurred())
+		{
+			return NULL;
+		}
+		bd_set_debug_mask((uint32_t)mask);
+	}
+
+	pthread_once(&debuglog_once, _debuglog_init);
+	__atomic_store_n(&debuglog_rate, rate, __ATOMIC_RELAXED);
+
+	// NULL puts back libbluray's own writes to stderr
+	bd_set_debug_handler(enable ? _debuglog_handler : NULL);
+
+	return PyLong_FromUnsignedLong(bd_get_debug_mask());
+}
+
+PyObject*
+BluRead_DrainDebugLog(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	Py_ssize_t max = DEBUGLOG_SLOTS;
+	static char *kwlist[] = {"Max", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|n", kwlist, &max))
+	{
+		return NULL;
+	}
+
+	PyObject *lines = PyList_New(0);
+	if (lines == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_once(&debuglog_once, _debuglog_init);
+	bluread_lock(&debuglog_drainlock);
+
+	int empty = 0;
+	for (;;)
+	{
+		DebugLogSlot *slot = &debuglog_ring[debuglog_tail & (DEBUGLOG_SLOTS - 1)];
+		if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != debuglog_tail + 1)
+		{
+			empty = 1;
+			break;
+		}
+		if (max-- <= 0)
+		{
+			break;
+		}
+
+		// Paths from the disc need not be UTF-8
+		PyObject *t = Py_BuildValue("(NK)", PyUnicode_DecodeUTF8(slot->line, strlen(slot->line), "replace"), (unsigned long long)slot->repeats);
+		__atomic_store_n(&slot->seq, debuglog_tail + DEBUGLOG_SLOTS, __ATOMIC_RELEASE);
+		debuglog_tail++;
+
+		if (t == NULL || PyList_Append(lines, t) < 0)
+		{
+			pthread_mutex_unlock(&debuglog_drainlock);
+			Py_XDECREF(t);
+			Py_DECREF(lines);
+			return NULL;
+		}
+		Py_DECREF(t);
+	}
+
+	// Repeats of the last line would otherwise wait for a different one to carry them, with
+	// the ring empty they are its own and the next copy of it is let through again
+	uint64_t repeats = 0;
+	if (empty)
+	{
+		repeats = __atomic_exchange_n(&debuglog_repeats, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&debuglog_last, 0, __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&debuglog_drainlock);
+
+	return Py_BuildValue("{s:N,s:K,s:K,s:K}",
+		"Lines", lines,
+		"Repeats", (unsigned long long)repeats,
+		"Dropped", (unsigned long long)__atomic_exchange_n(&debuglog_dropped, 0, __ATOMIC_RELAXED),
+		"Suppressed", (unsigned long long)__atomic_exchange_n(&debuglog_suppressed, 0, __ATOMIC_RELAXED));
+}
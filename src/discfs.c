@@ -0,0 +1,1388 @@
+#include "bluread.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Disc file trees
+//
+// A DiscFS is the flattened file tree of a disc, either parsed from the UDF file system
+// on a BlockSource (device or image) or walked from a directory holding a BDMV backup.
+// Files on UDF keep their extents, so callers can read them raw (no AACS needed) and
+// order their reads by physical location.
+//
+// Only what BD-ROM uses is supported: UDF 2.50 with physical, sparable and metadata
+// partition maps, short/long/embedded allocation descriptors and 8/16-bit CS0 names.
+// Sparable maps (BD-RE, BD-R with spare areas) read packets their sparing table moved
+// from where it put them.
+
+#define UDF_TAG_AVDP 2
+#define UDF_TAG_PD   5
+#define UDF_TAG_LVD  6
+#define UDF_TAG_TD   8
+#define UDF_TAG_FSD  256
+#define UDF_TAG_FID  257
+#define UDF_TAG_AED  258
+#define UDF_TAG_FE   261
+#define UDF_TAG_EFE  266
+
+#define UDF_MAX_PARTS 4
+#define UDF_MAX_SPARES 65536
+#define UDF_MAX_DEPTH 32
+#define UDF_MAX_DIRSIZE (64*1024*1024)
+#define UDF_MAX_FILES (1024*1024)
+
+// A packet of a sparable partition moved to a spare area
+typedef struct {
+	uint32_t orig;   // partition relative block the packet starts at
+	uint32_t mapped; // absolute sector it is at instead
+} UDFSpare;
+
+typedef struct {
+	int metadata;     // 1 for a metadata partition map
+	uint16_t partnum; // partition descriptor number it lives on
+	uint64_t start;   // absolute sector of the partition
+
+	// Sparable partition: blocks per packet and the remapped packets, sorted by orig
+	uint32_t packet;
+	UDFSpare *spares;
+	int numspares;
+
+	// Metadata partition: extents of the metadata file, absolute sectors
+	DiscExtent *meta;
+	int nummeta;
+} UDFPartMap;
+
+typedef struct {
+	DiscFS *fs;
+
+	struct {
+		uint16_t num;
+		uint32_t start;
+	} parts[UDF_MAX_PARTS];
+	int numparts;
+
+	UDFPartMap maps[UDF_MAX_PARTS];
+	int nummaps;
+	int physmap; // map file data in short_ad's refers to
+
+	size_t maxfiles;
+} UDFVolume;
+
+static inline uint16_t
+_le16(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t
+_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t
+_le64(const uint8_t *p)
+{
+	return _le32(p) | ((uint64_t)_le32(p + 4) << 32);
+}
+
+static int
+_udf_tag(const uint8_t *b)
+{
+	// Descriptor tag checksum covers the 16 byte tag except the checksum byte itself
+	uint8_t sum = 0;
+	int i;
+	for (i = 0; i < 16; i++)
+	{
+		if (i != 4) sum += b[i];
+	}
+	if (sum != b[4])
+	{
+		return -1;
+	}
+
+	return _le16(b);
+}
+
+static int
+_udf_readabs(UDFVolume *v, uint64_t lba, uint8_t *buf)
+{
+	if (source_read(v->fs->src, buf, lba, 1) != 1)
+	{
+		if (errno == 0) errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Translate partition relative block @lb of partition map @partref to an absolute sector.
+// *@run is set to the number of sectors that stay contiguous from there.
+static int
+_udf_lba(UDFVolume *v, int partref, uint32_t lb, uint64_t *lba, uint64_t *run)
+{
+	if (partref < 0 || partref >= v->nummaps)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	UDFPartMap *m = &v->maps[partref];
+	if (! m->metadata && m->numspares > 0)
+	{
+		// Binary search for the first remapped packet that does not end before @lb
+		int lo = 0, hi = m->numspares;
+		while (lo < hi)
+		{
+			int mid = (lo + hi) / 2;
+			if ((uint64_t)m->spares[mid].orig + m->packet <= lb) lo = mid + 1;
+			else hi = mid;
+		}
+
+		if (lo < m->numspares && m->spares[lo].orig <= lb)
+		{
+			*lba = (uint64_t)m->spares[lo].mapped + (lb - m->spares[lo].orig);
+			*run = m->spares[lo].orig + m->packet - lb;
+		}
+		else
+		{
+			*lba = m->start + lb;
+			*run = lo < m->numspares ? m->spares[lo].orig - lb : UINT64_MAX;
+		}
+		return 0;
+	}
+	if (! m->metadata)
+	{
+		*lba = m->start + lb;
+		*run = UINT64_MAX;
+		return 0;
+	}
+
+	uint64_t off = (uint64_t)lb * DISC_SECTOR_SIZE;
+	int i;
+	for (i = 0; i < m->nummeta; i++)
+	{
+		DiscExtent *e = &m->meta[i];
+		if (off >= e->offset && off < e->offset + e->len)
+		{
+			*lba = e->lba + (off - e->offset) / DISC_SECTOR_SIZE;
+			*run = (e->offset + e->len - off) / DISC_SECTOR_SIZE;
+			return 0;
+		}
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int
+_udf_readblock(UDFVolume *v, int partref, uint32_t lb, uint8_t *buf)
+{
+	uint64_t lba, run;
+	if (_udf_lba(v, partref, lb, &lba, &run) < 0)
+	{
+		return -1;
+	}
+
+	return _udf_readabs(v, lba, buf);
+}
+
+static int
+_udf_addextent(DiscFile *f, uint64_t offset, uint64_t lba, uint64_t len, int sparse)
+{
+	if (f->numextents % 16 == 0)
+	{
+		DiscExtent *tmp = realloc(f->extents, (f->numextents + 16) * sizeof(DiscExtent));
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		f->extents = tmp;
+	}
+
+	DiscExtent *e = &f->extents[f->numextents++];
+	e->offset = offset;
+	e->lba = lba;
+	e->len = len;
+	e->sparse = sparse;
+
+	return 0;
+}
+
+// Add an extent of @len bytes starting at block @lb of map @partref, splitting it where the map is not contiguous
+static int
+_udf_mapextent(UDFVolume *v, DiscFile *f, uint64_t *offset, int partref, uint32_t lb, uint64_t len)
+{
+	while (len > 0)
+	{
+		uint64_t lba, run;
+		if (_udf_lba(v, partref, lb, &lba, &run) < 0)
+		{
+			return -1;
+		}
+
+		uint64_t n = len;
+		if (run != UINT64_MAX && run * DISC_SECTOR_SIZE < n)
+		{
+			n = run * DISC_SECTOR_SIZE;
+		}
+
+		if (_udf_addextent(f, *offset, lba, n, 0) < 0)
+		{
+			return -1;
+		}
+
+		*offset += n;
+		len -= n;
+		lb += (uint32_t)(n / DISC_SECTOR_SIZE);
+	}
+
+	return 0;
+}
+
+// Parse allocation descriptors into extents of @f.  Short ADs refer to @partref.
+static int
+_udf_parseads(UDFVolume *v, DiscFile *f, uint64_t *offset, const uint8_t *ads, uint32_t len, int adtype, int partref, int depth)
+{
+	uint32_t adsize = (adtype == 0) ? 8 : 16;
+	uint32_t pos;
+
+	if (depth > UDF_MAX_DEPTH)
+	{
+		errno = ELOOP;
+		return -1;
+	}
+
+	for (pos = 0; pos + adsize <= len; pos += adsize)
+	{
+		uint32_t raw = _le32(ads + pos);
+		uint32_t elen = raw & 0x3FFFFFFF;
+		int etype = raw >> 30;
+		uint32_t lb = _le32(ads + pos + 4);
+		int pref = (adtype == 0) ? partref : _le16(ads + pos + 8);
+
+		if (elen == 0)
+		{
+			break;
+		}
+
+		if (etype == 3)
+		{
+			// Continuation: the rest of the descriptors are in an Allocation Extent Descriptor
+			uint8_t aed[DISC_SECTOR_SIZE];
+			if (_udf_readblock(v, pref, lb, aed) < 0)
+			{
+				return -1;
+			}
+			if (_udf_tag(aed) != UDF_TAG_AED)
+			{
+				errno = EINVAL;
+				return -1;
+			}
+
+			uint32_t alen = _le32(aed + 20);
+			if (alen > DISC_SECTOR_SIZE - 24)
+			{
+				alen = DISC_SECTOR_SIZE - 24;
+			}
+			return _udf_parseads(v, f, offset, aed + 24, alen, adtype, partref, depth + 1);
+		}
+
+		if (etype != 0)
+		{
+			// Allocated or not, nothing was recorded so it reads as zeros
+			if (_udf_addextent(f, *offset, 0, elen, 1) < 0)
+			{
+				return -1;
+			}
+			*offset += elen;
+			continue;
+		}
+
+		if (_udf_mapextent(v, f, offset, pref, lb, elen) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// Read the (extended) file entry at @lb of @partref into @f, returns the ICB file type
+static int
+_udf_readfe(UDFVolume *v, int partref, uint32_t lb, DiscFile *f)
+{
+	uint8_t b[DISC_SECTOR_SIZE];
+	uint32_t lea, lad, adstart;
+
+	if (_udf_readblock(v, partref, lb, b) < 0)
+	{
+		return -1;
+	}
+
+	int tag = _udf_tag(b);
+	if (tag == UDF_TAG_FE)
+	{
+		lea = _le32(b + 168);
+		lad = _le32(b + 172);
+		adstart = 176;
+	}
+	else if (tag == UDF_TAG_EFE)
+	{
+		lea = _le32(b + 208);
+		lad = _le32(b + 212);
+		adstart = 216;
+	}
+	else
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	int filetype = b[16 + 11];
+	int adtype = _le16(b + 16 + 18) & 7;
+
+	if (lea > DISC_SECTOR_SIZE || lad > DISC_SECTOR_SIZE || adstart + lea + lad > DISC_SECTOR_SIZE)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	adstart += lea;
+
+	f->size = _le64(b + 56);
+	f->isdir = (filetype == 4);
+
+	if (adtype == 3)
+	{
+		// Embedded: the file data is the allocation descriptor area itself
+		f->data = malloc(lad ? lad : 1);
+		if (f->data == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		memcpy(f->data, b + adstart, lad);
+		if (f->size > lad)
+		{
+			f->size = lad;
+		}
+		return filetype;
+	}
+	if (adtype != 0 && adtype != 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Directories live with their ICB (the metadata partition on BD), file data in the physical partition
+	uint64_t offset = 0;
+	int adpart = f->isdir ? partref : v->physmap;
+	if (_udf_parseads(v, f, &offset, b + adstart, lad, adtype, adpart, 0) < 0)
+	{
+		return -1;
+	}
+
+	return filetype;
+}
+
+// Decode an OSTA CS0 file identifier to UTF-8
+static void
+_udf_name(const uint8_t *d, int len, char *out, size_t outlen)
+{
+	size_t o = 0;
+	int i;
+
+	if (len < 1)
+	{
+		out[0] = '\0';
+		return;
+	}
+
+	int wide = (d[0] == 16 || d[0] == 255);
+	for (i = 1; i + wide < len; i += 1 + wide)
+	{
+		unsigned c = wide ? ((d[i] << 8) | d[i+1]) : d[i];
+		if (c == '/' || c == 0) c = '_';
+
+		if (c < 0x80 && o + 1 < outlen)
+		{
+			out[o++] = (char)c;
+		}
+		else if (c < 0x800 && o + 2 < outlen)
+		{
+			out[o++] = (char)(0xC0 | (c >> 6));
+			out[o++] = (char)(0x80 | (c & 0x3F));
+		}
+		else if (o + 3 < outlen)
+		{
+			out[o++] = (char)(0xE0 | (c >> 12));
+			out[o++] = (char)(0x80 | ((c >> 6) & 0x3F));
+			out[o++] = (char)(0x80 | (c & 0x3F));
+		}
+	}
+	out[o] = '\0';
+}
+
+static DiscFile*
+_discfs_newfile(DiscFS *fs, size_t maxfiles)
+{
+	if (fs->numfiles >= maxfiles)
+	{
+		errno = EFBIG;
+		return NULL;
+	}
+
+	if (fs->numfiles % 256 == 0)
+	{
+		DiscFile *tmp = realloc(fs->files, (fs->numfiles + 256) * sizeof(DiscFile));
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+		fs->files = tmp;
+	}
+
+	DiscFile *f = &fs->files[fs->numfiles++];
+	memset(f, 0, sizeof(DiscFile));
+	return f;
+}
+
+static char*
+_discfs_join(const char *dir, const char *name)
+{
+	size_t dl = strlen(dir), nl = strlen(name);
+	char *p = malloc(dl + nl + 2);
+	if (p == NULL)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (dl)
+	{
+		memcpy(p, dir, dl);
+		p[dl++] = '/';
+	}
+	memcpy(p + dl, name, nl + 1);
+
+	return p;
+}
+
+static int
+_udf_walkdir(UDFVolume *v, const DiscFile *dir, const char *prefix, int depth)
+{
+	DiscFS *fs = v->fs;
+
+	if (depth > UDF_MAX_DEPTH)
+	{
+		errno = ELOOP;
+		return -1;
+	}
+	if (dir->size > UDF_MAX_DIRSIZE)
+	{
+		errno = EFBIG;
+		return -1;
+	}
+
+	uint8_t *d = malloc(dir->size ? dir->size : 1);
+	if (d == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+	if (discfs_read(fs, dir, 0, d, dir->size) != (int64_t)dir->size)
+	{
+		free(d);
+		if (errno == 0) errno = EIO;
+		return -1;
+	}
+
+	uint64_t pos = 0;
+	while (pos + 38 <= dir->size)
+	{
+		const uint8_t *fid = d + pos;
+		if (_le16(fid) != UDF_TAG_FID)
+		{
+			break;
+		}
+
+		int chars = fid[18];
+		int lfi = fid[19];
+		uint32_t icblb = _le32(fid + 24);
+		int icbpart = _le16(fid + 28);
+		int liu = _le16(fid + 36);
+
+		uint64_t fidlen = (38 + liu + lfi + 3) & ~3;
+		if (pos + 38 + liu + lfi > dir->size)
+		{
+			break;
+		}
+		pos += fidlen;
+
+		// Skip the parent entry and deleted files
+		if (chars & 0x0C)
+		{
+			continue;
+		}
+
+		char name[256*3];
+		_udf_name(fid + 38 + liu, lfi, name, sizeof(name));
+
+		// Names that would step out of or alias a directory are never files, leave them out
+		if (name[0] == '\0' || strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+		{
+			continue;
+		}
+
+		DiscFile tmp;
+		memset(&tmp, 0, sizeof(tmp));
+		if (_udf_readfe(v, icbpart, icblb, &tmp) < 0)
+		{
+			free(tmp.extents);
+			free(tmp.data);
+			free(d);
+			return -1;
+		}
+
+		tmp.path = _discfs_join(prefix, name);
+		DiscFile *f = tmp.path ? _discfs_newfile(fs, v->maxfiles) : NULL;
+		if (f == NULL)
+		{
+			free(tmp.path);
+			free(tmp.extents);
+			free(tmp.data);
+			free(d);
+			return -1;
+		}
+		*f = tmp;
+
+		if (tmp.isdir)
+		{
+			// fs->files may move while recursing, so pass a copy
+			if (_udf_walkdir(v, &tmp, tmp.path, depth + 1) < 0)
+			{
+				free(d);
+				return -1;
+			}
+		}
+	}
+
+	free(d);
+	return 0;
+}
+
+static int
+_udf_sparecmp(const void *a, const void *b)
+{
+	const UDFSpare *x = a, *y = b;
+	return x->orig < y->orig ? -1 : (x->orig > y->orig);
+}
+
+// Read the sparing table of the sparable partition map @m into @pm, from the first of its copies that is intact
+static int
+_udf_sparing(UDFVolume *v, UDFPartMap *pm, const uint8_t *m)
+{
+	pm->packet = _le16(m + 40);
+	int numtables = m[42];
+	uint32_t tablesize = _le32(m + 44);
+	if (pm->packet == 0 || numtables < 1 || numtables > 4 || tablesize < 56)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	uint32_t sectors = (tablesize + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE;
+	uint8_t *table = malloc((size_t)sectors * DISC_SECTOR_SIZE);
+	if (table == NULL)
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+
+	int t;
+	for (t = 0; t < numtables; t++)
+	{
+		uint32_t loc = _le32(m + 48 + 4*t);
+		if (source_read(v->fs->src, table, loc, sectors) != (int)sectors)
+		{
+			continue;
+		}
+		if (_udf_tag(table) != 0 || memcmp(table + 17, "*UDF Sparing Table", 18) != 0)
+		{
+			continue;
+		}
+
+		uint32_t entries = _le16(table + 48);
+		if (56 + (uint64_t)entries * 8 > (uint64_t)sectors * DISC_SECTOR_SIZE || entries > UDF_MAX_SPARES)
+		{
+			continue;
+		}
+
+		pm->spares = malloc((entries ? entries : 1) * sizeof(UDFSpare));
+		if (pm->spares == NULL)
+		{
+			free(table);
+			errno = ENOMEM;
+			return -1;
+		}
+
+		// Entries from 0xFFFFFFF0 up are spare packets not in use (or found defective)
+		uint32_t e;
+		for (e = 0; e < entries; e++)
+		{
+			uint32_t orig = _le32(table + 56 + 8*e);
+			if (orig >= 0xFFFFFFF0 || orig % pm->packet != 0)
+			{
+				continue;
+			}
+			pm->spares[pm->numspares].orig = orig;
+			pm->spares[pm->numspares].mapped = _le32(table + 56 + 8*e + 4);
+			pm->numspares++;
+		}
+		qsort(pm->spares, pm->numspares, sizeof(UDFSpare), _udf_sparecmp);
+
+		free(table);
+		return 0;
+	}
+
+	// No copy of the table could be read, what it moved cannot be found
+	free(table);
+	errno = EINVAL;
+	return -1;
+}
+
+static int
+_udf_open(DiscFS *fs)
+{
+	UDFVolume v;
+	uint8_t b[DISC_SECTOR_SIZE];
+	uint32_t vdsloc = 0, vdslen = 0;
+	uint8_t lvd[DISC_SECTOR_SIZE];
+	int havelvd = 0;
+	int i, ret = -1;
+
+	memset(&v, 0, sizeof(v));
+	v.fs = fs;
+	v.physmap = 0;
+	v.maxfiles = UDF_MAX_FILES;
+
+	// Anchor volume descriptor pointer, at sector 256 or 256 before the end
+	if (_udf_readabs(&v, 256, b) < 0 || _udf_tag(b) != UDF_TAG_AVDP)
+	{
+		if (fs->src->blocks <= 256 || _udf_readabs(&v, fs->src->blocks - 256 - 1, b) < 0 || _udf_tag(b) != UDF_TAG_AVDP)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+	}
+	vdslen = _le32(b + 16);
+	vdsloc = _le32(b + 20);
+
+	// Main volume descriptor sequence
+	for (i = 0; i < 64 && (uint32_t)i*DISC_SECTOR_SIZE < vdslen; i++)
+	{
+		if (_udf_readabs(&v, vdsloc + i, b) < 0)
+		{
+			return -1;
+		}
+
+		int tag = _udf_tag(b);
+		if (tag == UDF_TAG_TD)
+		{
+			break;
+		}
+		else if (tag == UDF_TAG_PD && v.numparts < UDF_MAX_PARTS)
+		{
+			v.parts[v.numparts].num = _le16(b + 22);
+			v.parts[v.numparts].start = _le32(b + 188);
+			v.numparts++;
+		}
+		else if (tag == UDF_TAG_LVD)
+		{
+			memcpy(lvd, b, sizeof(lvd));
+			havelvd = 1;
+		}
+	}
+
+	if (! havelvd || v.numparts == 0 || _le32(lvd + 212) != DISC_SECTOR_SIZE)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Partition maps
+	uint32_t nummaps = _le32(lvd + 268);
+	uint32_t mpos = 440;
+	for (i = 0; (uint32_t)i < nummaps && i < UDF_MAX_PARTS; i++)
+	{
+		if (mpos + 2 > DISC_SECTOR_SIZE)
+		{
+			break;
+		}
+
+		const uint8_t *m = lvd + mpos;
+		int mtype = m[0], mlen = m[1];
+		UDFPartMap *pm = &v.maps[v.nummaps];
+
+		if (mlen < 6 || mpos + mlen > DISC_SECTOR_SIZE)
+		{
+			break;
+		}
+
+		if (mtype == 1)
+		{
+			pm->partnum = _le16(m + 4);
+		}
+		else if (mtype == 2 && mlen >= 64)
+		{
+			pm->partnum = _le16(m + 38);
+			if (memcmp(m + 5, "*UDF Metadata Partition", 23) == 0)
+			{
+				pm->metadata = 1;
+			}
+			else if (memcmp(m + 5, "*UDF Sparable Partition", 23) == 0)
+			{
+				if (_udf_sparing(&v, pm, m) < 0)
+				{
+					goto cleanup;
+				}
+			}
+			else
+			{
+				// Virtual partitions (BD-R without metadata) are not supported
+				errno = ENOTSUP;
+				goto cleanup;
+			}
+		}
+		else
+		{
+			errno = EINVAL;
+			goto cleanup;
+		}
+
+		int p;
+		for (p = 0; p < v.numparts; p++)
+		{
+			if (v.parts[p].num == pm->partnum) break;
+		}
+		if (p == v.numparts)
+		{
+			errno = EINVAL;
+			goto cleanup;
+		}
+		pm->start = v.parts[p].start;
+
+		v.nummaps++;
+		mpos += mlen;
+	}
+
+	// Short ADs of file data refer to the physical partition, which BD-ROM has exactly one of
+	v.physmap = -1;
+	for (i = 0; i < v.nummaps; i++)
+	{
+		if (! v.maps[i].metadata)
+		{
+			v.physmap = i;
+			break;
+		}
+	}
+	if (v.physmap < 0)
+	{
+		if (v.nummaps == 0 || v.nummaps >= UDF_MAX_PARTS)
+		{
+			errno = EINVAL;
+			goto cleanup;
+		}
+
+		// Only a metadata map was recorded, add a map for the partition under it
+		v.physmap = v.nummaps++;
+		v.maps[v.physmap] = v.maps[0];
+		v.maps[v.physmap].metadata = 0;
+	}
+
+	// Locate the metadata file of metadata partitions (falling back to its mirror)
+	for (i = 0; i < v.nummaps; i++)
+	{
+		if (! v.maps[i].metadata) continue;
+
+		const uint8_t *m = lvd + 440;
+		int k;
+		for (k = 0; k < i; k++) m += m[1];
+
+		uint32_t locs[2] = { _le32(m + 40), _le32(m + 44) };
+		int l;
+		for (l = 0; l < 2; l++)
+		{
+			DiscFile meta;
+			memset(&meta, 0, sizeof(meta));
+
+			// The metadata file entry and its short ADs are in the physical partition under it
+			if (_udf_readfe(&v, v.physmap, locs[l], &meta) >= 0 && meta.data == NULL)
+			{
+				v.maps[i].meta = meta.extents;
+				v.maps[i].nummeta = meta.numextents;
+				break;
+			}
+			free(meta.extents);
+			free(meta.data);
+		}
+		if (v.maps[i].meta == NULL)
+		{
+			errno = EINVAL;
+			goto cleanup;
+		}
+	}
+
+	// File set descriptor, then the root directory
+	uint32_t fsdlb = _le32(lvd + 252);
+	int fsdpart = _le16(lvd + 256);
+	if (_udf_readblock(&v, fsdpart, fsdlb, b) < 0 || _udf_tag(b) != UDF_TAG_FSD)
+	{
+		if (errno == 0) errno = EINVAL;
+		goto cleanup;
+	}
+
+	uint32_t rootlb = _le32(b + 404);
+	int rootpart = _le16(b + 408);
+
+	DiscFile root;
+	memset(&root, 0, sizeof(root));
+	if (_udf_readfe(&v, rootpart, rootlb, &root) < 0 || ! root.isdir)
+	{
+		free(root.extents);
+		free(root.data);
+		if (errno == 0) errno = EINVAL;
+		goto cleanup;
+	}
+
+	ret = _udf_walkdir(&v, &root, "", 0);
+	free(root.extents);
+	free(root.data);
+
+cleanup:
+	for (i = 0; i < v.nummaps; i++)
+	{
+		free(v.maps[i].meta);
+		free(v.maps[i].spares);
+	}
+	// A map being parsed when it failed is not counted yet
+	if (v.nummaps < UDF_MAX_PARTS)
+	{
+		free(v.maps[v.nummaps].spares);
+	}
+
+	return ret;
+}
+
+static int
+_dir_walk(DiscFS *fs, const char *prefix, int depth)
+{
+	if (depth > UDF_MAX_DEPTH)
+	{
+		errno = ELOOP;
+		return -1;
+	}
+
+	char *full = _discfs_join(fs->root, prefix);
+	if (full == NULL)
+	{
+		return -1;
+	}
+
+	DIR *d = opendir(full);
+	if (d == NULL)
+	{
+		free(full);
+		return -1;
+	}
+
+	struct dirent *de;
+	while ((de = readdir(d)) != NULL)
+	{
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+
+		char *path = _discfs_join(prefix, de->d_name);
+		char *abs = path ? _discfs_join(full, de->d_name) : NULL;
+		struct stat st;
+		if (abs == NULL || stat(abs, &st) < 0)
+		{
+			free(path);
+			free(abs);
+			closedir(d);
+			free(full);
+			return -1;
+		}
+		free(abs);
+
+		DiscFile *f = _discfs_newfile(fs, UDF_MAX_FILES);
+		if (f == NULL)
+		{
+			free(path);
+			closedir(d);
+			free(full);
+			return -1;
+		}
+		f->path = path;
+		f->isdir = S_ISDIR(st.st_mode);
+		f->size = f->isdir ? 0 : (uint64_t)st.st_size;
+
+		if (f->isdir && _dir_walk(fs, path, depth + 1) < 0)
+		{
+			closedir(d);
+			free(full);
+			return -1;
+		}
+	}
+
+	closedir(d);
+	free(full);
+	return 0;
+}
+
+static int
+_discfs_cmp(const void *a, const void *b)
+{
+	return strcasecmp(((const DiscFile*)a)->path, ((const DiscFile*)b)->path);
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Public interface
+
+DiscFS*
+discfs_open_source(BlockSource *src)
+{
+	DiscFS *fs = calloc(1, sizeof(DiscFS));
+	if (fs == NULL)
+	{
+		source_close(src);
+		errno = ENOMEM;
+		return NULL;
+	}
+	fs->src = src;
+
+	errno = 0;
+	if (_udf_open(fs) < 0)
+	{
+		int err = errno ? errno : EINVAL;
+		discfs_close(fs);
+		errno = err;
+		return NULL;
+	}
+
+	qsort(fs->files, fs->numfiles, sizeof(DiscFile), _discfs_cmp);
+	return fs;
+}
+
+DiscFS*
+discfs_open(const char *path)
+{
+	struct stat st;
+	if (stat(path, &st) < 0)
+	{
+		return NULL;
+	}
+
+	if (! S_ISDIR(st.st_mode))
+	{
+		BlockSource *src = source_open_fd(path);
+		if (src == NULL)
+		{
+			return NULL;
+		}
+		return discfs_open_source(src);
+	}
+
+	DiscFS *fs = calloc(1, sizeof(DiscFS));
+	if (fs == NULL || (fs->root = strdup(path)) == NULL)
+	{
+		free(fs);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (_dir_walk(fs, "", 0) < 0)
+	{
+		int err = errno;
+		discfs_close(fs);
+		errno = err;
+		return NULL;
+	}
+
+	qsort(fs->files, fs->numfiles, sizeof(DiscFile), _discfs_cmp);
+	return fs;
+}
+
+void
+discfs_close(DiscFS *fs)
+{
+	size_t i;
+
+	if (fs == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < fs->numfiles; i++)
+	{
+		free(fs->files[i].path);
+		free(fs->files[i].extents);
+		free(fs->files[i].data);
+	}
+	free(fs->files);
+	free(fs->root);
+	source_close(fs->src);
+	free(fs);
+}
+
+const DiscFile*
+discfs_find(DiscFS *fs, const char *path)
+{
+	size_t lo = 0, hi = fs->numfiles;
+
+	// Callers may pass paths with a leading slash, the tree has none
+	while (*path == '/') path++;
+
+	while (lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		int c = strcasecmp(fs->files[mid].path, path);
+		if (c == 0) return &fs->files[mid];
+		if (c < 0) lo = mid + 1;
+		else hi = mid;
+	}
+
+	return NULL;
+}
+
+const DiscFile*
+discfs_next_child(DiscFS *fs, const char *dir, size_t *pos)
+{
+	while (*dir == '/') dir++;
+
+	size_t dl = strlen(dir);
+	while (dl && dir[dl-1] == '/') dl--;
+
+	for (; *pos < fs->numfiles; (*pos)++)
+	{
+		const char *p = fs->files[*pos].path;
+
+		if (dl)
+		{
+			if (strncasecmp(p, dir, dl) != 0 || p[dl] != '/') continue;
+			p += dl + 1;
+		}
+
+		if (strchr(p, '/') == NULL)
+		{
+			return &fs->files[(*pos)++];
+		}
+	}
+
+	return NULL;
+}
+
+int64_t
+discfs_read(DiscFS *fs, const DiscFile *f, uint64_t offset, uint8_t *buf, size_t len)
+{
+	if (offset >= f->size)
+	{
+		return 0;
+	}
+	if (len > f->size - offset)
+	{
+		len = f->size - offset;
+	}
+
+	if (fs->src == NULL)
+	{
+		char *abs = _discfs_join(fs->root, f->path);
+		if (abs == NULL)
+		{
+			return -1;
+		}
+
+		int fd = open(abs, O_RDONLY);
+		free(abs);
+		if (fd < 0)
+		{
+			return -1;
+		}
+
+		int64_t n = copy_read_fd(&fd, buf, len, offset);
+		close(fd);
+		return n;
+	}
+
+	if (f->data)
+	{
+		memcpy(buf, f->data + offset, len);
+		return len;
+	}
+
+	size_t done = 0;
+	int i;
+	for (i = 0; i < f->numextents && done < len; i++)
+	{
+		const DiscExtent *e = &f->extents[i];
+
+		while (done < len && offset + done >= e->offset && offset + done < e->offset + e->len)
+		{
+			uint64_t in = offset + done - e->offset;
+			size_t n = len - done;
+			if (n > e->len - in)
+			{
+				n = e->len - in;
+			}
+
+			if (e->sparse)
+			{
+				memset(buf + done, 0, n);
+				done += n;
+				continue;
+			}
+
+			uint64_t lba = e->lba + in / DISC_SECTOR_SIZE;
+			size_t skip = in % DISC_SECTOR_SIZE;
+
+			if (fs->src->map)
+			{
+				uint64_t at = lba * DISC_SECTOR_SIZE + skip;
+				if (at >= fs->src->maplen)
+				{
+					errno = EIO;
+					return done ? (int64_t)done : -1;
+				}
+				if (n > fs->src->maplen - at)
+				{
+					n = fs->src->maplen - at;
+				}
+
+				memcpy(buf + done, fs->src->map + at, n);
+				done += n;
+			}
+			else if (skip == 0 && n >= DISC_SECTOR_SIZE)
+			{
+				// Whole sectors go straight into the caller's buffer
+				uint32_t num = (uint32_t)(n / DISC_SECTOR_SIZE > 65536 ? 65536 : n / DISC_SECTOR_SIZE);
+				int got = source_read(fs->src, buf + done, lba, num);
+				if (got <= 0)
+				{
+					if (got == 0) errno = EIO;
+					return done ? (int64_t)done : -1;
+				}
+				done += (size_t)got * DISC_SECTOR_SIZE;
+			}
+			else
+			{
+				uint8_t sector[DISC_SECTOR_SIZE];
+				if (source_read(fs->src, sector, lba, 1) != 1)
+				{
+					if (errno == 0) errno = EIO;
+					return done ? (int64_t)done : -1;
+				}
+
+				size_t take = DISC_SECTOR_SIZE - skip;
+				if (take > n) take = n;
+				memcpy(buf + done, sector + skip, take);
+				done += take;
+			}
+		}
+	}
+
+	return done;
+}
+
+uint64_t
+discfs_lba(const DiscFile *f, uint64_t offset)
+{
+	int i;
+	for (i = 0; i < f->numextents; i++)
+	{
+		const DiscExtent *e = &f->extents[i];
+		if (! e->sparse && offset >= e->offset && offset < e->offset + e->len)
+		{
+			return e->lba + (offset - e->offset) / DISC_SECTOR_SIZE;
+		}
+	}
+
+	return UINT64_MAX;
+}
+
+// --------------------------------------------------------------------------------
+// Preloading
+//
+// BDMV parsing opens hundreds of small MPLS/CLPI files in name order, which on an
+// optical drive means a seek per file.  Preloading reads all of them in one sweep
+// sorted by LBA, merging extents that sit close together into a single read, and
+// keeps them in memory (DiscFile.data) where discfs_read() serves them from.
+
+// Gaps up to this many sectors are read through rather than seeked over
+#define PRELOAD_GAP 64
+#define PRELOAD_MAXRUN (16*1024*1024 / DISC_SECTOR_SIZE)
+
+typedef struct {
+	uint64_t lba;
+	uint64_t sectors;
+	DiscFile *f;
+	uint64_t offset; // within the file
+	uint64_t len;    // bytes
+} PreloadPiece;
+
+static int
+_preload_cmp(const void *a, const void *b)
+{
+	const PreloadPiece *x = a, *y = b;
+	if (x->lba != y->lba) return x->lba < y->lba ? -1 : 1;
+	return 0;
+}
+
+int
+discfs_preload(DiscFS *fs, const char **dirs, uint64_t *bytes)
+{
+	DiscFile **files = NULL;
+	PreloadPiece *pieces = NULL;
+	size_t numfiles = 0, numpieces = 0, maxpieces = 0, i, j, k;
+	uint8_t *run = NULL;
+	int d, e, ret = -1;
+
+	*bytes = 0;
+
+	// Directory trees are already file reads, there is nothing to order
+	if (fs->src == NULL)
+	{
+		return 0;
+	}
+
+	files = malloc(fs->numfiles * sizeof(DiscFile*) + 1);
+	run = malloc((size_t)PRELOAD_MAXRUN * DISC_SECTOR_SIZE);
+	if (files == NULL || run == NULL)
+	{
+		errno = ENOMEM;
+		goto cleanup;
+	}
+
+	for (d = 0; dirs[d]; d++)
+	{
+		size_t pos = 0;
+		const DiscFile *cf;
+		while ((cf = discfs_next_child(fs, dirs[d], &pos)) != NULL)
+		{
+			DiscFile *f = &fs->files[cf - fs->files];
+			if (f->isdir || f->data || f->size > UDF_MAX_DIRSIZE)
+			{
+				continue;
+			}
+
+			f->data = calloc(1, f->size ? f->size : 1);
+			if (f->data == NULL)
+			{
+				errno = ENOMEM;
+				goto cleanup;
+			}
+			files[numfiles++] = f;
+
+			for (e = 0; e < f->numextents; e++)
+			{
+				const DiscExtent *x = &f->extents[e];
+				if (x->sparse || x->offset >= f->size) continue;
+
+				if (numpieces == maxpieces)
+				{
+					maxpieces = maxpieces ? maxpieces * 2 : 256;
+					PreloadPiece *tmp = realloc(pieces, maxpieces * sizeof(PreloadPiece));
+					if (tmp == NULL)
+					{
+						errno = ENOMEM;
+						goto cleanup;
+					}
+					pieces = tmp;
+				}
+
+				PreloadPiece *p = &pieces[numpieces++];
+				p->f = f;
+				p->lba = x->lba;
+				p->offset = x->offset;
+				p->len = x->len;
+				if (p->len > f->size - x->offset)
+				{
+					p->len = f->size - x->offset;
+				}
+				p->sectors = (p->len + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE;
+			}
+		}
+	}
+
+	qsort(pieces, numpieces, sizeof(PreloadPiece), _preload_cmp);
+
+	for (i = 0; i < numpieces; i = j)
+	{
+		// Grow the run while the next piece starts close to where it ends
+		uint64_t start = pieces[i].lba;
+		uint64_t end = start + pieces[i].sectors;
+		for (j = i + 1; j < numpieces && pieces[j].lba <= end + PRELOAD_GAP; j++)
+		{
+			if (pieces[j].lba + pieces[j].sectors > end)
+			{
+				end = pieces[j].lba + pieces[j].sectors;
+			}
+		}
+
+		// Read the run a window at a time and hand each piece its share
+		uint64_t w;
+		for (w = start; w < end; w += PRELOAD_MAXRUN)
+		{
+			uint64_t want = end - w > PRELOAD_MAXRUN ? PRELOAD_MAXRUN : end - w;
+			uint64_t got = 0;
+			while (got < want)
+			{
+				int n = source_read(fs->src, run + got * DISC_SECTOR_SIZE, w + got, (uint32_t)(want - got));
+				if (n <= 0)
+				{
+					if (n == 0) errno = EIO;
+					goto cleanup;
+				}
+				got += n;
+			}
+			*bytes += got * DISC_SECTOR_SIZE;
+
+			for (k = i; k < j; k++)
+			{
+				PreloadPiece *p = &pieces[k];
+				uint64_t from = p->lba > w ? p->lba : w;
+				uint64_t to = p->lba + p->sectors < w + got ? p->lba + p->sectors : w + got;
+				if (from >= to) continue;
+
+				uint64_t at = (from - p->lba) * DISC_SECTOR_SIZE;
+				uint64_t len = (to - from) * DISC_SECTOR_SIZE;
+				if (at + len > p->len) len = p->len - at;
+
+				memcpy(p->f->data + p->offset + at, run + (from - w) * DISC_SECTOR_SIZE, len);
+			}
+		}
+	}
+
+	ret = 0;
+
+cleanup:
+	if (ret < 0)
+	{
+		// Half loaded files must go back to being read from the source
+		int err = errno;
+		for (i = 0; i < numfiles; i++)
+		{
+			free(files[i]->data);
+			files[i]->data = NULL;
+		}
+		errno = err;
+	}
+	free(run);
+	free(pieces);
+	free(files);
+
+	return ret;
+}
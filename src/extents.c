@@ -0,0 +1,363 @@
+#include "bluread.h"
+
+#include <clpi_data.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Title extents
+//
+// The byte ranges of the M2TS files a title plays.  Each clip of the title covers
+// [in_time, out_time) of its clip, which the EP map in the clip info turns into source
+// packet numbers.  Ranges are widened to whole 6144 byte aligned units so they still
+// decrypt, and by one EP entry (a GOP) on either side since audio is muxed a little
+// apart from the video it plays with.
+
+#define ALIGNED_UNIT_SIZE 6144
+
+typedef struct {
+	char clip[6];
+	uint64_t start;
+	uint64_t end; // UINT64_MAX for the end of the file
+} ClipRange;
+
+// Find the packets covering [@in, @out) (90 kHz) through the EP map of the first stream
+static void
+_extents_lookup(const CLPI_CL *cl, uint64_t in, uint64_t out, uint64_t *start, uint64_t *end)
+{
+	*start = 0;
+	*end = UINT64_MAX;
+
+	if (cl->cpi.num_stream_pid == 0)
+	{
+		return;
+	}
+
+	const CLPI_EP_MAP_ENTRY *e = &cl->cpi.entry[0];
+	if (e->num_ep_coarse <= 0 || e->num_ep_fine <= 0)
+	{
+		return;
+	}
+
+	uint64_t prevspn = 0, startspn = 0;
+	int k = 0, j, past = 0;
+	for (j = 0; j < e->num_ep_fine; j++)
+	{
+		while (k + 1 < e->num_ep_coarse && e->coarse[k+1].ref_ep_fine_id <= j)
+		{
+			k++;
+		}
+
+		// Same reconstruction as libbluray's clpi_lookup_spn(), in 90 kHz
+		uint64_t pts = ((uint64_t)(e->coarse[k].pts_ep & ~0x01) << 19) + ((uint64_t)e->fine[j].pts_ep << 9);
+		uint64_t spn = (e->coarse[k].spn_ep & ~0x1FFFF) + e->fine[j].spn_ep;
+
+		if (pts <= in)
+		{
+			startspn = prevspn;
+		}
+		else if (pts > out && ++past == 2)
+		{
+			*end = spn;
+			break;
+		}
+		prevspn = spn;
+	}
+
+	*start = startspn;
+	if (*end != UINT64_MAX && *end <= *start)
+	{
+		// PTS wrapped or several STC sequences, take the whole file
+		*start = 0;
+		*end = UINT64_MAX;
+	}
+}
+
+static int
+_extents_push(ClipRange **ranges, size_t *num, size_t *max, const char *clip, uint64_t start, uint64_t end)
+{
+	if (*num == *max)
+	{
+		size_t n = *max ? *max * 2 : 32;
+		ClipRange *tmp = realloc(*ranges, n * sizeof(ClipRange));
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		*ranges = tmp;
+		*max = n;
+	}
+
+	ClipRange *r = &(*ranges)[(*num)++];
+	memcpy(r->clip, clip, 5);
+	r->clip[5] = '\0';
+	r->start = start;
+	r->end = end;
+
+	return 0;
+}
+
+// Append the ranges of every angle of @title.  Selects the title.
+static int
+_extents_title(BLURAY *bd, uint32_t title, ClipRange **ranges, size_t *num, size_t *max)
+{
+	BLURAY_TITLE_INFO *info = bd_get_title_info(bd, title, 0);
+	if (info == NULL || ! bd_select_title(bd, title))
+	{
+		if (info) bd_free_title_info(info);
+		errno = EINVAL;
+		return -1;
+	}
+	int angles = info->angle_count ? info->angle_count : 1;
+	bd_free_title_info(info);
+
+	int a;
+	for (a = 0; a < angles; a++)
+	{
+		// bd_get_clpi() reads the clips of the selected angle
+		if (angles > 1)
+		{
+			bd_select_angle(bd, a);
+		}
+
+		info = bd_get_title_info(bd, title, a);
+		if (info == NULL)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+
+		uint32_t i;
+		for (i = 0; i < info->clip_count; i++)
+		{
+			const BLURAY_CLIP_INFO *c = &info->clips[i];
+			uint64_t start = 0, end = UINT64_MAX;
+
+			struct clpi_cl *cl = bd_get_clpi(bd, i);
+			if (cl != NULL)
+			{
+				_extents_lookup(cl, c->in_time, c->out_time, &start, &end);
+				bd_free_clpi(cl);
+			}
+
+			start = start * BDAV_PACKET_SIZE / ALIGNED_UNIT_SIZE * ALIGNED_UNIT_SIZE;
+			if (end != UINT64_MAX)
+			{
+				end = (end * BDAV_PACKET_SIZE + ALIGNED_UNIT_SIZE - 1) / ALIGNED_UNIT_SIZE * ALIGNED_UNIT_SIZE;
+			}
+
+			if (_extents_push(ranges, num, max, c->clip_id, start, end) < 0)
+			{
+				bd_free_title_info(info);
+				return -1;
+			}
+		}
+		bd_free_title_info(info);
+	}
+
+	if (angles > 1)
+	{
+		bd_select_angle(bd, 0);
+	}
+
+	return 0;
+}
+
+static int
+_extents_cmp(const void *a, const void *b)
+{
+	const ClipRange *x = a, *y = b;
+	int c = strcmp(x->clip, y->clip);
+	if (c) return c;
+	return x->start < y->start ? -1 : (x->start > y->start);
+}
+
+static int
+_extents_isstream(const char *path)
+{
+	return strncasecmp(path, "BDMV/STREAM/", 12) == 0;
+}
+
+// The M2TS file of @clip, or its 3D SSIF when there is no M2TS
+static const DiscFile*
+_extents_clipfile(DiscFS *fs, const char *clip)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "BDMV/STREAM/%s.m2ts", clip);
+
+	const DiscFile *f = discfs_find(fs, path);
+	if (f == NULL)
+	{
+		snprintf(path, sizeof(path), "BDMV/STREAM/SSIF/%s.ssif", clip);
+		f = discfs_find(fs, path);
+	}
+
+	return f;
+}
+
+PyObject*
+extents_copy(BLURAY *bd, DiscFS *fs, const uint32_t *titles, size_t numtitles, const char *dst, int metadata, int threads, size_t chunk)
+{
+	ClipRange *ranges = NULL;
+	size_t num = 0, max = 0, i;
+	int *fds = NULL;
+	size_t numfds = 0;
+	uint64_t size = 0, skipped = 0;
+	PyObject *result = NULL, *list = NULL;
+
+	BackupJob job;
+	memset(&job, 0, sizeof(job));
+	job.fs = fs;
+	job.journalfd = -1;
+	job.threads = threads;
+	job.chunk = chunk;
+
+	for (i = 0; i < numtitles; i++)
+	{
+		if (_extents_title(bd, titles[i], &ranges, &num, &max) < 0)
+		{
+			PyErr_Format(PyExc_Exception, "Failed to get the clips of title %u", titles[i]);
+			goto cleanup;
+		}
+	}
+
+	// Merge overlapping ranges of the same clip
+	qsort(ranges, num, sizeof(ClipRange), _extents_cmp);
+	size_t out = 0;
+	for (i = 0; i < num; i++)
+	{
+		if (out && strcmp(ranges[out-1].clip, ranges[i].clip) == 0 && ranges[i].start <= ranges[out-1].end)
+		{
+			if (ranges[i].end > ranges[out-1].end)
+			{
+				ranges[out-1].end = ranges[i].end;
+			}
+			continue;
+		}
+		ranges[out++] = ranges[i];
+	}
+	num = out;
+
+	fds = calloc(fs->numfiles + 1, sizeof(int));
+	list = PyList_New(0);
+	if (fds == NULL || list == NULL)
+	{
+		PyErr_NoMemory();
+		goto cleanup;
+	}
+
+	// Output files are full size, ranges not copied stay holes
+	for (i = 0; i < fs->numfiles; i++)
+	{
+		const DiscFile *f = &fs->files[i];
+		if (f->isdir || ! metadata || _extents_isstream(f->path))
+		{
+			continue;
+		}
+
+		int fd = backup_openout(dst, f->path, f->size);
+		if (fd < 0)
+		{
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, f->path);
+			goto cleanup;
+		}
+		fds[numfds++] = fd;
+
+		if (backup_addrange(&job, f, fd, 0, f->size) < 0)
+		{
+			PyErr_NoMemory();
+			goto cleanup;
+		}
+		size += f->size;
+	}
+
+	const DiscFile *prev = NULL;
+	int prevfd = -1;
+	for (i = 0; i < num; i++)
+	{
+		const DiscFile *f = _extents_clipfile(fs, ranges[i].clip);
+		if (f == NULL)
+		{
+			errno = ENOENT;
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, ranges[i].clip);
+			goto cleanup;
+		}
+
+		if (f != prev)
+		{
+			prevfd = backup_openout(dst, f->path, f->size);
+			if (prevfd < 0)
+			{
+				PyErr_SetFromErrnoWithFilename(PyExc_OSError, f->path);
+				goto cleanup;
+			}
+			fds[numfds++] = prevfd;
+			prev = f;
+		}
+
+		uint64_t end = ranges[i].end < f->size ? ranges[i].end : f->size;
+		if (ranges[i].start >= end)
+		{
+			continue;
+		}
+
+		if (backup_addrange(&job, f, prevfd, ranges[i].start, end - ranges[i].start) < 0)
+		{
+			PyErr_NoMemory();
+			goto cleanup;
+		}
+		size += end - ranges[i].start;
+
+		PyObject *t = Py_BuildValue("(sKK)", f->path, (unsigned long long)ranges[i].start, (unsigned long long)(end - ranges[i].start));
+		if (t == NULL || PyList_Append(list, t) < 0)
+		{
+			Py_XDECREF(t);
+			goto cleanup;
+		}
+		Py_DECREF(t);
+	}
+
+	// Resume: skip what an interrupted run already wrote
+	char journal[PATH_MAX];
+	snprintf(journal, sizeof(journal), "%s/.bluread-journal", dst);
+	if (backup_journal(&job, journal, &skipped) < 0)
+	{
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, journal);
+		goto cleanup;
+	}
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = backup_run(&job);
+	Py_END_ALLOW_THREADS
+
+	if (ret < 0)
+	{
+		errno = job.err;
+		PyErr_SetFromErrno(PyExc_OSError);
+		goto cleanup;
+	}
+
+	result = Py_BuildValue("{s:O,s:K,s:K,s:K,s:d}",
+		"Ranges", list,
+		"Bytes", (unsigned long long)job.bytes,
+		"Skipped", (unsigned long long)skipped,
+		"Size", (unsigned long long)size,
+		"Seconds", job.seconds);
+
+cleanup:
+	for (i = 0; i < numfds; i++)
+	{
+		if (close(fds[i]) < 0 && result)
+		{
+			Py_CLEAR(result);
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst);
+		}
+	}
+	free(fds);
+	free(ranges);
+	Py_XDECREF(list);
+	backup_free(&job);
+
+	return result;
+}
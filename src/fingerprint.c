@@ -0,0 +1,312 @@
+#include "bluread.h"
+
+#include <openssl/evp.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Disc fingerprint
+//
+// SHA-256 over the BDMV navigation files (index.bdmv, MovieObject.bdmv, every MPLS and
+// CLPI) plus a fixed set of sectors sampled from the largest M2TS files.  The bytes are
+// read raw from the UDF file system so the result does not depend on AACS, and the
+// reads are issued in physical order so an optical drive only sweeps across the disc
+// once.  Hashing happens afterwards in a fixed (name) order.
+
+#define FP_MAX_FILESIZE (16*1024*1024)
+
+typedef struct {
+	const DiscFile *file;
+	uint64_t offset;
+	size_t len;
+	uint64_t lba;
+	int order;
+	uint8_t *data;
+} FPRead;
+
+typedef struct {
+	FPRead *reads;
+	int num;
+	int max;
+} FPReads;
+
+static int
+_fp_add(FPReads *r, const DiscFile *f, uint64_t offset, size_t len)
+{
+	if (r->num == r->max)
+	{
+		int n = r->max ? r->max * 2 : 64;
+		FPRead *tmp = realloc(r->reads, n * sizeof(FPRead));
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		r->reads = tmp;
+		r->max = n;
+	}
+
+	FPRead *rd = &r->reads[r->num];
+	rd->file = f;
+	rd->offset = offset;
+	rd->len = len;
+	rd->lba = discfs_lba(f, offset);
+	rd->order = r->num;
+	rd->data = NULL;
+	r->num++;
+
+	return 0;
+}
+
+static int
+_fp_hasext(const char *path, const char *ext)
+{
+	size_t pl = strlen(path), el = strlen(ext);
+	return pl > el && strcasecmp(path + pl - el, ext) == 0;
+}
+
+static int
+_fp_cmplba(const void *a, const void *b)
+{
+	const FPRead *x = a, *y = b;
+	if (x->lba != y->lba) return x->lba < y->lba ? -1 : 1;
+	return x->order - y->order;
+}
+
+static int
+_fp_cmporder(const void *a, const void *b)
+{
+	return ((const FPRead*)a)->order - ((const FPRead*)b)->order;
+}
+
+static int
+_fp_cmpsize(const void *a, const void *b)
+{
+	const DiscFile *x = *(const DiscFile* const*)a, *y = *(const DiscFile* const*)b;
+	if (x->size != y->size) return x->size > y->size ? -1 : 1;
+	return strcasecmp(x->path, y->path);
+}
+
+static int
+_fp_addfile(FPReads *r, DiscFS *fs, const DiscFile *f)
+{
+	if (f == NULL || f->isdir)
+	{
+		return 0;
+	}
+	if (f->size > FP_MAX_FILESIZE)
+	{
+		errno = EFBIG;
+		return -1;
+	}
+
+	return _fp_add(r, f, 0, f->size);
+}
+
+static int
+_fp_adddir(FPReads *r, DiscFS *fs, const char *dir, const char *ext)
+{
+	size_t pos = 0;
+	const DiscFile *f;
+
+	while ((f = discfs_next_child(fs, dir, &pos)) != NULL)
+	{
+		if (_fp_hasext(f->path, ext) && _fp_addfile(r, fs, f) < 0)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+_fp_addstreams(FPReads *r, DiscFS *fs, int streams, int samples)
+{
+	const DiscFile **m2ts = NULL;
+	int num = 0, max = 0;
+	size_t pos = 0;
+	const DiscFile *f;
+	int i, s;
+
+	while ((f = discfs_next_child(fs, "BDMV/STREAM", &pos)) != NULL)
+	{
+		if (f->isdir || ! _fp_hasext(f->path, ".m2ts") || f->size == 0) continue;
+
+		if (num == max)
+		{
+			max = max ? max * 2 : 64;
+			const DiscFile **tmp = realloc(m2ts, max * sizeof(DiscFile*));
+			if (tmp == NULL)
+			{
+				free(m2ts);
+				errno = ENOMEM;
+				return -1;
+			}
+			m2ts = tmp;
+		}
+		m2ts[num++] = f;
+	}
+
+	qsort(m2ts, num, sizeof(DiscFile*), _fp_cmpsize);
+
+	for (i = 0; i < num && i < streams; i++)
+	{
+		uint64_t sectors = (m2ts[i]->size + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE;
+
+		for (s = 0; s < samples; s++)
+		{
+			uint64_t offset = (sectors * (2*s + 1) / (2*samples)) * DISC_SECTOR_SIZE;
+			size_t len = DISC_SECTOR_SIZE;
+			if (offset + len > m2ts[i]->size)
+			{
+				len = m2ts[i]->size - offset;
+			}
+
+			if (_fp_add(r, m2ts[i], offset, len) < 0)
+			{
+				free(m2ts);
+				return -1;
+			}
+		}
+	}
+
+	free(m2ts);
+	return 0;
+}
+
+static void
+_fp_hashread(EVP_MD_CTX *ctx, const FPRead *rd)
+{
+	uint8_t hdr[16];
+	int i;
+
+	// Name, size and offset are part of the fingerprint, not just the bytes
+	for (i = 0; i < 8; i++)
+	{
+		hdr[i] = (uint8_t)(rd->file->size >> (8*i));
+		hdr[8 + i] = (uint8_t)(rd->offset >> (8*i));
+	}
+
+	EVP_DigestUpdate(ctx, rd->file->path, strlen(rd->file->path) + 1);
+	EVP_DigestUpdate(ctx, hdr, sizeof(hdr));
+	EVP_DigestUpdate(ctx, rd->data, rd->len);
+}
+
+static int
+_fp_run(const char *path, int streams, int samples, unsigned char *digest)
+{
+	FPReads r;
+	EVP_MD_CTX *ctx = NULL;
+	int i, ret = -1;
+
+	memset(&r, 0, sizeof(r));
+
+	DiscFS *fs = discfs_open(path);
+	if (fs == NULL)
+	{
+		return -1;
+	}
+
+	if (discfs_find(fs, "BDMV/index.bdmv") == NULL)
+	{
+		errno = ENOENT;
+		goto cleanup;
+	}
+
+	if (_fp_addfile(&r, fs, discfs_find(fs, "BDMV/index.bdmv")) < 0) goto cleanup;
+	if (_fp_addfile(&r, fs, discfs_find(fs, "BDMV/MovieObject.bdmv")) < 0) goto cleanup;
+	if (_fp_adddir(&r, fs, "BDMV/PLAYLIST", ".mpls") < 0) goto cleanup;
+	if (_fp_adddir(&r, fs, "BDMV/CLIPINF", ".clpi") < 0) goto cleanup;
+	if (_fp_addstreams(&r, fs, streams, samples) < 0) goto cleanup;
+
+	// Read in physical order
+	qsort(r.reads, r.num, sizeof(FPRead), _fp_cmplba);
+	for (i = 0; i < r.num; i++)
+	{
+		FPRead *rd = &r.reads[i];
+
+		rd->data = malloc(rd->len ? rd->len : 1);
+		if (rd->data == NULL)
+		{
+			errno = ENOMEM;
+			goto cleanup;
+		}
+		if (discfs_read(fs, rd->file, rd->offset, rd->data, rd->len) != (int64_t)rd->len)
+		{
+			if (errno == 0) errno = EIO;
+			goto cleanup;
+		}
+	}
+
+	// Hash in the order the reads were listed
+	qsort(r.reads, r.num, sizeof(FPRead), _fp_cmporder);
+
+	ctx = EVP_MD_CTX_new();
+	if (ctx == NULL || !EVP_DigestInit_ex(ctx, EVP_sha256(), NULL))
+	{
+		errno = ENOMEM;
+		goto cleanup;
+	}
+	for (i = 0; i < r.num; i++)
+	{
+		_fp_hashread(ctx, &r.reads[i]);
+	}
+
+	unsigned int len = 0;
+	EVP_DigestFinal_ex(ctx, digest, &len);
+	ret = 0;
+
+cleanup:
+	if (ctx) EVP_MD_CTX_free(ctx);
+	for (i = 0; i < r.num; i++)
+	{
+		free(r.reads[i].data);
+	}
+	free(r.reads);
+
+	int err = errno;
+	discfs_close(fs);
+	errno = err;
+
+	return ret;
+}
+
+PyObject*
+BluRead_Fingerprint(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	const char *path=NULL;
+	int samples=8, streams=3;
+	static char *kwlist[] = {"Path", "Samples", "Streams", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "s|ii", kwlist, &path, &samples, &streams))
+	{
+		return NULL;
+	}
+
+	if (samples < 0 || streams < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "Samples and Streams must be non-negative");
+		return NULL;
+	}
+
+	unsigned char digest[32];
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	errno = 0;
+	ret = _fp_run(path, streams, samples, digest);
+	Py_END_ALLOW_THREADS
+
+	if (ret < 0)
+	{
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, path);
+	}
+
+	char hex[2*32 + 1];
+	int i;
+	for (i = 0; i < 32; i++)
+	{
+		sprintf(hex + 2*i, "%02x", digest[i]);
+	}
+
+	return PyUnicode_FromString(hex);
+}
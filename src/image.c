@@ -0,0 +1,1582 @@
+#include "bluread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <xxhash.h>
+#include <zlib.h>
+#include <zstd.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Copy pipeline
+//
+// The calling thread reads chunks from the source and writes them to the destination.
+// When hashes are requested, every chunk is also handed to a hashing thread through a
+// small ring of buffers so hashing never stalls the drive.  The ring only blocks the
+// reader when the hasher is a full ring behind.
+
+#define COPY_RING 4
+
+typedef struct {
+	uint8_t *data;
+	size_t len;
+	uint64_t offset;
+} CopyBuf;
+
+typedef struct {
+	CopyJob *job;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+
+	CopyBuf bufs[COPY_RING];
+	int head;  // next buffer for the reader to fill
+	int tail;  // next buffer for the hasher
+	int count; // filled buffers not yet hashed
+	int done;  // reader has finished, hasher drains and exits
+
+	EVP_MD_CTX *sha256;
+	XXH3_state_t *xxh3;
+	uLong crc32;
+} CopyRing;
+
+double
+copy_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+_copy_addchunk(CopyJob *job, const CopyChunk *c)
+{
+	if (job->numchunks == job->maxchunks)
+	{
+		size_t n = job->maxchunks ? job->maxchunks * 2 : 1024;
+		CopyChunk *tmp = realloc(job->chunks, n * sizeof(CopyChunk));
+		if (tmp == NULL)
+		{
+			return -1;
+		}
+		job->chunks = tmp;
+		job->maxchunks = n;
+	}
+
+	job->chunks[job->numchunks++] = *c;
+	return 0;
+}
+
+// Hash one chunk into the whole-stream digests and record its own digests for the manifest
+static void
+_copy_hashbuf(CopyRing *ring, const CopyBuf *b)
+{
+	CopyJob *job = ring->job;
+	CopyChunk c;
+
+	memset(&c, 0, sizeof(c));
+	c.offset = b->offset;
+	c.len = b->len;
+
+	if (job->hashes & HASH_SHA256)
+	{
+		EVP_DigestUpdate(ring->sha256, b->data, b->len);
+	}
+	if (job->hashes & HASH_XXH3)
+	{
+		XXH3_64bits_update(ring->xxh3, b->data, b->len);
+		c.xxh3 = XXH3_64bits(b->data, b->len);
+	}
+	if (job->hashes & HASH_CRC32)
+	{
+		// Chunk CRCs are folded into the stream CRC so the data is only scanned once
+		c.crc32 = crc32(crc32(0L, Z_NULL, 0), b->data, b->len);
+		ring->crc32 = crc32_combine(ring->crc32, c.crc32, b->len);
+	}
+
+	if (_copy_addchunk(job, &c) < 0 && job->err == 0)
+	{
+		job->err = ENOMEM;
+	}
+}
+
+static void*
+_copy_hasher(void *arg)
+{
+	CopyRing *ring = arg;
+
+	pthread_mutex_lock(&ring->lock);
+	while (1)
+	{
+		while (ring->count == 0 && !ring->done)
+		{
+			pthread_cond_wait(&ring->cond, &ring->lock);
+		}
+		if (ring->count == 0)
+		{
+			break;
+		}
+
+		CopyBuf *b = &ring->bufs[ring->tail];
+		pthread_mutex_unlock(&ring->lock);
+
+		_copy_hashbuf(ring, b);
+
+		pthread_mutex_lock(&ring->lock);
+		ring->tail = (ring->tail + 1) % COPY_RING;
+		ring->count--;
+		pthread_cond_broadcast(&ring->cond);
+	}
+	pthread_mutex_unlock(&ring->lock);
+
+	return NULL;
+}
+
+static int64_t
+_copy_pread(int fd, uint8_t *buf, size_t len, uint64_t offset)
+{
+	size_t got = 0;
+	while (got < len)
+	{
+		ssize_t n = pread(fd, buf + got, len - got, offset + got);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		if (n == 0) break;
+		got += n;
+	}
+
+	return got;
+}
+
+int64_t
+copy_read_fd(void *handle, uint8_t *buf, size_t len, uint64_t offset)
+{
+	return _copy_pread(*(int*)handle, buf, len, offset);
+}
+
+static int
+_copy_put(CopyJob *job, const uint8_t *buf, size_t len, uint64_t offset)
+{
+	size_t put = 0;
+	while (put < len)
+	{
+		ssize_t n;
+		if (job->seekable)
+		{
+			n = pwrite(job->outfd, buf + put, len - put, offset + put);
+		}
+		else
+		{
+			n = write(job->outfd, buf + put, len - put);
+		}
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		put += n;
+	}
+
+	return 0;
+}
+
+// With job->resumable, records that everything below @offset is in the destination once it
+// is synced to disc, every COPY_SYNC_BYTES or when forced.  Writes may finish out of order, and
+// after a crash the destination size can run past data that never made it, so a copy resumes
+// from the recorded offset instead.
+// Writes @offset as the progress in @fd, fixed width so it always overwrites the last one
+static int
+_copy_record(int fd, uint64_t offset)
+{
+	char line[32];
+	int len = snprintf(line, sizeof(line), "%020llu\n", (unsigned long long)offset);
+	errno = 0;
+	if (pwrite(fd, line, len, 0) != len)
+	{
+		if (errno == 0) errno = EIO;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+_copy_progress(CopyJob *job, uint64_t offset, int force)
+{
+	if (! job->resumable || offset <= job->synced || (! force && offset - job->synced < COPY_SYNC_BYTES))
+	{
+		return 0;
+	}
+
+	if (fdatasync(job->outfd) < 0)
+	{
+		return -1;
+	}
+
+	if (_copy_record(job->progressfd, offset) < 0)
+	{
+		return -1;
+	}
+
+	job->synced = offset;
+	return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Sparse destinations
+//
+// With job->sparse set, blocks that are all zero are not written.  Past the end the
+// destination had before the copy they simply stay holes (copy_run() extends the file to
+// its full size at the end), below it they are punched out, or written as zeros where
+// the filesystem cannot punch holes.
+
+static int
+_copy_hole(CopyJob *job, const uint8_t *zeros, size_t len, uint64_t offset)
+{
+	if (offset >= job->holefrom)
+	{
+		return 0;
+	}
+
+#ifdef FALLOC_FL_PUNCH_HOLE
+	if (fallocate(job->outfd, FALLOC_FL_PUNCH_HOLE|FALLOC_FL_KEEP_SIZE, offset, len) == 0)
+	{
+		return 0;
+	}
+#endif
+
+	return _copy_put(job, zeros, len, offset);
+}
+
+// Skips the zero blocks at the start of buf[*pos,len) (which is at @offset), leaving holes for
+// them, and returns the length of the data that follows up to the next zero block or -1 with errno set
+static int64_t
+_copy_nextrun(CopyJob *job, const uint8_t *buf, size_t len, uint64_t offset, size_t *pos)
+{
+	size_t blk = job->sparse;
+	size_t zero = *pos, end, n;
+
+	if (blk == 0 || !job->seekable)
+	{
+		return len - *pos;
+	}
+
+	while (zero < len)
+	{
+		n = (len - zero < blk) ? len - zero : blk;
+		if (! zeroscan_iszero(buf + zero, n)) break;
+		job->blocks++;
+		job->zeroblocks++;
+		zero += n;
+	}
+
+	if (zero > *pos && _copy_hole(job, buf + *pos, zero - *pos, offset + *pos) < 0)
+	{
+		return -1;
+	}
+
+	// The block the zeros stopped at is already known to hold data
+	for (end = zero; end < len; end += n)
+	{
+		n = (len - end < blk) ? len - end : blk;
+		if (end > zero && zeroscan_iszero(buf + end, n)) break;
+		job->blocks++;
+	}
+
+	*pos = zero;
+	return end - zero;
+}
+
+static int
+_copy_write(CopyJob *job, const uint8_t *buf, size_t len, uint64_t offset)
+{
+	size_t pos = 0;
+
+	if (job->zw)
+	{
+		return zimage_write(job->zw, buf, len);
+	}
+
+	while (pos < len)
+	{
+		int64_t run = _copy_nextrun(job, buf, len, offset, &pos);
+		if (run < 0 || (run > 0 && _copy_put(job, buf + pos, run, offset + pos) < 0))
+		{
+			return -1;
+		}
+		pos += run;
+	}
+
+	return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Copy through an I/O engine
+//
+// Every buffer cycles through a read of the source and a write of the same bytes to the
+// destination, and up to job->depth buffers are in flight at once so the drive and the
+// destination both always have work queued.  Completions arrive in any order while the
+// digests need the stream in order, so a finished buffer is hashed (on this thread, the
+// other buffers keep the devices busy meanwhile) once everything before it has been.
+
+enum { ENGBUF_FREE, ENGBUF_READ, ENGBUF_WRITE, ENGBUF_DONE };
+
+typedef struct {
+	uint8_t *data;
+	int state;
+	int prefix;     // read back from job->prefixfd to be hashed, not written
+	uint64_t offset;
+	size_t want;
+	size_t len;     // bytes read
+	size_t written;
+} EngineBuf;
+
+static void
+_copy_engine(CopyJob *job, CopyRing *ring)
+{
+	EngineBuf *bufs = calloc(job->depth, sizeof(EngineBuf));
+	uint8_t **data = calloc(job->depth, sizeof(uint8_t*));
+	IOCompletion done[IOENGINE_MAXDEPTH];
+	IOEngine *e = NULL;
+	unsigned i;
+	int k;
+
+	if (bufs == NULL || data == NULL)
+	{
+		job->err = ENOMEM;
+		goto cleanup;
+	}
+
+	for (i = 0; i < job->depth; i++)
+	{
+		if (posix_memalign((void**)&data[i], 4096, job->chunk) != 0)
+		{
+			job->err = ENOMEM;
+			goto cleanup;
+		}
+		bufs[i].data = data[i];
+	}
+
+	e = ioengine_open(job->engine, job->depth, data, job->chunk);
+	if (e == NULL)
+	{
+		job->err = errno ? errno : ENOSYS;
+		goto cleanup;
+	}
+	job->enginename = ioengine_name(e);
+
+	uint64_t next = (job->hashes && job->prefixfd >= 0) ? 0 : job->start;
+	uint64_t end = job->end; // lowered to where the source turns out to end
+	uint64_t ordered = next; // every buffer before this offset has been written and hashed
+	unsigned inflight = 0;
+
+	while (1)
+	{
+		for (i = 0; i < job->depth && job->err == 0 && next < end; i++)
+		{
+			EngineBuf *b = &bufs[i];
+			if (b->state != ENGBUF_FREE)
+			{
+				continue;
+			}
+
+			b->prefix = (next < job->start);
+			b->want = job->chunk;
+			if (end - next < b->want)
+			{
+				b->want = end - next;
+			}
+			if (b->prefix && job->start - next < b->want)
+			{
+				b->want = job->start - next;
+			}
+			b->offset = next;
+			b->len = 0;
+			b->written = 0;
+
+			if (ioengine_read(e, b->prefix ? job->prefixfd : job->infd, i, b->data, b->want, next, i) < 0)
+			{
+				job->err = errno;
+				break;
+			}
+			b->state = ENGBUF_READ;
+			next += b->want;
+			inflight++;
+		}
+
+		if (inflight == 0)
+		{
+			break;
+		}
+
+		int n = ioengine_wait(e, done, IOENGINE_MAXDEPTH);
+		if (n < 0)
+		{
+			job->err = errno;
+			break;
+		}
+
+		for (k = 0; k < n; k++)
+		{
+			EngineBuf *b = &bufs[done[k].tag];
+			inflight--;
+
+			if (done[k].res < 0)
+			{
+				if (job->err == 0) job->err = -done[k].res;
+				if (b->state == ENGBUF_READ && ! b->prefix) metrics_add(METRIC_READ_ERRORS, 1);
+				b->state = ENGBUF_DONE;
+				continue;
+			}
+
+			if (b->state == ENGBUF_READ)
+			{
+				b->len = done[k].res;
+				if (b->len < b->want && b->offset + b->len < end)
+				{
+					// A short read is the end of the source, reads already queued past it come back empty
+					end = b->offset + b->len;
+				}
+
+				// Compressed output is written in order below, not here
+				if (b->prefix || b->len == 0 || job->err || job->zw)
+				{
+					b->state = ENGBUF_DONE;
+					continue;
+				}
+			}
+			else
+			{
+				if (done[k].res == 0)
+				{
+					job->err = EIO;
+				}
+				b->written += done[k].res;
+			}
+
+			// Write what was read a run at a time, the next run starts after a short write
+			int64_t run = 0;
+			if (job->err == 0 && b->written < b->len)
+			{
+				run = _copy_nextrun(job, b->data, b->len, b->offset, &b->written);
+				if (run < 0)
+				{
+					job->err = errno;
+				}
+			}
+			if (run <= 0)
+			{
+				job->bytes += b->len;
+				b->state = ENGBUF_DONE;
+				continue;
+			}
+			if (ioengine_write(e, job->outfd, done[k].tag, b->data + b->written, run, b->offset + b->written, done[k].tag) < 0)
+			{
+				job->err = errno;
+				b->state = ENGBUF_DONE;
+				continue;
+			}
+			b->state = ENGBUF_WRITE;
+			inflight++;
+		}
+
+		// Hash and recycle the finished buffers that continue the stream
+		int progress = 1;
+		while (progress)
+		{
+			progress = 0;
+			for (i = 0; i < job->depth; i++)
+			{
+				EngineBuf *b = &bufs[i];
+				if (b->state != ENGBUF_DONE || b->offset != ordered || b->len == 0 || job->err)
+				{
+					continue;
+				}
+
+				if (job->zw && !b->prefix)
+				{
+					if (zimage_write(job->zw, b->data, b->len) < 0)
+					{
+						job->err = errno;
+						break;
+					}
+					job->bytes += b->len;
+				}
+				if (job->hashes)
+				{
+					CopyBuf cb;
+					cb.data = b->data;
+					cb.len = b->len;
+					cb.offset = b->offset;
+					_copy_hashbuf(ring, &cb);
+				}
+				ordered += b->len;
+				b->state = ENGBUF_FREE;
+				progress = 1;
+			}
+		}
+
+		if (job->err == 0 && _copy_progress(job, ordered, 0) < 0)
+		{
+			job->err = errno;
+		}
+
+		for (i = 0; i < job->depth; i++)
+		{
+			if (bufs[i].state == ENGBUF_DONE && (bufs[i].offset >= end || job->err))
+			{
+				bufs[i].state = ENGBUF_FREE;
+			}
+		}
+	}
+	job->size = ordered;
+
+cleanup:
+	// Waits for anything still in flight before the buffers go
+	ioengine_close(e);
+
+	// Writes finish out of order, a resumed copy starts from the destination size so it must
+	// not run past a chunk that never made it
+	struct stat st;
+	uint64_t keep = job->size > job->start ? job->size : job->start;
+	if (job->err && job->resumable && fstat(job->outfd, &st) == 0 && (uint64_t)st.st_size > keep)
+	{
+		if (ftruncate(job->outfd, keep) < 0) {}
+	}
+
+	if (data)
+	{
+		for (i = 0; i < job->depth; i++)
+		{
+			free(data[i]);
+		}
+	}
+	free(data);
+	free(bufs);
+}
+
+int
+copy_run(CopyJob *job)
+{
+	CopyRing ring;
+	pthread_t hasher;
+	int threaded = 0;
+	int i;
+
+	memset(&ring, 0, sizeof(ring));
+	ring.job = job;
+
+	job->bytes = 0;
+	job->size = 0;
+	job->err = 0;
+	job->seekable = (lseek(job->outfd, 0, SEEK_CUR) >= 0);
+	job->blocks = 0;
+	job->zeroblocks = 0;
+
+	struct stat st;
+	if (job->sparse && job->seekable && fstat(job->outfd, &st) == 0)
+	{
+		job->holefrom = st.st_size;
+	}
+
+	double start = copy_now();
+
+	if (job->hashes)
+	{
+		if (job->hashes & HASH_SHA256)
+		{
+			ring.sha256 = EVP_MD_CTX_new();
+			if (ring.sha256 == NULL || !EVP_DigestInit_ex(ring.sha256, EVP_sha256(), NULL))
+			{
+				job->err = ENOMEM;
+				goto cleanup;
+			}
+		}
+		if (job->hashes & HASH_XXH3)
+		{
+			ring.xxh3 = XXH3_createState();
+			if (ring.xxh3 == NULL)
+			{
+				job->err = ENOMEM;
+				goto cleanup;
+			}
+			XXH3_64bits_reset(ring.xxh3);
+		}
+		ring.crc32 = crc32(0L, Z_NULL, 0);
+	}
+
+	// Engines need positional writes, a pipe or socket destination is copied a chunk at a time
+	if (job->engine != IOENGINE_NONE && job->seekable)
+	{
+		_copy_engine(job, &ring);
+		goto digests;
+	}
+
+	for (i = 0; i < (job->hashes ? COPY_RING : 1); i++)
+	{
+		ring.bufs[i].data = malloc(job->chunk);
+		if (ring.bufs[i].data == NULL)
+		{
+			job->err = ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	if (job->hashes)
+	{
+		pthread_mutex_init(&ring.lock, NULL);
+		pthread_cond_init(&ring.cond, NULL);
+		if (pthread_create(&hasher, NULL, _copy_hasher, &ring) != 0)
+		{
+			job->err = EAGAIN;
+			pthread_cond_destroy(&ring.cond);
+			pthread_mutex_destroy(&ring.lock);
+			goto cleanup;
+		}
+		threaded = 1;
+	}
+
+	// Data before job->start is already in the destination, it is only read back for hashing
+	uint64_t offset = (threaded && job->prefixfd >= 0) ? 0 : job->start;
+
+	while (offset < job->end)
+	{
+		CopyBuf *b = &ring.bufs[0];
+
+		if (threaded)
+		{
+			pthread_mutex_lock(&ring.lock);
+			while (ring.count == COPY_RING)
+			{
+				pthread_cond_wait(&ring.cond, &ring.lock);
+			}
+			b = &ring.bufs[ring.head];
+			pthread_mutex_unlock(&ring.lock);
+		}
+
+		size_t want = job->chunk;
+		if (job->end - offset < want)
+		{
+			want = job->end - offset;
+		}
+
+		int64_t n;
+		if (offset < job->start)
+		{
+			n = _copy_pread(job->prefixfd, b->data, want, offset);
+		}
+		else
+		{
+			n = job->read(job->handle, b->data, want, offset);
+			if (n < 0)
+			{
+				metrics_add(METRIC_READ_ERRORS, 1);
+			}
+			if (n > 0 && job->scan)
+			{
+				tsscan_feed(job->scan, b->data, n);
+			}
+			if (n > 0 && _copy_write(job, b->data, n, offset) < 0)
+			{
+				job->err = errno;
+				break;
+			}
+			if (n > 0)
+			{
+				job->bytes += n;
+			}
+		}
+
+		if (n < 0)
+		{
+			job->err = errno ? errno : EIO;
+			break;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+
+		b->len = n;
+		b->offset = offset;
+		offset += n;
+
+		if (_copy_progress(job, offset, 0) < 0)
+		{
+			job->err = errno;
+			break;
+		}
+
+		if (threaded)
+		{
+			pthread_mutex_lock(&ring.lock);
+			ring.head = (ring.head + 1) % COPY_RING;
+			ring.count++;
+			pthread_cond_broadcast(&ring.cond);
+			pthread_mutex_unlock(&ring.lock);
+		}
+	}
+	job->size = offset;
+
+	if (threaded)
+	{
+		pthread_mutex_lock(&ring.lock);
+		ring.done = 1;
+		pthread_cond_broadcast(&ring.cond);
+		pthread_mutex_unlock(&ring.lock);
+
+		pthread_join(hasher, NULL);
+		pthread_cond_destroy(&ring.cond);
+		pthread_mutex_destroy(&ring.lock);
+	}
+
+digests:
+	if (job->hashes && job->err == 0)
+	{
+		if (ring.sha256)
+		{
+			unsigned int len = 0;
+			EVP_DigestFinal_ex(ring.sha256, job->sha256, &len);
+		}
+		if (ring.xxh3)
+		{
+			job->xxh3 = XXH3_64bits_digest(ring.xxh3);
+		}
+		job->crc32 = ring.crc32;
+	}
+
+	// Zero blocks at the end were never written, the file still has to reach its full size
+	if (job->sparse && job->seekable && job->err == 0 && fstat(job->outfd, &st) == 0)
+	{
+		if ((uint64_t)st.st_size < job->size && ftruncate(job->outfd, job->size) < 0)
+		{
+			job->err = errno;
+		}
+		else if (fstat(job->outfd, &st) == 0)
+		{
+			job->allocated = (uint64_t)st.st_blocks * 512;
+		}
+	}
+
+	// Everything the copy got through is synced and recorded, a failed copy resumes from there
+	if (job->seekable && _copy_progress(job, job->size, 1) < 0 && job->err == 0)
+	{
+		job->err = errno;
+	}
+
+cleanup:
+	// Hashing time is included, the copy is not finished until its digests are
+	job->seconds = copy_now() - start;
+	metrics_add(METRIC_BYTES_READ, job->bytes);
+
+	if (ring.sha256) EVP_MD_CTX_free(ring.sha256);
+	if (ring.xxh3) XXH3_freeState(ring.xxh3);
+
+	for (i = 0; i < COPY_RING; i++)
+	{
+		free(ring.bufs[i].data);
+	}
+
+	return job->err ? -1 : 0;
+}
+
+void
+copy_free(CopyJob *job)
+{
+	free(job->chunks);
+	job->chunks = NULL;
+	job->numchunks = job->maxchunks = 0;
+}
+
+// --------------------------------------------------------------------------------
+// Streaming to a pipe or descriptor
+//
+// When the destination is a pipe, chunks are vmsplice()'d so the kernel maps our pages into
+// the pipe instead of copying them.  The reader of the pipe may still be looking at those
+// pages after vmsplice() returns, so the pipe is sized to one chunk and two buffers alternate:
+// once a chunk is wholly in the pipe the previous chunk has been consumed and can be refilled.
+// The last chunks are still in the pipe when the stream ends, so the pipe is drained before
+// the buffers go back to the heap.  Anything else gets plain write()s of whole chunks.
+
+// Wait until @fd can be written to, for non-blocking descriptors
+static int
+_copy_waitout(int fd)
+{
+	struct pollfd p;
+	p.fd = fd;
+	p.events = POLLOUT;
+	p.revents = 0;
+
+	while (poll(&p, 1, -1) < 0)
+	{
+		if (errno != EINTR) return -1;
+	}
+
+	return 0;
+}
+
+static int
+_copy_splice(int fd, uint8_t *buf, size_t len)
+{
+	struct iovec iov;
+	iov.iov_base = buf;
+	iov.iov_len = len;
+
+	while (iov.iov_len > 0)
+	{
+		ssize_t n = vmsplice(fd, &iov, 1, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && errno == EAGAIN)
+		{
+			if (_copy_waitout(fd) < 0) return -1;
+			continue;
+		}
+		if (n < 0) return -1;
+
+		iov.iov_base = (uint8_t*)iov.iov_base + n;
+		iov.iov_len -= n;
+	}
+
+	return 0;
+}
+
+// Wait until the reader has taken everything in the pipe, or there is no reader left to see it
+static void
+_copy_drain(int fd)
+{
+	int left;
+	while (ioctl(fd, FIONREAD, &left) == 0 && left > 0)
+	{
+		// Nothing to wait for but POLLERR, which a pipe with no readers raises, so this sleeps a millisecond
+		struct pollfd p;
+		p.fd = fd;
+		p.events = 0;
+		p.revents = 0;
+
+		if (poll(&p, 1, 1) > 0 && (p.revents & (POLLERR|POLLNVAL)))
+		{
+			break;
+		}
+	}
+}
+
+static int
+_copy_writeall(int fd, const uint8_t *buf, size_t len)
+{
+	size_t put = 0;
+	while (put < len)
+	{
+		ssize_t n = write(fd, buf + put, len - put);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0 && errno == EAGAIN)
+		{
+			if (_copy_waitout(fd) < 0) return -1;
+			continue;
+		}
+		if (n < 0) return -1;
+		put += n;
+	}
+
+	return 0;
+}
+
+int
+copy_stream(CopyJob *job)
+{
+	uint8_t *bufs[2] = {NULL, NULL};
+	struct stat st;
+	int cur = 0;
+
+	job->bytes = 0;
+	job->size = 0;
+	job->err = 0;
+	job->seekable = 0;
+	job->spliced = 0;
+
+	double start = copy_now();
+
+	if (fstat(job->outfd, &st) == 0 && S_ISFIFO(st.st_mode))
+	{
+		// Size the pipe to one chunk, halving it until it is under /proc/sys/fs/pipe-max-size
+		int want = job->chunk > (1 << 30) ? (1 << 30) : (int)job->chunk;
+		while (want > 65536 && fcntl(job->outfd, F_SETPIPE_SZ, want) < 0)
+		{
+			want /= 2;
+		}
+		int pipesz = fcntl(job->outfd, F_GETPIPE_SZ);
+		if (pipesz > 0)
+		{
+			job->chunk = pipesz;
+			job->spliced = 1;
+		}
+	}
+
+	// Page aligned so vmsplice() hands over whole pages
+	if (posix_memalign((void**)&bufs[0], 4096, job->chunk) != 0 ||
+	    (job->spliced && posix_memalign((void**)&bufs[1], 4096, job->chunk) != 0))
+	{
+		job->err = ENOMEM;
+		goto cleanup;
+	}
+
+	while (job->size < job->end)
+	{
+		size_t want = job->chunk;
+		if (job->end - job->size < want)
+		{
+			want = job->end - job->size;
+		}
+
+		int64_t n = job->read(job->handle, bufs[cur], want, job->size);
+		if (n < 0)
+		{
+			job->err = errno ? errno : EIO;
+			metrics_add(METRIC_READ_ERRORS, 1);
+			break;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+
+		// Before vmsplice() gives the pages away
+		if (job->scan)
+		{
+			tsscan_feed(job->scan, bufs[cur], n);
+		}
+
+		int ret;
+		if (job->spliced)
+		{
+			ret = _copy_splice(job->outfd, bufs[cur], n);
+			cur ^= 1;
+		}
+		else
+		{
+			ret = _copy_writeall(job->outfd, bufs[cur], n);
+		}
+		if (ret < 0)
+		{
+			job->err = errno;
+			break;
+		}
+
+		job->bytes += n;
+		job->size += n;
+	}
+
+cleanup:
+	job->seconds = copy_now() - start;
+	metrics_add(METRIC_BYTES_READ, job->bytes);
+
+	// The pipe maps the pages of the last chunks until they are read, they must not be reused before
+	if (job->spliced)
+	{
+		_copy_drain(job->outfd);
+	}
+
+	free(bufs[0]);
+	free(bufs[1]);
+
+	return job->err ? -1 : 0;
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Python interface
+
+static const struct {
+	const char *name;
+	int mask;
+} copy_hashnames[] = {
+	{"sha256", HASH_SHA256},
+	{"xxh3", HASH_XXH3},
+	{"crc32", HASH_CRC32},
+	{NULL, 0}
+};
+
+int
+copy_parsehashes(PyObject *names, int *mask)
+{
+	*mask = 0;
+	if (names == NULL || names == Py_None)
+	{
+		return 0;
+	}
+
+	PyObject *it = PyObject_GetIter(names);
+	if (it == NULL)
+	{
+		return -1;
+	}
+
+	PyObject *item;
+	while ((item = PyIter_Next(it)) != NULL)
+	{
+		const char *name = PyUnicode_AsUTF8(item);
+		if (name == NULL)
+		{
+			Py_DECREF(item);
+			Py_DECREF(it);
+			return -1;
+		}
+
+		int i;
+		for (i = 0; copy_hashnames[i].name; i++)
+		{
+			if (strcmp(copy_hashnames[i].name, name) == 0) break;
+		}
+		if (copy_hashnames[i].name == NULL)
+		{
+			PyErr_Format(PyExc_ValueError, "Unknown hash '%s', expected sha256, xxh3 or crc32", name);
+			Py_DECREF(item);
+			Py_DECREF(it);
+			return -1;
+		}
+
+		*mask |= copy_hashnames[i].mask;
+		Py_DECREF(item);
+	}
+	Py_DECREF(it);
+
+	return PyErr_Occurred() ? -1 : 0;
+}
+
+static PyObject*
+_copy_hex(unsigned long long v, int digits)
+{
+	char hex[17];
+	snprintf(hex, sizeof(hex), "%0*llx", digits, v);
+	return PyUnicode_FromString(hex);
+}
+
+PyObject*
+copy_topython(const CopyJob *job)
+{
+	PyObject *digests = PyDict_New();
+	PyObject *chunks = PyList_New(job->numchunks);
+	if (digests == NULL || chunks == NULL)
+	{
+		goto error;
+	}
+
+	if (job->hashes & HASH_SHA256)
+	{
+		char hex[2*32 + 1];
+		int i;
+		for (i = 0; i < 32; i++)
+		{
+			sprintf(hex + 2*i, "%02x", job->sha256[i]);
+		}
+
+		PyObject *v = PyUnicode_FromString(hex);
+		if (v == NULL || PyDict_SetItemString(digests, "sha256", v) < 0) { Py_XDECREF(v); goto error; }
+		Py_DECREF(v);
+	}
+	if (job->hashes & HASH_XXH3)
+	{
+		PyObject *v = _copy_hex(job->xxh3, 16);
+		if (v == NULL || PyDict_SetItemString(digests, "xxh3", v) < 0) { Py_XDECREF(v); goto error; }
+		Py_DECREF(v);
+	}
+	if (job->hashes & HASH_CRC32)
+	{
+		PyObject *v = _copy_hex(job->crc32, 8);
+		if (v == NULL || PyDict_SetItemString(digests, "crc32", v) < 0) { Py_XDECREF(v); goto error; }
+		Py_DECREF(v);
+	}
+
+	size_t i;
+	for (i = 0; i < job->numchunks; i++)
+	{
+		const CopyChunk *c = &job->chunks[i];
+		PyObject *d = PyDict_New();
+		if (d == NULL)
+		{
+			goto error;
+		}
+
+		if (job->hashes & HASH_XXH3)
+		{
+			PyObject *v = _copy_hex(c->xxh3, 16);
+			if (v == NULL || PyDict_SetItemString(d, "xxh3", v) < 0) { Py_XDECREF(v); Py_DECREF(d); goto error; }
+			Py_DECREF(v);
+		}
+		if (job->hashes & HASH_CRC32)
+		{
+			PyObject *v = _copy_hex(c->crc32, 8);
+			if (v == NULL || PyDict_SetItemString(d, "crc32", v) < 0) { Py_XDECREF(v); Py_DECREF(d); goto error; }
+			Py_DECREF(v);
+		}
+
+		PyObject *t = Py_BuildValue("(KkN)", (unsigned long long)c->offset, (unsigned long)c->len, d);
+		if (t == NULL)
+		{
+			goto error;
+		}
+		PyList_SET_ITEM(chunks, i, t);
+	}
+
+	return Py_BuildValue("{s:K,s:K,s:d,s:N,s:N}",
+		"Bytes", (unsigned long long)job->bytes,
+		"Size", (unsigned long long)job->size,
+		"Seconds", job->seconds,
+		"Digests", digests,
+		"Chunks", chunks);
+
+error:
+	Py_XDECREF(digests);
+	Py_XDECREF(chunks);
+	return NULL;
+}
+
+static int
+_image_cmprange(const void *a, const void *b)
+{
+	const SectorRange *x = a, *y = b;
+	return (x->lba > y->lba) - (x->lba < y->lba);
+}
+
+// Reads a sequence of (sector, count) pairs, sorted so the drive is read front to back
+static SectorRange*
+_image_parseranges(PyObject *obj, size_t *num)
+{
+	PyObject *seq = PySequence_Fast(obj, "Ranges must be a sequence of (sector, count) pairs");
+	SectorRange *r = NULL;
+	Py_ssize_t i, n;
+
+	if (seq == NULL)
+	{
+		return NULL;
+	}
+
+	n = PySequence_Fast_GET_SIZE(seq);
+	r = malloc((n ? n : 1) * sizeof(SectorRange));
+	if (r == NULL)
+	{
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		// Pairs may be lists too, as they come back from JSON
+		PyObject *pair = PySequence_Fast(PySequence_Fast_GET_ITEM(seq, i), "Ranges must be a sequence of (sector, count) pairs");
+		if (pair != NULL && PySequence_Fast_GET_SIZE(pair) == 2)
+		{
+			r[i].lba = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(pair, 0));
+			r[i].count = PyLong_AsUnsignedLongLong(PySequence_Fast_GET_ITEM(pair, 1));
+		}
+		else if (pair != NULL)
+		{
+			PyErr_SetString(PyExc_ValueError, "Ranges must be a sequence of (sector, count) pairs");
+		}
+		Py_XDECREF(pair);
+
+		if (PyErr_Occurred())
+		{
+			free(r);
+			Py_DECREF(seq);
+			return NULL;
+		}
+	}
+	Py_DECREF(seq);
+
+	qsort(r, n, sizeof(SectorRange), _image_cmprange);
+	*num = n;
+	return r;
+}
+
+// Copies just @ranges over an existing image, such as the sectors verification found different
+static int
+_image_ranges(CopyJob *job, const SectorRange *r, size_t n, uint64_t size)
+{
+	uint64_t bytes = 0;
+	double seconds = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+	{
+		uint64_t start = r[i].lba * DISC_SECTOR_SIZE;
+		uint64_t end = start + r[i].count * DISC_SECTOR_SIZE;
+		if (end > size)
+		{
+			end = size;
+		}
+		if (start >= end)
+		{
+			continue;
+		}
+
+		job->start = start;
+		job->end = end;
+		int ret = copy_run(job);
+		bytes += job->bytes;
+		seconds += job->seconds;
+		metrics_add(METRIC_RETRIES, 1);
+		if (ret == 0 && job->size < end)
+		{
+			job->err = EIO;
+			ret = -1;
+		}
+		if (ret < 0)
+		{
+			job->bytes = bytes;
+			return -1;
+		}
+	}
+
+	job->bytes = bytes;
+	job->seconds = seconds;
+	job->size = size;
+	return 0;
+}
+
+PyObject*
+BluRead_Image(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	const char *src=NULL, *dst=NULL;
+	unsigned long long size=0;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	PyObject *hashnames=NULL, *enginename=NULL;
+	PyObject *compress=NULL, *rangelist=NULL;
+	int hashes=0, engine=IOENGINE_NONE, sparse=0, level=0, threads=4;
+	unsigned int depth=IOENGINE_DEPTH;
+	Py_ssize_t framesize=ZIMAGE_FRAME_SIZE;
+	SectorRange *ranges=NULL;
+	size_t numranges=0;
+	static char *kwlist[] = {"Source", "Destination", "Size", "Hashes", "ChunkSize", "Engine", "QueueDepth", "Sparse", "Compress", "FrameSize", "CompressThreads", "Ranges", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "ssK|OnOIpOniO", kwlist, &src, &dst, &size, &hashnames, &chunk, &enginename, &depth, &sparse, &compress, &framesize, &threads, &rangelist))
+	{
+		return NULL;
+	}
+
+	// Ranges re-copies only those sectors over the image, which is then neither resumed nor hashed whole
+	if (rangelist != NULL && rangelist != Py_None)
+	{
+		if ((hashnames != NULL && hashnames != Py_None) || (compress != NULL && compress != Py_None))
+		{
+			PyErr_SetString(PyExc_ValueError, "Ranges cannot be combined with Hashes or Compress");
+			return NULL;
+		}
+	}
+	else
+	{
+		rangelist = NULL;
+	}
+
+	// Compress is None or the zstd level
+	if (compress != NULL && compress != Py_None)
+	{
+		level = (int)PyLong_AsLong(compress);
+		if (level == -1 && PyErr_Occurred())
+		{
+			return NULL;
+		}
+		if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel())
+		{
+			PyErr_Format(PyExc_ValueError, "Compression level (%d) must be between %d and %d", level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+			return NULL;
+		}
+		if (sparse)
+		{
+			PyErr_SetString(PyExc_ValueError, "Sparse and compressed output cannot be combined");
+			return NULL;
+		}
+		if (framesize < 64*1024 || framesize > 64*1024*1024 || framesize % 2048 != 0)
+		{
+			PyErr_Format(PyExc_ValueError, "Frame size (%zd) must be a multiple of the 2048 byte sector from 64 KiB to 64 MiB", framesize);
+			return NULL;
+		}
+	}
+	else
+	{
+		compress = NULL;
+	}
+
+	if (ioengine_parse(enginename, &engine) < 0)
+	{
+		return NULL;
+	}
+
+	if (depth < 1 || depth > IOENGINE_MAXDEPTH)
+	{
+		PyErr_Format(PyExc_ValueError, "Queue depth (%u) must be between 1 and %d", depth, IOENGINE_MAXDEPTH);
+		return NULL;
+	}
+
+	if (chunk < 4096 || chunk % 2048 != 0)
+	{
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must be a multiple of the 2048 byte sector and at least 4096", chunk);
+		return NULL;
+	}
+
+	if (copy_parsehashes(hashnames, &hashes) < 0)
+	{
+		return NULL;
+	}
+
+	if (rangelist != NULL && (ranges = _image_parseranges(rangelist, &numranges)) == NULL)
+	{
+		return NULL;
+	}
+
+	int infd = open(src, O_RDONLY);
+	if (infd < 0)
+	{
+		free(ranges);
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, src);
+	}
+
+	// A compressed image is always written from the start, its size says nothing about progress
+	int outfd = open(dst, compress ? O_WRONLY|O_CREAT|O_TRUNC : O_RDWR|O_CREAT, 0644);
+	if (outfd < 0)
+	{
+		free(ranges);
+		close(infd);
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst);
+	}
+
+	// Resume from the last whole chunk already in the destination, the chunks before it
+	// are read back from the destination (not the drive) only to be hashed
+	struct stat st;
+	if (fstat(outfd, &st) < 0)
+	{
+		free(ranges);
+		close(infd);
+		close(outfd);
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst);
+	}
+
+	// While a copy is unfinished, @dst.progress holds how much of it is synced, which is where it
+	// resumes rather than the size of @dst.  Without one the destination is a finished copy (or none).
+	char *progresspath = PyMem_Malloc(strlen(dst) + sizeof(".progress"));
+	if (progresspath == NULL)
+	{
+		free(ranges);
+		close(infd);
+		close(outfd);
+		return PyErr_NoMemory();
+	}
+	strcpy(progresspath, dst);
+	strcat(progresspath, ".progress");
+
+	uint64_t resume = (uint64_t)st.st_size;
+	int progressfd = -1;
+	if (ranges == NULL && compress == NULL)
+	{
+		// A new one means there was no unfinished copy, an older partial file without one resumes at its size
+		int found = 0;
+		progressfd = open(progresspath, O_RDWR|O_CREAT|O_EXCL, 0644);
+		if (progressfd < 0 && errno == EEXIST)
+		{
+			found = 1;
+			progressfd = open(progresspath, O_RDWR);
+		}
+		if (progressfd < 0)
+		{
+			PyErr_SetFromErrnoWithFilename(PyExc_OSError, progresspath);
+			PyMem_Free(progresspath);
+			free(ranges);
+			close(infd);
+			close(outfd);
+			return NULL;
+		}
+
+		char line[32];
+		ssize_t n = found ? pread(progressfd, line, sizeof(line) - 1, 0) : 0;
+		if (n > 0)
+		{
+			char *end;
+			line[n] = '\0';
+			uint64_t synced = strtoull(line, &end, 10);
+			if (end == line)
+			{
+				synced = 0;
+			}
+			if (synced < resume)
+			{
+				resume = synced;
+			}
+		}
+		else if (found)
+		{
+			// Killed before anything was recorded, nothing in the destination can be trusted
+			resume = 0;
+		}
+	}
+	else if (compress != NULL)
+	{
+		// Written over from the start, whatever was recorded for the old destination is gone
+		unlink(progresspath);
+	}
+
+	CopyJob job;
+	memset(&job, 0, sizeof(job));
+	job.read = copy_read_fd;
+	job.handle = &infd;
+	job.outfd = outfd;
+	job.prefixfd = outfd;
+	job.end = size;
+	job.start = resume < size ? resume : size;
+	job.start -= job.start % chunk;
+	job.chunk = chunk;
+	job.hashes = hashes;
+	job.engine = engine;
+	job.depth = depth;
+	job.infd = infd;
+	job.resumable = 1;
+	job.progressfd = progressfd;
+	job.synced = job.start;
+	if (ranges)
+	{
+		job.prefixfd = -1;
+		job.resumable = 0;
+	}
+	if (compress)
+	{
+		job.prefixfd = -1;
+		job.start = 0;
+		job.resumable = 0;
+		job.zw = zimage_open(outfd, level, threads, framesize);
+		if (job.zw == NULL)
+		{
+			PyMem_Free(progresspath);
+			close(infd);
+			close(outfd);
+			return PyErr_SetFromErrno(PyExc_OSError);
+		}
+	}
+	if (sparse)
+	{
+		// Holes are only worth leaving for whole filesystem blocks, sectors otherwise
+		job.sparse = (st.st_blksize > 0 && chunk % st.st_blksize == 0) ? (size_t)st.st_blksize : 2048;
+	}
+
+	// Recorded before any data is written, engines can extend the destination out of order
+	// long before the first sync, and a copy killed then must not resume past where it started
+	if (progressfd >= 0 && (_copy_record(progressfd, job.start) < 0 || fdatasync(progressfd) < 0))
+	{
+		PyErr_SetFromErrnoWithFilename(PyExc_OSError, progresspath);
+		close(progressfd);
+		PyMem_Free(progresspath);
+		close(infd);
+		close(outfd);
+		return NULL;
+	}
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	if (ranges)
+	{
+		ret = _image_ranges(&job, ranges, numranges, size);
+	}
+	else
+	{
+		ret = copy_run(&job);
+		if (ret == 0 && job.size < size)
+		{
+			// Source ended early, the image would be silently short
+			job.err = EIO;
+			ret = -1;
+		}
+	}
+	if (ret == 0 && job.zw && zimage_finish(job.zw) < 0)
+	{
+		job.err = errno;
+		ret = -1;
+	}
+	Py_END_ALLOW_THREADS
+
+	metrics_add(METRIC_BYTES_IMAGED, job.bytes);
+
+	free(ranges);
+
+	uint64_t frames = 0, rawsize = 0, compsize = 0;
+	if (job.zw)
+	{
+		zimage_stats(job.zw, &frames, &rawsize, &compsize);
+		zimage_free(job.zw);
+		job.zw = NULL;
+	}
+
+	close(infd);
+	if (close(outfd) < 0 && ret == 0)
+	{
+		job.err = errno;
+		ret = -1;
+	}
+
+	// A finished copy needs no record of its progress, a failed one resumes from it
+	if (progressfd >= 0)
+	{
+		close(progressfd);
+		if (ret == 0)
+		{
+			unlink(progresspath);
+		}
+	}
+	PyMem_Free(progresspath);
+
+	if (ret < 0)
+	{
+		copy_free(&job);
+		errno = job.err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, dst);
+	}
+
+	PyObject *result = copy_topython(&job);
+	copy_free(&job);
+
+	if (result != NULL && job.enginename != NULL)
+	{
+		PyObject *name = PyUnicode_FromString(job.enginename);
+		PyObject *qd = PyLong_FromUnsignedLong(depth);
+		if (name == NULL || qd == NULL || PyDict_SetItemString(result, "Engine", name) < 0 || PyDict_SetItemString(result, "QueueDepth", qd) < 0)
+		{
+			Py_CLEAR(result);
+		}
+		Py_XDECREF(name);
+		Py_XDECREF(qd);
+	}
+
+	if (result != NULL && compress)
+	{
+		PyObject *v = Py_BuildValue("{s:i,s:K,s:n,s:K,s:d}",
+			"Level", level,
+			"Frames", (unsigned long long)frames,
+			"FrameSize", framesize,
+			"Bytes", (unsigned long long)compsize,
+			"Ratio", rawsize ? (double)compsize / rawsize : 0.0);
+		if (v == NULL || PyDict_SetItemString(result, "Compressed", v) < 0)
+		{
+			Py_CLEAR(result);
+		}
+		Py_XDECREF(v);
+	}
+
+	if (result != NULL && job.sparse)
+	{
+		PyObject *v = Py_BuildValue("{s:n,s:K,s:K,s:d,s:K}",
+			"BlockSize", (Py_ssize_t)job.sparse,
+			"Blocks", (unsigned long long)job.blocks,
+			"ZeroBlocks", (unsigned long long)job.zeroblocks,
+			"ZeroRatio", job.blocks ? (double)job.zeroblocks / job.blocks : 0.0,
+			"Allocated", (unsigned long long)job.allocated);
+		if (v == NULL || PyDict_SetItemString(result, "Sparse", v) < 0)
+		{
+			Py_CLEAR(result);
+		}
+		Py_XDECREF(v);
+	}
+
+	return result;
+}
@@ -0,0 +1,591 @@
+#include "bluread.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#endif
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Asynchronous I/O engines
+//
+// Both engines run positional reads and writes against a fixed set of buffers and hand
+// back completions in whatever order the devices finish them.  The caller never has more
+// than one operation in flight per buffer, so @depth bounds everything queued.
+//
+// io_uring is driven through the raw system calls so liburing is not needed to build.  The
+// buffers are registered with the ring when the kernel allows it (RLIMIT_MEMLOCK on older
+// kernels may not) which saves pinning them on every operation.  Unregistered buffers need the
+// plain read and write operations of 5.6, so without either io_uring is not used.  Where it
+// is missing or blocked by a seccomp policy, a small pool of threads does the same with pread/pwrite.
+
+#define IOENGINE_MAXTHREADS 16
+
+typedef struct {
+	int write;
+	int fd;
+	uint8_t *data;
+	size_t len;
+	uint64_t offset;
+	uint64_t tag;
+} IOOp;
+
+struct IOEngine {
+	int kind;
+	unsigned depth;
+	unsigned inflight;
+
+#ifdef __linux__
+	// io_uring
+	int ringfd;
+	int fixed;
+	unsigned queued; // sqes written but not yet passed to io_uring_enter()
+	void *sqring, *cqring;
+	size_t sqlen, cqlen;
+	struct io_uring_sqe *sqes;
+	size_t sqeslen;
+	unsigned *sqhead, *sqtail, *sqmask, *sqarray;
+	unsigned *cqhead, *cqtail, *cqmask;
+	struct io_uring_cqe *cqes;
+	uint8_t **bufs;
+	size_t buflen;
+#endif
+
+	// threads
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+	pthread_cond_t done;
+	pthread_t threads[IOENGINE_MAXTHREADS];
+	int numthreads;
+	int stop;
+	IOOp *ops;          // submitted, ring of depth
+	unsigned ophead, opcount;
+	IOCompletion *cqs;  // completed, ring of depth
+	unsigned cqhead_, cqcount;
+};
+
+// --------------------------------------------------------------------------------
+// io_uring
+
+#ifdef __linux__
+
+static int
+_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+_uring_enter(int fd, unsigned submit, unsigned complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0);
+}
+
+static int
+_uring_register(int fd, unsigned op, void *arg, unsigned n)
+{
+	return (int)syscall(__NR_io_uring_register, fd, op, arg, n);
+}
+
+// Whether the kernel has IORING_OP_READ and IORING_OP_WRITE (5.6), which unregistered buffers
+// need.  The probe itself came with them, so a kernel that cannot answer it lacks them too.
+static int
+_uring_hasrw(int ringfd)
+{
+	size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+	struct io_uring_probe *probe = calloc(1, len);
+	if (probe == NULL)
+	{
+		return 0;
+	}
+
+	int ok = _uring_register(ringfd, IORING_REGISTER_PROBE, probe, 256) == 0
+		&& probe->last_op >= IORING_OP_WRITE
+		&& (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+		&& (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+
+	free(probe);
+	return ok;
+}
+
+static void
+_uring_close(IOEngine *e)
+{
+	if (e->sqes) munmap(e->sqes, e->sqeslen);
+	if (e->cqring && e->cqring != e->sqring) munmap(e->cqring, e->cqlen);
+	if (e->sqring) munmap(e->sqring, e->sqlen);
+	if (e->ringfd >= 0) close(e->ringfd);
+}
+
+static int
+_uring_open(IOEngine *e, uint8_t **bufs, size_t buflen)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	e->ringfd = _uring_setup(e->depth, &p);
+	if (e->ringfd < 0)
+	{
+		return -1;
+	}
+
+	e->sqlen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	e->cqlen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (e->cqlen > e->sqlen) e->sqlen = e->cqlen;
+		e->cqlen = e->sqlen;
+	}
+
+	e->sqring = mmap(NULL, e->sqlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, e->ringfd, IORING_OFF_SQ_RING);
+	if (e->sqring == MAP_FAILED)
+	{
+		e->sqring = NULL;
+		goto error;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		e->cqring = e->sqring;
+	}
+	else
+	{
+		e->cqring = mmap(NULL, e->cqlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, e->ringfd, IORING_OFF_CQ_RING);
+		if (e->cqring == MAP_FAILED)
+		{
+			e->cqring = NULL;
+			goto error;
+		}
+	}
+
+	e->sqeslen = p.sq_entries * sizeof(struct io_uring_sqe);
+	e->sqes = mmap(NULL, e->sqeslen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, e->ringfd, IORING_OFF_SQES);
+	if (e->sqes == MAP_FAILED)
+	{
+		e->sqes = NULL;
+		goto error;
+	}
+
+	uint8_t *sq = e->sqring;
+	uint8_t *cq = e->cqring;
+	e->sqhead = (unsigned*)(sq + p.sq_off.head);
+	e->sqtail = (unsigned*)(sq + p.sq_off.tail);
+	e->sqmask = (unsigned*)(sq + p.sq_off.ring_mask);
+	e->sqarray = (unsigned*)(sq + p.sq_off.array);
+	e->cqhead = (unsigned*)(cq + p.cq_off.head);
+	e->cqtail = (unsigned*)(cq + p.cq_off.tail);
+	e->cqmask = (unsigned*)(cq + p.cq_off.ring_mask);
+	e->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	// Fixed buffers are an optimisation only, plain reads and writes are used without them
+	struct iovec *iov = calloc(e->depth, sizeof(struct iovec));
+	if (iov != NULL)
+	{
+		unsigned i;
+		for (i = 0; i < e->depth; i++)
+		{
+			iov[i].iov_base = bufs[i];
+			iov[i].iov_len = buflen;
+		}
+		e->fixed = (_uring_register(e->ringfd, IORING_REGISTER_BUFFERS, iov, e->depth) == 0);
+		free(iov);
+	}
+
+	// Without them every operation is a plain read or write, which 5.1 to 5.5 reject; the
+	// threads do better there than failing each copy with EINVAL
+	if (! e->fixed && ! _uring_hasrw(e->ringfd))
+	{
+		_uring_close(e);
+		e->ringfd = -1;
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+	e->bufs = bufs;
+	e->buflen = buflen;
+
+	return 0;
+
+error:
+	_uring_close(e);
+	e->ringfd = -1;
+	return -1;
+}
+
+static int
+_uring_flush(IOEngine *e, unsigned complete)
+{
+	while (1)
+	{
+		int n = _uring_enter(e->ringfd, e->queued, complete, complete ? IORING_ENTER_GETEVENTS : 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		e->queued -= n;
+		if (e->queued == 0 || complete) return 0;
+	}
+}
+
+static int
+_uring_queue(IOEngine *e, const IOOp *op, int buf)
+{
+	unsigned tail = *e->sqtail;
+	if (tail - __atomic_load_n(e->sqhead, __ATOMIC_ACQUIRE) >= e->depth && _uring_flush(e, 0) < 0)
+	{
+		return -1;
+	}
+
+	unsigned idx = tail & *e->sqmask;
+	struct io_uring_sqe *sqe = &e->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+
+	sqe->fd = op->fd;
+	sqe->addr = (uintptr_t)op->data;
+	sqe->len = op->len;
+	sqe->off = op->offset;
+	sqe->user_data = op->tag;
+	if (e->fixed && buf >= 0)
+	{
+		sqe->opcode = op->write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+		sqe->buf_index = buf;
+	}
+	else
+	{
+		sqe->opcode = op->write ? IORING_OP_WRITE : IORING_OP_READ;
+	}
+
+	e->sqarray[idx] = idx;
+	__atomic_store_n(e->sqtail, tail + 1, __ATOMIC_RELEASE);
+	e->queued++;
+
+	return 0;
+}
+
+static int
+_uring_reap(IOEngine *e, IOCompletion *out, int max)
+{
+	unsigned head = *e->cqhead;
+	unsigned tail = __atomic_load_n(e->cqtail, __ATOMIC_ACQUIRE);
+	int n = 0;
+
+	while (head != tail && n < max)
+	{
+		struct io_uring_cqe *cqe = &e->cqes[head & *e->cqmask];
+		out[n].tag = cqe->user_data;
+		out[n].res = cqe->res;
+		n++;
+		head++;
+	}
+	__atomic_store_n(e->cqhead, head, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+#endif
+
+// --------------------------------------------------------------------------------
+// Threads
+
+static void*
+_threads_worker(void *arg)
+{
+	IOEngine *e = arg;
+
+	pthread_mutex_lock(&e->lock);
+	while (1)
+	{
+		while (e->opcount == 0 && !e->stop)
+		{
+			pthread_cond_wait(&e->work, &e->lock);
+		}
+		if (e->opcount == 0)
+		{
+			break;
+		}
+
+		IOOp op = e->ops[e->ophead];
+		e->ophead = (e->ophead + 1) % e->depth;
+		e->opcount--;
+		pthread_mutex_unlock(&e->lock);
+
+		ssize_t n;
+		do
+		{
+			n = op.write ? pwrite(op.fd, op.data, op.len, op.offset) : pread(op.fd, op.data, op.len, op.offset);
+		} while (n < 0 && errno == EINTR);
+
+		pthread_mutex_lock(&e->lock);
+		IOCompletion *c = &e->cqs[(e->cqhead_ + e->cqcount) % e->depth];
+		c->tag = op.tag;
+		c->res = n < 0 ? -errno : n;
+		e->cqcount++;
+		pthread_cond_signal(&e->done);
+	}
+	pthread_mutex_unlock(&e->lock);
+
+	return NULL;
+}
+
+static void
+_threads_close(IOEngine *e)
+{
+	int i;
+
+	pthread_mutex_lock(&e->lock);
+	e->stop = 1;
+	pthread_cond_broadcast(&e->work);
+	pthread_mutex_unlock(&e->lock);
+
+	for (i = 0; i < e->numthreads; i++)
+	{
+		pthread_join(e->threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&e->done);
+	pthread_cond_destroy(&e->work);
+	pthread_mutex_destroy(&e->lock);
+	free(e->ops);
+	free(e->cqs);
+}
+
+static int
+_threads_open(IOEngine *e)
+{
+	int want = e->depth < IOENGINE_MAXTHREADS ? (int)e->depth : IOENGINE_MAXTHREADS;
+
+	e->ops = calloc(e->depth, sizeof(IOOp));
+	e->cqs = calloc(e->depth, sizeof(IOCompletion));
+	if (e->ops == NULL || e->cqs == NULL)
+	{
+		free(e->ops);
+		free(e->cqs);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	pthread_mutex_init(&e->lock, NULL);
+	pthread_cond_init(&e->work, NULL);
+	pthread_cond_init(&e->done, NULL);
+
+	while (e->numthreads < want)
+	{
+		if (pthread_create(&e->threads[e->numthreads], NULL, _threads_worker, e) != 0)
+		{
+			break;
+		}
+		e->numthreads++;
+	}
+	if (e->numthreads == 0)
+	{
+		_threads_close(e);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	return 0;
+}
+
+// --------------------------------------------------------------------------------
+// Engine
+
+IOEngine*
+ioengine_open(int kind, unsigned depth, uint8_t **bufs, size_t buflen)
+{
+	IOEngine *e = calloc(1, sizeof(IOEngine));
+	if (e == NULL)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+	e->depth = depth;
+
+#ifdef __linux__
+	e->ringfd = -1;
+	if (kind != IOENGINE_THREADS)
+	{
+		if (_uring_open(e, bufs, buflen) == 0)
+		{
+			e->kind = IOENGINE_URING;
+			return e;
+		}
+		if (kind == IOENGINE_URING)
+		{
+			free(e);
+			return NULL;
+		}
+	}
+#else
+	if (kind == IOENGINE_URING)
+	{
+		free(e);
+		errno = ENOSYS;
+		return NULL;
+	}
+#endif
+
+	if (_threads_open(e) < 0)
+	{
+		free(e);
+		return NULL;
+	}
+	e->kind = IOENGINE_THREADS;
+
+	return e;
+}
+
+const char*
+ioengine_name(const IOEngine *e)
+{
+	return e->kind == IOENGINE_URING ? "io_uring" : "threads";
+}
+
+static int
+_ioengine_queue(IOEngine *e, int write, int fd, int buf, uint8_t *data, size_t len, uint64_t offset, uint64_t tag)
+{
+	IOOp op;
+	op.write = write;
+	op.fd = fd;
+	op.data = data;
+	op.len = len;
+	op.offset = offset;
+	op.tag = tag;
+
+	if (e->inflight == e->depth)
+	{
+		errno = EBUSY;
+		return -1;
+	}
+
+#ifdef __linux__
+	if (e->kind == IOENGINE_URING)
+	{
+		if (_uring_queue(e, &op, buf) < 0) return -1;
+		e->inflight++;
+		return 0;
+	}
+#endif
+
+	pthread_mutex_lock(&e->lock);
+	e->ops[(e->ophead + e->opcount) % e->depth] = op;
+	e->opcount++;
+	pthread_cond_signal(&e->work);
+	pthread_mutex_unlock(&e->lock);
+	e->inflight++;
+
+	return 0;
+}
+
+int
+ioengine_read(IOEngine *e, int fd, int buf, uint8_t *data, size_t len, uint64_t offset, uint64_t tag)
+{
+	return _ioengine_queue(e, 0, fd, buf, data, len, offset, tag);
+}
+
+int
+ioengine_write(IOEngine *e, int fd, int buf, const uint8_t *data, size_t len, uint64_t offset, uint64_t tag)
+{
+	return _ioengine_queue(e, 1, fd, buf, (uint8_t*)data, len, offset, tag);
+}
+
+int
+ioengine_wait(IOEngine *e, IOCompletion *out, int max)
+{
+	int n = 0;
+
+	if (e->inflight == 0)
+	{
+		return 0;
+	}
+
+#ifdef __linux__
+	if (e->kind == IOENGINE_URING)
+	{
+		while ((n = _uring_reap(e, out, max)) == 0)
+		{
+			if (_uring_flush(e, 1) < 0) return -1;
+		}
+		// Anything queued while completions were still waiting is submitted now, not on the next wait
+		if (e->queued && _uring_flush(e, 0) < 0) return -1;
+		e->inflight -= n;
+		return n;
+	}
+#endif
+
+	pthread_mutex_lock(&e->lock);
+	while (e->cqcount == 0)
+	{
+		pthread_cond_wait(&e->done, &e->lock);
+	}
+	while (e->cqcount > 0 && n < max)
+	{
+		out[n++] = e->cqs[e->cqhead_];
+		e->cqhead_ = (e->cqhead_ + 1) % e->depth;
+		e->cqcount--;
+	}
+	pthread_mutex_unlock(&e->lock);
+	e->inflight -= n;
+
+	return n;
+}
+
+void
+ioengine_close(IOEngine *e)
+{
+	if (e == NULL)
+	{
+		return;
+	}
+
+#ifdef __linux__
+	if (e->kind == IOENGINE_URING)
+	{
+		// The kernel still owns the buffers of anything in flight
+		IOCompletion c[16];
+		while (e->inflight > 0 && ioengine_wait(e, c, 16) > 0) ;
+		_uring_close(e);
+		free(e);
+		return;
+	}
+#endif
+
+	_threads_close(e);
+	free(e);
+}
+
+int
+ioengine_parse(PyObject *name, int *kind)
+{
+	*kind = IOENGINE_NONE;
+	if (name == NULL || name == Py_None)
+	{
+		return 0;
+	}
+
+	if (! PyUnicode_Check(name))
+	{
+		PyErr_SetString(PyExc_TypeError, "Engine must be None, 'auto', 'io_uring' or 'threads'");
+		return -1;
+	}
+
+	const char *s = PyUnicode_AsUTF8(name);
+	if (s == NULL)
+	{
+		return -1;
+	}
+
+	if (strcmp(s, "auto") == 0)          *kind = IOENGINE_AUTO;
+	else if (strcmp(s, "io_uring") == 0) *kind = IOENGINE_URING;
+	else if (strcmp(s, "threads") == 0)  *kind = IOENGINE_THREADS;
+	else
+	{
+		PyErr_Format(PyExc_ValueError, "Unknown I/O engine '%s', expected 'auto', 'io_uring' or 'threads'", s);
+		return -1;
+	}
+
+	return 0;
+}
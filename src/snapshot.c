@@ -0,0 +1,587 @@
+#include "bluread.h"
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Detached title metadata records
+//
+// A title is packed into one little-endian record holding just the fields the Title, Chapter,
+// Clip and stream objects expose, so it can be pickled, shipped to another process or kept
+// after the disc is closed.  After the 40 byte header every field is a column with one entry
+// per chapter, clip or stream, widest columns first so each stays naturally aligned:
+//
+//   0  "BRT1"           16 u64 duration         36 u8  angles
+//   4  u32 size         24 u32 chapters         37 u8  flags (SNAPSHOT_*)
+//   8  u32 title number 28 u32 clips            38 u16 zero
+//   12 u32 playlist     32 u32 streams
+//
+//   u64 chapter start[chapters], u64 chapter length[chapters], u32 chapter clip[chapters]
+//   u32 clip first stream[clips], u32 stream bitrate[streams], u16 stream pid[streams]
+//   u8  clip counts[5][clips] (videos, secondary videos, audios, secondary audios, subtitles)
+//   u8  clip id[5][clips]
+//   u8  stream coding type, format, rate, aspect[streams], u8 stream language[4][streams]
+//
+// padded with zeros to a multiple of 8 bytes.  Only the primary video, primary audio and
+// subtitle streams are kept, those of a clip are consecutive in that order from its first stream.
+
+static inline void
+_snapshot_put16(uint8_t *p, uint16_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static inline void
+_snapshot_put32(uint8_t *p, uint32_t v)
+{
+	_snapshot_put16(p, v);
+	_snapshot_put16(p + 2, v >> 16);
+}
+
+static inline void
+_snapshot_put64(uint8_t *p, uint64_t v)
+{
+	_snapshot_put32(p, v);
+	_snapshot_put32(p + 4, v >> 32);
+}
+
+static inline uint16_t
+_snapshot_get16(const uint8_t *p)
+{
+	return (uint16_t)p[0] | (uint16_t)p[1] << 8;
+}
+
+static inline uint32_t
+_snapshot_get32(const uint8_t *p)
+{
+	return (uint32_t)_snapshot_get16(p) | (uint32_t)_snapshot_get16(p + 2) << 16;
+}
+
+static inline uint64_t
+_snapshot_get64(const uint8_t *p)
+{
+	return (uint64_t)_snapshot_get32(p) | (uint64_t)_snapshot_get32(p + 4) << 32;
+}
+
+// Points the columns of @t at @rec from the counts
+static void
+_snapshot_columns(SnapshotTitle *t, const uint8_t *rec)
+{
+	size_t c = t->numchapters, k = t->numclips, s = t->numstreams;
+	const uint8_t *p = rec + SNAPSHOT_HEADER_SIZE;
+
+	t->chapterstart = p;   p += 8 * c;
+	t->chapterlength = p;  p += 8 * c;
+	t->chapterclip = p;    p += 4 * c;
+	t->clipfirst = p;      p += 4 * k;
+	t->streambitrate = p;  p += 4 * s;
+	t->streampid = p;      p += 2 * s;
+	t->clipcounts = p;     p += 5 * k;
+	t->clipid = p;         p += 5 * k;
+	t->streamcoding = p;   p += s;
+	t->streamformat = p;   p += s;
+	t->streamrate = p;     p += s;
+	t->streamaspect = p;   p += s;
+	t->streamlang = p;
+}
+
+// Bytes of a record with @c chapters, @k clips and @s streams before padding, as laid out above
+static uint64_t
+_snapshot_bytes(uint64_t c, uint64_t k, uint64_t s)
+{
+	return SNAPSHOT_HEADER_SIZE + 20 * c + 14 * k + 14 * s;
+}
+
+static size_t
+_snapshot_streams(const BLURAY_TITLE_INFO *info)
+{
+	size_t n = 0;
+	uint32_t i;
+
+	for (i = 0; i < info->clip_count; i++)
+	{
+		n += info->clips[i].video_stream_count + info->clips[i].audio_stream_count + info->clips[i].pg_stream_count;
+	}
+
+	return n;
+}
+
+size_t
+snapshot_size(const BLURAY_TITLE_INFO *info)
+{
+	uint64_t len = _snapshot_bytes(info->chapter_count, info->clip_count, _snapshot_streams(info));
+
+	return (len + 7) & ~(uint64_t)7;
+}
+
+size_t
+snapshot_info_size(const BLURAY_TITLE_INFO *info)
+{
+	size_t n = sizeof(*info);
+	uint32_t i;
+
+	n += info->chapter_count * sizeof(*info->chapters);
+	n += info->mark_count * sizeof(*info->marks);
+	n += info->clip_count * sizeof(*info->clips);
+
+	for (i = 0; i < info->clip_count; i++)
+	{
+		const BLURAY_CLIP_INFO *clip = &info->clips[i];
+
+		n += (clip->video_stream_count + clip->audio_stream_count + clip->pg_stream_count + clip->ig_stream_count
+			+ clip->sec_audio_stream_count + clip->sec_video_stream_count) * sizeof(BLURAY_STREAM_INFO);
+	}
+
+	return n;
+}
+
+// Bitrate of @pid in @bitrates, a sampled PID that was never seen is 0
+static int
+_snapshot_bitrate(PyObject *bitrates, uint16_t pid, uint32_t *out)
+{
+	PyObject *k = PyLong_FromLong(pid);
+	if (k == NULL)
+	{
+		return -1;
+	}
+
+	PyObject *v = PyDict_GetItemWithError(bitrates, k);
+	Py_DECREF(k);
+	if (v == NULL)
+	{
+		*out = 0;
+		return PyErr_Occurred() ? -1 : 0;
+	}
+
+	unsigned long long bps = PyLong_AsUnsignedLongLong(v);
+	if (bps == (unsigned long long)-1 && PyErr_Occurred())
+	{
+		return -1;
+	}
+
+	*out = bps > UINT32_MAX ? UINT32_MAX : (uint32_t)bps;
+	return 0;
+}
+
+static int
+_snapshot_packstream(const SnapshotTitle *t, uint32_t s, const BLURAY_STREAM_INFO *info, PyObject *bitrates)
+{
+	uint32_t bitrate = 0;
+	if (bitrates != NULL && _snapshot_bitrate(bitrates, info->pid, &bitrate) < 0)
+	{
+		return -1;
+	}
+
+	_snapshot_put32((uint8_t*)t->streambitrate + 4 * s, bitrate);
+	_snapshot_put16((uint8_t*)t->streampid + 2 * s, info->pid);
+	((uint8_t*)t->streamcoding)[s] = info->coding_type;
+	((uint8_t*)t->streamformat)[s] = info->format;
+	((uint8_t*)t->streamrate)[s] = info->rate;
+	((uint8_t*)t->streamaspect)[s] = info->aspect;
+	memcpy((uint8_t*)t->streamlang + 4 * s, info->lang, 4);
+
+	return 0;
+}
+
+int
+snapshot_pack(uint8_t *out, uint32_t num, const BLURAY_TITLE_INFO *info, PyObject *bitrates)
+{
+	size_t size = snapshot_size(info);
+	SnapshotTitle t;
+	uint32_t i, j, s = 0;
+
+	if (size > UINT32_MAX)
+	{
+		PyErr_SetString(PyExc_Exception, "Title is too large to snapshot");
+		return -1;
+	}
+
+	memset(out, 0, size);
+
+	t.numchapters = info->chapter_count;
+	t.numclips = info->clip_count;
+	t.numstreams = _snapshot_streams(info);
+	_snapshot_columns(&t, out);
+
+	memcpy(out, SNAPSHOT_MAGIC, 4);
+	_snapshot_put32(out + 4, size);
+	_snapshot_put32(out + 8, num);
+	_snapshot_put32(out + 12, info->playlist);
+	_snapshot_put64(out + 16, info->duration);
+	_snapshot_put32(out + 24, t.numchapters);
+	_snapshot_put32(out + 28, t.numclips);
+	_snapshot_put32(out + 32, t.numstreams);
+	out[36] = info->angle_count;
+	out[37] = bitrates != NULL ? SNAPSHOT_SAMPLED : 0;
+
+	for (i = 0; i < info->chapter_count; i++)
+	{
+		_snapshot_put64((uint8_t*)t.chapterstart + 8 * i, info->chapters[i].start);
+		_snapshot_put64((uint8_t*)t.chapterlength + 8 * i, info->chapters[i].duration);
+		_snapshot_put32((uint8_t*)t.chapterclip + 4 * i, info->chapters[i].clip_ref);
+	}
+
+	for (i = 0; i < info->clip_count; i++)
+	{
+		const BLURAY_CLIP_INFO *clip = &info->clips[i];
+		uint8_t *counts = (uint8_t*)t.clipcounts;
+
+		_snapshot_put32((uint8_t*)t.clipfirst + 4 * i, s);
+		counts[i] = clip->video_stream_count;
+		counts[t.numclips + i] = clip->sec_video_stream_count;
+		counts[2 * t.numclips + i] = clip->audio_stream_count;
+		counts[3 * t.numclips + i] = clip->sec_audio_stream_count;
+		counts[4 * t.numclips + i] = clip->pg_stream_count;
+		memcpy((uint8_t*)t.clipid + 5 * i, clip->clip_id, strnlen(clip->clip_id, 5));
+
+		for (j = 0; j < clip->video_stream_count; j++)
+		{
+			if (_snapshot_packstream(&t, s++, &clip->video_streams[j], bitrates) < 0) { return -1; }
+		}
+		for (j = 0; j < clip->audio_stream_count; j++)
+		{
+			if (_snapshot_packstream(&t, s++, &clip->audio_streams[j], bitrates) < 0) { return -1; }
+		}
+		for (j = 0; j < clip->pg_stream_count; j++)
+		{
+			if (_snapshot_packstream(&t, s++, &clip->pg_streams[j], bitrates) < 0) { return -1; }
+		}
+	}
+
+	return 0;
+}
+
+int
+snapshot_parse(SnapshotTitle *t, const uint8_t *buf, size_t len)
+{
+	uint32_t i;
+
+	if (len < SNAPSHOT_HEADER_SIZE || memcmp(buf, SNAPSHOT_MAGIC, 4) != 0)
+	{
+		PyErr_SetString(PyExc_Exception, "Not a title snapshot");
+		return -1;
+	}
+
+	t->rec = buf;
+	t->size = _snapshot_get32(buf + 4);
+	t->num = _snapshot_get32(buf + 8);
+	t->playlist = _snapshot_get32(buf + 12);
+	t->duration = _snapshot_get64(buf + 16);
+	t->numchapters = _snapshot_get32(buf + 24);
+	t->numclips = _snapshot_get32(buf + 28);
+	t->numstreams = _snapshot_get32(buf + 32);
+	t->angles = buf[36];
+	t->flags = buf[37];
+
+	// A record can claim any counts, they must fit in its size
+	if (t->size > len || t->size % 8 != 0 || _snapshot_bytes(t->numchapters, t->numclips, t->numstreams) > t->size)
+	{
+		PyErr_Format(PyExc_Exception, "Title snapshot is truncated or corrupt (%u bytes, %zu available)", t->size, len);
+		return -1;
+	}
+
+	_snapshot_columns(t, buf);
+
+	// Every clip's streams must lie within the stream columns
+	for (i = 0; i < t->numclips; i++)
+	{
+		SnapshotClip c;
+		snapshot_clip(t, i, &c);
+		if ((uint64_t)c.first + c.videos + c.audios + c.subtitles > t->numstreams)
+		{
+			PyErr_Format(PyExc_Exception, "Title snapshot is corrupt, clip %u has streams past the end", i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void
+snapshot_chapter(const SnapshotTitle *t, uint32_t i, SnapshotChapter *c)
+{
+	c->start = _snapshot_get64(t->chapterstart + 8 * i);
+	c->length = _snapshot_get64(t->chapterlength + 8 * i);
+	c->clip = _snapshot_get32(t->chapterclip + 4 * i);
+}
+
+void
+snapshot_clip(const SnapshotTitle *t, uint32_t i, SnapshotClip *c)
+{
+	const uint8_t *counts = t->clipcounts;
+
+	memcpy(c->clipid, t->clipid + 5 * i, 5);
+	c->clipid[5] = '\0';
+	c->videos = counts[i];
+	c->secvideos = counts[t->numclips + i];
+	c->audios = counts[2 * t->numclips + i];
+	c->secaudios = counts[3 * t->numclips + i];
+	c->subtitles = counts[4 * t->numclips + i];
+	c->first = _snapshot_get32(t->clipfirst + 4 * i);
+}
+
+void
+snapshot_stream(const SnapshotTitle *t, uint32_t i, SnapshotStream *s)
+{
+	s->coding_type = t->streamcoding[i];
+	s->format = t->streamformat[i];
+	s->rate = t->streamrate[i];
+	s->aspect = t->streamaspect[i];
+	memcpy(s->lang, t->streamlang + 4 * i, 4);
+	s->lang[4] = '\0';
+	s->pid = _snapshot_get16(t->streampid + 2 * i);
+	s->bitrate = _snapshot_get32(t->streambitrate + 4 * i);
+}
+
+
+// Whether stream @i of @t has a coding type, format and language @q allows
+static int
+_snapshot_stream_match(const SnapshotTitle *t, uint32_t i, const SnapshotStreamQuery *q)
+{
+	uint8_t coding = t->streamcoding[i], format = t->streamformat[i];
+	uint32_t j;
+
+	if (!(q->codings[coding >> 3] & 1 << (coding & 7)) || !(q->formats[format >> 3] & 1 << (format & 7)))
+	{
+		return 0;
+	}
+	if (q->numlangs == 0)
+	{
+		return 1;
+	}
+	for (j = 0; j < q->numlangs; j++)
+	{
+		if (memcmp(t->streamlang + 4 * (size_t)i, q->langs[j], 3) == 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int
+snapshot_match(const SnapshotTitle *t, const SnapshotQuery *q)
+{
+	uint32_t i, j, k;
+
+	if (t->duration < q->minlength || t->duration > q->maxlength)
+	{
+		return 0;
+	}
+	if (t->numchapters < q->minchapters || t->numchapters > q->maxchapters)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < q->numstreams; i++)
+	{
+		const SnapshotStreamQuery *sq = &q->streams[i];
+		int found = 0;
+
+		for (j = 0; !found && j < t->numclips; j++)
+		{
+			SnapshotClip c;
+			snapshot_clip(t, j, &c);
+
+			// Streams of a clip are its videos, then audios, then subtitles
+			uint32_t first = c.first, n = c.videos;
+			if (sq->kind == SNAPSHOT_AUDIO)
+			{
+				first += c.videos;
+				n = c.audios;
+			}
+			else if (sq->kind == SNAPSHOT_SUBTITLE)
+			{
+				first += c.videos + c.audios;
+				n = c.subtitles;
+			}
+
+			for (k = first; !found && k < first + n; k++)
+			{
+				found = _snapshot_stream_match(t, k, sq);
+			}
+		}
+
+		if (found != sq->present)
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Disc records and catalogs
+//
+// A disc record holds the disc wide fields and the title records of every title, each
+// found through an offset from the start of the disc record:
+//
+//   0  "BRD1"            16 char volume id[32]   96  u32 path length
+//   4  u32 size          48 char disc id[36]     100 u32 zero
+//   8  u32 titles        84 char org id[12]      104 u32 title offset[titles]
+//   12 i32 main title (-1 for none)
+//
+// then the path (UTF-8), padding to 8 bytes and the title records.  Strings are NUL padded.
+//
+// A catalog puts many disc records in one buffer, to be mapped by every process that needs
+// them and read in place:
+//
+//   0  "BRC1"            8  u64 size
+//   4  u32 discs         16 u64 disc offset[discs]
+//
+// followed by the disc records.  Every record starts at a multiple of 8 bytes.
+
+#define SNAPSHOT_DISC_HEADER_SIZE 104
+#define SNAPSHOT_CATALOG_HEADER_SIZE 16
+
+static void
+_snapshot_putstr(uint8_t *p, const char *s, size_t max)
+{
+	memcpy(p, s, strnlen(s, max));
+}
+
+static void
+_snapshot_getstr(char *s, const uint8_t *p, size_t max)
+{
+	memcpy(s, p, max);
+	s[max] = '\0';
+}
+
+size_t
+snapshot_disc_size(const SnapshotDisc *d, BLURAY_TITLE_INFO **infos)
+{
+	uint64_t len = SNAPSHOT_DISC_HEADER_SIZE + 4 * (uint64_t)d->numtitles + d->pathlen;
+	uint32_t i;
+
+	len = (len + 7) & ~(uint64_t)7;
+	for (i = 0; i < d->numtitles; i++)
+	{
+		len += snapshot_size(infos[i]);
+	}
+
+	return len;
+}
+
+int
+snapshot_pack_disc(uint8_t *out, const SnapshotDisc *d, BLURAY_TITLE_INFO **infos)
+{
+	size_t size = snapshot_disc_size(d, infos);
+	uint32_t i;
+
+	if (size > UINT32_MAX)
+	{
+		PyErr_SetString(PyExc_Exception, "Disc is too large to snapshot");
+		return -1;
+	}
+
+	memset(out, 0, SNAPSHOT_DISC_HEADER_SIZE);
+	memcpy(out, SNAPSHOT_DISC_MAGIC, 4);
+	_snapshot_put32(out + 4, size);
+	_snapshot_put32(out + 8, d->numtitles);
+	_snapshot_put32(out + 12, (uint32_t)d->main);
+	_snapshot_putstr(out + 16, d->volumeid, 32);
+	_snapshot_putstr(out + 48, d->discid, 36);
+	_snapshot_putstr(out + 84, d->orgid, 12);
+	_snapshot_put32(out + 96, d->pathlen);
+
+	size_t off = SNAPSHOT_DISC_HEADER_SIZE + 4 * (size_t)d->numtitles;
+	memcpy(out + off, d->path, d->pathlen);
+	off += d->pathlen;
+
+	size_t aligned = (off + 7) & ~(size_t)7;
+	memset(out + off, 0, aligned - off);
+	off = aligned;
+
+	for (i = 0; i < d->numtitles; i++)
+	{
+		_snapshot_put32(out + SNAPSHOT_DISC_HEADER_SIZE + 4 * i, off);
+		if (snapshot_pack(out + off, i, infos[i], NULL) < 0)
+		{
+			return -1;
+		}
+		off += snapshot_size(infos[i]);
+	}
+
+	return 0;
+}
+
+int
+snapshot_parse_disc(SnapshotDisc *d, const uint8_t *buf, size_t len)
+{
+	if (len < SNAPSHOT_DISC_HEADER_SIZE || memcmp(buf, SNAPSHOT_DISC_MAGIC, 4) != 0)
+	{
+		PyErr_SetString(PyExc_Exception, "Not a disc snapshot");
+		return -1;
+	}
+
+	d->rec = buf;
+	d->size = _snapshot_get32(buf + 4);
+	d->numtitles = _snapshot_get32(buf + 8);
+	d->main = (int32_t)_snapshot_get32(buf + 12);
+	_snapshot_getstr(d->volumeid, buf + 16, 32);
+	_snapshot_getstr(d->discid, buf + 48, 36);
+	_snapshot_getstr(d->orgid, buf + 84, 12);
+	d->pathlen = _snapshot_get32(buf + 96);
+	d->path = (const char*)buf + SNAPSHOT_DISC_HEADER_SIZE + 4 * (size_t)d->numtitles;
+
+	if (d->size > len || d->size % 8 != 0 || SNAPSHOT_DISC_HEADER_SIZE + 4 * (uint64_t)d->numtitles + d->pathlen > d->size)
+	{
+		PyErr_Format(PyExc_Exception, "Disc snapshot is truncated or corrupt (%u bytes, %zu available)", d->size, len);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+snapshot_disc_title(const SnapshotDisc *d, uint32_t i, uint32_t *off)
+{
+	*off = _snapshot_get32(d->rec + SNAPSHOT_DISC_HEADER_SIZE + 4 * (size_t)i);
+
+	if (*off % 8 != 0 || *off < SNAPSHOT_DISC_HEADER_SIZE || *off >= d->size)
+	{
+		PyErr_Format(PyExc_Exception, "Disc snapshot is corrupt, title %u is at %u of %u bytes", i, *off, d->size);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+snapshot_parse_catalog(SnapshotCatalog *c, const uint8_t *buf, size_t len)
+{
+	if (len < SNAPSHOT_CATALOG_HEADER_SIZE || memcmp(buf, SNAPSHOT_CATALOG_MAGIC, 4) != 0)
+	{
+		PyErr_SetString(PyExc_Exception, "Not a catalog");
+		return -1;
+	}
+
+	c->rec = buf;
+	c->numdiscs = _snapshot_get32(buf + 4);
+	c->size = _snapshot_get64(buf + 8);
+
+	if (c->size > len || SNAPSHOT_CATALOG_HEADER_SIZE + 8 * (uint64_t)c->numdiscs > c->size)
+	{
+		PyErr_Format(PyExc_Exception, "Catalog is truncated or corrupt (%llu bytes, %zu available)", (unsigned long long)c->size, len);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+snapshot_catalog_disc(const SnapshotCatalog *c, uint32_t i, uint64_t *off)
+{
+	*off = _snapshot_get64(c->rec + SNAPSHOT_CATALOG_HEADER_SIZE + 8 * (size_t)i);
+
+	if (*off % 8 != 0 || *off < SNAPSHOT_CATALOG_HEADER_SIZE || *off >= c->size)
+	{
+		PyErr_Format(PyExc_Exception, "Catalog is corrupt, disc %u is at %llu of %llu bytes", i, (unsigned long long)*off, (unsigned long long)c->size);
+		return -1;
+	}
+
+	return 0;
+}
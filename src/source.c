@@ -0,0 +1,447 @@
+#include "bluread.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Block sources
+//
+// A BlockSource reads whole 2048 byte sectors of a disc, whatever holds it.
+// DiscFS parses UDF on top of one, so every backend gets file access for free.
+
+// --------------------------------------------------------------------------------
+// File descriptor source, for devices and image files
+
+static int
+_source_fd_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	size_t len = (size_t)num * DISC_SECTOR_SIZE;
+	size_t got = 0;
+
+	while (got < len)
+	{
+		ssize_t n = pread(src->fd, buf + got, len - got, (off_t)(lba * DISC_SECTOR_SIZE + got));
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		if (n == 0) break;
+		got += n;
+	}
+
+	return (int)(got / DISC_SECTOR_SIZE);
+}
+
+static void
+_source_fd_close(BlockSource *src)
+{
+	if (src->fd >= 0)
+	{
+		close(src->fd);
+	}
+	free(src);
+}
+
+BlockSource*
+source_open_fd(const char *path)
+{
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	if (src == NULL)
+	{
+		return NULL;
+	}
+
+	src->fd = open(path, O_RDONLY);
+	if (src->fd < 0)
+	{
+		free(src);
+		return NULL;
+	}
+
+	// lseek() gives the size of block devices as well as regular files
+	off_t size = lseek(src->fd, 0, SEEK_END);
+	if (size < 0)
+	{
+		int err = errno;
+		close(src->fd);
+		free(src);
+		errno = err;
+		return NULL;
+	}
+
+	src->blocks = (uint64_t)size / DISC_SECTOR_SIZE;
+	src->read = _source_fd_read;
+	src->close = _source_fd_close;
+
+	return src;
+}
+
+// --------------------------------------------------------------------------------
+// Memory mapped source, for image files
+//
+// Reads become memcpy()s out of the page cache, and DiscFS copies straight out of the
+// map so partial sectors need no bounce buffer.
+
+static int
+_source_map_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	if (lba >= src->blocks)
+	{
+		return 0;
+	}
+	if (num > src->blocks - lba)
+	{
+		num = (uint32_t)(src->blocks - lba);
+	}
+
+	memcpy(buf, src->map + lba * DISC_SECTOR_SIZE, (size_t)num * DISC_SECTOR_SIZE);
+	return (int)num;
+}
+
+static void
+_source_map_close(BlockSource *src)
+{
+	if (src->map)
+	{
+		munmap((void*)src->map, src->maplen);
+	}
+	if (src->fd >= 0)
+	{
+		close(src->fd);
+	}
+	free(src);
+}
+
+BlockSource*
+source_open_mmap(const char *path)
+{
+	struct stat st;
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	if (src == NULL)
+	{
+		return NULL;
+	}
+
+	src->fd = open(path, O_RDONLY);
+	if (src->fd < 0)
+	{
+		free(src);
+		return NULL;
+	}
+
+	// Only regular files, block devices cannot be mapped
+	if (fstat(src->fd, &st) < 0 || ! S_ISREG(st.st_mode) || st.st_size < DISC_SECTOR_SIZE)
+	{
+		close(src->fd);
+		free(src);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	src->maplen = (size_t)st.st_size;
+	void *map = mmap(NULL, src->maplen, PROT_READ, MAP_SHARED, src->fd, 0);
+	if (map == MAP_FAILED)
+	{
+		int err = errno;
+		close(src->fd);
+		free(src);
+		errno = err;
+		return NULL;
+	}
+
+	// Metadata reads hop around the file system, kernel read-around only wastes I/O on them.
+	// Stream files ask for read-ahead themselves through source_advise().
+	madvise(map, src->maplen, MADV_RANDOM);
+
+	src->map = map;
+	src->blocks = (uint64_t)st.st_size / DISC_SECTOR_SIZE;
+	src->read = _source_map_read;
+	src->close = _source_map_close;
+
+	return src;
+}
+
+// --------------------------------------------------------------------------------
+// Entering Python from a read
+//
+// Reads come from whichever thread is in libbluray, usually one that released the GIL.
+// The PyGILState API only knows the main interpreter, so a source remembers the interpreter
+// it was opened in and gets a thread state of that one instead.
+
+static PyThreadState*
+_source_current(void)
+{
+#if PY_VERSION_HEX >= 0x030D0000
+	return PyThreadState_GetUnchecked();
+#else
+	return _PyThreadState_UncheckedGet();
+#endif
+}
+
+// Returns what _source_leave() needs to put things back, NULL if this thread was already in
+static PyThreadState*
+_source_enter(BlockSource *src, PyThreadState **saved)
+{
+	*saved = NULL;
+
+	PyThreadState *cur = _source_current();
+	if (cur != NULL)
+	{
+		if (PyThreadState_GetInterpreter(cur) == src->interp)
+		{
+			return NULL;
+		}
+		*saved = PyEval_SaveThread();
+	}
+
+	PyThreadState *ts = PyThreadState_New(src->interp);
+	PyEval_RestoreThread(ts);
+	return ts;
+}
+
+static void
+_source_leave(PyThreadState *ts, PyThreadState *saved)
+{
+	if (ts == NULL)
+	{
+		return;
+	}
+
+	PyThreadState_Clear(ts);
+	PyThreadState_DeleteCurrent();
+
+	if (saved != NULL)
+	{
+		PyEval_RestoreThread(saved);
+	}
+}
+
+// --------------------------------------------------------------------------------
+// Python buffer source, for images already in memory
+//
+// The exported buffer is used in place, the same as a memory map.
+
+static void
+_source_buffer_close(BlockSource *src)
+{
+	PyThreadState *saved;
+	PyThreadState *ts = _source_enter(src, &saved);
+	PyBuffer_Release(src->handle);
+	_source_leave(ts, saved);
+
+	free(src->handle);
+	free(src);
+}
+
+// Called with the GIL held
+BlockSource*
+source_open_buffer(PyObject *obj)
+{
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	Py_buffer *view = calloc(1, sizeof(Py_buffer));
+	if (src == NULL || view == NULL)
+	{
+		free(src);
+		free(view);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	if (PyObject_GetBuffer(obj, view, PyBUF_SIMPLE) < 0)
+	{
+		free(src);
+		free(view);
+		return NULL;
+	}
+
+	src->handle = view;
+	src->fd = -1;
+	src->interp = PyInterpreterState_Get();
+	src->map = view->buf;
+	src->maplen = (size_t)view->len;
+	src->blocks = (uint64_t)view->len / DISC_SECTOR_SIZE;
+	src->read = _source_map_read;
+	src->close = _source_buffer_close;
+
+	return src;
+}
+
+// --------------------------------------------------------------------------------
+// Python file-like source, for seekable streams
+//
+// Every read takes the GIL and calls seek() and readinto() (or read()) on the object.
+// source_open_pyfile() puts a block cache in front so that is not done per sector.
+
+static int
+_source_pyfile_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	PyObject *obj = src->handle;
+	size_t len = (size_t)num * DISC_SECTOR_SIZE;
+	size_t got = 0;
+
+	PyThreadState *saved;
+	PyThreadState *ts = _source_enter(src, &saved);
+
+	PyObject *r = PyObject_CallMethod(obj, "seek", "K", (unsigned long long)(lba * DISC_SECTOR_SIZE));
+	if (r == NULL)
+	{
+		goto error;
+	}
+	Py_DECREF(r);
+
+	while (got < len)
+	{
+		Py_ssize_t n;
+
+		if (PyObject_HasAttrString(obj, "readinto"))
+		{
+			PyObject *mv = PyMemoryView_FromMemory((char*)buf + got, len - got, PyBUF_WRITE);
+			if (mv == NULL)
+			{
+				goto error;
+			}
+			r = PyObject_CallMethod(obj, "readinto", "O", mv);
+			Py_DECREF(mv);
+			if (r == NULL)
+			{
+				goto error;
+			}
+			n = (r == Py_None) ? 0 : PyLong_AsSsize_t(r);
+			Py_DECREF(r);
+		}
+		else
+		{
+			r = PyObject_CallMethod(obj, "read", "n", (Py_ssize_t)(len - got));
+			if (r == NULL)
+			{
+				goto error;
+			}
+
+			char *data;
+			if (PyBytes_AsStringAndSize(r, &data, &n) < 0)
+			{
+				Py_DECREF(r);
+				goto error;
+			}
+			if ((size_t)n > len - got)
+			{
+				n = len - got;
+			}
+			memcpy(buf + got, data, n);
+			Py_DECREF(r);
+		}
+
+		if (n < 0)
+		{
+			goto error;
+		}
+		if (n == 0)
+		{
+			break;
+		}
+		got += n;
+	}
+
+	_source_leave(ts, saved);
+	return (int)(got / DISC_SECTOR_SIZE);
+
+error:
+	// Nobody up the stack can take a Python exception, so report it here
+	PyErr_WriteUnraisable(obj);
+	_source_leave(ts, saved);
+	errno = EIO;
+	return -1;
+}
+
+static void
+_source_pyfile_close(BlockSource *src)
+{
+	PyThreadState *saved;
+	PyThreadState *ts = _source_enter(src, &saved);
+	Py_DECREF((PyObject*)src->handle);
+	_source_leave(ts, saved);
+
+	free(src);
+}
+
+// Called with the GIL held
+BlockSource*
+source_open_pyfile(PyObject *obj, size_t cachebytes)
+{
+	PyObject *r = PyObject_CallMethod(obj, "seek", "ii", 0, SEEK_END);
+	if (r == NULL)
+	{
+		return NULL;
+	}
+	unsigned long long size = PyLong_AsUnsignedLongLong(r);
+	Py_DECREF(r);
+	if (PyErr_Occurred())
+	{
+		return NULL;
+	}
+
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	if (src == NULL)
+	{
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	Py_INCREF(obj);
+	src->handle = obj;
+	src->fd = -1;
+	src->interp = PyInterpreterState_Get();
+	src->blocks = size / DISC_SECTOR_SIZE;
+	src->read = _source_pyfile_read;
+	src->close = _source_pyfile_close;
+
+	BlockSource *cached = source_cache(src, cachebytes);
+	if (cached == NULL)
+	{
+		PyErr_NoMemory();
+	}
+	return cached;
+}
+
+// --------------------------------------------------------------------------------
+// Generic interface
+
+int
+source_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	return src->read(src, buf, lba, num);
+}
+
+void
+source_close(BlockSource *src)
+{
+	if (src)
+	{
+		src->close(src);
+	}
+}
+
+// Hint that @num sectors from @lba will be read soon
+void
+source_willneed(BlockSource *src, uint64_t lba, uint64_t num)
+{
+	if (lba >= src->blocks)
+	{
+		return;
+	}
+	if (num > src->blocks - lba)
+	{
+		num = src->blocks - lba;
+	}
+
+	if (src->map)
+	{
+		// madvise() wants a page aligned start
+		uint64_t start = lba * DISC_SECTOR_SIZE;
+		uint64_t align = start % (uint64_t)sysconf(_SC_PAGESIZE);
+		madvise((void*)(src->map + start - align), num * DISC_SECTOR_SIZE + align, MADV_WILLNEED);
+	}
+	else if (src->fd >= 0)
+	{
+		posix_fadvise(src->fd, (off_t)(lba * DISC_SECTOR_SIZE), (off_t)(num * DISC_SECTOR_SIZE), POSIX_FADV_WILLNEED);
+	}
+}
@@ -0,0 +1,277 @@
+#include "bluread.h"
+
+#include <time.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Latency counters
+//
+// Every libbluray call and object construction in bluread.c is timed into the StatSet
+// of its Bluray and into one for the whole module.  Timing is off unless EnableStats() or
+// the BLUREAD_STATS environment variable turns it on; while off the only cost is testing
+// stats_enabled.  Reads run with the GIL released from copy threads, and on the free-threaded
+// build every call can, so the counters are updated with relaxed atomics rather than under a lock.
+//
+// Histogram bucket 0 counts calls under 1 us, bucket i those from 2^(i-1) to 2^i us.
+
+int stats_enabled = 0;
+
+static StatSet stats_global;
+
+static const char *stats_names[STAT_COUNT] = {
+	"bd_init",
+	"bd_open_disc",
+	"bd_open_files",
+	"bd_get_disc_info",
+	"bd_get_titles",
+	"bd_get_main_title",
+	"bd_get_title_info",
+	"bd_free_title_info",
+	"bd_select_title",
+	"bd_get_title_size",
+	"bd_seek",
+	"bd_seek_time",
+	"bd_read",
+	"bd_close",
+	"Bluray",
+	"Title",
+	"Chapter",
+	"Clip",
+	"Video",
+	"Audio",
+	"Subtitle",
+};
+
+uint64_t
+stats_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	// Never 0, which STATS_END() takes as not timed
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec + 1;
+}
+
+static void
+_stats_add(StatCounter *c, uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int bucket = 0;
+	while (us > 0 && bucket < STATS_BUCKETS - 1)
+	{
+		us >>= 1;
+		bucket++;
+	}
+
+	__atomic_fetch_add(&c->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&c->total, ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&c->buckets[bucket], 1, __ATOMIC_RELAXED);
+
+	uint64_t old = __atomic_load_n(&c->min, __ATOMIC_RELAXED);
+	while ((old == 0 || ns < old) && !__atomic_compare_exchange_n(&c->min, &old, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+
+	old = __atomic_load_n(&c->max, __ATOMIC_RELAXED);
+	while (ns > old && !__atomic_compare_exchange_n(&c->max, &old, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+}
+
+void
+stats_record(StatSet *set, int id, uint64_t start)
+{
+	uint64_t ns = stats_now() - start;
+
+	if (set != NULL)
+	{
+		_stats_add(&set->c[id], ns);
+	}
+	_stats_add(&stats_global.c[id], ns);
+}
+
+void
+stats_reset(StatSet *set)
+{
+	memset(set ? set : &stats_global, 0, sizeof(StatSet));
+}
+
+// One counter as {Count, Seconds, Mean, Min, Max, Histogram}, the histogram holding only
+// the buckets with calls as (upper bound in us, count)
+static PyObject*
+_stats_counter(const StatCounter *c)
+{
+	PyObject *hist = PyList_New(0);
+	int b;
+
+	for (b = 0; hist != NULL && b < STATS_BUCKETS; b++)
+	{
+		if (c->buckets[b] == 0)
+		{
+			continue;
+		}
+
+		PyObject *t = Py_BuildValue("(KK)", 1ULL << b, (unsigned long long)c->buckets[b]);
+		if (t == NULL || PyList_Append(hist, t) < 0)
+		{
+			Py_CLEAR(hist);
+		}
+		Py_XDECREF(t);
+	}
+	if (hist == NULL)
+	{
+		return NULL;
+	}
+
+	return Py_BuildValue("{s:K,s:d,s:d,s:d,s:d,s:N}",
+		"Count", (unsigned long long)c->count,
+		"Seconds", c->total / 1e9,
+		"Mean", c->count ? c->total / 1e9 / c->count : 0.0,
+		"Min", c->min / 1e9,
+		"Max", c->max / 1e9,
+		"Histogram", hist);
+}
+
+PyObject*
+stats_topython(const StatSet *set)
+{
+	PyObject *dict = PyDict_New();
+	int i;
+
+	if (dict == NULL)
+	{
+		return NULL;
+	}
+	if (set == NULL)
+	{
+		set = &stats_global;
+	}
+
+	for (i = 0; i < STAT_COUNT; i++)
+	{
+		if (set->c[i].count == 0)
+		{
+			continue;
+		}
+
+		PyObject *v = _stats_counter(&set->c[i]);
+		if (v == NULL || PyDict_SetItemString(dict, stats_names[i], v) < 0)
+		{
+			Py_XDECREF(v);
+			Py_DECREF(dict);
+			return NULL;
+		}
+		Py_DECREF(v);
+	}
+
+	return dict;
+}
+
+PyObject*
+BluRead_Stats(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	int reset = 0;
+	static char *kwlist[] = {"Reset", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|p", kwlist, &reset))
+	{
+		return NULL;
+	}
+
+	PyObject *ret = stats_topython(NULL);
+	if (ret != NULL && reset)
+	{
+		stats_reset(NULL);
+	}
+
+	return ret;
+}
+
+PyObject*
+BluRead_EnableStats(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	int enable = 1;
+	static char *kwlist[] = {"Enable", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "|p", kwlist, &enable))
+	{
+		return NULL;
+	}
+
+	return PyBool_FromLong(__atomic_exchange_n(&stats_enabled, enable, __ATOMIC_RELAXED));
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Process metrics
+//
+// Unlike the latency counters these are always kept, they are bumped once per open, title,
+// copy or cache lookup rather than per libbluray call.  They only ever grow, as Prometheus
+// expects of counters; bluread.metrics renders them in its text format.
+
+static uint64_t metrics[METRIC_COUNT];
+static StatCounter metrics_openlatency;
+
+static const char *metrics_names[METRIC_COUNT] = {
+	"Opens",
+	"OpenFailures",
+	"Titles",
+	"BytesRead",
+	"BytesImaged",
+	"ReadErrors",
+	"Retries",
+	"CacheHits",
+	"CacheMisses",
+	"CacheEvictions",
+};
+
+void
+metrics_add(int id, uint64_t n)
+{
+	__atomic_fetch_add(&metrics[id], n, __ATOMIC_RELAXED);
+}
+
+void
+metrics_open(uint64_t start, int ok)
+{
+	if (ok)
+	{
+		_stats_add(&metrics_openlatency, stats_now() - start);
+		metrics_add(METRIC_OPENS, 1);
+	}
+	else
+	{
+		metrics_add(METRIC_OPEN_FAILURES, 1);
+	}
+}
+
+PyObject*
+BluRead_Metrics(PyObject *self, PyObject *unused)
+{
+	PyObject *dict = PyDict_New();
+	int i;
+
+	if (dict == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < METRIC_COUNT; i++)
+	{
+		PyObject *v = PyLong_FromUnsignedLongLong(__atomic_load_n(&metrics[i], __ATOMIC_RELAXED));
+		if (v == NULL || PyDict_SetItemString(dict, metrics_names[i], v) < 0)
+		{
+			Py_XDECREF(v);
+			Py_DECREF(dict);
+			return NULL;
+		}
+		Py_DECREF(v);
+	}
+
+	PyObject *v = _stats_counter(&metrics_openlatency);
+	if (v == NULL || PyDict_SetItemString(dict, "OpenLatency", v) < 0)
+	{
+		Py_XDECREF(v);
+		Py_DECREF(dict);
+		return NULL;
+	}
+	Py_DECREF(v);
+
+	return dict;
+}
@@ -0,0 +1,349 @@
+#include "bluread.h"
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// BDAV (M2TS) packet scanning
+//
+// A BDAV packet is a 4 byte TP_extra_header followed by a 188 byte transport packet.
+// The transport packet starts with the 0x47 sync byte and the 13-bit PID is in the
+// two bytes after it, so the interesting bytes of every packet are at offsets 4..6.
+// The vector kernels gather those bytes from several packets at once, the scalar
+// kernel is the reference and handles any tail that does not fill a vector.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TSSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static inline uint32_t
+_tsscan_load32(const uint8_t *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// Account for a single packet whose header word (bytes 4..7 of the BDAV packet) is @w
+static inline void
+_tsscan_one(TSScanResult *r, uint32_t w, uint64_t offset)
+{
+	if ((w & 0xFF) != TS_SYNC_BYTE)
+	{
+		if (r->bad_sync == 0)
+		{
+			r->first_bad = (int64_t)offset;
+		}
+		r->bad_sync++;
+		return;
+	}
+
+	r->pids[(w & 0x1F00) | ((w >> 16) & 0xFF)]++;
+}
+
+static void
+_tsscan_scalar(TSScanResult *r, const uint8_t *buf, size_t npkts, uint64_t base)
+{
+	size_t i;
+	for (i = 0; i < npkts; i++)
+	{
+		const uint8_t *p = buf + i*BDAV_PACKET_SIZE;
+
+		// Reads bytes individually so this is endian neutral, unlike the vector kernels
+		uint32_t w = p[4] | (p[5] << 8) | (p[6] << 16);
+		_tsscan_one(r, w, base + i*BDAV_PACKET_SIZE);
+	}
+}
+
+#ifdef TSSCAN_X86
+
+__attribute__((target("sse4.1")))
+static void
+_tsscan_sse4(TSScanResult *r, const uint8_t *buf, size_t npkts, uint64_t base)
+{
+	const __m128i sync = _mm_set1_epi32(TS_SYNC_BYTE);
+	const __m128i lowbyte = _mm_set1_epi32(0xFF);
+	const __m128i pidhi = _mm_set1_epi32(0x1F00);
+	uint32_t pids[4];
+	size_t i, k;
+
+	for (i = 0; i + 4 <= npkts; i += 4)
+	{
+		const uint8_t *p = buf + i*BDAV_PACKET_SIZE + 4;
+
+		__m128i w = _mm_cvtsi32_si128((int)_tsscan_load32(p));
+		w = _mm_insert_epi32(w, (int)_tsscan_load32(p + 1*BDAV_PACKET_SIZE), 1);
+		w = _mm_insert_epi32(w, (int)_tsscan_load32(p + 2*BDAV_PACKET_SIZE), 2);
+		w = _mm_insert_epi32(w, (int)_tsscan_load32(p + 3*BDAV_PACKET_SIZE), 3);
+
+		__m128i ok = _mm_cmpeq_epi32(_mm_and_si128(w, lowbyte), sync);
+		__m128i pid = _mm_or_si128(_mm_and_si128(w, pidhi), _mm_and_si128(_mm_srli_epi32(w, 16), lowbyte));
+		_mm_storeu_si128((__m128i*)pids, pid);
+
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(ok));
+		if (mask == 0xF)
+		{
+			r->pids[pids[0]]++;
+			r->pids[pids[1]]++;
+			r->pids[pids[2]]++;
+			r->pids[pids[3]]++;
+		}
+		else
+		{
+			for (k = 0; k < 4; k++)
+			{
+				_tsscan_one(r, _tsscan_load32(p + k*BDAV_PACKET_SIZE), base + (i+k)*BDAV_PACKET_SIZE);
+			}
+		}
+	}
+
+	_tsscan_scalar(r, buf + i*BDAV_PACKET_SIZE, npkts - i, base + i*BDAV_PACKET_SIZE);
+}
+
+__attribute__((target("avx2")))
+static void
+_tsscan_avx2(TSScanResult *r, const uint8_t *buf, size_t npkts, uint64_t base)
+{
+	const __m256i idx = _mm256_setr_epi32(
+		0*BDAV_PACKET_SIZE + 4, 1*BDAV_PACKET_SIZE + 4, 2*BDAV_PACKET_SIZE + 4, 3*BDAV_PACKET_SIZE + 4,
+		4*BDAV_PACKET_SIZE + 4, 5*BDAV_PACKET_SIZE + 4, 6*BDAV_PACKET_SIZE + 4, 7*BDAV_PACKET_SIZE + 4);
+	const __m256i sync = _mm256_set1_epi32(TS_SYNC_BYTE);
+	const __m256i lowbyte = _mm256_set1_epi32(0xFF);
+	const __m256i pidhi = _mm256_set1_epi32(0x1F00);
+	uint32_t pids[8];
+	size_t i, k;
+
+	for (i = 0; i + 8 <= npkts; i += 8)
+	{
+		const uint8_t *p = buf + i*BDAV_PACKET_SIZE;
+
+		__m256i w = _mm256_i32gather_epi32((const int*)p, idx, 1);
+		__m256i ok = _mm256_cmpeq_epi32(_mm256_and_si256(w, lowbyte), sync);
+		__m256i pid = _mm256_or_si256(_mm256_and_si256(w, pidhi), _mm256_and_si256(_mm256_srli_epi32(w, 16), lowbyte));
+		_mm256_storeu_si256((__m256i*)pids, pid);
+
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(ok));
+		if (mask == 0xFF)
+		{
+			for (k = 0; k < 8; k++)
+			{
+				r->pids[pids[k]]++;
+			}
+		}
+		else
+		{
+			for (k = 0; k < 8; k++)
+			{
+				_tsscan_one(r, _tsscan_load32(p + k*BDAV_PACKET_SIZE + 4), base + (i+k)*BDAV_PACKET_SIZE);
+			}
+		}
+	}
+
+	_tsscan_scalar(r, buf + i*BDAV_PACKET_SIZE, npkts - i, base + i*BDAV_PACKET_SIZE);
+}
+
+#endif // TSSCAN_X86
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Kernel dispatch
+
+typedef void (*tsscan_kernel)(TSScanResult*, const uint8_t*, size_t, uint64_t);
+
+typedef struct {
+	const char *name;
+	tsscan_kernel func;
+} TSScanKernel;
+
+static const TSScanKernel tsscan_kernels[] = {
+#ifdef TSSCAN_X86
+	{"avx2", _tsscan_avx2},
+	{"sse4", _tsscan_sse4},
+#endif
+	{"scalar", _tsscan_scalar},
+	{NULL, NULL}
+};
+
+// Best kernel supported by this CPU, picked once by tsscan_init()
+static const TSScanKernel *tsscan_best = NULL;
+
+static int
+_tsscan_supported(const TSScanKernel *k)
+{
+#ifdef TSSCAN_X86
+	if (strcmp(k->name, "avx2") == 0)	return __builtin_cpu_supports("avx2");
+	if (strcmp(k->name, "sse4") == 0)	return __builtin_cpu_supports("sse4.1");
+#endif
+	return 1;
+}
+
+void
+tsscan_init(void)
+{
+	const TSScanKernel *k;
+
+#ifdef TSSCAN_X86
+	__builtin_cpu_init();
+#endif
+
+	for (k = tsscan_kernels; k->name; k++)
+	{
+		if (_tsscan_supported(k))
+		{
+			tsscan_best = k;
+			return;
+		}
+	}
+}
+
+const char*
+tsscan_kernel_name(void)
+{
+	return tsscan_best ? tsscan_best->name : "scalar";
+}
+
+void
+tsscan_reset(TSScanResult *r)
+{
+	memset(r, 0, sizeof(*r));
+	r->first_bad = -1;
+}
+
+int
+tsscan_run(TSScanResult *r, const uint8_t *buf, size_t len, const char *kernel)
+{
+	tsscan_kernel func = tsscan_best ? tsscan_best->func : _tsscan_scalar;
+	size_t npkts = len / BDAV_PACKET_SIZE;
+
+	if (kernel != NULL)
+	{
+		const TSScanKernel *k;
+		for (k = tsscan_kernels; k->name; k++)
+		{
+			if (strcmp(k->name, kernel) == 0) break;
+		}
+		if (k->name == NULL || !_tsscan_supported(k))
+		{
+			return -1;
+		}
+		func = k->func;
+	}
+
+	// Offsets reported for bad packets are relative to everything scanned into @r so far
+	func(r, buf, npkts, r->bytes);
+
+	r->packets += npkts;
+	r->bytes += npkts * BDAV_PACKET_SIZE;
+
+	return 0;
+}
+
+void
+tsscan_feed(TSScanStream *s, const uint8_t *buf, size_t len)
+{
+	// Complete the packet the last piece ended in the middle of
+	if (s->carried > 0)
+	{
+		size_t n = BDAV_PACKET_SIZE - s->carried;
+		if (n > len)
+		{
+			n = len;
+		}
+		memcpy(s->carry + s->carried, buf, n);
+		s->carried += n;
+		buf += n;
+		len -= n;
+
+		if (s->carried < BDAV_PACKET_SIZE)
+		{
+			return;
+		}
+		tsscan_run(&s->result, s->carry, BDAV_PACKET_SIZE, NULL);
+		s->carried = 0;
+	}
+
+	size_t whole = len - len % BDAV_PACKET_SIZE;
+	tsscan_run(&s->result, buf, whole, NULL);
+
+	memcpy(s->carry, buf + whole, len - whole);
+	s->carried = len - whole;
+}
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Python interface
+
+PyObject*
+tsscan_topython(const TSScanResult *r, Py_ssize_t remainder)
+{
+	PyObject *pids = PyDict_New();
+	if (pids == NULL)
+	{
+		return NULL;
+	}
+
+	int pid;
+	for (pid = 0; pid < TS_PID_COUNT; pid++)
+	{
+		if (r->pids[pid] == 0) continue;
+
+		PyObject *k = PyLong_FromLong(pid);
+		PyObject *v = PyLong_FromUnsignedLongLong(r->pids[pid]);
+		if (k == NULL || v == NULL || PyDict_SetItem(pids, k, v) < 0)
+		{
+			Py_XDECREF(k);
+			Py_XDECREF(v);
+			Py_DECREF(pids);
+			return NULL;
+		}
+		Py_DECREF(k);
+		Py_DECREF(v);
+	}
+
+	return Py_BuildValue("{s:K,s:K,s:L,s:n,s:N}",
+		"Packets", (unsigned long long)r->packets,
+		"BadSync", (unsigned long long)r->bad_sync,
+		"FirstBadOffset", (long long)r->first_bad,
+		"Remainder", remainder,
+		"PIDs", pids);
+}
+
+PyObject*
+BluRead_ScanPackets(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	Py_buffer view;
+	const char *kernel = NULL;
+	static char *kwlist[] = {"Data", "Kernel", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "y*|z", kwlist, &view, &kernel))
+	{
+		return NULL;
+	}
+
+	TSScanResult *r = PyMem_Malloc(sizeof(TSScanResult));
+	if (r == NULL)
+	{
+		PyBuffer_Release(&view);
+		return PyErr_NoMemory();
+	}
+	tsscan_reset(r);
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = tsscan_run(r, (const uint8_t*)view.buf, (size_t)view.len, kernel);
+	Py_END_ALLOW_THREADS
+
+	Py_ssize_t remainder = view.len % BDAV_PACKET_SIZE;
+	PyBuffer_Release(&view);
+
+	if (ret < 0)
+	{
+		PyMem_Free(r);
+		PyErr_Format(PyExc_ValueError, "Packet scan kernel '%s' is unknown or not supported by this CPU", kernel);
+		return NULL;
+	}
+
+	PyObject *result = tsscan_topython(r, remainder);
+	PyMem_Free(r);
+
+	return result;
+}
@@ -0,0 +1,503 @@
+#include "bluread.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Image verification
+//
+// The device is re-read in large chunks by the calling thread, in offset order so the
+// drive streams, and a pool of threads compares every chunk against the image through a
+// memory map.  A chunk that differs is compared again a sector at a time and the sectors
+// that differ are collected as ranges, so a retry only has to read those again.  Chunks
+// the drive fails to read are kept apart from the ones that differ.
+//
+// Sampled verification compares @samples chunks spread evenly over the disc instead of
+// all of it, taken from the middle of equal parts like the fingerprint samples.
+
+#define VERIFY_BUFS_PER_THREAD 2
+#define VERIFY_MAXTHREADS 64
+
+enum { VBUF_FREE, VBUF_FILLED, VBUF_BUSY };
+
+typedef struct {
+	int state;
+	uint8_t *data;
+	uint64_t offset;
+	size_t want;
+	size_t len;  // bytes the device returned
+	int err;     // errno of a failed read
+} VerifyBuf;
+
+typedef struct {
+	SectorRange *ranges;
+	size_t num, max;
+} RangeList;
+
+typedef struct {
+	const uint8_t *map;
+	uint64_t mapsize;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	VerifyBuf *bufs;
+	unsigned numbufs;
+	uint64_t filled; // buffers handed to the threads, in order
+	uint64_t taken;
+	int stop;
+
+	RangeList mismatch;
+	RangeList unreadable;
+	int err;
+} Verifier;
+
+static int
+_verify_add(RangeList *l, uint64_t lba, uint64_t count)
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	if (l->num == l->max)
+	{
+		size_t n = l->max ? l->max * 2 : 64;
+		SectorRange *tmp = realloc(l->ranges, n * sizeof(SectorRange));
+		if (tmp == NULL)
+		{
+			return -1;
+		}
+		l->ranges = tmp;
+		l->max = n;
+	}
+
+	l->ranges[l->num].lba = lba;
+	l->ranges[l->num].count = count;
+	l->num++;
+
+	return 0;
+}
+
+static int
+_verify_cmprange(const void *a, const void *b)
+{
+	const SectorRange *x = a, *y = b;
+	return (x->lba > y->lba) - (x->lba < y->lba);
+}
+
+// Chunks finish in any order, sort the ranges and join the ones that touch
+static void
+_verify_merge(RangeList *l)
+{
+	size_t i, n = 0;
+
+	qsort(l->ranges, l->num, sizeof(SectorRange), _verify_cmprange);
+	for (i = 0; i < l->num; i++)
+	{
+		if (n > 0 && l->ranges[n-1].lba + l->ranges[n-1].count >= l->ranges[i].lba)
+		{
+			uint64_t end = l->ranges[i].lba + l->ranges[i].count;
+			if (end > l->ranges[n-1].lba + l->ranges[n-1].count)
+			{
+				l->ranges[n-1].count = end - l->ranges[n-1].lba;
+			}
+			continue;
+		}
+		l->ranges[n++] = l->ranges[i];
+	}
+	l->num = n;
+}
+
+// Compares one chunk into @bad and @unread, which the caller merges under the lock once per chunk
+static int
+_verify_chunk(Verifier *v, const VerifyBuf *b, RangeList *bad, RangeList *unread)
+{
+	uint64_t first = b->offset / DISC_SECTOR_SIZE;
+
+	if (b->err)
+	{
+		return _verify_add(unread, first, (b->want + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE);
+	}
+
+	// The device ended before the size being verified
+	if (b->len < b->want)
+	{
+		uint64_t from = (b->offset + b->len) / DISC_SECTOR_SIZE;
+		if (_verify_add(unread, from, first + (b->want + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE - from) < 0) return -1;
+	}
+
+	// Whatever the image lacks differs
+	size_t have = 0;
+	if (b->offset < v->mapsize)
+	{
+		have = (v->mapsize - b->offset < b->len) ? (size_t)(v->mapsize - b->offset) : b->len;
+	}
+	if (have < b->len)
+	{
+		uint64_t from = (b->offset + have) / DISC_SECTOR_SIZE;
+		if (_verify_add(bad, from, (b->offset + b->len + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE - from) < 0) return -1;
+	}
+
+	if (have == 0 || memcmp(b->data, v->map + b->offset, have) == 0)
+	{
+		return 0;
+	}
+
+	size_t pos;
+	uint64_t runstart = 0, runlen = 0;
+	for (pos = 0; pos < have; pos += DISC_SECTOR_SIZE)
+	{
+		size_t n = (have - pos < DISC_SECTOR_SIZE) ? have - pos : DISC_SECTOR_SIZE;
+		if (memcmp(b->data + pos, v->map + b->offset + pos, n) == 0)
+		{
+			continue;
+		}
+
+		uint64_t lba = (b->offset + pos) / DISC_SECTOR_SIZE;
+		if (runlen > 0 && runstart + runlen == lba)
+		{
+			runlen++;
+			continue;
+		}
+		if (_verify_add(bad, runstart, runlen) < 0) return -1;
+		runstart = lba;
+		runlen = 1;
+	}
+
+	return _verify_add(bad, runstart, runlen);
+}
+
+static void*
+_verify_worker(void *arg)
+{
+	Verifier *v = arg;
+	RangeList bad, unread;
+	size_t i;
+
+	memset(&bad, 0, sizeof(bad));
+	memset(&unread, 0, sizeof(unread));
+
+	pthread_mutex_lock(&v->lock);
+	while (1)
+	{
+		while (v->taken == v->filled && !v->stop)
+		{
+			pthread_cond_wait(&v->cond, &v->lock);
+		}
+		if (v->taken == v->filled)
+		{
+			break;
+		}
+
+		VerifyBuf *b = &v->bufs[v->taken % v->numbufs];
+		v->taken++;
+		b->state = VBUF_BUSY;
+		pthread_mutex_unlock(&v->lock);
+
+		bad.num = 0;
+		unread.num = 0;
+		int ret = _verify_chunk(v, b, &bad, &unread);
+
+		pthread_mutex_lock(&v->lock);
+		for (i = 0; i < bad.num && ret == 0; i++)
+		{
+			ret = _verify_add(&v->mismatch, bad.ranges[i].lba, bad.ranges[i].count);
+		}
+		for (i = 0; i < unread.num && ret == 0; i++)
+		{
+			ret = _verify_add(&v->unreadable, unread.ranges[i].lba, unread.ranges[i].count);
+		}
+		if (ret < 0 && v->err == 0)
+		{
+			v->err = ENOMEM;
+		}
+		b->state = VBUF_FREE;
+		pthread_cond_broadcast(&v->cond);
+	}
+	pthread_mutex_unlock(&v->lock);
+
+	free(bad.ranges);
+	free(unread.ranges);
+	return NULL;
+}
+
+int
+verify_run(VerifyJob *job)
+{
+	Verifier v;
+	pthread_t threads[VERIFY_MAXTHREADS];
+	int numthreads = 0;
+	unsigned i;
+	int fd = -1;
+	struct stat st;
+
+	memset(&v, 0, sizeof(v));
+	job->err = 0;
+	job->bytes = 0;
+	pthread_mutex_init(&v.lock, NULL);
+	pthread_cond_init(&v.cond, NULL);
+
+	double start = copy_now();
+
+	fd = open(job->image, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0)
+	{
+		job->err = errno;
+		goto cleanup;
+	}
+	v.mapsize = st.st_size;
+	if (v.mapsize > 0)
+	{
+		void *map = mmap(NULL, v.mapsize, PROT_READ, MAP_SHARED, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			job->err = errno;
+			goto cleanup;
+		}
+		v.map = map;
+		madvise(map, v.mapsize, job->samples ? MADV_RANDOM : MADV_SEQUENTIAL);
+	}
+
+	uint64_t size = job->size ? job->size : v.mapsize;
+	uint64_t sectors = (size + DISC_SECTOR_SIZE - 1) / DISC_SECTOR_SIZE;
+	uint64_t chunks = (size + job->chunk - 1) / job->chunk;
+	uint64_t n = (job->samples > 0 && (uint64_t)job->samples < chunks) ? (uint64_t)job->samples : chunks;
+	job->size = size;
+	job->sampled = (n < chunks);
+
+	v.numbufs = job->threads * VERIFY_BUFS_PER_THREAD;
+	v.bufs = calloc(v.numbufs, sizeof(VerifyBuf));
+	if (v.bufs == NULL)
+	{
+		job->err = ENOMEM;
+		goto cleanup;
+	}
+	for (i = 0; i < v.numbufs; i++)
+	{
+		v.bufs[i].data = malloc(job->chunk);
+		if (v.bufs[i].data == NULL)
+		{
+			job->err = ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	while (numthreads < job->threads && pthread_create(&threads[numthreads], NULL, _verify_worker, &v) == 0)
+	{
+		numthreads++;
+	}
+	if (numthreads == 0)
+	{
+		job->err = EAGAIN;
+		goto cleanup;
+	}
+
+	uint64_t s;
+	for (s = 0; s < n && job->err == 0; s++)
+	{
+		// Sampled chunks start on a sector in the middle of each of @n equal parts
+		uint64_t offset = (n == chunks) ? s * job->chunk : (sectors * (2*s + 1) / (2*n)) * DISC_SECTOR_SIZE;
+		if (n < chunks && offset + job->chunk > size)
+		{
+			offset = size > job->chunk ? (size - job->chunk) / DISC_SECTOR_SIZE * DISC_SECTOR_SIZE : 0;
+		}
+
+		VerifyBuf *b = &v.bufs[v.filled % v.numbufs];
+		pthread_mutex_lock(&v.lock);
+		while (b->state != VBUF_FREE)
+		{
+			pthread_cond_wait(&v.cond, &v.lock);
+		}
+		pthread_mutex_unlock(&v.lock);
+
+		b->offset = offset;
+		b->want = (size - offset < job->chunk) ? (size_t)(size - offset) : job->chunk;
+		b->len = 0;
+		b->err = 0;
+
+		int64_t got = job->read(job->handle, b->data, b->want, offset);
+		if (got < 0)
+		{
+			b->err = errno ? errno : EIO;
+			metrics_add(METRIC_READ_ERRORS, 1);
+		}
+		else
+		{
+			b->len = got;
+			job->bytes += got;
+		}
+
+		pthread_mutex_lock(&v.lock);
+		b->state = VBUF_FILLED;
+		v.filled++;
+		pthread_cond_broadcast(&v.cond);
+		if (v.err) job->err = v.err;
+		pthread_mutex_unlock(&v.lock);
+	}
+
+cleanup:
+	pthread_mutex_lock(&v.lock);
+	v.stop = 1;
+	pthread_cond_broadcast(&v.cond);
+	pthread_mutex_unlock(&v.lock);
+
+	for (i = 0; i < (unsigned)numthreads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	if (v.err && job->err == 0)
+	{
+		job->err = v.err;
+	}
+
+	_verify_merge(&v.mismatch);
+	_verify_merge(&v.unreadable);
+	job->mismatch = v.mismatch.ranges;
+	job->nummismatch = v.mismatch.num;
+	job->unreadable = v.unreadable.ranges;
+	job->numunreadable = v.unreadable.num;
+
+	job->seconds = copy_now() - start;
+	metrics_add(METRIC_BYTES_READ, job->bytes);
+
+	for (i = 0; v.bufs && i < v.numbufs; i++)
+	{
+		free(v.bufs[i].data);
+	}
+	free(v.bufs);
+	if (v.map) munmap((void*)v.map, v.mapsize);
+	if (fd >= 0) close(fd);
+	pthread_cond_destroy(&v.cond);
+	pthread_mutex_destroy(&v.lock);
+
+	return job->err ? -1 : 0;
+}
+
+void
+verify_free(VerifyJob *job)
+{
+	free(job->mismatch);
+	free(job->unreadable);
+	job->mismatch = NULL;
+	job->unreadable = NULL;
+}
+
+static PyObject*
+_verify_ranges(const SectorRange *r, size_t n, uint64_t *sectors)
+{
+	PyObject *list = PyList_New(n);
+	size_t i;
+
+	*sectors = 0;
+	if (list == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		PyObject *t = Py_BuildValue("(KK)", (unsigned long long)r[i].lba, (unsigned long long)r[i].count);
+		if (t == NULL)
+		{
+			Py_DECREF(list);
+			return NULL;
+		}
+		PyList_SET_ITEM(list, i, t);
+		*sectors += r[i].count;
+	}
+
+	return list;
+}
+
+PyObject*
+BluRead_Verify(PyObject *self, PyObject *args, PyObject *kwds)
+{
+	const char *src=NULL, *image=NULL;
+	unsigned long long size=0;
+	int threads=4, samples=0;
+	Py_ssize_t chunk=COPY_CHUNK_SIZE;
+	static char *kwlist[] = {"Source", "Image", "Size", "Threads", "ChunkSize", "Samples", NULL};
+
+	if (! PyArg_ParseTupleAndKeywords(args,kwds, "ss|Kini", kwlist, &src, &image, &size, &threads, &chunk, &samples))
+	{
+		return NULL;
+	}
+
+	if (chunk < DISC_SECTOR_SIZE || chunk % DISC_SECTOR_SIZE != 0)
+	{
+		PyErr_Format(PyExc_ValueError, "Chunk size (%zd) must be a multiple of the 2048 byte sector", chunk);
+		return NULL;
+	}
+	if (threads < 1 || threads > VERIFY_MAXTHREADS)
+	{
+		PyErr_Format(PyExc_ValueError, "Threads (%d) must be between 1 and %d", threads, VERIFY_MAXTHREADS);
+		return NULL;
+	}
+	if (samples < 0)
+	{
+		PyErr_SetString(PyExc_ValueError, "Samples must be non-negative");
+		return NULL;
+	}
+
+	int infd = open(src, O_RDONLY);
+	if (infd < 0)
+	{
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, src);
+	}
+
+	// Devices report their size through lseek() too
+	if (size == 0)
+	{
+		off_t end = lseek(infd, 0, SEEK_END);
+		size = end > 0 ? (unsigned long long)end : 0;
+	}
+
+	VerifyJob job;
+	memset(&job, 0, sizeof(job));
+	job.read = copy_read_fd;
+	job.handle = &infd;
+	job.image = image;
+	job.size = size;
+	job.chunk = chunk;
+	job.threads = threads;
+	job.samples = samples;
+
+	int ret;
+	Py_BEGIN_ALLOW_THREADS
+	ret = verify_run(&job);
+	Py_END_ALLOW_THREADS
+
+	close(infd);
+
+	if (ret < 0)
+	{
+		verify_free(&job);
+		errno = job.err;
+		return PyErr_SetFromErrnoWithFilename(PyExc_OSError, image);
+	}
+
+	uint64_t badsectors, unreadsectors;
+	PyObject *mismatch = _verify_ranges(job.mismatch, job.nummismatch, &badsectors);
+	PyObject *unreadable = _verify_ranges(job.unreadable, job.numunreadable, &unreadsectors);
+	verify_free(&job);
+	if (mismatch == NULL || unreadable == NULL)
+	{
+		Py_XDECREF(mismatch);
+		Py_XDECREF(unreadable);
+		return NULL;
+	}
+
+	return Py_BuildValue("{s:O,s:K,s:K,s:O,s:d,s:d,s:N,s:K,s:N,s:K}",
+		"Match", (badsectors == 0 && unreadsectors == 0) ? Py_True : Py_False,
+		"Size", (unsigned long long)job.size,
+		"Bytes", (unsigned long long)job.bytes,
+		"Sampled", job.sampled ? Py_True : Py_False,
+		"Seconds", job.seconds,
+		"Throughput", job.seconds > 0 ? job.bytes / job.seconds : 0.0,
+		"Mismatches", mismatch,
+		"MismatchSectors", (unsigned long long)badsectors,
+		"Unreadable", unreadable,
+		"UnreadableSectors", (unsigned long long)unreadsectors);
+}
@@ -0,0 +1,136 @@
+#include "bluread.h"
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Zero block detection
+//
+// Disc images carry long runs of zero padding between and after the files.  The sparse
+// writer asks about every block it copies, so the kernels OR whole cache lines together
+// and only test the accumulator once per line; data blocks almost always fail on the
+// first line, zero blocks have to be read to the end either way.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ZEROSCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static int
+_zeroscan_scalar(const uint8_t *buf, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + 64 <= len; i += 64)
+	{
+		uint64_t w[8];
+		memcpy(w, buf + i, sizeof(w));
+		if ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) != 0)
+		{
+			return 0;
+		}
+	}
+
+	for (; i < len; i++)
+	{
+		if (buf[i] != 0) return 0;
+	}
+
+	return 1;
+}
+
+#ifdef ZEROSCAN_X86
+
+// SSE2 is part of x86-64 so this kernel needs no target attribute or CPU check
+static int
+_zeroscan_sse2(const uint8_t *buf, size_t len)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i;
+
+	for (i = 0; i + 64 <= len; i += 64)
+	{
+		const __m128i *p = (const __m128i*)(buf + i);
+		__m128i acc = _mm_or_si128(
+			_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)),
+			_mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF)
+		{
+			return 0;
+		}
+	}
+
+	return _zeroscan_scalar(buf + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static int
+_zeroscan_avx2(const uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i + 128 <= len; i += 128)
+	{
+		const __m256i *p = (const __m256i*)(buf + i);
+		__m256i acc = _mm256_or_si256(
+			_mm256_or_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)),
+			_mm256_or_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+		if (! _mm256_testz_si256(acc, acc))
+		{
+			return 0;
+		}
+	}
+
+	return _zeroscan_scalar(buf + i, len - i);
+}
+
+#endif // ZEROSCAN_X86
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Kernel dispatch
+
+typedef int (*zeroscan_kernel)(const uint8_t*, size_t);
+
+typedef struct {
+	const char *name;
+	zeroscan_kernel func;
+} ZeroScanKernel;
+
+static const ZeroScanKernel zeroscan_kernels[] = {
+#ifdef ZEROSCAN_X86
+	{"avx2", _zeroscan_avx2},
+	{"sse2", _zeroscan_sse2},
+#endif
+	{"scalar", _zeroscan_scalar},
+	{NULL, NULL}
+};
+
+// Best kernel supported by this CPU, picked once by zeroscan_init()
+static const ZeroScanKernel *zeroscan_best = NULL;
+
+void
+zeroscan_init(void)
+{
+	const ZeroScanKernel *k = zeroscan_kernels;
+
+#ifdef ZEROSCAN_X86
+	__builtin_cpu_init();
+	if (! __builtin_cpu_supports("avx2"))
+	{
+		k++;
+	}
+#endif
+
+	zeroscan_best = k;
+}
+
+const char*
+zeroscan_kernel_name(void)
+{
+	return zeroscan_best ? zeroscan_best->name : "scalar";
+}
+
+int
+zeroscan_iszero(const uint8_t *buf, size_t len)
+{
+	return zeroscan_best ? zeroscan_best->func(buf, len) : _zeroscan_scalar(buf, len);
+}
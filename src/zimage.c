@@ -0,0 +1,750 @@
+#include "bluread.h"
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <xxhash.h>
+#include <zstd.h>
+
+// --------------------------------------------------------------------------------
+// --------------------------------------------------------------------------------
+// Seekable zstd images
+//
+// The image is cut into frames of a fixed uncompressed size, each compressed on its own
+// so any of them can be decompressed without the ones before it.  After the last frame a
+// skippable frame holds the seek table (compressed and uncompressed size of every frame,
+// and the low 32 bits of the XXH64 of its data), which is the zstd seekable format, so
+// zstd itself decompresses these images and the contrib seekable tools can read them.
+//
+//   skippable frame: u32 0x184D2A5E, u32 size of what follows
+//   per frame:       u32 compressed size, u32 uncompressed size, u32 checksum
+//   footer:          u32 number of frames, u8 descriptor (0x80 = checksums), u32 0x8F92EAB1
+//
+// Frames are compressed by a pool of threads while the copy carries on, and written out
+// strictly in order by whichever thread hands in data, so the output may be a pipe.
+
+#define ZIMAGE_SKIPPABLE_MAGIC 0x184D2A5E
+#define ZIMAGE_SEEKABLE_MAGIC 0x8F92EAB1
+#define ZIMAGE_FOOTER_SIZE 9
+#define ZIMAGE_CHECKSUM_FLAG 0x80
+#define ZIMAGE_CACHE_FRAMES 8
+
+static void
+_zimage_put32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+static uint32_t
+_zimage_get32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// --------------------------------------------------------------------------------
+// Writer
+
+enum { ZFRAME_FREE, ZFRAME_QUEUED, ZFRAME_DONE };
+
+typedef struct {
+	int state;
+	uint8_t *in;
+	size_t inlen;
+	uint8_t *out;
+	size_t outlen;
+	uint32_t checksum;
+	int err;
+} ZFrame;
+
+struct ZImageWriter {
+	int fd;
+	int level;
+	size_t framesize;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t threads[ZIMAGE_MAXTHREADS];
+	int numthreads;
+	int stop;
+
+	// Frame @seq uses frames[seq % numframes]
+	ZFrame *frames;
+	unsigned numframes;
+	uint64_t submitted; // frames handed to the pool, the one after is being filled
+	uint64_t taken;     // frames a thread has started on
+	uint64_t flushed;   // frames written out
+
+	uint8_t *table; // seek table entries of the flushed frames
+	size_t tablelen, tablemax;
+
+	uint64_t insize;
+	uint64_t outsize;
+	int err;
+};
+
+static void*
+_zimage_worker(void *arg)
+{
+	ZImageWriter *w = arg;
+	ZSTD_CCtx *cctx = ZSTD_createCCtx();
+
+	if (cctx != NULL)
+	{
+		ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, w->level);
+		ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+	}
+
+	pthread_mutex_lock(&w->lock);
+	while (1)
+	{
+		while (w->taken == w->submitted && !w->stop)
+		{
+			pthread_cond_wait(&w->cond, &w->lock);
+		}
+		if (w->taken == w->submitted)
+		{
+			break;
+		}
+
+		ZFrame *f = &w->frames[w->taken % w->numframes];
+		w->taken++;
+		pthread_mutex_unlock(&w->lock);
+
+		f->checksum = (uint32_t)XXH64(f->in, f->inlen, 0);
+		if (cctx == NULL)
+		{
+			f->err = ENOMEM;
+		}
+		else
+		{
+			size_t n = ZSTD_compress2(cctx, f->out, ZSTD_compressBound(w->framesize), f->in, f->inlen);
+			if (ZSTD_isError(n))
+			{
+				f->err = EIO;
+			}
+			else
+			{
+				f->outlen = n;
+			}
+		}
+
+		pthread_mutex_lock(&w->lock);
+		f->state = ZFRAME_DONE;
+		pthread_cond_broadcast(&w->cond);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	ZSTD_freeCCtx(cctx);
+	return NULL;
+}
+
+static int
+_zimage_put(ZImageWriter *w, const uint8_t *buf, size_t len)
+{
+	size_t put = 0;
+	while (put < len)
+	{
+		ssize_t n = write(w->fd, buf + put, len - put);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		put += n;
+	}
+
+	w->outsize += len;
+	return 0;
+}
+
+// Writes out the oldest compressed frame, waiting for it when @wait is set, returns 1 if
+// one was written, 0 if none was ready and -1 on errors
+static int
+_zimage_flush(ZImageWriter *w, int wait)
+{
+	if (w->flushed == w->submitted)
+	{
+		return 0;
+	}
+
+	ZFrame *f = &w->frames[w->flushed % w->numframes];
+
+	pthread_mutex_lock(&w->lock);
+	while (f->state != ZFRAME_DONE && wait)
+	{
+		pthread_cond_wait(&w->cond, &w->lock);
+	}
+	int ready = (f->state == ZFRAME_DONE);
+	pthread_mutex_unlock(&w->lock);
+
+	if (! ready)
+	{
+		return 0;
+	}
+
+	if (f->err)
+	{
+		errno = f->err;
+		return -1;
+	}
+
+	if (w->tablelen + 12 > w->tablemax)
+	{
+		size_t n = w->tablemax ? w->tablemax * 2 : 12 * 4096;
+		uint8_t *tmp = realloc(w->table, n);
+		if (tmp == NULL)
+		{
+			errno = ENOMEM;
+			return -1;
+		}
+		w->table = tmp;
+		w->tablemax = n;
+	}
+
+	if (_zimage_put(w, f->out, f->outlen) < 0)
+	{
+		return -1;
+	}
+
+	_zimage_put32(w->table + w->tablelen, (uint32_t)f->outlen);
+	_zimage_put32(w->table + w->tablelen + 4, (uint32_t)f->inlen);
+	_zimage_put32(w->table + w->tablelen + 8, f->checksum);
+	w->tablelen += 12;
+
+	f->state = ZFRAME_FREE;
+	f->inlen = 0;
+	f->outlen = 0;
+	w->flushed++;
+
+	return 1;
+}
+
+static int
+_zimage_submit(ZImageWriter *w)
+{
+	ZFrame *f = &w->frames[w->submitted % w->numframes];
+
+	pthread_mutex_lock(&w->lock);
+	f->state = ZFRAME_QUEUED;
+	w->submitted++;
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+
+	// Keep the output moving with whatever is already compressed
+	int n;
+	while ((n = _zimage_flush(w, 0)) > 0) ;
+
+	return n;
+}
+
+ZImageWriter*
+zimage_open(int fd, int level, int threads, size_t framesize)
+{
+	ZImageWriter *w = calloc(1, sizeof(ZImageWriter));
+	unsigned i;
+
+	if (w == NULL)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (threads < 1) threads = 1;
+	if (threads > ZIMAGE_MAXTHREADS) threads = ZIMAGE_MAXTHREADS;
+
+	w->fd = fd;
+	w->level = level;
+	w->framesize = framesize;
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->cond, NULL);
+
+	// Two frames per thread, one being compressed while the next one fills
+	w->numframes = 2 * threads;
+	w->frames = calloc(w->numframes, sizeof(ZFrame));
+	if (w->frames == NULL)
+	{
+		zimage_free(w);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	for (i = 0; i < w->numframes; i++)
+	{
+		w->frames[i].in = malloc(framesize);
+		w->frames[i].out = malloc(ZSTD_compressBound(framesize));
+		if (w->frames[i].in == NULL || w->frames[i].out == NULL)
+		{
+			zimage_free(w);
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+
+	while (w->numthreads < threads)
+	{
+		if (pthread_create(&w->threads[w->numthreads], NULL, _zimage_worker, w) != 0)
+		{
+			break;
+		}
+		w->numthreads++;
+	}
+	if (w->numthreads == 0)
+	{
+		zimage_free(w);
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	return w;
+}
+
+int
+zimage_write(ZImageWriter *w, const uint8_t *buf, size_t len)
+{
+	if (w->err)
+	{
+		errno = w->err;
+		return -1;
+	}
+
+	while (len > 0)
+	{
+		ZFrame *f = &w->frames[w->submitted % w->numframes];
+
+		// The frame to fill is still in use while every frame is queued or compressed
+		if (w->submitted - w->flushed == w->numframes && _zimage_flush(w, 1) < 0)
+		{
+			w->err = errno;
+			return -1;
+		}
+
+		size_t n = w->framesize - f->inlen;
+		if (n > len)
+		{
+			n = len;
+		}
+		memcpy(f->in + f->inlen, buf, n);
+		f->inlen += n;
+		w->insize += n;
+		buf += n;
+		len -= n;
+
+		if (f->inlen == w->framesize && _zimage_submit(w) < 0)
+		{
+			w->err = errno;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+zimage_finish(ZImageWriter *w)
+{
+	if (w->err)
+	{
+		errno = w->err;
+		return -1;
+	}
+
+	ZFrame *f = &w->frames[w->submitted % w->numframes];
+	if (f->inlen > 0 && _zimage_submit(w) < 0)
+	{
+		goto error;
+	}
+
+	while (w->flushed < w->submitted)
+	{
+		if (_zimage_flush(w, 1) < 0)
+		{
+			goto error;
+		}
+	}
+
+	uint64_t frames = w->tablelen / 12;
+	uint8_t head[8], foot[ZIMAGE_FOOTER_SIZE];
+	_zimage_put32(head, ZIMAGE_SKIPPABLE_MAGIC);
+	_zimage_put32(head + 4, (uint32_t)(w->tablelen + ZIMAGE_FOOTER_SIZE));
+	_zimage_put32(foot, (uint32_t)frames);
+	foot[4] = ZIMAGE_CHECKSUM_FLAG;
+	_zimage_put32(foot + 5, ZIMAGE_SEEKABLE_MAGIC);
+
+	if (_zimage_put(w, head, sizeof(head)) < 0 ||
+		_zimage_put(w, w->table, w->tablelen) < 0 ||
+		_zimage_put(w, foot, sizeof(foot)) < 0)
+	{
+		goto error;
+	}
+
+	return 0;
+
+error:
+	w->err = errno;
+	return -1;
+}
+
+void
+zimage_stats(const ZImageWriter *w, uint64_t *frames, uint64_t *insize, uint64_t *outsize)
+{
+	*frames = w->tablelen / 12;
+	*insize = w->insize;
+	*outsize = w->outsize;
+}
+
+void
+zimage_free(ZImageWriter *w)
+{
+	unsigned i;
+
+	if (w == NULL)
+	{
+		return;
+	}
+
+	if (w->numthreads > 0)
+	{
+		pthread_mutex_lock(&w->lock);
+		w->stop = 1;
+		pthread_cond_broadcast(&w->cond);
+		pthread_mutex_unlock(&w->lock);
+
+		for (i = 0; i < (unsigned)w->numthreads; i++)
+		{
+			pthread_join(w->threads[i], NULL);
+		}
+	}
+	pthread_cond_destroy(&w->cond);
+	pthread_mutex_destroy(&w->lock);
+
+	for (i = 0; w->frames && i < w->numframes; i++)
+	{
+		free(w->frames[i].in);
+		free(w->frames[i].out);
+	}
+	free(w->frames);
+	free(w->table);
+	free(w);
+}
+
+// --------------------------------------------------------------------------------
+// Reader
+//
+// A BlockSource over a seekable image.  Recently decompressed frames are kept so the
+// small scattered reads of UDF and BDMV parsing do not decompress a frame every time.
+
+typedef struct {
+	int64_t frame; // -1 when empty
+	uint64_t used;
+	uint8_t *data;
+} ZCacheSlot;
+
+typedef struct {
+	int fd;
+	uint64_t numframes;
+	uint64_t *compoff; // numframes+1 offsets into the file
+	uint64_t *rawoff;  // numframes+1 offsets into the image
+	uint32_t *checksums;
+	size_t maxframe;
+
+	pthread_mutex_t lock;
+	ZSTD_DCtx *dctx;
+	uint8_t *comp;
+	ZCacheSlot cache[ZIMAGE_CACHE_FRAMES];
+	uint64_t clock;
+} ZImageReader;
+
+static int
+_zimage_pread(int fd, uint8_t *buf, size_t len, uint64_t offset)
+{
+	size_t got = 0;
+	while (got < len)
+	{
+		ssize_t n = pread(fd, buf + got, len - got, (off_t)(offset + got));
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return -1;
+		if (n == 0)
+		{
+			errno = EIO;
+			return -1;
+		}
+		got += n;
+	}
+
+	return 0;
+}
+
+// Decompressed frame @i, called with the lock held
+static const uint8_t*
+_zimage_frame(ZImageReader *z, uint64_t i)
+{
+	ZCacheSlot *slot = &z->cache[0];
+	int k;
+
+	for (k = 0; k < ZIMAGE_CACHE_FRAMES; k++)
+	{
+		if (z->cache[k].frame == (int64_t)i)
+		{
+			z->cache[k].used = ++z->clock;
+			return z->cache[k].data;
+		}
+		if (z->cache[k].used < slot->used)
+		{
+			slot = &z->cache[k];
+		}
+	}
+
+	size_t complen = z->compoff[i+1] - z->compoff[i];
+	size_t rawlen = z->rawoff[i+1] - z->rawoff[i];
+
+	if (slot->data == NULL)
+	{
+		slot->data = malloc(z->maxframe);
+		if (slot->data == NULL)
+		{
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+	slot->frame = -1;
+
+	if (_zimage_pread(z->fd, z->comp, complen, z->compoff[i]) < 0)
+	{
+		return NULL;
+	}
+
+	size_t n = ZSTD_decompressDCtx(z->dctx, slot->data, rawlen, z->comp, complen);
+	if (ZSTD_isError(n) || n != rawlen || (z->checksums && (uint32_t)XXH64(slot->data, rawlen, 0) != z->checksums[i]))
+	{
+		errno = EIO;
+		return NULL;
+	}
+
+	slot->frame = i;
+	slot->used = ++z->clock;
+	return slot->data;
+}
+
+static int
+_zimage_read(BlockSource *src, uint8_t *buf, uint64_t lba, uint32_t num)
+{
+	ZImageReader *z = src->handle;
+	uint64_t offset = lba * DISC_SECTOR_SIZE;
+	uint64_t end = offset + (uint64_t)num * DISC_SECTOR_SIZE;
+	uint64_t size = z->rawoff[z->numframes];
+
+	if (offset >= size)
+	{
+		return 0;
+	}
+	if (end > size)
+	{
+		end = size - (size - offset) % DISC_SECTOR_SIZE;
+	}
+
+	// Frame holding @offset, by bisection of the uncompressed offsets
+	uint64_t lo = 0, hi = z->numframes;
+	while (hi - lo > 1)
+	{
+		uint64_t mid = (lo + hi) / 2;
+		if (z->rawoff[mid] <= offset) lo = mid; else hi = mid;
+	}
+
+	uint64_t pos = offset;
+	pthread_mutex_lock(&z->lock);
+	while (pos < end)
+	{
+		const uint8_t *data = _zimage_frame(z, lo);
+		if (data == NULL)
+		{
+			pthread_mutex_unlock(&z->lock);
+			return -1;
+		}
+
+		uint64_t stop = z->rawoff[lo+1] < end ? z->rawoff[lo+1] : end;
+		memcpy(buf + (pos - offset), data + (pos - z->rawoff[lo]), stop - pos);
+		pos = stop;
+		lo++;
+	}
+	pthread_mutex_unlock(&z->lock);
+
+	return (int)((end - offset) / DISC_SECTOR_SIZE);
+}
+
+static void
+_zimage_close(BlockSource *src)
+{
+	ZImageReader *z = src->handle;
+	int k;
+
+	if (z != NULL)
+	{
+		for (k = 0; k < ZIMAGE_CACHE_FRAMES; k++)
+		{
+			free(z->cache[k].data);
+		}
+		ZSTD_freeDCtx(z->dctx);
+		pthread_mutex_destroy(&z->lock);
+		free(z->comp);
+		free(z->compoff);
+		free(z->rawoff);
+		free(z->checksums);
+		if (z->fd >= 0) close(z->fd);
+		free(z);
+	}
+	free(src);
+}
+
+// Reads the footer of @fd, returns the number of frames and the descriptor or -1 if it is no seekable image
+static int64_t
+_zimage_footer(int fd, uint64_t size, int *descriptor)
+{
+	uint8_t foot[ZIMAGE_FOOTER_SIZE];
+
+	if (size < 8 + ZIMAGE_FOOTER_SIZE || _zimage_pread(fd, foot, sizeof(foot), size - sizeof(foot)) < 0)
+	{
+		return -1;
+	}
+	if (_zimage_get32(foot + 5) != ZIMAGE_SEEKABLE_MAGIC || (foot[4] & 0x7C) != 0)
+	{
+		return -1;
+	}
+
+	*descriptor = foot[4];
+	return _zimage_get32(foot);
+}
+
+int
+zimage_probe(const char *path)
+{
+	struct stat st;
+	int descriptor;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return 0;
+	}
+
+	// Only images, reading the end of a drive would spin it up for nothing
+	int ret = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && _zimage_footer(fd, st.st_size, &descriptor) >= 0);
+	close(fd);
+
+	return ret;
+}
+
+BlockSource*
+source_open_zstd(const char *path)
+{
+	BlockSource *src = calloc(1, sizeof(BlockSource));
+	ZImageReader *z = calloc(1, sizeof(ZImageReader));
+	uint8_t *table = NULL;
+	struct stat st;
+	int descriptor, k;
+	int err = EINVAL;
+
+	if (src == NULL || z == NULL)
+	{
+		free(src);
+		free(z);
+		errno = ENOMEM;
+		return NULL;
+	}
+	src->fd = -1;
+	src->handle = z;
+	src->read = _zimage_read;
+	src->close = _zimage_close;
+	pthread_mutex_init(&z->lock, NULL);
+	for (k = 0; k < ZIMAGE_CACHE_FRAMES; k++)
+	{
+		z->cache[k].frame = -1;
+	}
+
+	z->fd = open(path, O_RDONLY);
+	if (z->fd < 0 || fstat(z->fd, &st) < 0)
+	{
+		err = errno;
+		goto error;
+	}
+
+	int64_t frames = _zimage_footer(z->fd, st.st_size, &descriptor);
+	if (frames < 0)
+	{
+		goto error;
+	}
+
+	size_t entry = (descriptor & ZIMAGE_CHECKSUM_FLAG) ? 12 : 8;
+	uint64_t tablelen = (uint64_t)frames * entry;
+	if (tablelen + ZIMAGE_FOOTER_SIZE + 8 > (uint64_t)st.st_size)
+	{
+		goto error;
+	}
+
+	uint64_t tableoff = st.st_size - ZIMAGE_FOOTER_SIZE - tablelen;
+	uint8_t head[8];
+	table = malloc(tablelen ? tablelen : 1);
+	if (table == NULL)
+	{
+		err = ENOMEM;
+		goto error;
+	}
+	if (_zimage_pread(z->fd, head, sizeof(head), tableoff - 8) < 0 || _zimage_pread(z->fd, table, tablelen, tableoff) < 0)
+	{
+		err = errno;
+		goto error;
+	}
+	if (_zimage_get32(head) != ZIMAGE_SKIPPABLE_MAGIC || _zimage_get32(head + 4) != tablelen + ZIMAGE_FOOTER_SIZE)
+	{
+		goto error;
+	}
+
+	z->numframes = frames;
+	z->compoff = calloc(frames + 1, sizeof(uint64_t));
+	z->rawoff = calloc(frames + 1, sizeof(uint64_t));
+	if (entry == 12)
+	{
+		z->checksums = calloc(frames ? frames : 1, sizeof(uint32_t));
+	}
+	if (z->compoff == NULL || z->rawoff == NULL || (entry == 12 && z->checksums == NULL))
+	{
+		err = ENOMEM;
+		goto error;
+	}
+
+	size_t maxcomp = 0;
+	int64_t i;
+	for (i = 0; i < frames; i++)
+	{
+		const uint8_t *e = table + i * entry;
+		uint32_t complen = _zimage_get32(e);
+		uint32_t rawlen = _zimage_get32(e + 4);
+
+		z->compoff[i+1] = z->compoff[i] + complen;
+		z->rawoff[i+1] = z->rawoff[i] + rawlen;
+		if (z->checksums) z->checksums[i] = _zimage_get32(e + 8);
+		if (complen > maxcomp) maxcomp = complen;
+		if (rawlen > z->maxframe) z->maxframe = rawlen;
+	}
+	if (z->compoff[frames] > tableoff - 8)
+	{
+		goto error;
+	}
+
+	z->comp = malloc(maxcomp ? maxcomp : 1);
+	z->dctx = ZSTD_createDCtx();
+	if (z->comp == NULL || z->dctx == NULL)
+	{
+		err = ENOMEM;
+		goto error;
+	}
+
+	free(table);
+	src->blocks = z->rawoff[frames] / DISC_SECTOR_SIZE;
+	return src;
+
+error:
+	free(table);
+	_zimage_close(src);
+	errno = err;
+	return NULL;
+}
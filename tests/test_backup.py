@@ -0,0 +1,146 @@
+"""
+Backup tests over crafted UDF images: names on a disc are not to be trusted, and packets a
+disc's sparing table moved are read from where they went.
+Run with python3 -m unittest discover tests after building the extension in place.
+"""
+
+import os
+import struct
+import sys
+import tempfile
+import unittest
+
+import _bluread
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'bench'))
+import fixtures
+
+
+class TraversalTest(unittest.TestCase):
+	def setUp(self):
+		self.tmp = tempfile.TemporaryDirectory()
+		self.addCleanup(self.tmp.cleanup)
+
+	def _image(self, files, rename):
+		"""
+		Writes @files ({path: data}) into a UDF image whose directory entries call the
+		placeholder names in @rename by the names given there instead.
+		"""
+		tree = os.path.join(self.tmp.name, 'tree')
+		for rel, data in files.items():
+			path = os.path.join(tree, rel)
+			os.makedirs(os.path.dirname(path), exist_ok=True)
+			with open(path, 'wb') as f:
+				f.write(data)
+
+		image = os.path.join(self.tmp.name, 'hostile.iso')
+		fid = fixtures._fid
+		fixtures._fid = lambda name, *args, **kwargs: fid(rename.get(name, name), *args, **kwargs)
+		try:
+			fixtures.WriteUDF(tree, image)
+		finally:
+			fixtures._fid = fid
+
+		return image
+
+	def _backup(self, image):
+		"""Backs @image up one level below a directory of its own, returns the files each holds"""
+		outer = os.path.join(self.tmp.name, 'outer')
+		dst = os.path.join(outer, 'dst')
+		os.makedirs(dst)
+
+		_bluread.Backup(image, dst)
+
+		def files(root):
+			return sorted(os.path.relpath(os.path.join(d, f), root) for d, _, names in os.walk(root) for f in names)
+		return files(outer), files(dst)
+
+	def _check(self, placeholder, name, hostile):
+		image = self._image({'BDMV/GOOD': b'good' * 1000, hostile: b'hostile' * 1000}, {placeholder: name})
+		outer, inside = self._backup(image)
+
+		# Everything written is under dst, and the entry that named its way out is left out
+		self.assertEqual(outer, ['dst/' + f for f in inside])
+		self.assertEqual(inside, ['BDMV/GOOD'])
+
+	def test_parent(self):
+		# dst/../ESCAPED
+		self._check('UP', '..', 'UP/ESCAPED')
+
+	def test_current(self):
+		# dst/./ALIAS, the same directory under a second name
+		self._check('HERE', '.', 'HERE/ALIAS')
+
+	def test_empty(self):
+		# dst/ itself as a file
+		self._check('NONAME', '', 'BDMV/NONAME')
+
+
+class SparingTest(unittest.TestCase):
+	PACKET = 32
+
+	def setUp(self):
+		self.tmp = tempfile.TemporaryDirectory()
+		self.addCleanup(self.tmp.cleanup)
+
+	def _image(self, data):
+		"""
+		Writes @data as BDMV/DATA into an image whose physical partition map is sparable,
+		with a packet of it moved to a spare area after the partition. Returns its path.
+		"""
+		tree = os.path.join(self.tmp.name, 'tree')
+		os.makedirs(os.path.join(tree, 'BDMV'))
+		with open(os.path.join(tree, 'BDMV', 'DATA'), 'wb') as f:
+			f.write(data)
+		image = os.path.join(self.tmp.name, 'sparable.iso')
+		total = fixtures.WriteUDF(tree, image) // fixtures.SECTOR
+
+		S = fixtures.SECTOR
+		P = 288
+		with open(image, 'r+b') as f:
+			disc = bytearray(f.read())
+
+			# The first packet that lies wholly in the file, moved to the sectors after the sparing table
+			first = disc.index(data[:S]) // S - P
+			orig = (first + self.PACKET - 1) // self.PACKET * self.PACKET
+			table, spare = total, total + 1
+
+			entries = struct.pack('<IIII', orig, spare, 0xFFFFFFF0, spare + self.PACKET)
+			body = bytearray(56)
+			body[16:48] = fixtures._regid('*UDF Sparing Table', fixtures._UDF250)
+			struct.pack_into('<HHI', body, 48, 2, 0, 0)
+			f.seek(table * S)
+			f.write(fixtures._tag(0, table, bytes(body) + entries))
+			f.seek(spare * S)
+			f.write(disc[(P + orig) * S:(P + orig + self.PACKET) * S])
+			f.seek((P + orig) * S)
+			f.write(b'\xAA' * (self.PACKET * S))
+
+			# Swap the type 1 map for a sparable one, in both volume descriptor sequences
+			m = bytearray(64)
+			m[0:2] = bytes([2, 64])
+			m[4:36] = fixtures._regid('*UDF Sparable Partition', fixtures._UDF250)
+			struct.pack_into('<HHHBBII', m, 36, 1, 0, self.PACKET, 1, 0, S, table)
+			for lba in (35, 51):
+				lvd = bytearray(disc[lba * S:lba * S + 440 + 70])
+				lvd = lvd[:440] + m + lvd[446:]
+				struct.pack_into('<I', lvd, 264, 128)
+				f.seek(lba * S)
+				f.write(fixtures._tag(6, lba, bytes(lvd[:440 + 128])))
+
+		return image
+
+	def test_remapped(self):
+		data = b''.join(struct.pack('<I', 0xB1D00000 + i) * (fixtures.SECTOR // 4) for i in range(4 * self.PACKET))
+		image = self._image(data)
+
+		dst = os.path.join(self.tmp.name, 'dst')
+		os.makedirs(dst)
+		_bluread.Backup(image, dst)
+
+		with open(os.path.join(dst, 'BDMV', 'DATA'), 'rb') as f:
+			self.assertEqual(f.read(), data)
+
+
+if __name__ == '__main__':
+	unittest.main()
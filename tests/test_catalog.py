@@ -0,0 +1,61 @@
+"""
+Catalog tests that need no disc: an empty catalog is still a valid one.
+Run with python3 -m unittest discover tests after building the extension in place.
+"""
+
+import multiprocessing
+import os
+import subprocess
+import sys
+import time
+import unittest
+
+import bluread
+
+
+def _attach(name):
+	c = bluread.Catalog.Attach(name)
+	assert len(c) == 0
+
+
+@unittest.skipUnless(os.path.isdir('/dev/shm'), "needs POSIX shared memory in /dev/shm")
+class AttachTest(unittest.TestCase):
+	def _segment(self, name):
+		return os.path.exists('/dev/shm/' + name.lstrip('/'))
+
+	def _check(self, run):
+		c = bluread.Catalog.Create([])
+		try:
+			self.assertEqual(run(c.Name), 0)
+
+			# The child attached and exited, the segment belongs to this process still.  A tracker left
+			# holding it cleans up after the child is gone, give it time to do so
+			deadline = time.monotonic() + 1.0
+			while self._segment(c.Name) and time.monotonic() < deadline:
+				time.sleep(0.05)
+			self.assertTrue(self._segment(c.Name))
+			self.assertEqual(len(bluread.Catalog.Attach(c.Name)), 0)
+		finally:
+			c.Unlink()
+		self.assertFalse(self._segment(c.Name))
+
+	def _process(self, method, name):
+		p = multiprocessing.get_context(method).Process(target=_attach, args=(name,))
+		p.start()
+		p.join()
+		return p.exitcode
+
+	def test_fork(self):
+		self._check(lambda name: self._process('fork', name))
+
+	def test_spawn(self):
+		self._check(lambda name: self._process('spawn', name))
+
+	def test_unrelated(self):
+		# Another interpreter has a resource tracker of its own, which unlinks what is registered with it on exit
+		code = "import sys, bluread; bluread.Catalog.Attach(sys.argv[1])"
+		self._check(lambda name: subprocess.run([sys.executable, '-c', code, name]).returncode)
+
+
+if __name__ == '__main__':
+	unittest.main()